@@ -110,6 +110,10 @@ Postgres CMake build options
 
 **-DWITH_ICU** default OFF, optional
 
+**-DWITH_LZ4** default OFF, optional
+
+**-DWITH_ZSTD** default OFF, optional
+
 **-DENABLE_NLS** default OFF
 
 **-DENABLE_GSS** default OFF
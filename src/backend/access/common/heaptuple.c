@@ -1066,6 +1066,47 @@ slot_deform_tuple(TupleTableSlot *slot, int natts)
 
 	tp = (char *) tup + tup->t_hoff;
 
+	/*
+	 * If the slot has a deform program, fetch the leading fixed-width
+	 * attributes straight from their precomputed offsets.  That's only valid
+	 * if none of them can be null: either the tuple has no nulls at all, or
+	 * the attributes are declared NOT NULL.
+	 */
+	if (attnum == 0 && slot->tts_deform != NULL)
+	{
+		TupleDeformProgram *prog = slot->tts_deform;
+		int			nfast = hasnulls ? prog->nnotnull : prog->nfixed;
+
+		nfast = Min(nfast, natts);
+		for (; attnum < nfast; attnum++)
+		{
+			DeformAttr *dattr = &prog->attrs[attnum];
+			char	   *attp = tp + dattr->off;
+
+			isnull[attnum] = false;
+			switch ((DeformFetch) dattr->fetch)
+			{
+				case DEFORM_FETCH_CHAR:
+					values[attnum] = CharGetDatum(*attp);
+					break;
+				case DEFORM_FETCH_INT16:
+					values[attnum] = Int16GetDatum(*(int16 *) attp);
+					break;
+				case DEFORM_FETCH_INT32:
+					values[attnum] = Int32GetDatum(*(int32 *) attp);
+					break;
+				case DEFORM_FETCH_DATUM:
+					values[attnum] = *(Datum *) attp;
+					break;
+				case DEFORM_FETCH_POINTER:
+					values[attnum] = PointerGetDatum(attp);
+					break;
+			}
+		}
+		if (attnum > 0)
+			off = prog->attrs[attnum - 1].off + prog->attrs[attnum - 1].len;
+	}
+
 	for (; attnum < natts; attnum++)
 	{
 		Form_pg_attribute thisatt = att[attnum];
@@ -23,6 +23,7 @@
 #include "access/nbtree.h"
 #include "access/reloptions.h"
 #include "access/spgist.h"
+#include "access/tuptoaster.h"
 #include "catalog/pg_type.h"
 #include "commands/defrem.h"
 #include "commands/tablespace.h"
@@ -420,6 +421,18 @@ static relopt_string stringRelOpts[] =
 		validateWithCheckOption,
 		NULL
 	},
+	{
+		{
+			"compression",
+			"Sets the method used to compress values of a column.",
+			RELOPT_KIND_ATTRIBUTE,
+			ShareUpdateExclusiveLock
+		},
+		0,
+		true,
+		ValidateCompressionMethod,
+		NULL
+	},
 	/* list terminator */
 	{{NULL}}
 };
@@ -1466,7 +1479,8 @@ attribute_reloptions(Datum reloptions, bool validate)
 	int			numoptions;
 	static const relopt_parse_elt tab[] = {
 		{"n_distinct", RELOPT_TYPE_REAL, offsetof(AttributeOpts, n_distinct)},
-		{"n_distinct_inherited", RELOPT_TYPE_REAL, offsetof(AttributeOpts, n_distinct_inherited)}
+		{"n_distinct_inherited", RELOPT_TYPE_REAL, offsetof(AttributeOpts, n_distinct_inherited)},
+		{"compression", RELOPT_TYPE_STRING, offsetof(AttributeOpts, compression_offset)}
 	};
 
 	options = parseRelOptions(reloptions, validate, RELOPT_KIND_ATTRIBUTE,
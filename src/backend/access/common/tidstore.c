@@ -0,0 +1,506 @@
+/*-------------------------------------------------------------------------
+ *
+ * tidstore.c
+ *	  Compact storage for a set of TIDs, such as vacuum's dead tuples.
+ *
+ * A TidStore holds the offsets of the TIDs of each block in one of two
+ * forms, whichever is smaller: a sorted array of offset numbers, or a bitmap
+ * with one bit per offset up to the highest one present.  Either way they're
+ * stored as 16-bit words, so that a block full of dead heap tuples takes
+ * only a few dozen bytes, where a plain array of ItemPointers would need six
+ * bytes per tuple.
+ *
+ * To find a block's offsets quickly without searching, blocks are grouped
+ * into chunks of 64.  Each chunk has a bitmap of the blocks present in it,
+ * and the index of its first block's entry; a block's entry is found by
+ * counting the bits set before it.  This directory covers every block of
+ * the relation, but needs only a quarter byte per block.
+ *
+ * Blocks must be added in ascending block number order, and all of a
+ * block's offsets at once; that's how vacuum finds them anyway.  A store
+ * has a fixed size, given when it's created along with the highest offset
+ * it needs to hold, and TidStoreIsFull tells when there might not be room
+ * for another block.
+ *
+ * The store is a single allocation, without any internal pointers.  The
+ * block entries are at the start of the space following the directory, and
+ * grow upwards; the offsets are at the end, and grow downwards.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/common/tidstore.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/tidstore.h"
+#include "utils/memutils.h"
+
+
+#define TIDSTORE_CHUNK_BLOCKS	64
+
+/*
+ * A block entry is the index of the first word of the block's offsets in
+ * the data area, with the high bit set if they're stored as a bitmap.  The
+ * number of words is implied by where the previous block's offsets start.
+ */
+#define TIDSTORE_ENTRY_BITMAP	((uint32) 0x80000000)
+#define TIDSTORE_ENTRY_START	((uint32) 0x7FFFFFFF)
+
+#define TIDSTORE_WORD_BITS		16
+
+typedef struct TidStoreChunk
+{
+	uint64		blocks;			/* bit i is set if block chunkno * 64 + i is
+								 * present */
+	uint32		first;			/* index of the entry of its first block */
+} TidStoreChunk;
+
+struct TidStore
+{
+	Size		size;			/* total size of the store */
+	BlockNumber nblocks;		/* blocks covered by the directory */
+	OffsetNumber max_offset;	/* highest offset allowed */
+	uint32		nchunks;		/* number of directory chunks */
+	uint32		nentries;		/* number of blocks stored */
+	uint32		area_words;		/* size of the area after the directory */
+	uint32		data_start;		/* first word used by offsets */
+	BlockNumber last_block;		/* last block added, or InvalidBlockNumber */
+	int64		num_tids;		/* number of TIDs stored */
+	TidStoreChunk chunks[FLEXIBLE_ARRAY_MEMBER];
+};
+
+struct TidStoreIter
+{
+	TidStore   *ts;
+	uint32		chunkno;		/* current chunk */
+	int			bit;			/* next block to look at within the chunk */
+	uint32		entryno;		/* entry of that block, if present */
+	TidStoreIterResult result;
+};
+
+#define TidStoreAreaOffset(nchunks) \
+	MAXALIGN(offsetof(TidStore, chunks) + (nchunks) * sizeof(TidStoreChunk))
+
+/* Block entries, and the offsets they point to */
+#define TidStoreEntries(ts) \
+	((uint32 *) ((char *) (ts) + TidStoreAreaOffset((ts)->nchunks)))
+#define TidStoreWords(ts) \
+	((uint16 *) ((char *) (ts) + TidStoreAreaOffset((ts)->nchunks)))
+
+static inline int
+tidstore_popcount64(uint64 word)
+{
+	word = word - ((word >> 1) & UINT64CONST(0x5555555555555555));
+	word = (word & UINT64CONST(0x3333333333333333)) +
+		((word >> 2) & UINT64CONST(0x3333333333333333));
+	word = (word + (word >> 4)) & UINT64CONST(0x0F0F0F0F0F0F0F0F);
+	return (int) ((word * UINT64CONST(0x0101010101010101)) >> 56);
+}
+
+/*
+ * Number of words used by block entry 'entryno'.
+ */
+static inline uint32
+tidstore_entry_words(TidStore *ts, uint32 *entries, uint32 entryno)
+{
+	uint32		end;
+
+	end = (entryno == 0) ? ts->area_words :
+		(entries[entryno - 1] & TIDSTORE_ENTRY_START);
+	return end - (entries[entryno] & TIDSTORE_ENTRY_START);
+}
+
+/*
+ * Number of bytes a block may take, if all its offsets are at most
+ * 'max_offset'.
+ */
+static inline Size
+tidstore_block_size(OffsetNumber max_offset)
+{
+	return sizeof(uint32) +
+		(max_offset / TIDSTORE_WORD_BITS + 1) * sizeof(uint16);
+}
+
+/*
+ * TidStoreMaxSize
+ *		How large must a store be to hold every TID of nblocks blocks, if
+ *		their offsets are at most 'max_offset'?
+ */
+Size
+TidStoreMaxSize(BlockNumber nblocks, OffsetNumber max_offset)
+{
+	return TidStoreAreaOffset(nblocks / TIDSTORE_CHUNK_BLOCKS + 1) +
+		(Size) (nblocks + 1) * tidstore_block_size(max_offset);
+}
+
+/*
+ * TidStoreEstimate
+ *		Size of a store using at most 'max_bytes' bytes, for TIDs of blocks
+ *		0 to nblocks - 1 with offsets up to 'max_offset'.
+ *
+ * The result may be larger than MaxAllocSize.  If max_bytes is too small to
+ * hold even one block, it's a bit more than that.
+ */
+Size
+TidStoreEstimate(Size max_bytes, BlockNumber nblocks, OffsetNumber max_offset)
+{
+	Size		area_offset;
+	Size		area_bytes;
+
+	area_offset = TidStoreAreaOffset(nblocks / TIDSTORE_CHUNK_BLOCKS + 1);
+
+	area_bytes = (max_bytes > area_offset) ? max_bytes - area_offset : 0;
+	area_bytes = Max(area_bytes,
+					 TYPEALIGN(sizeof(uint32), tidstore_block_size(max_offset)));
+	/* the entries can only address this many words */
+	area_bytes = Min(area_bytes,
+					 (Size) TIDSTORE_ENTRY_START * sizeof(uint16));
+	area_bytes = Min(area_bytes, MaxAllocHugeSize - area_offset);
+	area_bytes &= ~((Size) sizeof(uint32) - 1);
+
+	return area_offset + area_bytes;
+}
+
+/*
+ * TidStoreInitialize
+ *		Initialize an empty store in 'size' bytes at 'place', which must be
+ *		MAXALIGNed.
+ *
+ * 'size' should come from TidStoreEstimate with the same nblocks and
+ * max_offset.  Since the store contains no pointers, it can be placed in
+ * shared memory and read by other processes, as long as nobody modifies it
+ * meanwhile.
+ */
+TidStore *
+TidStoreInitialize(void *place, Size size, BlockNumber nblocks,
+				   OffsetNumber max_offset)
+{
+	TidStore   *ts = (TidStore *) place;
+	uint32		nchunks;
+	Size		area_bytes;
+
+	nchunks = nblocks / TIDSTORE_CHUNK_BLOCKS + 1;
+	area_bytes = (size - TidStoreAreaOffset(nchunks)) &
+		~((Size) sizeof(uint32) - 1);
+	Assert(size > TidStoreAreaOffset(nchunks));
+	Assert(area_bytes >= tidstore_block_size(max_offset));
+
+	ts->size = size;
+	ts->nblocks = nblocks;
+	ts->max_offset = max_offset;
+	ts->nchunks = nchunks;
+	ts->area_words = area_bytes / sizeof(uint16);
+	TidStoreReset(ts);
+
+	return ts;
+}
+
+/*
+ * TidStoreCreate
+ *		Create a store using at most 'max_bytes' bytes, as with
+ *		TidStoreEstimate, in CurrentMemoryContext.
+ */
+TidStore *
+TidStoreCreate(Size max_bytes, BlockNumber nblocks, OffsetNumber max_offset)
+{
+	Size		size;
+	void	   *place;
+
+	size = TidStoreEstimate(max_bytes, nblocks, max_offset);
+	place = MemoryContextAllocHuge(CurrentMemoryContext, size);
+	return TidStoreInitialize(place, size, nblocks, max_offset);
+}
+
+/*
+ * TidStoreFree
+ *		Release a store.
+ */
+void
+TidStoreFree(TidStore *ts)
+{
+	pfree(ts);
+}
+
+/*
+ * TidStoreReset
+ *		Forget all the TIDs in a store.
+ */
+void
+TidStoreReset(TidStore *ts)
+{
+	memset(ts->chunks, 0, ts->nchunks * sizeof(TidStoreChunk));
+	ts->nentries = 0;
+	ts->data_start = ts->area_words;
+	ts->last_block = InvalidBlockNumber;
+	ts->num_tids = 0;
+}
+
+/*
+ * TidStoreIsFull
+ *		Is it possible that another block won't fit into the store?
+ */
+bool
+TidStoreIsFull(TidStore *ts)
+{
+	Size		free_words;
+
+	free_words = ts->data_start - ts->nentries * (sizeof(uint32) / sizeof(uint16));
+	return free_words * sizeof(uint16) < tidstore_block_size(ts->max_offset);
+}
+
+/*
+ * TidStoreSetBlockOffsets
+ *		Add the TIDs of one block to the store.
+ *
+ * 'offsets' must be sorted, without duplicates.  The block must come after
+ * all the blocks already added, and there must be room for it; see
+ * TidStoreIsFull.
+ */
+void
+TidStoreSetBlockOffsets(TidStore *ts, BlockNumber blkno,
+						OffsetNumber *offsets, int num_offsets)
+{
+	uint32	   *entries = TidStoreEntries(ts);
+	uint16	   *words = TidStoreWords(ts);
+	TidStoreChunk *chunk;
+	int			nbitmapwords;
+	uint32		start;
+	int			i;
+
+	if (num_offsets <= 0)
+		return;
+
+	if (blkno >= ts->nblocks ||
+		(ts->last_block != InvalidBlockNumber && blkno <= ts->last_block))
+		elog(ERROR, "block %u cannot be added to TID store", blkno);
+	if (TidStoreIsFull(ts))
+		elog(ERROR, "TID store is full");
+
+	if (offsets[num_offsets - 1] > ts->max_offset)
+		elog(ERROR, "offset %u is too large for TID store",
+			 offsets[num_offsets - 1]);
+
+	/* Use whichever form is smaller */
+	nbitmapwords = offsets[num_offsets - 1] / TIDSTORE_WORD_BITS + 1;
+	if (nbitmapwords < num_offsets)
+	{
+		start = ts->data_start - nbitmapwords;
+		memset(&words[start], 0, nbitmapwords * sizeof(uint16));
+		for (i = 0; i < num_offsets; i++)
+			words[start + offsets[i] / TIDSTORE_WORD_BITS] |=
+				(uint16) 1 << (offsets[i] % TIDSTORE_WORD_BITS);
+		entries[ts->nentries] = start | TIDSTORE_ENTRY_BITMAP;
+	}
+	else
+	{
+		start = ts->data_start - num_offsets;
+		for (i = 0; i < num_offsets; i++)
+		{
+			Assert(i == 0 || offsets[i] > offsets[i - 1]);
+			words[start + i] = offsets[i];
+		}
+		entries[ts->nentries] = start;
+	}
+
+	chunk = &ts->chunks[blkno / TIDSTORE_CHUNK_BLOCKS];
+	if (chunk->blocks == 0)
+		chunk->first = ts->nentries;
+	chunk->blocks |= UINT64CONST(1) << (blkno % TIDSTORE_CHUNK_BLOCKS);
+
+	ts->nentries++;
+	ts->data_start = start;
+	ts->last_block = blkno;
+	ts->num_tids += num_offsets;
+}
+
+/*
+ * TidStoreIsMember
+ *		Is the given TID in the store?
+ */
+bool
+TidStoreIsMember(TidStore *ts, ItemPointer tid)
+{
+	BlockNumber blkno = ItemPointerGetBlockNumber(tid);
+	OffsetNumber off = ItemPointerGetOffsetNumber(tid);
+	uint32	   *entries;
+	uint16	   *words;
+	TidStoreChunk *chunk;
+	uint64		bit;
+	uint32		entryno;
+	uint32		start;
+	uint32		nwords;
+	uint32		i;
+
+	if (blkno >= ts->nblocks)
+		return false;
+
+	chunk = &ts->chunks[blkno / TIDSTORE_CHUNK_BLOCKS];
+	bit = UINT64CONST(1) << (blkno % TIDSTORE_CHUNK_BLOCKS);
+	if ((chunk->blocks & bit) == 0)
+		return false;
+
+	entries = TidStoreEntries(ts);
+	words = TidStoreWords(ts);
+	entryno = chunk->first + tidstore_popcount64(chunk->blocks & (bit - 1));
+	start = entries[entryno] & TIDSTORE_ENTRY_START;
+	nwords = tidstore_entry_words(ts, entries, entryno);
+
+	if (entries[entryno] & TIDSTORE_ENTRY_BITMAP)
+	{
+		if (off / TIDSTORE_WORD_BITS >= nwords)
+			return false;
+		return (words[start + off / TIDSTORE_WORD_BITS] &
+				((uint16) 1 << (off % TIDSTORE_WORD_BITS))) != 0;
+	}
+
+	/* Arrays are used only when they're shorter than a bitmap; just scan */
+	for (i = 0; i < nwords; i++)
+	{
+		if (words[start + i] >= off)
+			return words[start + i] == off;
+	}
+	return false;
+}
+
+/*
+ * TidStoreNumTids
+ *		Number of TIDs in the store.
+ */
+int64
+TidStoreNumTids(TidStore *ts)
+{
+	return ts->num_tids;
+}
+
+/*
+ * TidStoreMaxTids
+ *		How many TIDs can an empty store surely hold?
+ *
+ * The worst case is one TID per block, taking a block entry and one word.
+ */
+int64
+TidStoreMaxTids(TidStore *ts)
+{
+	Size		usable;
+
+	usable = ts->area_words * sizeof(uint16) -
+		tidstore_block_size(ts->max_offset);
+	return Min((int64) (usable / (sizeof(uint32) + sizeof(uint16))) + 1,
+			   (int64) ts->nblocks * ts->max_offset);
+}
+
+/*
+ * TidStoreBeginIterate
+ *		Prepare to iterate over the blocks of the store, in block order.
+ *
+ * The store must not be changed while iterating.
+ */
+TidStoreIter *
+TidStoreBeginIterate(TidStore *ts)
+{
+	TidStoreIter *iter;
+
+	iter = (TidStoreIter *) palloc(sizeof(TidStoreIter));
+	iter->ts = ts;
+	iter->chunkno = 0;
+	iter->bit = 0;
+	iter->entryno = 0;
+
+	return iter;
+}
+
+/*
+ * TidStoreIterateNext
+ *		Return the next block and its offsets, in ascending order, or NULL
+ *		if there are no more.
+ *
+ * The result is overwritten by the next call.
+ */
+TidStoreIterResult *
+TidStoreIterateNext(TidStoreIter *iter)
+{
+	TidStore   *ts = iter->ts;
+	TidStoreIterResult *result = &iter->result;
+	uint32	   *entries;
+	uint16	   *words;
+	uint32		start;
+	uint32		nwords;
+	uint32		i;
+
+	if (iter->entryno >= ts->nentries)
+		return NULL;
+
+	/* Find the next block present */
+	for (;;)
+	{
+		uint64		blocks = ts->chunks[iter->chunkno].blocks;
+
+		if (iter->bit < TIDSTORE_CHUNK_BLOCKS)
+			blocks >>= iter->bit;
+		else
+			blocks = 0;
+
+		if (blocks != 0)
+		{
+			while ((blocks & 1) == 0)
+			{
+				blocks >>= 1;
+				iter->bit++;
+			}
+			break;
+		}
+
+		iter->chunkno++;
+		iter->bit = 0;
+		Assert(iter->chunkno < ts->nchunks);
+	}
+
+	result->blkno = iter->chunkno * TIDSTORE_CHUNK_BLOCKS + iter->bit;
+	iter->bit++;
+
+	entries = TidStoreEntries(ts);
+	words = TidStoreWords(ts);
+	start = entries[iter->entryno] & TIDSTORE_ENTRY_START;
+	nwords = tidstore_entry_words(ts, entries, iter->entryno);
+
+	result->num_offsets = 0;
+	if (entries[iter->entryno] & TIDSTORE_ENTRY_BITMAP)
+	{
+		for (i = 0; i < nwords; i++)
+		{
+			uint16		word = words[start + i];
+			int			b;
+
+			for (b = 0; word != 0; b++, word >>= 1)
+			{
+				if (word & 1)
+					result->offsets[result->num_offsets++] =
+						(OffsetNumber) (i * TIDSTORE_WORD_BITS + b);
+			}
+		}
+	}
+	else
+	{
+		for (i = 0; i < nwords; i++)
+			result->offsets[result->num_offsets++] = words[start + i];
+	}
+
+	iter->entryno++;
+
+	return result;
+}
+
+/*
+ * TidStoreEndIterate
+ *		Finish an iteration.
+ */
+void
+TidStoreEndIterate(TidStoreIter *iter)
+{
+	pfree(iter);
+}
@@ -299,6 +299,8 @@ initscan(HeapScanDesc scan, ScanKey key, bool keep_startblock)
 	ItemPointerSetInvalid(&scan->rs_ctup.t_self);
 	scan->rs_cbuf = InvalidBuffer;
 	scan->rs_cblock = InvalidBlockNumber;
+	scan->rs_nreadahead = 0;
+	scan->rs_nextreadahead = 0;
 
 	/* page-at-a-time fields are always invalid when not rs_inited */
 
@@ -336,6 +338,66 @@ heap_setscanlimits(HeapScanDesc scan, BlockNumber startBlk, BlockNumber numBlks)
 	scan->rs_numblocks = numBlks;
 }
 
+/*
+ * heap_release_readahead - unpin the blocks read ahead but not yet scanned
+ */
+static void
+heap_release_readahead(HeapScanDesc scan)
+{
+	while (scan->rs_nextreadahead < scan->rs_nreadahead)
+		ReleaseBuffer(scan->rs_readahead[scan->rs_nextreadahead++]);
+	scan->rs_nreadahead = 0;
+	scan->rs_nextreadahead = 0;
+}
+
+/*
+ * heap_readahead_blocks - how many blocks to read, starting with 'page'
+ *
+ * A serial forward scan of the whole relation reads the blocks it is about
+ * to visit io_combine_limit at a time, so that they can be read with one
+ * system call.  We only do that once the scan has moved on to the next
+ * block in sequence, and never past the point where the scan will end.
+ * Backward scans, and scans that read blocks in some other order or only
+ * part of the relation, read one block at a time.  So do temporary
+ * relations, as local buffers are read one at a time anyway.
+ *
+ * All of the blocks stay pinned until the scan gets to them, so we also
+ * stay within the number of pins this backend may hold, and below half of
+ * the strategy's ring, since pinned buffers in the ring can't be reused.
+ */
+static int
+heap_readahead_blocks(HeapScanDesc scan, BlockNumber page)
+{
+	BlockNumber end;
+	int			nblocks;
+	int			ring_size;
+
+	if (io_combine_limit <= 1 ||
+		scan->rs_bitmapscan || scan->rs_samplescan ||
+		scan->rs_parallel != NULL ||
+		scan->rs_numblocks != InvalidBlockNumber ||
+		RelationUsesLocalBuffers(scan->rs_rd))
+		return 1;
+
+	if (!(scan->rs_cblock == InvalidBlockNumber ?
+		  page == scan->rs_startblock :
+		  (page == scan->rs_cblock + 1 ||
+		   (page == 0 && scan->rs_cblock == scan->rs_nblocks - 1))))
+		return 1;
+
+	/* A synchronized scan wraps around to end just before its start */
+	end = (page < scan->rs_startblock) ? scan->rs_startblock : scan->rs_nblocks;
+
+	nblocks = (int) Min(end - page, (BlockNumber) io_combine_limit);
+
+	nblocks = Min(nblocks, GetAdditionalPinLimit());
+	ring_size = GetAccessStrategyBufferCount(scan->rs_strategy);
+	if (ring_size > 0)
+		nblocks = Min(nblocks, (ring_size - 1) / 2);
+
+	return Max(nblocks, 1);
+}
+
 /*
  * heapgetpage - subroutine for heapgettup()
  *
@@ -371,9 +433,37 @@ heapgetpage(HeapScanDesc scan, BlockNumber page)
 	 */
 	CHECK_FOR_INTERRUPTS();
 
-	/* read page using selected strategy */
-	scan->rs_cbuf = ReadBufferExtended(scan->rs_rd, MAIN_FORKNUM, page,
-									   RBM_NORMAL, scan->rs_strategy);
+	/*
+	 * Take the page from the blocks we read ahead, if we have it.  Else read
+	 * it using selected strategy, along with the next few blocks if the scan
+	 * is sequential.
+	 */
+	if (scan->rs_nextreadahead < scan->rs_nreadahead &&
+		page == scan->rs_readahead_block)
+	{
+		scan->rs_cbuf = scan->rs_readahead[scan->rs_nextreadahead++];
+		scan->rs_readahead_block++;
+	}
+	else
+	{
+		int			nblocks;
+
+		heap_release_readahead(scan);
+
+		nblocks = heap_readahead_blocks(scan, page);
+		if (nblocks > 1)
+		{
+			ReadBufferRange(scan->rs_rd, MAIN_FORKNUM, page, nblocks,
+							scan->rs_strategy, scan->rs_readahead);
+			scan->rs_cbuf = scan->rs_readahead[0];
+			scan->rs_nreadahead = nblocks;
+			scan->rs_nextreadahead = 1;
+			scan->rs_readahead_block = page + 1;
+		}
+		else
+			scan->rs_cbuf = ReadBufferExtended(scan->rs_rd, MAIN_FORKNUM, page,
+											   RBM_NORMAL, scan->rs_strategy);
+	}
 	scan->rs_cblock = page;
 
 	if (!scan->rs_pageatatime)
@@ -1526,6 +1616,7 @@ heap_rescan(HeapScanDesc scan,
 	 */
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
+	heap_release_readahead(scan);
 
 	/*
 	 * reinitialize scan descriptor
@@ -1586,6 +1677,7 @@ heap_endscan(HeapScanDesc scan)
 	 */
 	if (BufferIsValid(scan->rs_cbuf))
 		ReleaseBuffer(scan->rs_cbuf);
+	heap_release_readahead(scan);
 
 	/*
 	 * decrement relation reference count and free scan descriptor storage
@@ -2339,6 +2431,10 @@ GetBulkInsertState(void)
 	bistate = (BulkInsertState) palloc(sizeof(BulkInsertStateData));
 	bistate->strategy = GetAccessStrategy(BAS_BULKWRITE);
 	bistate->current_buf = InvalidBuffer;
+	bistate->next_free = InvalidBlockNumber;
+	bistate->last_free = InvalidBlockNumber;
+	bistate->free_rel = NULL;
+	bistate->already_extended_by = 0;
 	return bistate;
 }
 
@@ -2350,6 +2446,7 @@ FreeBulkInsertState(BulkInsertState bistate)
 {
 	if (bistate->current_buf != InvalidBuffer)
 		ReleaseBuffer(bistate->current_buf);
+	ReleaseBulkInsertReservedBlocks(bistate);
 	FreeAccessStrategy(bistate->strategy);
 	pfree(bistate);
 }
@@ -2363,6 +2460,10 @@ ReleaseBulkInsertStatePin(BulkInsertState bistate)
 	if (bistate->current_buf != InvalidBuffer)
 		ReleaseBuffer(bistate->current_buf);
 	bistate->current_buf = InvalidBuffer;
+
+	/* The blocks we reserved belong to the relation we were inserting into */
+	ReleaseBulkInsertReservedBlocks(bistate);
+	bistate->already_extended_by = 0;
 }
 
 
@@ -25,6 +25,13 @@
 #include "storage/smgr.h"
 
 
+/* Maximum # of blocks a bulk insert reserves each time it extends a rel */
+#define BULK_INSERT_MAX_EXTEND_BLOCKS	64
+
+/* This is what PageGetHeapFreeSpace reports for an empty page */
+#define EMPTY_HEAP_PAGE_FREE_SPACE \
+	(BLCKSZ - SizeOfPageHeaderData - sizeof(ItemIdData))
+
 /*
  * RelationPutHeapTuple - place tuple at specified page
  *
@@ -74,23 +81,31 @@ RelationPutHeapTuple(Relation relation,
 }
 
 /*
- * Read in a buffer, using bulk-insert strategy if bistate isn't NULL.
+ * Read in a buffer in mode, using bulk-insert strategy if bistate isn't NULL.
  */
 static Buffer
 ReadBufferBI(Relation relation, BlockNumber targetBlock,
-			 BulkInsertState bistate)
+			 ReadBufferMode mode, BulkInsertState bistate)
 {
 	Buffer		buffer;
 
 	/* If not bulk-insert, exactly like ReadBuffer */
 	if (!bistate)
-		return ReadBuffer(relation, targetBlock);
+		return ReadBufferExtended(relation, MAIN_FORKNUM, targetBlock,
+								  mode, NULL);
 
 	/* If we have the desired block already pinned, re-pin and return it */
 	if (bistate->current_buf != InvalidBuffer)
 	{
 		if (BufferGetBlockNumber(bistate->current_buf) == targetBlock)
 		{
+			/*
+			 * The locking modes are only used to extend the relation, which
+			 * never asks for a block we have pinned already.
+			 */
+			Assert(mode != RBM_ZERO_AND_LOCK &&
+				   mode != RBM_ZERO_AND_CLEANUP_LOCK);
+
 			IncrBufferRefCount(bistate->current_buf);
 			return bistate->current_buf;
 		}
@@ -101,7 +116,7 @@ ReadBufferBI(Relation relation, BlockNumber targetBlock,
 
 	/* Perform a read using the buffer strategy */
 	buffer = ReadBufferExtended(relation, MAIN_FORKNUM, targetBlock,
-								RBM_NORMAL, bistate->strategy);
+								mode, bistate->strategy);
 
 	/* Save the selected block as target for future inserts */
 	IncrBufferRefCount(buffer);
@@ -168,22 +183,43 @@ GetVisibilityMapPins(Relation relation, Buffer buffer1, Buffer buffer2,
 	}
 }
 
+/*
+ * Add nblocks zero-filled blocks at the end of the relation, and return the
+ * number of the first one.
+ *
+ * Caller must hold the relation extension lock, unless the relation is local.
+ */
+static BlockNumber
+RelationExtendBlocks(Relation relation, int nblocks)
+{
+	BlockNumber firstBlock;
+
+	RelationOpenSmgr(relation);
+	firstBlock = smgrnblocks(relation->rd_smgr, MAIN_FORKNUM);
+	smgrzeroextend(relation->rd_smgr, MAIN_FORKNUM, firstBlock, nblocks,
+				   false);
+
+	return firstBlock;
+}
+
 /*
  * Extend a relation by multiple blocks to avoid future contention on the
  * relation extension lock.  Our goal is to pre-extend the relation by an
  * amount which ramps up as the degree of contention ramps up, but limiting
  * the result to some sane overall value.
+ *
+ * The new blocks are written with a single large write of zeroes, without
+ * going through shared buffers.  They are initialized by whoever first
+ * inserts into them; see RelationGetBufferForTuple.
  */
 static void
-RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
+RelationAddExtraBlocks(Relation relation)
 {
-	Page		page;
-	BlockNumber blockNum = InvalidBlockNumber,
-				firstBlock = InvalidBlockNumber;
+	BlockNumber blockNum,
+				firstBlock;
 	int			extraBlocks = 0;
 	int			lockWaiters = 0;
-	Size		freespace = 0;
-	Buffer		buffer;
+	Size		freespace;
 
 	/* Use the length of the lock wait queue to judge how much to extend. */
 	lockWaiters = RelationExtensionLockWaiterCount(relation);
@@ -198,43 +234,25 @@ RelationAddExtraBlocks(Relation relation, BulkInsertState bistate)
 	 */
 	extraBlocks = Min(512, lockWaiters * 20);
 
-	while (extraBlocks-- >= 0)
-	{
-		/* Ouch - an unnecessary lseek() each time through the loop! */
-		buffer = ReadBufferBI(relation, P_NEW, bistate);
+	firstBlock = RelationExtendBlocks(relation, extraBlocks);
+	freespace = EMPTY_HEAP_PAGE_FREE_SPACE;
 
-		/* Extend by one page. */
-		LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
-		page = BufferGetPage(buffer);
-		PageInit(page, BufferGetPageSize(buffer), 0);
-		MarkBufferDirty(buffer);
-		blockNum = BufferGetBlockNumber(buffer);
-		freespace = PageGetHeapFreeSpace(page);
-		UnlockReleaseBuffer(buffer);
-
-		/* Remember first block number thus added. */
-		if (firstBlock == InvalidBlockNumber)
-			firstBlock = blockNum;
-
-		/*
-		 * Immediately update the bottom level of the FSM.  This has a good
-		 * chance of making this page visible to other concurrently inserting
-		 * backends, and we want that to happen without delay.
-		 */
+	/*
+	 * Immediately update the bottom level of the FSM.  This has a good chance
+	 * of making the new pages visible to other concurrently inserting
+	 * backends, and we want that to happen without delay.
+	 */
+	for (blockNum = firstBlock; blockNum < firstBlock + extraBlocks; blockNum++)
 		RecordPageWithFreeSpace(relation, blockNum, freespace);
-	}
 
 	/*
 	 * Updating the upper levels of the free space map is too expensive to do
 	 * for every block, but it's worth doing once at the end to make sure that
 	 * subsequent insertion activity sees all of those nifty free pages we
 	 * just inserted.
-	 *
-	 * Note that we're using the freespace value that was reported for the
-	 * last block we added as if it were the freespace value for every block
-	 * we added.  That's actually true, because they're all equally empty.
 	 */
-	UpdateFreeSpaceMap(relation, firstBlock, blockNum, freespace);
+	UpdateFreeSpaceMap(relation, firstBlock, firstBlock + extraBlocks - 1,
+					   freespace);
 }
 
 /*
@@ -306,6 +324,7 @@ RelationGetBufferForTuple(Relation relation, Size len,
 				saveFreeSpace = 0;
 	BlockNumber targetBlock,
 				otherBlock;
+	int			extendBy;
 	bool		needLock;
 
 	len = MAXALIGN(len);		/* be conservative */
@@ -396,7 +415,7 @@ loop:
 		if (otherBuffer == InvalidBuffer)
 		{
 			/* easy case */
-			buffer = ReadBufferBI(relation, targetBlock, bistate);
+			buffer = ReadBufferBI(relation, targetBlock, RBM_NORMAL, bistate);
 			if (PageIsAllVisible(BufferGetPage(buffer)))
 				visibilitymap_pin(relation, targetBlock, vmbuffer);
 			LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
@@ -458,11 +477,22 @@ loop:
 								 otherBlock, targetBlock, vmbuffer_other,
 								 vmbuffer);
 
+		/*
+		 * If the page was added to the relation but not yet initialized, see
+		 * RelationAddExtraBlocks, initialize it now.  No need to WAL-log
+		 * that; heap_insert will tell redo to initialize the page.
+		 */
+		page = BufferGetPage(buffer);
+		if (PageIsNew(page))
+		{
+			PageInit(page, BufferGetPageSize(buffer), 0);
+			MarkBufferDirty(buffer);
+		}
+
 		/*
 		 * Now we can check to see if there's enough free space here. If so,
 		 * we're done.
 		 */
-		page = BufferGetPage(buffer);
 		pageFreeSpace = PageGetHeapFreeSpace(page);
 		if (len + saveFreeSpace <= pageFreeSpace)
 		{
@@ -500,6 +530,27 @@ loop:
 													len + saveFreeSpace);
 	}
 
+	/*
+	 * If we're bulk inserting, try the blocks we reserved the last time we
+	 * extended the relation before extending it again.  Those aren't in the
+	 * FSM, so we don't have to worry about others using them, except that
+	 * someone could pick the last one as the relation's last page; the
+	 * checks in the loop above take care of that.
+	 */
+	if (bistate && bistate->next_free != InvalidBlockNumber &&
+		len + saveFreeSpace <= MaxHeapTupleSize)
+	{
+		targetBlock = bistate->next_free;
+		if (bistate->next_free == bistate->last_free)
+		{
+			bistate->next_free = InvalidBlockNumber;
+			bistate->last_free = InvalidBlockNumber;
+		}
+		else
+			bistate->next_free++;
+		goto loop;
+	}
+
 	/*
 	 * Have to extend the relation.
 	 *
@@ -542,41 +593,48 @@ loop:
 			}
 
 			/* Time to bulk-extend. */
-			RelationAddExtraBlocks(relation, bistate);
+			RelationAddExtraBlocks(relation);
 		}
 	}
 
 	/*
 	 * In addition to whatever extension we performed above, we always add at
-	 * least one block to satisfy our own request.
+	 * least one block to satisfy our own request.  A bulk insert adds more,
+	 * and keeps the rest for its next insertions, so that it needn't come
+	 * back for the extension lock for a while.  The more it has added
+	 * already, the more it adds, up to BULK_INSERT_MAX_EXTEND_BLOCKS.
+	 *
+	 * We get the new page's buffer zeroed and locked at once, before anyone
+	 * else could find the page and start using it.  When extending by just
+	 * one block, ReadBuffer takes care of that.  Otherwise, the first block
+	 * we add isn't the relation's last block, so only VACUUM could find it,
+	 * and VACUUM waits for the extension lock before touching new pages.
 	 *
 	 * XXX This does an lseek - rather expensive - but at the moment it is the
 	 * only way to accurately determine how many blocks are in a relation.  Is
 	 * it worth keeping an accurate file length in shared memory someplace,
 	 * rather than relying on the kernel to do it for us?
 	 */
-	buffer = ReadBufferBI(relation, P_NEW, bistate);
+	extendBy = 1;
+	if (bistate && len + saveFreeSpace <= MaxHeapTupleSize)
+		extendBy = Max(1, Min(bistate->already_extended_by,
+							  BULK_INSERT_MAX_EXTEND_BLOCKS));
 
-	/*
-	 * We can be certain that locking the otherBuffer first is OK, since it
-	 * must have a lower page number.
-	 */
-	if (otherBuffer != InvalidBuffer)
-		LockBuffer(otherBuffer, BUFFER_LOCK_EXCLUSIVE);
+	if (extendBy > 1)
+	{
+		BlockNumber firstBlock = RelationExtendBlocks(relation, extendBy);
 
-	/*
-	 * Now acquire lock on the new page.
-	 */
-	LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+		Assert(bistate->next_free == InvalidBlockNumber);
+		bistate->next_free = firstBlock + 1;
+		bistate->last_free = firstBlock + extendBy - 1;
+		bistate->free_rel = relation;
+		buffer = ReadBufferBI(relation, firstBlock, RBM_ZERO_AND_LOCK, bistate);
+	}
+	else
+		buffer = ReadBufferBI(relation, P_NEW, RBM_ZERO_AND_LOCK, bistate);
 
-	/*
-	 * Release the file-extension lock; it's now OK for someone else to extend
-	 * the relation some more.  Note that we cannot release this lock before
-	 * we have buffer lock on the new page, or we risk a race condition
-	 * against vacuumlazy.c --- see comments therein.
-	 */
-	if (needLock)
-		UnlockRelationForExtension(relation, ExclusiveLock);
+	if (bistate)
+		bistate->already_extended_by += extendBy;
 
 	/*
 	 * We need to initialize the empty new page.  Double-check that it really
@@ -591,6 +649,43 @@ loop:
 			 RelationGetRelationName(relation));
 
 	PageInit(page, BufferGetPageSize(buffer), 0);
+	MarkBufferDirty(buffer);
+
+	/*
+	 * Release the file-extension lock; it's now OK for someone else to extend
+	 * the relation some more.
+	 */
+	if (needLock)
+		UnlockRelationForExtension(relation, ExclusiveLock);
+
+	/*
+	 * Lock the other buffer.  It has a lower page number than the new page,
+	 * so by the deadlock avoidance rules we ought to lock it first, but then
+	 * we'd have had to hold it locked while extending the relation.  Try to
+	 * lock it conditionally, which very likely works.  Otherwise we have to
+	 * lock the buffers in the right order, and start over if somebody used up
+	 * the space on the new page while it was unlocked.
+	 */
+	if (otherBuffer != InvalidBuffer)
+	{
+		Assert(otherBuffer != buffer);
+
+		if (unlikely(!ConditionalLockBuffer(otherBuffer)))
+		{
+			LockBuffer(buffer, BUFFER_LOCK_UNLOCK);
+			LockBuffer(otherBuffer, BUFFER_LOCK_EXCLUSIVE);
+			LockBuffer(buffer, BUFFER_LOCK_EXCLUSIVE);
+
+			if (len > PageGetHeapFreeSpace(page))
+			{
+				LockBuffer(otherBuffer, BUFFER_LOCK_UNLOCK);
+				UnlockReleaseBuffer(buffer);
+
+				targetBlock = InvalidBlockNumber;
+				goto loop;
+			}
+		}
+	}
 
 	if (len > PageGetHeapFreeSpace(page))
 	{
@@ -611,3 +706,32 @@ loop:
 
 	return buffer;
 }
+
+/*
+ * ReleaseBulkInsertReservedBlocks - give up the blocks a bulk insert reserved
+ *
+ * The blocks the bulk insert added to the relation but didn't use aren't in
+ * the free space map, so nobody else would find them until the next VACUUM.
+ * Record them there now, with the free space of an empty page, and update
+ * the upper levels of the map so that searches see them.
+ */
+void
+ReleaseBulkInsertReservedBlocks(BulkInsertState bistate)
+{
+	BlockNumber blockNum;
+
+	if (bistate->next_free == InvalidBlockNumber)
+		return;
+
+	Assert(bistate->free_rel != NULL);
+
+	for (blockNum = bistate->next_free; blockNum <= bistate->last_free;
+		 blockNum++)
+		RecordPageWithFreeSpace(bistate->free_rel, blockNum,
+								EMPTY_HEAP_PAGE_FREE_SPACE);
+	FreeSpaceMapVacuum(bistate->free_rel);
+
+	bistate->next_free = InvalidBlockNumber;
+	bistate->last_free = InvalidBlockNumber;
+	bistate->free_rel = NULL;
+}
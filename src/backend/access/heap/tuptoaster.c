@@ -29,6 +29,12 @@
 
 #include <unistd.h>
 #include <fcntl.h>
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
 
 #include "access/genam.h"
 #include "access/heapam.h"
@@ -37,8 +43,10 @@
 #include "catalog/catalog.h"
 #include "common/pg_lzcompress.h"
 #include "miscadmin.h"
+#include "utils/attoptcache.h"
 #include "utils/expandeddatum.h"
 #include "utils/fmgroids.h"
+#include "utils/guc.h"
 #include "utils/rel.h"
 #include "utils/snapmgr.h"
 #include "utils/typcache.h"
@@ -53,7 +61,8 @@
 typedef struct toast_compress_header
 {
 	int32		vl_len_;		/* varlena header (do not touch directly!) */
-	int32		rawsize;
+	uint32		tcinfo;			/* 2 bits for compression method and 30 bits
+								 * rawsize */
 } toast_compress_header;
 
 /*
@@ -61,11 +70,45 @@ typedef struct toast_compress_header
  * toast entries.
  */
 #define TOAST_COMPRESS_HDRSZ		((int32) sizeof(toast_compress_header))
-#define TOAST_COMPRESS_RAWSIZE(ptr) (((toast_compress_header *) (ptr))->rawsize)
+#define TOAST_COMPRESS_RAWSIZE(ptr) \
+	((int32) (((toast_compress_header *) (ptr))->tcinfo & VARLENA_RAWSIZE_MASK))
+#define TOAST_COMPRESS_METHOD(ptr) \
+	(((toast_compress_header *) (ptr))->tcinfo >> VARLENA_RAWSIZE_BITS)
 #define TOAST_COMPRESS_RAWDATA(ptr) \
 	(((char *) (ptr)) + TOAST_COMPRESS_HDRSZ)
-#define TOAST_COMPRESS_SET_RAWSIZE(ptr, len) \
-	(((toast_compress_header *) (ptr))->rawsize = (len))
+#define TOAST_COMPRESS_SET_SIZE_AND_METHOD(ptr, len, cm) \
+	(((toast_compress_header *) (ptr))->tcinfo = \
+	 (len) | ((uint32) (cm) << VARLENA_RAWSIZE_BITS))
+
+#define NO_LZ4_SUPPORT() \
+	ereport(ERROR, \
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED), \
+			 errmsg("compression method lz4 not supported"), \
+			 errdetail("This functionality requires the server to be built with lz4 support.")))
+
+#define NO_ZSTD_SUPPORT() \
+	ereport(ERROR, \
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED), \
+			 errmsg("compression method zstd not supported"), \
+			 errdetail("This functionality requires the server to be built with zstd support.")))
+
+/* GUC variable */
+int			default_toast_compression = TOAST_PGLZ_COMPRESSION_ID;
+
+/*
+ * GUC support.  Methods this build doesn't support are left out, so that
+ * they're rejected.
+ */
+const struct config_enum_entry default_toast_compression_options[] = {
+	{"pglz", TOAST_PGLZ_COMPRESSION_ID, false},
+#ifdef USE_LZ4
+	{"lz4", TOAST_LZ4_COMPRESSION_ID, false},
+#endif
+#ifdef USE_ZSTD
+	{"zstd", TOAST_ZSTD_COMPRESSION_ID, false},
+#endif
+	{NULL, 0, false}
+};
 
 static void toast_delete_datum(Relation rel, Datum value, bool is_speculative);
 static Datum toast_save_datum(Relation rel, Datum value,
@@ -76,6 +119,11 @@ static struct varlena *toast_fetch_datum(struct varlena *attr);
 static struct varlena *toast_fetch_datum_slice(struct varlena *attr,
 						int32 sliceoffset, int32 length);
 static struct varlena *toast_decompress_datum(struct varlena *attr);
+static struct varlena *toast_decompress_datum_slice(struct varlena *attr,
+							 int32 slicelength);
+static int32 toast_decompress_bytes(struct varlena *attr, char *dest,
+					   int32 rawsize, bool check_complete);
+static int	toast_attr_compression(Relation rel, int attnum);
 static int toast_open_indexes(Relation toastrel,
 				   LOCKMODE lock,
 				   Relation **toastidxs,
@@ -302,7 +350,12 @@ heap_tuple_untoast_attr_slice(struct varlena *attr,
 	{
 		struct varlena *tmp = preslice;
 
-		preslice = toast_decompress_datum(tmp);
+		/* Decompress no more than the slice needs, if we know how much */
+		if (slicelength >= 0 && sliceoffset <= PG_INT32_MAX - slicelength)
+			preslice = toast_decompress_datum_slice(tmp,
+													sliceoffset + slicelength);
+		else
+			preslice = toast_decompress_datum(tmp);
 
 		if (tmp != attr)
 			pfree(tmp);
@@ -421,7 +474,7 @@ toast_datum_size(Datum value)
 		struct varatt_external toast_pointer;
 
 		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
-		result = toast_pointer.va_extsize;
+		result = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
 	}
 	else if (VARATT_IS_EXTERNAL_INDIRECT(attr))
 	{
@@ -774,7 +827,8 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 		if (att[i]->attstorage == 'x')
 		{
 			old_value = toast_values[i];
-			new_value = toast_compress_datum(old_value);
+			new_value = toast_compress_datum(old_value,
+											 toast_attr_compression(rel, i + 1));
 
 			if (DatumGetPointer(new_value) != NULL)
 			{
@@ -913,7 +967,8 @@ toast_insert_or_update(Relation rel, HeapTuple newtup, HeapTuple oldtup,
 		 */
 		i = biggest_attno;
 		old_value = toast_values[i];
-		new_value = toast_compress_datum(old_value);
+		new_value = toast_compress_datum(old_value,
+										 toast_attr_compression(rel, i + 1));
 
 		if (DatumGetPointer(new_value) != NULL)
 		{
@@ -1359,7 +1414,8 @@ toast_build_flattened_tuple(TupleDesc tupleDesc,
 /* ----------
  * toast_compress_datum -
  *
- *	Create a compressed version of a varlena datum
+ *	Create a compressed version of a varlena datum, using the compression
+ *	method cmethod
  *
  *	If we fail (ie, compressed result is actually bigger than original)
  *	then return NULL.  We must not use compressed data if it'd expand
@@ -1370,28 +1426,77 @@ toast_build_flattened_tuple(TupleDesc tupleDesc,
  * ----------
  */
 Datum
-toast_compress_datum(Datum value)
+toast_compress_datum(Datum value, int cmethod)
 {
 	struct varlena *tmp;
+	const char *source = VARDATA_ANY(DatumGetPointer(value));
 	int32		valsize = VARSIZE_ANY_EXHDR(DatumGetPointer(value));
-	int32		len;
+	int32		len = -1;
 
 	Assert(!VARATT_IS_EXTERNAL(DatumGetPointer(value)));
 	Assert(!VARATT_IS_COMPRESSED(DatumGetPointer(value)));
 
-	/*
-	 * No point in wasting a palloc cycle if value size is out of the allowed
-	 * range for compression
-	 */
-	if (valsize < PGLZ_strategy_default->min_input_size ||
-		valsize > PGLZ_strategy_default->max_input_size)
-		return PointerGetDatum(NULL);
+	switch (cmethod)
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
 
-	tmp = (struct varlena *) palloc(PGLZ_MAX_OUTPUT(valsize) +
-									TOAST_COMPRESS_HDRSZ);
+			/*
+			 * No point in wasting a palloc cycle if value size is out of the
+			 * allowed range for compression
+			 */
+			if (valsize < PGLZ_strategy_default->min_input_size ||
+				valsize > PGLZ_strategy_default->max_input_size)
+				return PointerGetDatum(NULL);
+
+			tmp = (struct varlena *) palloc(PGLZ_MAX_OUTPUT(valsize) +
+											TOAST_COMPRESS_HDRSZ);
+			len = pglz_compress(source, valsize,
+								TOAST_COMPRESS_RAWDATA(tmp),
+								PGLZ_strategy_default);
+			break;
+
+		case TOAST_LZ4_COMPRESSION_ID:
+#ifdef USE_LZ4
+			{
+				int32		max_size = LZ4_compressBound(valsize);
+
+				tmp = (struct varlena *) palloc(max_size +
+												TOAST_COMPRESS_HDRSZ);
+				len = LZ4_compress_default(source,
+										   TOAST_COMPRESS_RAWDATA(tmp),
+										   valsize, max_size);
+				if (len <= 0)
+					len = -1;
+			}
+#else
+			NO_LZ4_SUPPORT();
+#endif
+			break;
+
+		case TOAST_ZSTD_COMPRESSION_ID:
+#ifdef USE_ZSTD
+			{
+				size_t		max_size = ZSTD_compressBound(valsize);
+				size_t		zlen;
+
+				tmp = (struct varlena *) palloc(max_size +
+												TOAST_COMPRESS_HDRSZ);
+				zlen = ZSTD_compress(TOAST_COMPRESS_RAWDATA(tmp), max_size,
+									 source, valsize, ZSTD_CLEVEL_DEFAULT);
+				len = ZSTD_isError(zlen) ? -1 : (int32) zlen;
+			}
+#else
+			NO_ZSTD_SUPPORT();
+#endif
+			break;
+
+		default:
+			elog(ERROR, "invalid compression method %d", cmethod);
+			return PointerGetDatum(NULL);	/* keep compiler quiet */
+	}
 
 	/*
-	 * We recheck the actual size even if pglz_compress() reports success,
+	 * We recheck the actual size even if the compressor reports success,
 	 * because it might be satisfied with having saved as little as one byte
 	 * in the compressed data --- which could turn into a net loss once you
 	 * consider header and alignment padding.  Worst case, the compressed
@@ -1400,14 +1505,10 @@ toast_compress_datum(Datum value)
 	 * only one header byte and no padding if the value is short enough.  So
 	 * we insist on a savings of more than 2 bytes to ensure we have a gain.
 	 */
-	len = pglz_compress(VARDATA_ANY(DatumGetPointer(value)),
-						valsize,
-						TOAST_COMPRESS_RAWDATA(tmp),
-						PGLZ_strategy_default);
 	if (len >= 0 &&
 		len + TOAST_COMPRESS_HDRSZ < valsize - 2)
 	{
-		TOAST_COMPRESS_SET_RAWSIZE(tmp, valsize);
+		TOAST_COMPRESS_SET_SIZE_AND_METHOD(tmp, valsize, cmethod);
 		SET_VARSIZE_COMPRESSED(tmp, len + TOAST_COMPRESS_HDRSZ);
 		/* successful compression */
 		return PointerGetDatum(tmp);
@@ -1420,6 +1521,140 @@ toast_compress_datum(Datum value)
 	}
 }
 
+/* ----------
+ * toast_get_compression_id -
+ *
+ *	Return the compression method of a varlena datum, looking only at its
+ *	header or TOAST pointer, or TOAST_INVALID_COMPRESSION_ID if it isn't
+ *	compressed.
+ * ----------
+ */
+ToastCompressionId
+toast_get_compression_id(struct varlena *attr)
+{
+	if (VARATT_IS_EXTERNAL_ONDISK(attr))
+	{
+		struct varatt_external toast_pointer;
+
+		VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
+
+		if (VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer))
+			return (ToastCompressionId)
+				VARATT_EXTERNAL_GET_COMPRESSION(toast_pointer);
+	}
+	else if (VARATT_IS_EXTERNAL_INDIRECT(attr))
+	{
+		struct varatt_indirect redirect;
+
+		VARATT_EXTERNAL_GET_POINTER(redirect, attr);
+
+		/* nested indirect Datums aren't allowed */
+		Assert(!VARATT_IS_EXTERNAL_INDIRECT(redirect.pointer));
+
+		return toast_get_compression_id((struct varlena *) redirect.pointer);
+	}
+	else if (VARATT_IS_COMPRESSED(attr))
+		return (ToastCompressionId) VARCOMPRESS_4B_C(attr);
+
+	return TOAST_INVALID_COMPRESSION_ID;
+}
+
+/*
+ * Return the ToastCompressionId for a compression method name, or
+ * TOAST_INVALID_COMPRESSION_ID if it's not a known method.
+ */
+ToastCompressionId
+CompressionNameToMethod(const char *name)
+{
+	if (pg_strcasecmp(name, "pglz") == 0)
+		return TOAST_PGLZ_COMPRESSION_ID;
+	if (pg_strcasecmp(name, "lz4") == 0)
+		return TOAST_LZ4_COMPRESSION_ID;
+	if (pg_strcasecmp(name, "zstd") == 0)
+		return TOAST_ZSTD_COMPRESSION_ID;
+	return TOAST_INVALID_COMPRESSION_ID;
+}
+
+/*
+ * Return the name of a compression method.
+ */
+const char *
+GetCompressionMethodName(ToastCompressionId cmethod)
+{
+	switch (cmethod)
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			return "pglz";
+		case TOAST_LZ4_COMPRESSION_ID:
+			return "lz4";
+		case TOAST_ZSTD_COMPRESSION_ID:
+			return "zstd";
+		default:
+			elog(ERROR, "invalid compression method %d", (int) cmethod);
+			return NULL;		/* keep compiler quiet */
+	}
+}
+
+/*
+ * Validator for the "compression" column option: the method must be known
+ * and supported by this build.
+ */
+void
+ValidateCompressionMethod(char *name)
+{
+	switch (CompressionNameToMethod(name))
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			break;
+		case TOAST_LZ4_COMPRESSION_ID:
+#ifndef USE_LZ4
+			NO_LZ4_SUPPORT();
+#endif
+			break;
+		case TOAST_ZSTD_COMPRESSION_ID:
+#ifndef USE_ZSTD
+			NO_ZSTD_SUPPORT();
+#endif
+			break;
+		default:
+			ereport(ERROR,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid compression method \"%s\"", name)));
+	}
+}
+
+/*
+ * Return the compression method to use for a column of a relation: the
+ * column's "compression" option if it has one, else default_toast_compression.
+ */
+static int
+toast_attr_compression(Relation rel, int attnum)
+{
+	AttributeOpts *aopts;
+	int			cmethod = default_toast_compression;
+
+	/* the attribute options cache isn't usable in bootstrap mode */
+	if (IsBootstrapProcessingMode())
+		return cmethod;
+
+	aopts = get_attribute_options(RelationGetRelid(rel), attnum);
+	if (aopts != NULL)
+	{
+		if (aopts->compression_offset != 0)
+		{
+			ToastCompressionId colmethod;
+
+			colmethod = CompressionNameToMethod((char *) aopts +
+												aopts->compression_offset);
+			if (colmethod != TOAST_INVALID_COMPRESSION_ID)
+				cmethod = colmethod;
+		}
+		pfree(aopts);
+	}
+
+	return cmethod;
+}
+
 
 /* ----------
  * toast_get_valid_index
@@ -1517,7 +1752,8 @@ toast_save_datum(Relation rel, Datum value,
 	 * va_rawsize is the size of the equivalent fully uncompressed datum, so
 	 * we have to adjust for short headers.
 	 *
-	 * va_extsize is the actual size of the data payload in the toast records.
+	 * va_extsize is the actual size of the data payload in the toast records,
+	 * plus the compression method if the data is compressed.
 	 */
 	if (VARATT_IS_SHORT(dval))
 	{
@@ -1532,7 +1768,8 @@ toast_save_datum(Relation rel, Datum value,
 		data_todo = VARSIZE(dval) - VARHDRSZ;
 		/* rawsize in a compressed datum is just the size of the payload */
 		toast_pointer.va_rawsize = VARRAWSIZE_4B_C(dval) + VARHDRSZ;
-		toast_pointer.va_extsize = data_todo;
+		VARATT_EXTERNAL_SET_SIZE_AND_COMPRESSION(toast_pointer, data_todo,
+												 VARCOMPRESS_4B_C(dval));
 		/* Assert that the numbers look like it's compressed */
 		Assert(VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer));
 	}
@@ -1901,7 +2138,7 @@ toast_fetch_datum(struct varlena *attr)
 	/* Must copy to access aligned fields */
 	VARATT_EXTERNAL_GET_POINTER(toast_pointer, attr);
 
-	ressize = toast_pointer.va_extsize;
+	ressize = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
 	numchunks = ((ressize - 1) / TOAST_MAX_CHUNK_SIZE) + 1;
 
 	result = (struct varlena *) palloc(ressize + VARHDRSZ);
@@ -2086,7 +2323,7 @@ toast_fetch_datum_slice(struct varlena *attr, int32 sliceoffset, int32 length)
 	 */
 	Assert(!VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer));
 
-	attrsize = toast_pointer.va_extsize;
+	attrsize = VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer);
 	totalchunks = ((attrsize - 1) / TOAST_MAX_CHUNK_SIZE) + 1;
 
 	if (sliceoffset >= attrsize)
@@ -2279,22 +2516,111 @@ static struct varlena *
 toast_decompress_datum(struct varlena *attr)
 {
 	struct varlena *result;
+	int32		rawsize = TOAST_COMPRESS_RAWSIZE(attr);
 
 	Assert(VARATT_IS_COMPRESSED(attr));
 
-	result = (struct varlena *)
-		palloc(TOAST_COMPRESS_RAWSIZE(attr) + VARHDRSZ);
-	SET_VARSIZE(result, TOAST_COMPRESS_RAWSIZE(attr) + VARHDRSZ);
+	result = (struct varlena *) palloc(rawsize + VARHDRSZ);
+	SET_VARSIZE(result, rawsize + VARHDRSZ);
 
-	if (pglz_decompress(TOAST_COMPRESS_RAWDATA(attr),
-						VARSIZE(attr) - TOAST_COMPRESS_HDRSZ,
-						VARDATA(result),
-						TOAST_COMPRESS_RAWSIZE(attr)) < 0)
+	if (toast_decompress_bytes(attr, VARDATA(result), rawsize,
+							   true) != rawsize)
 		elog(ERROR, "compressed data is corrupted");
 
 	return result;
 }
 
+/* ----------
+ * toast_decompress_datum_slice -
+ *
+ * Decompress only the first slicelength bytes of a compressed version of a
+ * varlena datum, where the method allows stopping early.
+ */
+static struct varlena *
+toast_decompress_datum_slice(struct varlena *attr, int32 slicelength)
+{
+	struct varlena *result;
+	int32		len;
+
+	Assert(VARATT_IS_COMPRESSED(attr));
+
+	/* zstd can't stop early; and if we need it all anyway, get it all */
+	if (slicelength >= TOAST_COMPRESS_RAWSIZE(attr) ||
+		TOAST_COMPRESS_METHOD(attr) == TOAST_ZSTD_COMPRESSION_ID)
+		return toast_decompress_datum(attr);
+
+	result = (struct varlena *) palloc(slicelength + VARHDRSZ);
+
+	len = toast_decompress_bytes(attr, VARDATA(result), slicelength, false);
+	if (len < 0)
+		elog(ERROR, "compressed data is corrupted");
+
+	SET_VARSIZE(result, len + VARHDRSZ);
+
+	return result;
+}
+
+/* ----------
+ * toast_decompress_bytes -
+ *
+ * Decompress a compressed datum into dest, with the method recorded in its
+ * header.  If check_complete is true, rawsize must be the full decompressed
+ * size; otherwise we may stop once rawsize bytes have been produced.
+ * Returns the number of bytes decompressed, or -1 if the data is corrupt.
+ */
+static int32
+toast_decompress_bytes(struct varlena *attr, char *dest, int32 rawsize,
+					   bool check_complete)
+{
+	const char *source = TOAST_COMPRESS_RAWDATA(attr);
+	int32		slen = VARSIZE(attr) - TOAST_COMPRESS_HDRSZ;
+
+	switch (TOAST_COMPRESS_METHOD(attr))
+	{
+		case TOAST_PGLZ_COMPRESSION_ID:
+			return pglz_decompress(source, slen, dest, rawsize,
+								   check_complete);
+
+		case TOAST_LZ4_COMPRESSION_ID:
+#ifdef USE_LZ4
+			{
+				int			len;
+
+				if (check_complete)
+					len = LZ4_decompress_safe(source, dest, slen, rawsize);
+				else
+					len = LZ4_decompress_safe_partial(source, dest, slen,
+													  rawsize, rawsize);
+				return (len < 0) ? -1 : len;
+			}
+#else
+			NO_LZ4_SUPPORT();
+			break;
+#endif
+
+		case TOAST_ZSTD_COMPRESSION_ID:
+#ifdef USE_ZSTD
+			{
+				size_t		len;
+
+				Assert(check_complete);
+				len = ZSTD_decompress(dest, rawsize, source, slen);
+				return ZSTD_isError(len) ? -1 : (int32) len;
+			}
+#else
+			NO_ZSTD_SUPPORT();
+			break;
+#endif
+
+		default:
+			break;
+	}
+
+	elog(ERROR, "invalid compression method %u",
+		 (unsigned int) TOAST_COMPRESS_METHOD(attr));
+	return -1;					/* keep compiler quiet */
+}
+
 
 /* ----------
  * toast_open_indexes
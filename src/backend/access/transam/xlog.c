@@ -18,6 +18,9 @@
 #include <math.h>
 #include <time.h>
 #include <fcntl.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <unistd.h>
@@ -34,6 +37,7 @@
 #include "access/xact.h"
 #include "access/xlog_internal.h"
 #include "access/xloginsert.h"
+#include "access/xlogprefetch.h"
 #include "access/xlogreader.h"
 #include "access/xlogutils.h"
 #include "catalog/catversion.h"
@@ -43,6 +47,7 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "port/atomics.h"
+#include "portability/instr_time.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/walwriter.h"
 #include "postmaster/startup.h"
@@ -96,13 +101,14 @@ char	   *XLogArchiveCommand = NULL;
 bool		EnableHotStandby = false;
 bool		fullPageWrites = true;
 bool		wal_log_hints = false;
-bool		wal_compression = false;
+int			wal_compression = WAL_COMPRESSION_NONE;
 char	   *wal_consistency_checking_string = NULL;
 bool	   *wal_consistency_checking = NULL;
 bool		log_checkpoints = false;
 int			sync_method = DEFAULT_SYNC_METHOD;
 int			wal_level = WAL_LEVEL_MINIMAL;
-int			CommitDelay = 0;	/* precommit delay in microseconds */
+int			CommitDelay = 0;	/* precommit delay in microseconds, or -1 for
+								 * adaptive */
 int			CommitSiblings = 5; /* # concurrent xacts needed to sleep */
 int			wal_retrieve_retry_interval = 5000;
 
@@ -115,7 +121,16 @@ bool		XLOG_DEBUG = false;
  * to happen concurrently, but adds some CPU overhead to flushing the WAL,
  * which needs to iterate all the locks.
  */
-#define NUM_XLOGINSERT_LOCKS  8
+int			wal_insert_locks = 8;
+
+/*
+ * Parameters of the adaptive commit delay (commit_delay = -1): the fraction
+ * of the average flush time to wait, the longest wait in microseconds, and
+ * the weight of the moving averages of flush time and request rate.
+ */
+#define ADAPTIVE_COMMIT_DELAY_FRACTION	0.5
+#define MAX_ADAPTIVE_COMMIT_DELAY		10000
+#define COMMIT_DELAY_AVG_WEIGHT			8
 
 /*
  * Max distance from last checkpoint, before triggering a new xlog-based
@@ -165,6 +180,29 @@ const struct config_enum_entry archive_mode_options[] = {
 	{NULL, 0, false}
 };
 
+/*
+ * "on" means pglz, for compatibility with when that was the only method.
+ * Methods this build doesn't support are left out, so that they're rejected.
+ */
+const struct config_enum_entry wal_compression_options[] = {
+	{"pglz", WAL_COMPRESSION_PGLZ, false},
+#ifdef USE_LZ4
+	{"lz4", WAL_COMPRESSION_LZ4, false},
+#endif
+#ifdef USE_ZSTD
+	{"zstd", WAL_COMPRESSION_ZSTD, false},
+#endif
+	{"on", WAL_COMPRESSION_PGLZ, false},
+	{"off", WAL_COMPRESSION_NONE, false},
+	{"true", WAL_COMPRESSION_PGLZ, true},
+	{"false", WAL_COMPRESSION_NONE, true},
+	{"yes", WAL_COMPRESSION_PGLZ, true},
+	{"no", WAL_COMPRESSION_NONE, true},
+	{"1", WAL_COMPRESSION_PGLZ, true},
+	{"0", WAL_COMPRESSION_NONE, true},
+	{NULL, 0, false}
+};
+
 /*
  * Statistics for current checkpoint are collected in this global struct.
  * Because only the checkpointer or a stand-alone backend can perform
@@ -592,6 +630,16 @@ typedef struct XLogCtlData
 	pg_time_t	lastSegSwitchTime;
 	XLogRecPtr	lastSegSwitchLSN;
 
+	/*
+	 * Measurements for the adaptive commit delay.  flushRequests counts the
+	 * XLogFlush calls that had to wait for a flush since the last one was
+	 * done; the rest is protected by WALWriteLock.
+	 */
+	pg_atomic_uint32 flushRequests;
+	instr_time	lastFlushEnd;	/* when the last flush was done */
+	double		avgFlushTime;	/* average duration of a flush, in usec */
+	double		avgRequestRate; /* average flush requests per usec */
+
 	/*
 	 * Protected by info_lck and WALWriteLock (you must hold either lock to
 	 * read it, but both to update)
@@ -863,6 +911,8 @@ static XLogRecPtr XLogGetReplicationSlotMinimumLSN(void);
 static void AdvanceXLInsertBuffer(XLogRecPtr upto, bool opportunistic);
 static bool XLogCheckpointNeeded(XLogSegNo new_segno);
 static void XLogWrite(XLogwrtRqst WriteRqst, bool flexible);
+static int	AdaptiveCommitDelay(void);
+static void UpdateCommitDelayStats(instr_time start, instr_time end);
 static bool InstallXLogFileSegment(XLogSegNo *segno, char *tmppath,
 					   bool find_free, XLogSegNo max_segno,
 					   bool use_lock);
@@ -921,6 +971,7 @@ static XLogRecPtr XLogBytePosToEndRecPtr(uint64 bytepos);
 static uint64 XLogRecPtrToBytePos(XLogRecPtr ptr);
 static void checkXLogConsistency(XLogReaderState *record);
 
+static int	WALInsertLockForCPU(void);
 static void WALInsertLockAcquire(void);
 static void WALInsertLockAcquireExclusive(void);
 static void WALInsertLockRelease(void);
@@ -991,8 +1042,8 @@ XLogInsertRecord(XLogRecData *rdata,
 	 * To keep track of which insertions are still in-progress, each concurrent
 	 * inserter acquires an insertion lock. In addition to just indicating that
 	 * an insertion is in progress, the lock tells others how far the inserter
-	 * has progressed. There is a small fixed number of insertion locks,
-	 * determined by NUM_XLOGINSERT_LOCKS. When an inserter crosses a page
+	 * has progressed. There is a small number of insertion locks, set by
+	 * the wal_insert_locks GUC. When an inserter crosses a page
 	 * boundary, it updates the value stored in the lock to the how far it has
 	 * inserted, to allow the previous buffer to be flushed.
 	 *
@@ -1564,6 +1615,32 @@ CopyXLogRecordToWAL(int write_len, bool isLogSwitch, XLogRecData *rdata,
 		elog(PANIC, "space reserved for WAL record does not match what was written");
 }
 
+/*
+ * Choose a WAL insertion lock for a backend that has no preference yet.
+ *
+ * Where the OS tells us which CPU we're running on, we use the lock of that
+ * CPU, so that the lock's cache line tends to stay in the cache of that CPU,
+ * and hence in its NUMA node's memory, instead of bouncing across the
+ * interconnect.  Sharing a lock with the other backends on the same CPU is
+ * not free: if one of them is preempted while holding it, the others block
+ * until it is scheduled again.  WALInsertLockAcquire() moves on to another
+ * lock when that happens.  Otherwise, pick a lock (semi-)randomly
+ * by our PGPROC number.  That allows the locks to be used evenly if you have
+ * a lot of very short connections.
+ */
+static int
+WALInsertLockForCPU(void)
+{
+#ifdef __linux__
+	int			cpu = sched_getcpu();
+
+	if (cpu >= 0)
+		return cpu % wal_insert_locks;
+#endif
+
+	return MyProc->pgprocno % wal_insert_locks;
+}
+
 /*
  * Acquire a WAL insertion lock, for inserting to WAL.
  */
@@ -1579,14 +1656,13 @@ WALInsertLockAcquire(void)
 	 * affinity to a particular lock so that you don't unnecessarily bounce
 	 * cache lines between processes when there's no contention.
 	 *
-	 * If this is the first time through in this backend, pick a lock
-	 * (semi-)randomly.  This allows the locks to be used evenly if you have a
-	 * lot of very short connections.
+	 * If this is the first time through in this backend, pick the lock
+	 * belonging to the CPU we're running on, see WALInsertLockForCPU().
 	 */
 	static int	lockToTry = -1;
 
 	if (lockToTry == -1)
-		lockToTry = MyProc->pgprocno % NUM_XLOGINSERT_LOCKS;
+		lockToTry = WALInsertLockForCPU();
 	MyLockNo = lockToTry;
 
 	/*
@@ -1603,8 +1679,17 @@ WALInsertLockAcquire(void)
 		 * lock that no-one else is using.  On a system with more inserters
 		 * than locks, it still helps to distribute the inserters evenly
 		 * across the locks.
+		 *
+		 * Prefer the lock of the CPU we're on now, as the scheduler may have
+		 * moved us since we last chose.  If that's the lock we just waited
+		 * for, move on to the next one instead.
 		 */
-		lockToTry = (lockToTry + 1) % NUM_XLOGINSERT_LOCKS;
+		int			cpuLock = WALInsertLockForCPU();
+
+		if (cpuLock != lockToTry)
+			lockToTry = cpuLock;
+		else
+			lockToTry = (lockToTry + 1) % wal_insert_locks;
 	}
 }
 
@@ -1617,12 +1702,20 @@ WALInsertLockAcquireExclusive(void)
 {
 	int			i;
 
+	/*
+	 * We're usually in a critical section here, where running out of
+	 * LWLock slots would PANIC, and the caller may already hold a few other
+	 * LWLocks.
+	 */
+	StaticAssertStmt(MAX_WAL_INSERT_LOCKS + 64 <= MAX_SIMUL_LWLOCKS,
+					 "MAX_WAL_INSERT_LOCKS too large for MAX_SIMUL_LWLOCKS");
+
 	/*
 	 * When holding all the locks, all but the last lock's insertingAt
 	 * indicator is set to 0xFFFFFFFFFFFFFFFF, which is higher than any real
 	 * XLogRecPtr value, to make sure that no-one blocks waiting on those.
 	 */
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS - 1; i++)
+	for (i = 0; i < wal_insert_locks - 1; i++)
 	{
 		LWLockAcquire(&WALInsertLocks[i].l.lock, LW_EXCLUSIVE);
 		LWLockUpdateVar(&WALInsertLocks[i].l.lock,
@@ -1648,7 +1741,7 @@ WALInsertLockRelease(void)
 	{
 		int			i;
 
-		for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+		for (i = 0; i < wal_insert_locks; i++)
 			LWLockReleaseClearVar(&WALInsertLocks[i].l.lock,
 								  &WALInsertLocks[i].l.insertingAt,
 								  0);
@@ -1676,8 +1769,8 @@ WALInsertLockUpdateInsertingAt(XLogRecPtr insertingAt)
 		 * We use the last lock to mark our actual position, see comments in
 		 * WALInsertLockAcquireExclusive.
 		 */
-		LWLockUpdateVar(&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.lock,
-						&WALInsertLocks[NUM_XLOGINSERT_LOCKS - 1].l.insertingAt,
+		LWLockUpdateVar(&WALInsertLocks[wal_insert_locks - 1].l.lock,
+						&WALInsertLocks[wal_insert_locks - 1].l.insertingAt,
 						insertingAt);
 	}
 	else
@@ -1744,7 +1837,7 @@ WaitXLogInsertionsToFinish(XLogRecPtr upto)
 	 * out for any insertion that's still in progress.
 	 */
 	finishedUpto = reservedUpto;
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < wal_insert_locks; i++)
 	{
 		XLogRecPtr	insertingat = InvalidXLogRecPtr;
 
@@ -2784,6 +2877,10 @@ XLogFlush(XLogRecPtr record)
 			 (uint32) (LogwrtResult.Flush >> 32), (uint32) LogwrtResult.Flush);
 #endif
 
+	/* Let the adaptive commit delay know about one more flush request */
+	if (CommitDelay < 0)
+		pg_atomic_fetch_add_u32(&XLogCtl->flushRequests, 1);
+
 	START_CRIT_SECTION();
 
 	/*
@@ -2804,6 +2901,7 @@ XLogFlush(XLogRecPtr record)
 	for (;;)
 	{
 		XLogRecPtr	insertpos;
+		int			delay;
 
 		/* read LogwrtResult and update local state */
 		SpinLockAcquire(&XLogCtl->info_lck);
@@ -2855,11 +2953,13 @@ XLogFlush(XLogRecPtr record)
 		 *
 		 * We do not sleep if enableFsync is not turned on, nor if there are
 		 * fewer than CommitSiblings other backends with active transactions.
+		 * If commit_delay is -1, the delay is chosen by AdaptiveCommitDelay.
 		 */
-		if (CommitDelay > 0 && enableFsync &&
+		delay = (CommitDelay >= 0) ? CommitDelay : AdaptiveCommitDelay();
+		if (delay > 0 && enableFsync &&
 			MinimumActiveBackends(CommitSiblings))
 		{
-			pg_usleep(CommitDelay);
+			pg_usleep(delay);
 
 			/*
 			 * Re-check how far we can now flush the WAL. It's generally not
@@ -2878,7 +2978,18 @@ XLogFlush(XLogRecPtr record)
 		WriteRqst.Write = insertpos;
 		WriteRqst.Flush = insertpos;
 
-		XLogWrite(WriteRqst, false);
+		if (CommitDelay < 0 && enableFsync)
+		{
+			instr_time	start;
+			instr_time	end;
+
+			INSTR_TIME_SET_CURRENT(start);
+			XLogWrite(WriteRqst, false);
+			INSTR_TIME_SET_CURRENT(end);
+			UpdateCommitDelayStats(start, end);
+		}
+		else
+			XLogWrite(WriteRqst, false);
 
 		LWLockRelease(WALWriteLock);
 		/* done */
@@ -2918,6 +3029,69 @@ XLogFlush(XLogRecPtr record)
 			 (uint32) (LogwrtResult.Flush >> 32), (uint32) LogwrtResult.Flush);
 }
 
+/*
+ * Choose the commit delay when commit_delay is -1.  Caller must hold
+ * WALWriteLock.
+ *
+ * Waiting pays off only if other backends are going to request a flush
+ * while we wait, and they'd otherwise have to wait for the whole next flush.
+ * So we wait for a fraction of the time a flush takes, but only if at the
+ * rate flush requests have been arriving, we expect at least one more to
+ * arrive meanwhile.  With few concurrent commits, or fast flushes, that
+ * means no delay at all.
+ */
+static int
+AdaptiveCommitDelay(void)
+{
+	double		delay;
+
+	delay = XLogCtl->avgFlushTime * ADAPTIVE_COMMIT_DELAY_FRACTION;
+	if (delay < 1 || delay * XLogCtl->avgRequestRate < 1.0)
+		return 0;
+
+	return (int) Min(delay, (double) MAX_ADAPTIVE_COMMIT_DELAY);
+}
+
+/*
+ * Update the measurements AdaptiveCommitDelay works from, after a flush
+ * that lasted from 'start' to 'end'.  Caller must hold WALWriteLock.
+ *
+ * Both the flush time and the rate of flush requests are kept as moving
+ * averages, so that the delay follows changes in load, but not every
+ * hiccup.
+ */
+static void
+UpdateCommitDelayStats(instr_time start, instr_time end)
+{
+	instr_time	duration = end;
+	double		flush_time;
+	uint32		nrequests;
+
+	INSTR_TIME_SUBTRACT(duration, start);
+	flush_time = (double) INSTR_TIME_GET_MICROSEC(duration);
+	nrequests = pg_atomic_exchange_u32(&XLogCtl->flushRequests, 0);
+
+	if (XLogCtl->avgFlushTime == 0)
+		XLogCtl->avgFlushTime = flush_time;
+	else
+		XLogCtl->avgFlushTime +=
+			(flush_time - XLogCtl->avgFlushTime) / COMMIT_DELAY_AVG_WEIGHT;
+
+	if (!INSTR_TIME_IS_ZERO(XLogCtl->lastFlushEnd))
+	{
+		instr_time	interval = end;
+		double		interval_usec;
+
+		INSTR_TIME_SUBTRACT(interval, XLogCtl->lastFlushEnd);
+		interval_usec = (double) INSTR_TIME_GET_MICROSEC(interval);
+		if (interval_usec > 0)
+			XLogCtl->avgRequestRate +=
+				(nrequests / interval_usec - XLogCtl->avgRequestRate) /
+				COMMIT_DELAY_AVG_WEIGHT;
+	}
+	XLogCtl->lastFlushEnd = end;
+}
+
 /*
  * Write & flush xlog, but without specifying exactly where to.
  *
@@ -4826,7 +5000,7 @@ XLOGShmemSize(void)
 	size = sizeof(XLogCtlData);
 
 	/* WAL insertion locks, plus alignment */
-	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), NUM_XLOGINSERT_LOCKS + 1));
+	size = add_size(size, mul_size(sizeof(WALInsertLockPadded), wal_insert_locks + 1));
 	/* xlblocks array */
 	size = add_size(size, mul_size(sizeof(XLogRecPtr), XLOGbuffers));
 	/* extra alignment padding for XLOG I/O buffers */
@@ -4901,10 +5075,10 @@ XLOGShmemInit(void)
 		((uintptr_t) allocptr) % sizeof(WALInsertLockPadded);
 	WALInsertLocks = XLogCtl->Insert.WALInsertLocks =
 		(WALInsertLockPadded *) allocptr;
-	allocptr += sizeof(WALInsertLockPadded) * NUM_XLOGINSERT_LOCKS;
+	allocptr += sizeof(WALInsertLockPadded) * wal_insert_locks;
 
 	LWLockRegisterTranche(LWTRANCHE_WAL_INSERT, "wal_insert");
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < wal_insert_locks; i++)
 	{
 		LWLockInitialize(&WALInsertLocks[i].l.lock, LWTRANCHE_WAL_INSERT);
 		WALInsertLocks[i].l.insertingAt = InvalidXLogRecPtr;
@@ -4928,6 +5102,10 @@ XLOGShmemInit(void)
 	XLogCtl->SharedRecoveryInProgress = true;
 	XLogCtl->SharedHotStandbyActive = false;
 	XLogCtl->WalWriterSleeping = false;
+	pg_atomic_init_u32(&XLogCtl->flushRequests, 0);
+	INSTR_TIME_SET_ZERO(XLogCtl->lastFlushEnd);
+	XLogCtl->avgFlushTime = 0;
+	XLogCtl->avgRequestRate = 0;
 
 	SpinLockInit(&XLogCtl->Insert.insertpos_lck);
 	SpinLockInit(&XLogCtl->info_lck);
@@ -7011,6 +7189,7 @@ StartupXLOG(void)
 		{
 			ErrorContextCallback errcallback;
 			TimestampTz xtime;
+			XLogPrefetcher *prefetcher;
 
 			InRedo = true;
 
@@ -7018,6 +7197,8 @@ StartupXLOG(void)
 					(errmsg("redo starts at %X/%X",
 							(uint32) (ReadRecPtr >> 32), (uint32) ReadRecPtr)));
 
+			prefetcher = XLogPrefetcherAllocate();
+
 			/*
 			 * main redo apply loop
 			 */
@@ -7047,6 +7228,13 @@ StartupXLOG(void)
 				/* Handle interrupt signals of startup process */
 				HandleStartupProcInterrupts();
 
+				/*
+				 * Start reading the blocks that the following records will
+				 * need, if recovery_prefetch_distance is set.
+				 */
+				XLogPrefetcherReadAhead(prefetcher, ReadRecPtr,
+										xlogreader->readPageTLI);
+
 				/*
 				 * Pause WAL replay, if requested by a hot-standby session via
 				 * SetRecoveryPause().
@@ -7245,6 +7433,8 @@ StartupXLOG(void)
 			 * end of main redo apply loop
 			 */
 
+			XLogPrefetcherFree(prefetcher);
+
 			if (reachedStopPoint)
 			{
 				if (!reachedConsistency)
@@ -8247,7 +8437,7 @@ GetLastImportantRecPtr(void)
 	XLogRecPtr	res = InvalidXLogRecPtr;
 	int			i;
 
-	for (i = 0; i < NUM_XLOGINSERT_LOCKS; i++)
+	for (i = 0; i < wal_insert_locks; i++)
 	{
 		XLogRecPtr	last_important;
 
@@ -9998,16 +10188,24 @@ xlog_outdesc(StringInfo buf, XLogReaderState *record)
 
 /*
  * Return the (possible) sync flag used for opening a file, depending on the
- * value of the GUC wal_sync_method.
+ * value of the GUC wal_sync_method, plus O_DIRECT if the file should bypass
+ * the kernel cache.
  */
 static int
 get_sync_bit(int method)
 {
 	int			o_direct_flag = 0;
 
+	/*
+	 * If io_direct includes WAL, always bypass the kernel cache.  Never in
+	 * walreceiver though, see below.
+	 */
+	if ((io_direct_flags & IO_DIRECT_WAL) && !AmWalReceiverProcess())
+		o_direct_flag = PG_O_DIRECT;
+
 	/* If fsync is disabled, never open in sync mode */
 	if (!enableFsync)
-		return 0;
+		return o_direct_flag;
 
 	/*
 	 * Optimize writes by bypassing kernel cache with O_DIRECT when using
@@ -10037,7 +10235,7 @@ get_sync_bit(int method)
 		case SYNC_METHOD_FSYNC:
 		case SYNC_METHOD_FSYNC_WRITETHROUGH:
 		case SYNC_METHOD_FDATASYNC:
-			return 0;
+			return o_direct_flag;
 #ifdef OPEN_SYNC_FLAG
 		case SYNC_METHOD_OPEN:
 			return OPEN_SYNC_FLAG | o_direct_flag;
@@ -19,6 +19,13 @@
 
 #include "postgres.h"
 
+#ifdef USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
 #include "access/xact.h"
 #include "access/xlog.h"
 #include "access/xlog_internal.h"
@@ -32,9 +39,26 @@
 #include "utils/memutils.h"
 #include "pg_trace.h"
 
-/* Buffer size required to store a compressed version of backup block image */
+/*
+ * Buffer size required to store a compressed version of backup block image,
+ * with any of the compression methods we support.
+ */
 #define PGLZ_MAX_BLCKSZ PGLZ_MAX_OUTPUT(BLCKSZ)
 
+#ifdef USE_LZ4
+#define LZ4_MAX_BLCKSZ	LZ4_COMPRESSBOUND(BLCKSZ)
+#else
+#define LZ4_MAX_BLCKSZ	0
+#endif
+
+#ifdef USE_ZSTD
+#define ZSTD_MAX_BLCKSZ ZSTD_COMPRESSBOUND(BLCKSZ)
+#else
+#define ZSTD_MAX_BLCKSZ 0
+#endif
+
+#define COMPRESS_BUFSIZE	Max(Max(PGLZ_MAX_BLCKSZ, LZ4_MAX_BLCKSZ), ZSTD_MAX_BLCKSZ)
+
 /*
  * For each block reference registered with XLogRegisterBuffer, we fill in
  * a registered_buffer struct.
@@ -57,7 +81,7 @@ typedef struct
 								 * backup block data in XLogRecordAssemble() */
 
 	/* buffer to store a compressed version of backup block image */
-	char		compressed_page[PGLZ_MAX_BLCKSZ];
+	char		compressed_page[COMPRESS_BUFSIZE];
 } registered_buffer;
 
 static registered_buffer *registered_buffers;
@@ -620,7 +644,7 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 			/*
 			 * Try to compress a block image if wal_compression is enabled
 			 */
-			if (wal_compression)
+			if (wal_compression != WAL_COMPRESSION_NONE)
 			{
 				is_compressed =
 					XLogCompressBackupBlock(page, bimg.hole_offset,
@@ -655,7 +679,23 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 			if (is_compressed)
 			{
 				bimg.length = compressed_len;
-				bimg.bimg_info |= BKPIMAGE_IS_COMPRESSED;
+
+				/* record the method used, so that the reader can decode it */
+				switch ((WalCompression) wal_compression)
+				{
+					case WAL_COMPRESSION_PGLZ:
+						bimg.bimg_info |= BKPIMAGE_COMPRESS_PGLZ;
+						break;
+					case WAL_COMPRESSION_LZ4:
+						bimg.bimg_info |= BKPIMAGE_COMPRESS_LZ4;
+						break;
+					case WAL_COMPRESSION_ZSTD:
+						bimg.bimg_info |= BKPIMAGE_COMPRESS_ZSTD;
+						break;
+					case WAL_COMPRESSION_NONE:
+						Assert(false);	/* cannot happen */
+						break;
+				}
 
 				rdt_datas_last->data = regbuf->compressed_page;
 				rdt_datas_last->len = compressed_len;
@@ -795,7 +835,8 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 }
 
 /*
- * Create a compressed version of a backup block image.
+ * Create a compressed version of a backup block image, using the method
+ * selected by wal_compression.
  *
  * Returns FALSE if compression fails (i.e., compressed result is actually
  * bigger than original). Otherwise, returns TRUE and sets 'dlen' to
@@ -806,7 +847,7 @@ XLogCompressBackupBlock(char *page, uint16 hole_offset, uint16 hole_length,
 						char *dest, uint16 *dlen)
 {
 	int32		orig_len = BLCKSZ - hole_length;
-	int32		len;
+	int32		len = -1;
 	int32		extra_bytes = 0;
 	char	   *source;
 	char		tmp[BLCKSZ];
@@ -830,11 +871,46 @@ XLogCompressBackupBlock(char *page, uint16 hole_offset, uint16 hole_length,
 		source = page;
 
 	/*
-	 * We recheck the actual size even if pglz_compress() reports success and
+	 * We recheck the actual size even if the compressor reports success and
 	 * see if the number of bytes saved by compression is larger than the
 	 * length of extra data needed for the compressed version of block image.
 	 */
-	len = pglz_compress(source, orig_len, dest, PGLZ_strategy_default);
+	switch ((WalCompression) wal_compression)
+	{
+		case WAL_COMPRESSION_PGLZ:
+			len = pglz_compress(source, orig_len, dest, PGLZ_strategy_default);
+			break;
+
+		case WAL_COMPRESSION_LZ4:
+#ifdef USE_LZ4
+			len = LZ4_compress_default(source, dest, orig_len,
+									   COMPRESS_BUFSIZE);
+			if (len <= 0)
+				len = -1;		/* failure */
+#else
+			elog(ERROR, "LZ4 is not supported by this build");
+#endif
+			break;
+
+		case WAL_COMPRESSION_ZSTD:
+#ifdef USE_ZSTD
+			{
+				size_t		zlen;
+
+				zlen = ZSTD_compress(dest, COMPRESS_BUFSIZE, source, orig_len,
+									 ZSTD_CLEVEL_DEFAULT);
+				len = ZSTD_isError(zlen) ? -1 : (int32) zlen;
+			}
+#else
+			elog(ERROR, "zstd is not supported by this build");
+#endif
+			break;
+
+		case WAL_COMPRESSION_NONE:
+			Assert(false);		/* cannot happen */
+			break;
+	}
+
 	if (len >= 0 &&
 		len + extra_bytes < orig_len)
 	{
@@ -0,0 +1,484 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.c
+ *	  Prefetching of data blocks referenced by upcoming WAL records.
+ *
+ * Redo is performed by the startup process alone, one record at a time, so
+ * whenever a record touches a block that isn't in shared buffers, replay
+ * stalls until that block has been read.  With a large, mostly uncached data
+ * set the startup process spends most of its time waiting for such random
+ * reads.  To avoid that, the XLogPrefetcher decodes the WAL up to
+ * recovery_prefetch_distance bytes ahead of the record being replayed, using
+ * its own xlogreader, and issues posix_fadvise() hints for the blocks those
+ * records reference, so that the kernel can read them concurrently before
+ * replay gets there.
+ *
+ * Prefetching is only an optimization, so the prefetcher never waits for WAL
+ * and never raises errors about it: it reads only WAL that is already
+ * present in pg_wal (and, while streaming, flushed by the WAL receiver), and
+ * whenever it runs out of WAL or finds something it can't decode, it gives
+ * up until replay has caught up with it.
+ *
+ * Blocks that the record will overwrite with a full-page image or
+ * initialize from scratch don't need to be read, and neither do blocks past
+ * the current end of the relation, which replay will extend.  The
+ * prefetcher must never try to access a relation file that doesn't exist at
+ * the current replay position, so it remembers the sizes of the relation
+ * forks it has seen, and it stops reading ahead at any record that might
+ * drop or truncate relations until replay has passed it.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/access/transam/xlogprefetch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "access/rmgr.h"
+#include "access/xact.h"
+#include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
+#include "access/xlogreader.h"
+#include "catalog/storage_xlog.h"
+#include "pgstat.h"
+#include "replication/walreceiver.h"
+#include "storage/bufmgr.h"
+#include "storage/fd.h"
+#include "storage/smgr.h"
+#include "utils/hsearch.h"
+
+
+/* GUC parameter, in kB */
+int			recovery_prefetch_distance = 0;
+
+/* How many recently prefetched blocks to remember */
+#define XLOGPREFETCHER_RECENT_SIZE 8
+
+/* Identity of a block, for the recently-seen list */
+typedef struct XLogPrefetcherBlock
+{
+	RelFileNode rnode;
+	ForkNumber	forknum;
+	BlockNumber blkno;
+} XLogPrefetcherBlock;
+
+/* Hash table entry for the known size of a relation fork */
+typedef struct XLogPrefetcherRelSize
+{
+	RelFileNode rnode;			/* hash key: relation ... */
+	ForkNumber	forknum;		/* ... and fork */
+	BlockNumber nblocks;		/* size, as of when we last looked */
+} XLogPrefetcherRelSize;
+
+struct XLogPrefetcher
+{
+	XLogReaderState *reader;	/* decodes records ahead of replay */
+	bool		reading;		/* is the reader positioned? */
+	TimeLineID	tli;			/* timeline of the WAL files we read */
+	int			readFile;		/* open WAL segment, or -1 */
+	XLogSegNo	readSegNo;		/* segment number of readFile */
+
+	/* if not reading, wait until replay has reached this point */
+	XLogRecPtr	stalled_lsn;
+
+	/* if valid, wait until replay has passed this record */
+	XLogRecPtr	barrier_lsn;
+
+	/* known sizes of relation forks, reset at each barrier */
+	HTAB	   *relsizes;
+
+	/* recently seen blocks, to skip repeated references cheaply */
+	XLogPrefetcherBlock recent[XLOGPREFETCHER_RECENT_SIZE];
+	int			next_recent;
+
+	/* statistics, reported at DEBUG1 when we're done */
+	uint64		prefetched;		/* blocks we issued hints for */
+	uint64		skip_hit;		/* blocks already in shared buffers */
+	uint64		skip_new;		/* blocks that don't exist yet */
+	uint64		skip_fpw;		/* blocks that will be overwritten */
+	uint64		skip_recent;	/* blocks we saw just before */
+};
+
+static int XLogPrefetcherReadPage(XLogReaderState *reader,
+					   XLogRecPtr targetPagePtr, int reqLen,
+					   XLogRecPtr targetRecPtr, char *readBuf,
+					   TimeLineID *pageTLI);
+static void XLogPrefetcherResetRelSizes(XLogPrefetcher *prefetcher);
+static bool XLogPrefetcherIsBarrier(XLogReaderState *reader);
+static void XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher);
+static bool XLogPrefetcherBlockExists(XLogPrefetcher *prefetcher,
+						  SMgrRelation reln, ForkNumber forknum,
+						  BlockNumber blkno);
+
+/*
+ * Create a prefetcher for the startup process.  It does nothing until
+ * XLogPrefetcherReadAhead is called.
+ */
+XLogPrefetcher *
+XLogPrefetcherAllocate(void)
+{
+	XLogPrefetcher *prefetcher;
+
+	prefetcher = (XLogPrefetcher *) palloc0(sizeof(XLogPrefetcher));
+	prefetcher->reader = XLogReaderAllocate(&XLogPrefetcherReadPage,
+											prefetcher);
+	if (!prefetcher->reader)
+		ereport(ERROR,
+				(errcode(ERRCODE_OUT_OF_MEMORY),
+				 errmsg("out of memory"),
+				 errdetail("Failed while allocating a WAL reading processor.")));
+	prefetcher->reading = false;
+	prefetcher->readFile = -1;
+	prefetcher->stalled_lsn = InvalidXLogRecPtr;
+	prefetcher->barrier_lsn = InvalidXLogRecPtr;
+	XLogPrefetcherResetRelSizes(prefetcher);
+
+	return prefetcher;
+}
+
+/*
+ * Release a prefetcher's resources at the end of recovery.
+ */
+void
+XLogPrefetcherFree(XLogPrefetcher *prefetcher)
+{
+	if (prefetcher->prefetched > 0 || prefetcher->skip_hit > 0)
+		elog(DEBUG1,
+			 "recovery prefetched " UINT64_FORMAT " blocks; skipped " UINT64_FORMAT " already in buffers, "
+			 UINT64_FORMAT " not yet created, " UINT64_FORMAT " with full-page images and "
+			 UINT64_FORMAT " seen just before",
+			 prefetcher->prefetched, prefetcher->skip_hit,
+			 prefetcher->skip_new, prefetcher->skip_fpw,
+			 prefetcher->skip_recent);
+
+	if (prefetcher->readFile >= 0)
+		close(prefetcher->readFile);
+	XLogReaderFree(prefetcher->reader);
+	hash_destroy(prefetcher->relsizes);
+	pfree(prefetcher);
+}
+
+/*
+ * Issue prefetches for the blocks referenced by the WAL following the record
+ * that replay is about to apply, which starts at replay_lsn in a WAL file of
+ * timeline replay_tli.  Called by the startup process before each record.
+ */
+void
+XLogPrefetcherReadAhead(XLogPrefetcher *prefetcher, XLogRecPtr replay_lsn,
+						TimeLineID replay_tli)
+{
+	XLogReaderState *reader = prefetcher->reader;
+	XLogRecPtr	start_lsn = InvalidXLogRecPtr;
+	XLogRecPtr	horizon;
+
+	if (recovery_prefetch_distance <= 0)
+		return;
+
+	/*
+	 * If we stopped at a record that might remove relation files, wait for
+	 * replay to apply it, then forget what we knew about relation sizes.
+	 */
+	if (!XLogRecPtrIsInvalid(prefetcher->barrier_lsn))
+	{
+		if (replay_lsn <= prefetcher->barrier_lsn)
+			return;
+		prefetcher->barrier_lsn = InvalidXLogRecPtr;
+		XLogPrefetcherResetRelSizes(prefetcher);
+	}
+
+	if (!prefetcher->reading)
+	{
+		/* After running out of WAL, wait for replay to get there first */
+		if (replay_lsn < prefetcher->stalled_lsn)
+			return;
+		start_lsn = replay_lsn;
+	}
+	else if (reader->EndRecPtr < replay_lsn || replay_tli != prefetcher->tli)
+	{
+		/* We've fallen behind replay, or it has moved to a new timeline */
+		start_lsn = replay_lsn;
+	}
+
+	if (!XLogRecPtrIsInvalid(start_lsn))
+	{
+		XLogReaderInvalReadState(reader);
+		if (prefetcher->readFile >= 0)
+		{
+			close(prefetcher->readFile);
+			prefetcher->readFile = -1;
+		}
+		prefetcher->tli = replay_tli;
+		prefetcher->reading = true;
+	}
+
+	horizon = replay_lsn + (XLogRecPtr) recovery_prefetch_distance * 1024;
+
+	while (!XLogRecPtrIsInvalid(start_lsn) || reader->EndRecPtr < horizon)
+	{
+		XLogRecord *record;
+		char	   *errormsg;
+
+		record = XLogReadRecord(reader, start_lsn, &errormsg);
+		if (record == NULL)
+		{
+			/*
+			 * End of the WAL available to us, or something we can't read.
+			 * Try again once replay has caught up.  If we couldn't even read
+			 * the record replay is at, its segment isn't in pg_wal under its
+			 * usual name (it may have been restored from the archive), so
+			 * don't bother trying again before the next segment.
+			 */
+			prefetcher->reading = false;
+			if (XLogRecPtrIsInvalid(start_lsn))
+				prefetcher->stalled_lsn = reader->EndRecPtr;
+			else
+			{
+				XLogSegNo	segno;
+
+				XLByteToSeg(start_lsn, segno);
+				XLogSegNoOffsetToRecPtr(segno + 1, 0, prefetcher->stalled_lsn);
+			}
+			break;
+		}
+		start_lsn = InvalidXLogRecPtr;
+
+		if (XLogPrefetcherIsBarrier(reader))
+		{
+			prefetcher->barrier_lsn = reader->ReadRecPtr;
+			break;
+		}
+
+		/* Replay is going to read the blocks of its own record right away */
+		if (reader->ReadRecPtr > replay_lsn)
+			XLogPrefetcherScanBlocks(prefetcher);
+	}
+}
+
+/*
+ * Page read callback for the prefetcher's xlogreader.  Unlike XLogPageRead,
+ * this never waits, fetches files from the archive or reports errors; it
+ * just fails if the page isn't available in pg_wal yet.
+ */
+static int
+XLogPrefetcherReadPage(XLogReaderState *reader, XLogRecPtr targetPagePtr,
+					   int reqLen, XLogRecPtr targetRecPtr, char *readBuf,
+					   TimeLineID *pageTLI)
+{
+	XLogPrefetcher *prefetcher = (XLogPrefetcher *) reader->private_data;
+	XLogSegNo	targetSegNo;
+	uint32		targetPageOff;
+	int			readLen = XLOG_BLCKSZ;
+	int			nread;
+
+	XLByteToSeg(targetPagePtr, targetSegNo);
+	targetPageOff = targetPagePtr % XLogSegSize;
+
+	/* Don't look past what the WAL receiver has flushed */
+	if (WalRcvStreaming())
+	{
+		XLogRecPtr	receivedUpto = GetWalRcvWriteRecPtr(NULL, NULL);
+
+		if (targetPagePtr + reqLen > receivedUpto)
+			return -1;
+		if (receivedUpto - targetPagePtr < XLOG_BLCKSZ)
+			readLen = receivedUpto - targetPagePtr;
+	}
+
+	if (prefetcher->readFile >= 0 && targetSegNo != prefetcher->readSegNo)
+	{
+		close(prefetcher->readFile);
+		prefetcher->readFile = -1;
+	}
+
+	if (prefetcher->readFile < 0)
+	{
+		char		path[MAXPGPATH];
+
+		XLogFilePath(path, prefetcher->tli, targetSegNo);
+		prefetcher->readFile = BasicOpenFile(path, O_RDONLY | PG_BINARY, 0);
+		if (prefetcher->readFile < 0)
+			return -1;
+		prefetcher->readSegNo = targetSegNo;
+	}
+
+	if (lseek(prefetcher->readFile, (off_t) targetPageOff, SEEK_SET) < 0)
+		return -1;
+
+	pgstat_report_wait_start(WAIT_EVENT_WAL_READ);
+	nread = read(prefetcher->readFile, readBuf, readLen);
+	pgstat_report_wait_end();
+	if (nread < reqLen)
+		return -1;
+
+	*pageTLI = prefetcher->tli;
+	return nread;
+}
+
+/*
+ * Forget all known relation sizes.
+ */
+static void
+XLogPrefetcherResetRelSizes(XLogPrefetcher *prefetcher)
+{
+	HASHCTL		ctl;
+
+	if (prefetcher->relsizes)
+		hash_destroy(prefetcher->relsizes);
+
+	memset(&ctl, 0, sizeof(ctl));
+	ctl.keysize = offsetof(XLogPrefetcherRelSize, nblocks);
+	ctl.entrysize = sizeof(XLogPrefetcherRelSize);
+	prefetcher->relsizes = hash_create("XLogPrefetcher relation sizes", 64,
+									   &ctl, HASH_ELEM | HASH_BLOBS);
+
+	memset(prefetcher->recent, 0, sizeof(prefetcher->recent));
+	prefetcher->next_recent = 0;
+}
+
+/*
+ * Might replaying the record just decoded remove or truncate relation files?
+ * If so, we mustn't touch any relation until replay has applied it.
+ */
+static bool
+XLogPrefetcherIsBarrier(XLogReaderState *reader)
+{
+	uint8		info = XLogRecGetInfo(reader) & ~XLR_INFO_MASK;
+
+	switch (XLogRecGetRmid(reader))
+	{
+		case RM_SMGR_ID:
+			return info == XLOG_SMGR_TRUNCATE;
+
+		case RM_DBASE_ID:
+		case RM_TBLSPC_ID:
+			return true;
+
+		case RM_XACT_ID:
+			switch (info & XLOG_XACT_OPMASK)
+			{
+				case XLOG_XACT_COMMIT:
+				case XLOG_XACT_COMMIT_PREPARED:
+					{
+						xl_xact_parsed_commit parsed;
+
+						ParseCommitRecord(XLogRecGetInfo(reader),
+										  (xl_xact_commit *) XLogRecGetData(reader),
+										  &parsed);
+						return parsed.nrels > 0;
+					}
+				case XLOG_XACT_ABORT:
+				case XLOG_XACT_ABORT_PREPARED:
+					{
+						xl_xact_parsed_abort parsed;
+
+						ParseAbortRecord(XLogRecGetInfo(reader),
+										 (xl_xact_abort *) XLogRecGetData(reader),
+										 &parsed);
+						return parsed.nrels > 0;
+					}
+				default:
+					return false;
+			}
+
+		default:
+			return false;
+	}
+}
+
+/*
+ * Issue prefetches for the blocks referenced by the record just decoded.
+ */
+static void
+XLogPrefetcherScanBlocks(XLogPrefetcher *prefetcher)
+{
+	XLogReaderState *reader = prefetcher->reader;
+	int			block_id;
+
+	for (block_id = 0; block_id <= reader->max_block_id; block_id++)
+	{
+		XLogPrefetcherBlock block;
+		SMgrRelation reln;
+		int			i;
+
+		if (!XLogRecGetBlockTag(reader, block_id,
+								&block.rnode, &block.forknum, &block.blkno))
+			continue;
+
+		/* No need to read a block that replay will overwrite entirely */
+		if (XLogRecBlockImageApply(reader, block_id) ||
+			(reader->blocks[block_id].flags & BKPBLOCK_WILL_INIT) != 0)
+		{
+			prefetcher->skip_fpw++;
+			continue;
+		}
+
+		/* Successive records often touch the same few blocks */
+		for (i = 0; i < XLOGPREFETCHER_RECENT_SIZE; i++)
+		{
+			if (RelFileNodeEquals(prefetcher->recent[i].rnode, block.rnode) &&
+				prefetcher->recent[i].forknum == block.forknum &&
+				prefetcher->recent[i].blkno == block.blkno)
+				break;
+		}
+		if (i < XLOGPREFETCHER_RECENT_SIZE)
+		{
+			prefetcher->skip_recent++;
+			continue;
+		}
+		prefetcher->recent[prefetcher->next_recent] = block;
+		prefetcher->next_recent = (prefetcher->next_recent + 1) %
+			XLOGPREFETCHER_RECENT_SIZE;
+
+		reln = smgropen(block.rnode, InvalidBackendId);
+		if (!XLogPrefetcherBlockExists(prefetcher, reln, block.forknum,
+									   block.blkno))
+		{
+			prefetcher->skip_new++;
+			continue;
+		}
+
+		if (PrefetchSharedBuffer(reln, block.forknum, block.blkno))
+			prefetcher->prefetched++;
+		else
+			prefetcher->skip_hit++;
+	}
+}
+
+/*
+ * Does the given block exist at the current replay position?
+ *
+ * A relation fork that doesn't exist yet will be created by replay, and
+ * blocks past its end will be added by replay, so there's nothing to read
+ * for them.  We remember the size of each fork we've seen; it can only grow
+ * until the next barrier, so we only need to look again when a block lies
+ * beyond it.
+ */
+static bool
+XLogPrefetcherBlockExists(XLogPrefetcher *prefetcher, SMgrRelation reln,
+						  ForkNumber forknum, BlockNumber blkno)
+{
+	XLogPrefetcherRelSize key;
+	XLogPrefetcherRelSize *entry;
+
+	key.rnode = reln->smgr_rnode.node;
+	key.forknum = forknum;
+	entry = hash_search(prefetcher->relsizes, &key, HASH_FIND, NULL);
+	if (entry == NULL)
+	{
+		/* Don't remember forks that are missing; replay may create them */
+		if (!smgrexists(reln, forknum))
+			return false;
+		entry = hash_search(prefetcher->relsizes, &key, HASH_ENTER, NULL);
+		entry->nblocks = smgrnblocks(reln, forknum);
+	}
+	else if (blkno >= entry->nblocks)
+		entry->nblocks = smgrnblocks(reln, forknum);
+
+	return blkno < entry->nblocks;
+}
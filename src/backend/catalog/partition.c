@@ -105,6 +105,39 @@ typedef struct PartitionRangeBound
 	bool		lower;			/* this is the lower (vs upper) bound */
 } PartitionRangeBound;
 
+/*
+ * Tuple routing looks up the values of a list partitioned table's key in a
+ * hash table rather than by binary search, if it has at least this many.
+ */
+#define PARTITION_LIST_HASH_MIN_DATUMS	64
+
+/* Entry in a PartitionDispatch's listhash */
+typedef struct PartitionListHashEntry
+{
+	Datum		value;			/* a list bound value */
+	int			offset;			/* its offset in boundinfo->datums */
+	uint32		hash;			/* hash value (cached) */
+	char		status;			/* hash status */
+} PartitionListHashEntry;
+
+static uint32 partlisthash_hash_value(struct partlisthash_hash *tb,
+						Datum value);
+static bool partlisthash_equal(struct partlisthash_hash *tb,
+				   Datum a, Datum b);
+
+#define SH_PREFIX partlisthash
+#define SH_ELEMENT_TYPE PartitionListHashEntry
+#define SH_KEY_TYPE Datum
+#define SH_KEY value
+#define SH_HASH_KEY(tb, key) partlisthash_hash_value(tb, key)
+#define SH_EQUAL(tb, a, b) partlisthash_equal(tb, a, b)
+#define SH_SCOPE static inline
+#define SH_STORE_HASH
+#define SH_GET_HASH(tb, a) a->hash
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
 static int32 qsort_partition_list_value_cmp(const void *a, const void *b,
 							   void *arg);
 static int32 qsort_partition_rbound_cmp(const void *a, const void *b,
@@ -139,6 +172,8 @@ static int32 partition_bound_cmp(PartitionKey key,
 static int partition_bound_bsearch(PartitionKey key,
 						PartitionBoundInfo boundinfo,
 						void *probe, bool probe_is_bound, bool *is_equal);
+static int get_list_partition_bound(PartitionDispatch pd, Datum value);
+static int get_range_partition_bound(PartitionDispatch pd, Datum *values);
 
 /*
  * RelationBuildPartitionDesc
@@ -1110,6 +1145,32 @@ RelationGetPartitionDispatchInfo(Relation rel, int lockmode,
 			pd[i]->tupmap = NULL;
 		}
 		pd[i]->indexes = (int *) palloc(partdesc->nparts * sizeof(int));
+		pd[i]->last_bound = -1;
+		pd[i]->listhash = NULL;
+		pd[i]->listhashfn.fn_oid = InvalidOid;
+
+		/*
+		 * If the table has many list values, look up the hash function that
+		 * goes with the equality operator of the key's operator family, to
+		 * route tuples through a hash table.  It's only built once a tuple
+		 * is actually routed through this table.
+		 */
+		if (partkey->strategy == PARTITION_STRATEGY_LIST &&
+			partdesc->nparts > 0 &&
+			partdesc->boundinfo->ndatums >= PARTITION_LIST_HASH_MIN_DATUMS)
+		{
+			Oid			eqop;
+			RegProcedure hashproc;
+			RegProcedure righthashproc;
+
+			eqop = get_opfamily_member(partkey->partopfamily[0],
+									   partkey->partopcintype[0],
+									   partkey->partopcintype[0],
+									   BTEqualStrategyNumber);
+			if (OidIsValid(eqop) &&
+				get_op_hash_functions(eqop, &hashproc, &righthashproc))
+				fmgr_info(hashproc, &pd[i]->listhashfn);
+		}
 
 		/*
 		 * Indexes corresponding to the internal partitions are multiplied by
@@ -1937,8 +1998,7 @@ get_partition_for_tuple(PartitionDispatch *pd,
 	PartitionDispatch parent;
 	Datum		values[PARTITION_MAX_KEYS];
 	bool		isnull[PARTITION_MAX_KEYS];
-	int			cur_offset,
-				cur_index;
+	int			cur_index;
 	int			i,
 				result;
 	ExprContext *ecxt = GetPerTupleExprContext(estate);
@@ -2010,33 +2070,29 @@ get_partition_for_tuple(PartitionDispatch *pd,
 			cur_index = partdesc->boundinfo->null_index;
 		else if (!isnull[0])
 		{
-			/* Else bsearch in partdesc->boundinfo */
-			bool		equal = false;
+			int			bound;
 
-			cur_offset = partition_bound_bsearch(key, partdesc->boundinfo,
-												 values, false, &equal);
 			switch (key->strategy)
 			{
 				case PARTITION_STRATEGY_LIST:
-					if (cur_offset >= 0 && equal)
-						cur_index = partdesc->boundinfo->indexes[cur_offset];
-					else
-						cur_index = -1;
+					bound = get_list_partition_bound(parent, values[0]);
 					break;
 
 				case PARTITION_STRATEGY_RANGE:
-
-					/*
-					 * Offset returned is such that the bound at offset is
-					 * found to be less or equal with the tuple. So, the bound
-					 * at offset+1 would be the upper bound.
-					 */
-					cur_index = partdesc->boundinfo->indexes[cur_offset + 1];
+					bound = get_range_partition_bound(parent, values);
 					break;
 
 				default:
 					elog(ERROR, "unexpected partition strategy: %d",
 						 (int) key->strategy);
+					bound = -1; /* keep compiler quiet */
+			}
+
+			if (bound >= 0)
+			{
+				cur_index = partdesc->boundinfo->indexes[bound];
+				if (cur_index >= 0)
+					parent->last_bound = bound;
 			}
 		}
 
@@ -2066,6 +2122,231 @@ error_exit:
 	return result;
 }
 
+/*
+ * get_list_partition_bound
+ *		Find the list bound value equal to a tuple's partition key value
+ *
+ * Returns the bound's offset in boundinfo->datums, which is also the entry
+ * of the indexes array telling its partition, or -1 if there is none.
+ */
+static int
+get_list_partition_bound(PartitionDispatch pd, Datum value)
+{
+	PartitionKey key = pd->key;
+	PartitionBoundInfo boundinfo = pd->partdesc->boundinfo;
+	PartitionListHashEntry *entry;
+	int			offset;
+	bool		equal = false;
+
+	/* Same value as the last tuple? */
+	if (pd->last_bound >= 0 &&
+		partition_bound_cmp(key, boundinfo, pd->last_bound, &value,
+							false) == 0)
+		return pd->last_bound;
+
+	if (!OidIsValid(pd->listhashfn.fn_oid))
+	{
+		offset = partition_bound_bsearch(key, boundinfo, &value, false,
+										 &equal);
+		return (offset >= 0 && equal) ? offset : -1;
+	}
+
+	/* First time through, put all the bound values in the hash table */
+	if (pd->listhash == NULL)
+	{
+		pd->listhash = partlisthash_create(GetMemoryChunkContext(pd),
+										   boundinfo->ndatums, pd);
+		for (offset = 0; offset < boundinfo->ndatums; offset++)
+		{
+			bool		found;
+
+			entry = partlisthash_insert(pd->listhash,
+										boundinfo->datums[offset][0],
+										&found);
+			Assert(!found);
+			entry->offset = offset;
+		}
+	}
+
+	entry = partlisthash_lookup(pd->listhash, value);
+
+	return entry ? entry->offset : -1;
+}
+
+/*
+ * get_range_partition_bound
+ *		Find the range that contains a tuple's partition key values
+ *
+ * Returns the entry of boundinfo->indexes for the range that ends at the
+ * smallest bound greater than the key, or -1 if there is none (the key is
+ * >= the greatest bound).
+ */
+static int
+get_range_partition_bound(PartitionDispatch pd, Datum *values)
+{
+	PartitionKey key = pd->key;
+	PartitionBoundInfo boundinfo = pd->partdesc->boundinfo;
+	int			bound = pd->last_bound;
+	bool		equal = false;
+
+	/*
+	 * Does the key fall in the same range as the last tuple's?  That is, is
+	 * it >= the lower bound and < the upper bound of that range?
+	 */
+	if (bound >= 0 && bound < boundinfo->ndatums &&
+		(bound == 0 ||
+		 partition_bound_cmp(key, boundinfo, bound - 1, values, false) <= 0) &&
+		partition_bound_cmp(key, boundinfo, bound, values, false) > 0)
+		return bound;
+
+	/*
+	 * The bound at the offset we get is <= the key, so the one after it is
+	 * the upper bound.
+	 */
+	bound = partition_bound_bsearch(key, boundinfo, values, false,
+									&equal) + 1;
+
+	return bound < boundinfo->ndatums ? bound : -1;
+}
+
+/*
+ * Hash and equality functions for a PartitionDispatch's listhash.  Values
+ * are compared with the btree comparison function of the partition key, so
+ * that they're equal exactly when the binary search would find them so.
+ */
+static uint32
+partlisthash_hash_value(struct partlisthash_hash *tb, Datum value)
+{
+	PartitionDispatch pd = (PartitionDispatch) tb->private_data;
+
+	return DatumGetUInt32(FunctionCall1Coll(&pd->listhashfn,
+											pd->key->partcollation[0],
+											value));
+}
+
+static bool
+partlisthash_equal(struct partlisthash_hash *tb, Datum a, Datum b)
+{
+	PartitionDispatch pd = (PartitionDispatch) tb->private_data;
+
+	return DatumGetInt32(FunctionCall2Coll(&pd->key->partsupfunc[0],
+										   pd->key->partcollation[0],
+										   a, b)) == 0;
+}
+
+/*
+ * get_partitions_for_key_value
+ *		Find the partitions that may contain rows whose partition key
+ *		satisfies "key <strategy> value"
+ *
+ * Returns the set of indexes in partdesc of those partitions.  The key must
+ * have a single column, and strategy is a btree strategy number of an
+ * operator of the key's operator family whose inputs are both of the key's
+ * operator class input type.  As such operators are strict, a null value
+ * matches no partition.
+ */
+Bitmapset *
+get_partitions_for_key_value(PartitionKey key, PartitionDesc partdesc,
+							 StrategyNumber strategy,
+							 Datum value, bool isnull)
+{
+	PartitionBoundInfo boundinfo = partdesc->boundinfo;
+	Bitmapset  *result = NULL;
+	bool		equal = false;
+	int			offset;
+	int			lo,
+				hi,
+				i;
+
+	Assert(key->partnatts == 1);
+
+	if (isnull || partdesc->nparts == 0)
+		return NULL;
+
+	/* Find the greatest bound that is <= value */
+	offset = partition_bound_bsearch(key, boundinfo, &value, false, &equal);
+
+	switch (key->strategy)
+	{
+		case PARTITION_STRATEGY_LIST:
+
+			/*
+			 * datums[i] is the value accepted by partition indexes[i], so
+			 * we want the partitions of the datums satisfying the condition.
+			 */
+			lo = 0;
+			hi = boundinfo->ndatums - 1;
+			switch (strategy)
+			{
+				case BTLessStrategyNumber:
+					hi = equal ? offset - 1 : offset;
+					break;
+				case BTLessEqualStrategyNumber:
+					hi = offset;
+					break;
+				case BTEqualStrategyNumber:
+					lo = offset;
+					hi = equal ? offset : offset - 1;
+					break;
+				case BTGreaterEqualStrategyNumber:
+					lo = equal ? offset : offset + 1;
+					break;
+				case BTGreaterStrategyNumber:
+					lo = offset + 1;
+					break;
+				default:
+					elog(ERROR, "invalid btree strategy number: %d",
+						 (int) strategy);
+			}
+			break;
+
+		case PARTITION_STRATEGY_RANGE:
+
+			/*
+			 * indexes[i] is the partition, if any, accepting the values from
+			 * datums[i - 1] up to but not including datums[i]; the first and
+			 * last entries are unbounded below and above, respectively.
+			 */
+			lo = 0;
+			hi = boundinfo->ndatums;
+			switch (strategy)
+			{
+				case BTLessStrategyNumber:
+					hi = equal ? offset : offset + 1;
+					break;
+				case BTLessEqualStrategyNumber:
+					hi = offset + 1;
+					break;
+				case BTEqualStrategyNumber:
+					lo = hi = offset + 1;
+					break;
+				case BTGreaterEqualStrategyNumber:
+				case BTGreaterStrategyNumber:
+					lo = offset + 1;
+					break;
+				default:
+					elog(ERROR, "invalid btree strategy number: %d",
+						 (int) strategy);
+			}
+			break;
+
+		default:
+			elog(ERROR, "unexpected partition strategy: %d",
+				 (int) key->strategy);
+			lo = 0;				/* keep compiler quiet */
+			hi = -1;
+			break;
+	}
+
+	for (i = lo; i <= hi; i++)
+	{
+		if (boundinfo->indexes[i] >= 0)
+			result = bms_add_member(result, boundinfo->indexes[i]);
+	}
+
+	return result;
+}
+
 /*
  * qsort_partition_list_value_cmp
  *
@@ -80,6 +80,8 @@ static void show_upper_qual(List *qual, const char *qlabel,
 				ExplainState *es);
 static void show_sort_keys(SortState *sortstate, List *ancestors,
 			   ExplainState *es);
+static void show_incremental_sort_keys(IncrementalSortState *incrsortstate,
+						   List *ancestors, ExplainState *es);
 static void show_merge_append_keys(MergeAppendState *mstate, List *ancestors,
 					   ExplainState *es);
 static void show_agg_keys(AggState *astate, List *ancestors,
@@ -101,7 +103,14 @@ static void show_sortorder_options(StringInfo buf, Node *sortexpr,
 static void show_tablesample(TableSampleClause *tsc, PlanState *planstate,
 				 List *ancestors, ExplainState *es);
 static void show_sort_info(SortState *sortstate, ExplainState *es);
+static void show_resultcache_keys(ResultCacheState *rcstate, List *ancestors,
+					  ExplainState *es);
+static void show_resultcache_info(ResultCacheState *rcstate,
+					  ExplainState *es);
+static void show_incremental_sort_info(IncrementalSortState *incrsortstate,
+						   ExplainState *es);
 static void show_hash_info(HashState *hashstate, ExplainState *es);
+static void show_hashagg_info(AggState *aggstate, ExplainState *es);
 static void show_tidbitmap_info(BitmapHeapScanState *planstate,
 					ExplainState *es);
 static void show_instrumentation_count(const char *qlabel, int which,
@@ -116,7 +125,7 @@ static void ExplainModifyTarget(ModifyTable *plan, ExplainState *es);
 static void ExplainTargetRel(Plan *plan, Index rti, ExplainState *es);
 static void show_modifytable_info(ModifyTableState *mtstate, List *ancestors,
 					  ExplainState *es);
-static void ExplainMemberNodes(List *plans, PlanState **planstates,
+static void ExplainMemberNodes(PlanState **planstates, int nplans,
 				   List *ancestors, ExplainState *es);
 static void ExplainSubPlans(List *plans, List *ancestors,
 				const char *relationship, ExplainState *es);
@@ -1000,9 +1009,15 @@ ExplainNode(PlanState *planstate, List *ancestors,
 		case T_Material:
 			pname = sname = "Materialize";
 			break;
+		case T_ResultCache:
+			pname = sname = "Result Cache";
+			break;
 		case T_Sort:
 			pname = sname = "Sort";
 			break;
+		case T_IncrementalSort:
+			pname = sname = "Incremental Sort";
+			break;
 		case T_Group:
 			pname = sname = "Group";
 			break;
@@ -1581,6 +1596,8 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			if (plan->qual)
 				show_instrumentation_count("Rows Removed by Filter", 1,
 										   planstate, es);
+			if (es->analyze)
+				show_hashagg_info(castNode(AggState, planstate), es);
 			break;
 		case T_Group:
 			show_group_keys(castNode(GroupState, planstate), ancestors, es);
@@ -1593,10 +1610,32 @@ ExplainNode(PlanState *planstate, List *ancestors,
 			show_sort_keys(castNode(SortState, planstate), ancestors, es);
 			show_sort_info(castNode(SortState, planstate), es);
 			break;
+		case T_IncrementalSort:
+			show_incremental_sort_keys(castNode(IncrementalSortState, planstate),
+									   ancestors, es);
+			show_incremental_sort_info(castNode(IncrementalSortState, planstate),
+									   es);
+			break;
 		case T_MergeAppend:
 			show_merge_append_keys(castNode(MergeAppendState, planstate),
 								   ancestors, es);
 			break;
+		case T_Append:
+			{
+				int			nremoved;
+
+				/* Say how many subplans partition pruning left out */
+				nremoved = list_length(((Append *) plan)->appendplans) -
+					((AppendState *) planstate)->as_nplans;
+				if (nremoved > 0)
+					ExplainPropertyLong("Subplans Removed", nremoved, es);
+			}
+			break;
+		case T_ResultCache:
+			show_resultcache_keys(castNode(ResultCacheState, planstate),
+								  ancestors, es);
+			show_resultcache_info(castNode(ResultCacheState, planstate), es);
+			break;
 		case T_Result:
 			show_upper_qual((List *) ((Result *) plan)->resconstantqual,
 							"One-Time Filter", planstate, ancestors, es);
@@ -1725,28 +1764,28 @@ ExplainNode(PlanState *planstate, List *ancestors,
 	switch (nodeTag(plan))
 	{
 		case T_ModifyTable:
-			ExplainMemberNodes(((ModifyTable *) plan)->plans,
-							   ((ModifyTableState *) planstate)->mt_plans,
+			ExplainMemberNodes(((ModifyTableState *) planstate)->mt_plans,
+							   list_length(((ModifyTable *) plan)->plans),
 							   ancestors, es);
 			break;
 		case T_Append:
-			ExplainMemberNodes(((Append *) plan)->appendplans,
-							   ((AppendState *) planstate)->appendplans,
+			ExplainMemberNodes(((AppendState *) planstate)->appendplans,
+							   ((AppendState *) planstate)->as_nplans,
 							   ancestors, es);
 			break;
 		case T_MergeAppend:
-			ExplainMemberNodes(((MergeAppend *) plan)->mergeplans,
-							   ((MergeAppendState *) planstate)->mergeplans,
+			ExplainMemberNodes(((MergeAppendState *) planstate)->mergeplans,
+							   list_length(((MergeAppend *) plan)->mergeplans),
 							   ancestors, es);
 			break;
 		case T_BitmapAnd:
-			ExplainMemberNodes(((BitmapAnd *) plan)->bitmapplans,
-							   ((BitmapAndState *) planstate)->bitmapplans,
+			ExplainMemberNodes(((BitmapAndState *) planstate)->bitmapplans,
+							   list_length(((BitmapAnd *) plan)->bitmapplans),
 							   ancestors, es);
 			break;
 		case T_BitmapOr:
-			ExplainMemberNodes(((BitmapOr *) plan)->bitmapplans,
-							   ((BitmapOrState *) planstate)->bitmapplans,
+			ExplainMemberNodes(((BitmapOrState *) planstate)->bitmapplans,
+							   list_length(((BitmapOr *) plan)->bitmapplans),
 							   ancestors, es);
 			break;
 		case T_SubqueryScan:
@@ -1926,6 +1965,27 @@ show_sort_keys(SortState *sortstate, List *ancestors, ExplainState *es)
 						 ancestors, es);
 }
 
+/*
+ * Likewise, for an IncrementalSort node; also show which of the keys the
+ * input is already sorted on.
+ */
+static void
+show_incremental_sort_keys(IncrementalSortState *incrsortstate,
+						   List *ancestors, ExplainState *es)
+{
+	IncrementalSort *plan = (IncrementalSort *) incrsortstate->ss.ps.plan;
+
+	show_sort_group_keys((PlanState *) incrsortstate, "Sort Key",
+						 plan->sort.numCols, plan->sort.sortColIdx,
+						 plan->sort.sortOperators, plan->sort.collations,
+						 plan->sort.nullsFirst,
+						 ancestors, es);
+	show_sort_group_keys((PlanState *) incrsortstate, "Presorted Key",
+						 plan->presortedCols, plan->sort.sortColIdx,
+						 NULL, NULL, NULL,
+						 ancestors, es);
+}
+
 /*
  * Likewise, for a MergeAppend node.
  */
@@ -1942,6 +2002,34 @@ show_merge_append_keys(MergeAppendState *mstate, List *ancestors,
 						 ancestors, es);
 }
 
+/*
+ * Show the cache key of a ResultCache node, that is, the expressions the
+ * parameters of its subplan are computed from.
+ */
+static void
+show_resultcache_keys(ResultCacheState *rcstate, List *ancestors,
+					  ExplainState *es)
+{
+	ResultCache *plan = (ResultCache *) rcstate->ss.ps.plan;
+	List	   *context;
+	List	   *result = NIL;
+	bool		useprefix;
+	ListCell   *lc;
+
+	/* Set up deparsing context */
+	context = set_deparse_context_planstate(es->deparse_cxt,
+											(Node *) rcstate,
+											ancestors);
+	useprefix = list_length(es->rtable) > 1;
+
+	foreach(lc, plan->param_exprs)
+		result = lappend(result,
+						 deparse_expression((Node *) lfirst(lc), context,
+											useprefix, false));
+
+	ExplainPropertyList("Cache Key", result, es);
+}
+
 /*
  * Show the grouping keys for an Agg node.
  */
@@ -2304,6 +2392,68 @@ show_sort_info(SortState *sortstate, ExplainState *es)
 	}
 }
 
+/*
+ * If it's EXPLAIN ANALYZE, show how many batches an IncrementalSort node
+ * sorted, and the space used by the largest of them.
+ */
+static void
+show_incremental_sort_info(IncrementalSortState *incrsortstate,
+						   ExplainState *es)
+{
+	if (es->analyze && incrsortstate->nbatches > 0)
+	{
+		if (es->format == EXPLAIN_FORMAT_TEXT)
+		{
+			appendStringInfoSpaces(es->str, es->indent * 2);
+			appendStringInfo(es->str,
+							 "Sort Batches: " INT64_FORMAT "  Peak %s: %ldkB\n",
+							 incrsortstate->nbatches,
+							 incrsortstate->maxSpaceType,
+							 incrsortstate->maxSpaceUsed);
+		}
+		else
+		{
+			ExplainPropertyLong("Sort Batches", incrsortstate->nbatches, es);
+			ExplainPropertyLong("Peak Sort Space Used",
+								incrsortstate->maxSpaceUsed, es);
+			ExplainPropertyText("Peak Sort Space Type",
+								incrsortstate->maxSpaceType, es);
+		}
+	}
+}
+
+/*
+ * If it's EXPLAIN ANALYZE, show how well a ResultCache node's cache worked.
+ */
+static void
+show_resultcache_info(ResultCacheState *rcstate, ExplainState *es)
+{
+	long		memPeakKb = (rcstate->mem_peak + 1023) / 1024;
+
+	if (!es->analyze)
+		return;
+
+	if (es->format == EXPLAIN_FORMAT_TEXT)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str,
+						 "Hits: " UINT64_FORMAT "  Misses: " UINT64_FORMAT
+						 "  Evictions: " UINT64_FORMAT "  Overflows: " UINT64_FORMAT
+						 "  Memory Usage: %ldkB\n",
+						 rcstate->cache_hits, rcstate->cache_misses,
+						 rcstate->cache_evictions, rcstate->cache_overflows,
+						 memPeakKb);
+	}
+	else
+	{
+		ExplainPropertyLong("Cache Hits", rcstate->cache_hits, es);
+		ExplainPropertyLong("Cache Misses", rcstate->cache_misses, es);
+		ExplainPropertyLong("Cache Evictions", rcstate->cache_evictions, es);
+		ExplainPropertyLong("Cache Overflows", rcstate->cache_overflows, es);
+		ExplainPropertyLong("Peak Memory Usage", memPeakKb, es);
+	}
+}
+
 /*
  * Show information on hash buckets/batches.
  */
@@ -2351,6 +2501,30 @@ show_hash_info(HashState *hashstate, ExplainState *es)
 	}
 }
 
+/*
+ * If it's EXPLAIN ANALYZE, show disk usage of a hash aggregate that spilled
+ */
+static void
+show_hashagg_info(AggState *aggstate, ExplainState *es)
+{
+	long		diskKb = (aggstate->hash_disk_used + 1023) / 1024;
+
+	if (!aggstate->hash_spill_enabled)
+		return;
+
+	if (es->format != EXPLAIN_FORMAT_TEXT)
+	{
+		ExplainPropertyLong("HashAgg Batches", aggstate->hash_batches_used, es);
+		ExplainPropertyLong("Disk Usage", diskKb, es);
+	}
+	else if (aggstate->hash_batches_used > 0)
+	{
+		appendStringInfoSpaces(es->str, es->indent * 2);
+		appendStringInfo(es->str, "Batches: %d  Disk Usage: %ldkB\n",
+						 aggstate->hash_batches_used, diskKb);
+	}
+}
+
 /*
  * If it's EXPLAIN ANALYZE, show exact/lossy pages for a BitmapHeapScan node
  */
@@ -2910,14 +3084,13 @@ show_modifytable_info(ModifyTableState *mtstate, List *ancestors,
  * The ancestors list should already contain the immediate parent of these
  * plans.
  *
- * Note: we don't actually need to examine the Plan list members, but
- * we need the list in order to determine the length of the PlanState array.
+ * nplans is the length of the PlanState array, which for an Append may be
+ * shorter than its list of Plans, if partitions were pruned at startup.
  */
 static void
-ExplainMemberNodes(List *plans, PlanState **planstates,
+ExplainMemberNodes(PlanState **planstates, int nplans,
 				   List *ancestors, ExplainState *es)
 {
-	int			nplans = list_length(plans);
 	int			j;
 
 	for (j = 0; j < nplans; j++)
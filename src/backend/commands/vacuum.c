@@ -60,6 +60,16 @@ int			vacuum_freeze_table_age;
 int			vacuum_multixact_freeze_min_age;
 int			vacuum_multixact_freeze_table_age;
 
+/*
+ * While the indexes of a table are vacuumed in parallel, the leader and the
+ * workers point these at their shared cost balance and at the number of
+ * participants; see compute_parallel_delay.  VacuumCostBalanceLocal is what
+ * this participant has added to the shared balance since it last slept.
+ */
+pg_atomic_uint32 *VacuumSharedCostBalance = NULL;
+pg_atomic_uint32 *VacuumActiveNWorkers = NULL;
+int			VacuumCostBalanceLocal = 0;
+
 
 /* A few variables that don't seem worth passing around as parameters */
 static MemoryContext vac_context = NULL;
@@ -74,6 +84,7 @@ static void vac_truncate_clog(TransactionId frozenXID,
 				  MultiXactId lastSaneMinMulti);
 static bool vacuum_rel(Oid relid, RangeVar *relation, int options,
 		   VacuumParams *params);
+static int	compute_parallel_delay(void);
 
 /*
  * Primary entry point for manual VACUUM and ANALYZE commands
@@ -288,6 +299,9 @@ vacuum(int options, RangeVar *relation, Oid relid, VacuumParams *params,
 		in_vacuum = true;
 		VacuumCostActive = (VacuumCostDelay > 0);
 		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
 		VacuumPageHit = 0;
 		VacuumPageMiss = 0;
 		VacuumPageDirty = 0;
@@ -333,6 +347,8 @@ vacuum(int options, RangeVar *relation, Oid relid, VacuumParams *params,
 	{
 		in_vacuum = false;
 		VacuumCostActive = false;
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
@@ -1559,16 +1575,26 @@ vac_close_indexes(int nindexes, Relation *Irel, LOCKMODE lockmode)
 void
 vacuum_delay_point(void)
 {
+	int			msec = 0;
+
 	/* Always check for interrupts */
 	CHECK_FOR_INTERRUPTS();
 
-	/* Nap if appropriate */
-	if (VacuumCostActive && !InterruptPending &&
-		VacuumCostBalance >= VacuumCostLimit)
-	{
-		int			msec;
+	if (!VacuumCostActive || InterruptPending)
+		return;
 
+	/*
+	 * The participants of a parallel vacuum share one balance, so they have
+	 * to work out together who sleeps.
+	 */
+	if (VacuumSharedCostBalance != NULL)
+		msec = compute_parallel_delay();
+	else if (VacuumCostBalance >= VacuumCostLimit)
 		msec = VacuumCostDelay * VacuumCostBalance / VacuumCostLimit;
+
+	/* Nap if appropriate */
+	if (msec > 0)
+	{
 		if (msec > VacuumCostDelay * 4)
 			msec = VacuumCostDelay * 4;
 
@@ -1583,3 +1609,40 @@ vacuum_delay_point(void)
 		CHECK_FOR_INTERRUPTS();
 	}
 }
+
+/*
+ * compute_parallel_delay --- how long to nap in a parallel vacuum.
+ *
+ * The leader and the workers add what they have spent to the shared
+ * balance, so that together they stay within VacuumCostLimit.  Once the
+ * shared balance reaches the limit, a participant naps in proportion to what
+ * it has added itself since its last nap, and takes that off the shared
+ * balance.  A participant that has spent less than half its share of the
+ * limit doesn't nap, so that the ones doing the most I/O are the ones that
+ * get throttled.
+ */
+static int
+compute_parallel_delay(void)
+{
+	int			msec = 0;
+	uint32		shared_balance;
+	int			nworkers;
+
+	shared_balance = pg_atomic_add_fetch_u32(VacuumSharedCostBalance,
+											 VacuumCostBalance);
+	nworkers = Max(pg_atomic_read_u32(VacuumActiveNWorkers), 1);
+
+	VacuumCostBalanceLocal += VacuumCostBalance;
+	VacuumCostBalance = 0;
+
+	if (shared_balance >= VacuumCostLimit &&
+		VacuumCostBalanceLocal > 0.5 * ((double) VacuumCostLimit / nworkers))
+	{
+		msec = VacuumCostDelay * VacuumCostBalanceLocal / VacuumCostLimit;
+		pg_atomic_sub_fetch_u32(VacuumSharedCostBalance,
+								VacuumCostBalanceLocal);
+		VacuumCostBalanceLocal = 0;
+	}
+
+	return msec;
+}
@@ -4,23 +4,33 @@
  *	  Concurrent ("lazy") vacuuming.
  *
  *
- * The major space usage for LAZY VACUUM is storage for the array of dead tuple
- * TIDs.  We want to ensure we can vacuum even the very largest relations with
+ * The major space usage for LAZY VACUUM is storage for the dead tuple TIDs.
+ * We want to ensure we can vacuum even the very largest relations with
  * finite memory space usage.  To do that, we set upper bounds on the number of
  * tuples we will keep track of at once.
  *
  * We are willing to use at most maintenance_work_mem (or perhaps
  * autovacuum_work_mem) memory space to keep track of dead tuples.  We
- * initially allocate an array of TIDs of that size, with an upper limit that
+ * initially allocate a TidStore of that size, with an upper limit that
  * depends on table size (this limit ensures we don't allocate a huge area
- * uselessly for vacuuming small tables).  If the array threatens to overflow,
+ * uselessly for vacuuming small tables).  If the store threatens to overflow,
  * we suspend the heap scan phase and perform a pass of index cleanup and page
- * compaction, then resume the heap scan with an empty TID array.
+ * compaction, then resume the heap scan with an empty store.  Since the
+ * store keeps the dead tuples of each page in a compact form, that happens
+ * much less often than it would with a plain array of TIDs.
  *
  * If we're processing a table with no indexes, we can just vacuum each page
  * as we go; there's no need to save up multiple tuples to minimize the number
  * of index scans performed.  So we don't use maintenance_work_mem memory for
- * the TID array, just enough to hold as many heap tuples as fit on one page.
+ * the store at all.
+ *
+ * If the table has several indexes, we may vacuum them in parallel.  The
+ * store is then placed in a dynamic shared memory segment, and for each
+ * round of index vacuuming or cleanup we launch parallel workers, which
+ * together with the leader take the indexes one at a time until all are
+ * done.  The index AMs' statistics are kept in the segment, so that they're
+ * passed to the next round whoever processes it.  The heap itself is always
+ * scanned and vacuumed by the leader alone.
  *
  *
  * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
@@ -41,8 +51,11 @@
 #include "access/heapam_xlog.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
+#include "access/tidstore.h"
 #include "access/transam.h"
 #include "access/visibilitymap.h"
+#include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/catalog.h"
 #include "catalog/storage.h"
@@ -50,12 +63,14 @@
 #include "commands/progress.h"
 #include "commands/vacuum.h"
 #include "miscadmin.h"
+#include "optimizer/paths.h"
 #include "pgstat.h"
 #include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/proc.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
@@ -84,13 +99,6 @@
 #define VACUUM_TRUNCATE_LOCK_WAIT_INTERVAL		50	/* ms */
 #define VACUUM_TRUNCATE_LOCK_TIMEOUT			5000	/* ms */
 
-/*
- * Guesstimation of number of dead tuples per page.  This is used to
- * provide an upper limit to memory allocated when vacuuming small
- * tables.
- */
-#define LAZY_ALLOC_TUPLES		MaxHeapTuplesPerPage
-
 /*
  * Before we consider skipping a page that's marked as clean in
  * visibility map, we must've seen at least this many clean pages.
@@ -103,6 +111,49 @@
  */
 #define PREFETCH_SIZE			((BlockNumber) 32)
 
+/* DSM keys for parallel index vacuuming */
+#define PARALLEL_VACUUM_KEY_SHARED			UINT64CONST(0xB000000000000001)
+#define PARALLEL_VACUUM_KEY_DEAD_TUPLES		UINT64CONST(0xB000000000000002)
+
+/*
+ * Statistics of one index, kept in shared memory across the rounds of
+ * parallel index vacuuming.  'updated' is false until the index AM has
+ * returned some; the AMs treat NULL stats as meaning nothing's been done yet.
+ */
+typedef struct LVSharedIndStats
+{
+	bool		updated;		/* are the stats valid? */
+	IndexBulkDeleteResult stats;
+} LVSharedIndStats;
+
+/*
+ * Shared state for parallel index vacuuming, set up by the leader before
+ * each round.
+ */
+typedef struct LVShared
+{
+	Oid			relid;			/* the table being vacuumed */
+	int			elevel;			/* log level of the vacuum */
+	bool		for_cleanup;	/* index cleanup, rather than bulk deletion? */
+	double		reltuples;		/* num_heap_tuples for the index AMs */
+	bool		estimated_count;	/* is reltuples only an estimate? */
+	int			cost_delay;		/* leader's VacuumCostDelay */
+	int			cost_limit;		/* leader's VacuumCostLimit */
+	pg_atomic_uint32 cost_balance;	/* shared VacuumCostBalance */
+	pg_atomic_uint32 active_nworkers;	/* # of participants at work */
+	pg_atomic_uint32 nextidx;	/* next index to process */
+	int			nindexes;
+	LVSharedIndStats indstats[FLEXIBLE_ARRAY_MEMBER];
+} LVShared;
+
+/* Leader's private state for parallel index vacuuming */
+typedef struct LVParallelState
+{
+	ParallelContext *pcxt;
+	LVShared   *lvshared;
+	bool		relaunch;		/* must reinitialize the DSM before launch? */
+} LVParallelState;
+
 typedef struct LVRelStats
 {
 	/* hasindex = true means two-pass strategy; false means one-pass */
@@ -121,11 +172,11 @@ typedef struct LVRelStats
 	BlockNumber pages_removed;
 	double		tuples_deleted;
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
-	/* List of TIDs of tuples we intend to delete */
-	/* NB: this list is ordered by TID address */
-	int			num_dead_tuples;	/* current # of entries */
-	int			max_dead_tuples;	/* # slots allocated in array */
-	ItemPointer dead_tuples;	/* array of ItemPointerData */
+	/* TIDs of tuples we intend to delete */
+	TidStore   *dead_tuples;
+	/* dead tuples of the page being scanned, not yet in dead_tuples */
+	int			num_page_dead;
+	OffsetNumber page_dead[MaxHeapTuplesPerPage];
 	int			num_index_scans;
 	TransactionId latestRemovedXid;
 	bool		lock_waiter_detected;
@@ -148,25 +199,47 @@ static void lazy_scan_heap(Relation onerel, int options,
 			   bool aggressive);
 static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats);
 static bool lazy_check_needs_freeze(Buffer buf, bool *hastup);
+static void lazy_vacuum_all_indexes(Relation *Irel, int nindexes,
+						IndexBulkDeleteResult **stats,
+						LVRelStats *vacrelstats, LVParallelState *lps);
+static void lazy_cleanup_all_indexes(Relation *Irel, int nindexes,
+						 IndexBulkDeleteResult **stats,
+						 LVRelStats *vacrelstats, LVParallelState *lps);
 static void lazy_vacuum_index(Relation indrel,
 				  IndexBulkDeleteResult **stats,
-				  LVRelStats *vacrelstats);
+				  TidStore *dead_tuples, double reltuples);
 static void lazy_cleanup_index(Relation indrel,
-				   IndexBulkDeleteResult *stats,
-				   LVRelStats *vacrelstats);
-static int lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer);
+				   IndexBulkDeleteResult **stats,
+				   double reltuples, bool estimated_count);
+static void lazy_update_index_stats(Relation indrel,
+						IndexBulkDeleteResult *stats, PGRUsage *ru0);
+static void lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
+				 OffsetNumber *deadoffsets, int ndeadoffsets,
+				 LVRelStats *vacrelstats, Buffer *vmbuffer);
 static bool should_attempt_truncation(LVRelStats *vacrelstats);
 static void lazy_truncate_heap(Relation onerel, LVRelStats *vacrelstats);
 static BlockNumber count_nondeletable_pages(Relation onerel,
 						 LVRelStats *vacrelstats);
-static void lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks);
+static LVParallelState *lazy_space_alloc(Relation onerel,
+				 LVRelStats *vacrelstats, BlockNumber relblocks,
+				 Relation *Irel, int nindexes);
 static void lazy_record_dead_tuple(LVRelStats *vacrelstats,
-					   ItemPointer itemptr);
+					   OffsetNumber offnum);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
 static bool heap_page_is_all_visible(Relation rel, Buffer buf,
 						 TransactionId *visibility_cutoff_xid, bool *all_frozen);
+static int compute_parallel_workers(Relation onerel, Relation *Irel,
+						 int nindexes);
+static LVParallelState *begin_parallel_vacuum(Oid relid, LVRelStats *vacrelstats,
+					  BlockNumber nblocks, Size maxbytes,
+					  int nindexes, int nrequested);
+static void end_parallel_vacuum(LVParallelState *lps, LVRelStats *vacrelstats,
+					IndexBulkDeleteResult **stats, int nindexes);
+static void lazy_parallel_vacuum_indexes(Relation *Irel, int nindexes,
+							 LVRelStats *vacrelstats, LVParallelState *lps,
+							 bool for_cleanup);
+static void parallel_vacuum_indexes(Relation *Irel, int nindexes,
+						LVShared *lvshared, TidStore *dead_tuples);
 
 
 /*
@@ -469,6 +542,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 				nkeep,
 				nunused;
 	IndexBulkDeleteResult **indstats;
+	LVParallelState *lps;
 	int			i;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
@@ -504,13 +578,13 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 	vacrelstats->nonempty_pages = 0;
 	vacrelstats->latestRemovedXid = InvalidTransactionId;
 
-	lazy_space_alloc(vacrelstats, nblocks);
+	lps = lazy_space_alloc(onerel, vacrelstats, nblocks, Irel, nindexes);
 	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
 
 	/* Report that we're scanning the heap, advertising total # of blocks */
 	initprog_val[0] = PROGRESS_VACUUM_PHASE_SCAN_HEAP;
 	initprog_val[1] = nblocks;
-	initprog_val[2] = vacrelstats->max_dead_tuples;
+	initprog_val[2] = TidStoreMaxTids(vacrelstats->dead_tuples);
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
 	/*
@@ -594,7 +668,6 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 					maxoff;
 		bool		tupgone,
 					hastup;
-		int			prev_dead_count;
 		int			nfrozen;
 		Size		freespace;
 		bool		all_visible_according_to_vm = false;
@@ -688,8 +761,8 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		 * If we are close to overrunning the available space for dead-tuple
 		 * TIDs, pause and do a cycle of vacuuming before we tackle this page.
 		 */
-		if ((vacrelstats->max_dead_tuples - vacrelstats->num_dead_tuples) < MaxHeapTuplesPerPage &&
-			vacrelstats->num_dead_tuples > 0)
+		if (TidStoreIsFull(vacrelstats->dead_tuples) &&
+			TidStoreNumTids(vacrelstats->dead_tuples) > 0)
 		{
 			const int	hvp_index[] = {
 				PROGRESS_VACUUM_PHASE,
@@ -717,10 +790,8 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 										 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
 
 			/* Remove index entries */
-			for (i = 0; i < nindexes; i++)
-				lazy_vacuum_index(Irel[i],
-								  &indstats[i],
-								  vacrelstats);
+			lazy_vacuum_all_indexes(Irel, nindexes, indstats,
+									vacrelstats, lps);
 
 			/*
 			 * Report that we are now vacuuming the heap.  We also increase
@@ -740,7 +811,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			TidStoreReset(vacrelstats->dead_tuples);
 			vacrelstats->num_index_scans++;
 
 			/* Report that we are once again scanning the heap */
@@ -829,17 +900,21 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		if (PageIsNew(page))
 		{
 			/*
-			 * An all-zeroes page could be left over if a backend extends the
-			 * relation but crashes before initializing the page. Reclaim such
-			 * pages for use.
+			 * All-zeroes pages are normal: when there's contention for the
+			 * relation extension lock, RelationGetBufferForTuple adds blocks
+			 * that are only initialized when they're first used, and a bulk
+			 * load may leave some of the blocks it reserved unused.  Such a
+			 * page could also be left over if a backend extends the relation
+			 * but crashes before initializing the page.  Reclaim such pages
+			 * for use.
 			 *
 			 * We have to be careful here because we could be looking at a
 			 * page that someone has just added to the relation and not yet
 			 * been able to initialize (see RelationGetBufferForTuple). To
 			 * protect against that, release the buffer lock, grab the
 			 * relation extension lock momentarily, and re-lock the buffer. If
-			 * the page is still uninitialized by then, it must be left over
-			 * from a crashed backend, and we can initialize it.
+			 * the page is still uninitialized by then, nobody is working on
+			 * it, and we can initialize it.
 			 *
 			 * We don't really need the relation lock when this is a new or
 			 * temp relation, but it's probably not worth the code space to
@@ -854,9 +929,6 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			LockBufferForCleanup(buf);
 			if (PageIsNew(page))
 			{
-				ereport(WARNING,
-						(errmsg("relation \"%s\" page %u is uninitialized --- fixing",
-								relname, blkno)));
 				PageInit(page, BufferGetPageSize(buf), 0);
 				empty_pages++;
 			}
@@ -923,7 +995,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		has_dead_tuples = false;
 		nfrozen = 0;
 		hastup = false;
-		prev_dead_count = vacrelstats->num_dead_tuples;
+		vacrelstats->num_page_dead = 0;
 		maxoff = PageGetMaxOffsetNumber(page);
 
 		/*
@@ -962,7 +1034,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			 */
 			if (ItemIdIsDead(itemid))
 			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
+				lazy_record_dead_tuple(vacrelstats, offnum);
 				all_visible = false;
 				continue;
 			}
@@ -1067,7 +1139,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 
 			if (tupgone)
 			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
+				lazy_record_dead_tuple(vacrelstats, offnum);
 				HeapTupleHeaderAdvanceLatestRemovedXid(tuple.t_data,
 													   &vacrelstats->latestRemovedXid);
 				tups_vacuumed += 1;
@@ -1135,10 +1207,12 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		 * instead of doing a second scan.
 		 */
 		if (nindexes == 0 &&
-			vacrelstats->num_dead_tuples > 0)
+			vacrelstats->num_page_dead > 0)
 		{
 			/* Remove tuples from heap */
-			lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats, &vmbuffer);
+			lazy_vacuum_page(onerel, blkno, buf, vacrelstats->page_dead,
+							 vacrelstats->num_page_dead, vacrelstats,
+							 &vmbuffer);
 			has_dead_tuples = false;
 
 			/*
@@ -1146,9 +1220,18 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 			 * not to reset latestRemovedXid since we want that value to be
 			 * valid.
 			 */
-			vacrelstats->num_dead_tuples = 0;
+			vacrelstats->num_page_dead = 0;
 			vacuumed_pages++;
 		}
+		else if (vacrelstats->num_page_dead > 0)
+		{
+			/* Remember them until we've removed their index entries */
+			TidStoreSetBlockOffsets(vacrelstats->dead_tuples, blkno,
+									vacrelstats->page_dead,
+									vacrelstats->num_page_dead);
+			pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
+										 TidStoreNumTids(vacrelstats->dead_tuples));
+		}
 
 		freespace = PageGetHeapFreeSpace(page);
 
@@ -1249,7 +1332,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 		 * page, so remember its free space as-is.  (This path will always be
 		 * taken if there are no indexes.)
 		 */
-		if (vacrelstats->num_dead_tuples == prev_dead_count)
+		if (vacrelstats->num_page_dead == 0)
 			RecordPageWithFreeSpace(onerel, blkno, freespace);
 	}
 
@@ -1280,7 +1363,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 
 	/* If any tuples need to be deleted, perform final vacuum cycle */
 	/* XXX put a threshold on min number of tuples here? */
-	if (vacrelstats->num_dead_tuples > 0)
+	if (TidStoreNumTids(vacrelstats->dead_tuples) > 0)
 	{
 		const int	hvp_index[] = {
 			PROGRESS_VACUUM_PHASE,
@@ -1296,10 +1379,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 									 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
 
 		/* Remove index entries */
-		for (i = 0; i < nindexes; i++)
-			lazy_vacuum_index(Irel[i],
-							  &indstats[i],
-							  vacrelstats);
+		lazy_vacuum_all_indexes(Irel, nindexes, indstats, vacrelstats, lps);
 
 		/* Report that we are now vacuuming the heap */
 		hvp_val[0] = PROGRESS_VACUUM_PHASE_VACUUM_HEAP;
@@ -1319,8 +1399,7 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 								 PROGRESS_VACUUM_PHASE_INDEX_CLEANUP);
 
 	/* Do post-vacuum cleanup and statistics update for each index */
-	for (i = 0; i < nindexes; i++)
-		lazy_cleanup_index(Irel[i], indstats[i], vacrelstats);
+	lazy_cleanup_all_indexes(Irel, nindexes, indstats, vacrelstats, lps);
 
 	/* If no indexes, make log report that lazy_vacuum_heap would've made */
 	if (vacuumed_pages)
@@ -1377,35 +1456,37 @@ lazy_scan_heap(Relation onerel, int options, LVRelStats *vacrelstats,
 static void
 lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 {
-	int			tupindex;
+	TidStoreIter *iter;
+	TidStoreIterResult *res;
+	int64		ntuples;
 	int			npages;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
 
 	pg_rusage_init(&ru0);
 	npages = 0;
+	ntuples = 0;
 
-	tupindex = 0;
-	while (tupindex < vacrelstats->num_dead_tuples)
+	iter = TidStoreBeginIterate(vacrelstats->dead_tuples);
+	while ((res = TidStoreIterateNext(iter)) != NULL)
 	{
-		BlockNumber tblk;
+		BlockNumber tblk = res->blkno;
 		Buffer		buf;
 		Page		page;
 		Size		freespace;
 
 		vacuum_delay_point();
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
 		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
 								 vac_strategy);
 		if (!ConditionalLockBufferForCleanup(buf))
 		{
 			ReleaseBuffer(buf);
-			++tupindex;
 			continue;
 		}
-		tupindex = lazy_vacuum_page(onerel, tblk, buf, tupindex, vacrelstats,
-									&vmbuffer);
+		lazy_vacuum_page(onerel, tblk, buf, res->offsets, res->num_offsets,
+						 vacrelstats, &vmbuffer);
+		ntuples += res->num_offsets;
 
 		/* Now that we've compacted the page, record its available space */
 		page = BufferGetPage(buf);
@@ -1415,6 +1496,7 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 		RecordPageWithFreeSpace(onerel, tblk, freespace);
 		npages++;
 	}
+	TidStoreEndIterate(iter);
 
 	if (BufferIsValid(vmbuffer))
 	{
@@ -1423,9 +1505,9 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
 	}
 
 	ereport(elevel,
-			(errmsg("\"%s\": removed %d row versions in %d pages",
+			(errmsg("\"%s\": removed %.0f row versions in %d pages",
 					RelationGetRelationName(onerel),
-					tupindex, npages),
+					(double) ntuples, npages),
 			 errdetail_internal("%s", pg_rusage_show(&ru0))));
 }
 
@@ -1435,37 +1517,28 @@ lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
  *
  * Caller must hold pin and buffer cleanup lock on the buffer.
  *
- * tupindex is the index in vacrelstats->dead_tuples of the first dead
- * tuple for this page.  We assume the rest follow sequentially.
- * The return value is the first tupindex after the tuples of this page.
+ * deadoffsets are the offsets of the page's ndeadoffsets dead tuples.
  */
-static int
+static void
 lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer)
+				 OffsetNumber *deadoffsets, int ndeadoffsets,
+				 LVRelStats *vacrelstats, Buffer *vmbuffer)
 {
 	Page		page = BufferGetPage(buffer);
-	OffsetNumber unused[MaxOffsetNumber];
-	int			uncnt = 0;
 	TransactionId visibility_cutoff_xid;
 	bool		all_frozen;
+	int			i;
 
 	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
 
 	START_CRIT_SECTION();
 
-	for (; tupindex < vacrelstats->num_dead_tuples; tupindex++)
+	for (i = 0; i < ndeadoffsets; i++)
 	{
-		BlockNumber tblk;
-		OffsetNumber toff;
 		ItemId		itemid;
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&vacrelstats->dead_tuples[tupindex]);
-		itemid = PageGetItemId(page, toff);
+		itemid = PageGetItemId(page, deadoffsets[i]);
 		ItemIdSetUnused(itemid);
-		unused[uncnt++] = toff;
 	}
 
 	PageRepairFragmentation(page);
@@ -1482,7 +1555,7 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 
 		recptr = log_heap_clean(onerel, buffer,
 								NULL, 0, NULL, 0,
-								unused, uncnt,
+								deadoffsets, ndeadoffsets,
 								vacrelstats->latestRemovedXid);
 		PageSetLSN(page, recptr);
 	}
@@ -1526,8 +1599,6 @@ lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
 			visibilitymap_set(onerel, blkno, buffer, InvalidXLogRecPtr,
 							  *vmbuffer, visibility_cutoff_xid, flags);
 	}
-
-	return tupindex;
 }
 
 /*
@@ -1583,16 +1654,76 @@ lazy_check_needs_freeze(Buffer buf, bool *hastup)
 }
 
 
+/*
+ *	lazy_vacuum_all_indexes() -- remove the dead tuples from all indexes.
+ */
+static void
+lazy_vacuum_all_indexes(Relation *Irel, int nindexes,
+						IndexBulkDeleteResult **stats,
+						LVRelStats *vacrelstats, LVParallelState *lps)
+{
+	int			i;
+
+	if (lps != NULL)
+	{
+		lazy_parallel_vacuum_indexes(Irel, nindexes, vacrelstats, lps, false);
+		return;
+	}
+
+	for (i = 0; i < nindexes; i++)
+		lazy_vacuum_index(Irel[i], &stats[i], vacrelstats->dead_tuples,
+						  vacrelstats->old_rel_tuples);
+}
+
+/*
+ *	lazy_cleanup_all_indexes() -- do post-vacuum cleanup for all indexes,
+ *		and update their statistics.
+ *
+ *		This also ends parallel vacuuming, if we're doing that, since
+ *		the statistics can't be updated in parallel mode.
+ */
+static void
+lazy_cleanup_all_indexes(Relation *Irel, int nindexes,
+						 IndexBulkDeleteResult **stats,
+						 LVRelStats *vacrelstats, LVParallelState *lps)
+{
+	bool		estimated_count;
+	PGRUsage	ru0;
+	int			i;
+
+	estimated_count = (vacrelstats->tupcount_pages < vacrelstats->rel_pages);
+
+	if (lps != NULL)
+	{
+		pg_rusage_init(&ru0);
+		lazy_parallel_vacuum_indexes(Irel, nindexes, vacrelstats, lps, true);
+		end_parallel_vacuum(lps, vacrelstats, stats, nindexes);
+
+		for (i = 0; i < nindexes; i++)
+			lazy_update_index_stats(Irel[i], stats[i], &ru0);
+		return;
+	}
+
+	for (i = 0; i < nindexes; i++)
+	{
+		pg_rusage_init(&ru0);
+		lazy_cleanup_index(Irel[i], &stats[i], vacrelstats->new_rel_tuples,
+						   estimated_count);
+		lazy_update_index_stats(Irel[i], stats[i], &ru0);
+	}
+}
+
 /*
  *	lazy_vacuum_index() -- vacuum one index relation.
  *
  *		Delete all the index entries pointing to tuples listed in
- *		vacrelstats->dead_tuples, and update running statistics.
+ *		dead_tuples, and update running statistics.  reltuples is the
+ *		number of heap tuples to tell the index AM about.
  */
 static void
 lazy_vacuum_index(Relation indrel,
 				  IndexBulkDeleteResult **stats,
-				  LVRelStats *vacrelstats)
+				  TidStore *dead_tuples, double reltuples)
 {
 	IndexVacuumInfo ivinfo;
 	PGRUsage	ru0;
@@ -1603,17 +1734,17 @@ lazy_vacuum_index(Relation indrel,
 	ivinfo.analyze_only = false;
 	ivinfo.estimated_count = true;
 	ivinfo.message_level = elevel;
-	ivinfo.num_heap_tuples = vacrelstats->old_rel_tuples;
+	ivinfo.num_heap_tuples = reltuples;
 	ivinfo.strategy = vac_strategy;
 
 	/* Do bulk deletion */
 	*stats = index_bulk_delete(&ivinfo, *stats,
-							   lazy_tid_reaped, (void *) vacrelstats);
+							   lazy_tid_reaped, (void *) dead_tuples);
 
 	ereport(elevel,
-			(errmsg("scanned index \"%s\" to remove %d row versions",
+			(errmsg("scanned index \"%s\" to remove %.0f row versions",
 					RelationGetRelationName(indrel),
-					vacrelstats->num_dead_tuples),
+					(double) TidStoreNumTids(dead_tuples)),
 			 errdetail_internal("%s", pg_rusage_show(&ru0))));
 }
 
@@ -1622,23 +1753,31 @@ lazy_vacuum_index(Relation indrel,
  */
 static void
 lazy_cleanup_index(Relation indrel,
-				   IndexBulkDeleteResult *stats,
-				   LVRelStats *vacrelstats)
+				   IndexBulkDeleteResult **stats,
+				   double reltuples, bool estimated_count)
 {
 	IndexVacuumInfo ivinfo;
-	PGRUsage	ru0;
-
-	pg_rusage_init(&ru0);
 
 	ivinfo.index = indrel;
 	ivinfo.analyze_only = false;
-	ivinfo.estimated_count = (vacrelstats->tupcount_pages < vacrelstats->rel_pages);
+	ivinfo.estimated_count = estimated_count;
 	ivinfo.message_level = elevel;
-	ivinfo.num_heap_tuples = vacrelstats->new_rel_tuples;
+	ivinfo.num_heap_tuples = reltuples;
 	ivinfo.strategy = vac_strategy;
 
-	stats = index_vacuum_cleanup(&ivinfo, stats);
+	*stats = index_vacuum_cleanup(&ivinfo, *stats);
+}
 
+/*
+ *	lazy_update_index_stats() -- update pg_class for one index after cleanup,
+ *		and release its statistics.
+ *
+ *		ru0 is when the cleanup started, for the log report.
+ */
+static void
+lazy_update_index_stats(Relation indrel, IndexBulkDeleteResult *stats,
+						PGRUsage *ru0)
+{
 	if (!stats)
 		return;
 
@@ -1666,7 +1805,7 @@ lazy_cleanup_index(Relation indrel,
 					   "%s.",
 					   stats->tuples_removed,
 					   stats->pages_deleted, stats->pages_free,
-					   pg_rusage_show(&ru0))));
+					   pg_rusage_show(ru0))));
 
 	pfree(stats);
 }
@@ -1976,111 +2115,70 @@ count_nondeletable_pages(Relation onerel, LVRelStats *vacrelstats)
 /*
  * lazy_space_alloc - space allocation decisions for lazy vacuum
  *
- * See the comments at the head of this file for rationale.
+ * See the comments at the head of this file for rationale.  If the indexes
+ * are to be vacuumed in parallel, the dead tuple store is set up in shared
+ * memory, and the parallel state is returned; otherwise NULL.
  */
-static void
-lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
+static LVParallelState *
+lazy_space_alloc(Relation onerel, LVRelStats *vacrelstats,
+				 BlockNumber relblocks, Relation *Irel, int nindexes)
 {
-	long		maxtuples;
+	LVParallelState *lps = NULL;
+	Size		maxbytes;
+	int			nworkers;
 	int			vac_work_mem = IsAutoVacuumWorkerProcess() &&
 	autovacuum_work_mem != -1 ?
 	autovacuum_work_mem : maintenance_work_mem;
 
 	if (vacrelstats->hasindex)
 	{
-		maxtuples = (vac_work_mem * 1024L) / sizeof(ItemPointerData);
-		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MaxAllocSize / sizeof(ItemPointerData));
+		maxbytes = (Size) vac_work_mem * 1024;
 
-		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
-			maxtuples = relblocks * LAZY_ALLOC_TUPLES;
-
-		/* stay sane if small maintenance_work_mem */
-		maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
+		/* no need for more than it takes to store every tuple of the table */
+		maxbytes = Min(maxbytes,
+					   TidStoreMaxSize(relblocks, MaxHeapTuplesPerPage));
 	}
 	else
 	{
-		maxtuples = MaxHeapTuplesPerPage;
+		/* we vacuum each page as we go, so the store stays empty */
+		maxbytes = 0;
+		relblocks = 0;
 	}
 
-	vacrelstats->num_dead_tuples = 0;
-	vacrelstats->max_dead_tuples = (int) maxtuples;
-	vacrelstats->dead_tuples = (ItemPointer)
-		palloc(maxtuples * sizeof(ItemPointerData));
+	vacrelstats->num_page_dead = 0;
+
+	nworkers = compute_parallel_workers(onerel, Irel, nindexes);
+	if (nworkers > 0)
+		lps = begin_parallel_vacuum(RelationGetRelid(onerel), vacrelstats,
+									relblocks, maxbytes, nindexes, nworkers);
+
+	if (lps == NULL)
+		vacrelstats->dead_tuples = TidStoreCreate(maxbytes, relblocks,
+												  MaxHeapTuplesPerPage);
+	return lps;
 }
 
 /*
- * lazy_record_dead_tuple - remember one deletable tuple
+ * lazy_record_dead_tuple - remember one deletable tuple of the current page
  */
 static void
-lazy_record_dead_tuple(LVRelStats *vacrelstats,
-					   ItemPointer itemptr)
+lazy_record_dead_tuple(LVRelStats *vacrelstats, OffsetNumber offnum)
 {
-	/*
-	 * The array shouldn't overflow under normal behavior, but perhaps it
-	 * could if we are given a really small maintenance_work_mem. In that
-	 * case, just forget the last few tuples (we'll get 'em next time).
-	 */
-	if (vacrelstats->num_dead_tuples < vacrelstats->max_dead_tuples)
-	{
-		vacrelstats->dead_tuples[vacrelstats->num_dead_tuples] = *itemptr;
-		vacrelstats->num_dead_tuples++;
-		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
-									 vacrelstats->num_dead_tuples);
-	}
+	Assert(vacrelstats->num_page_dead < MaxHeapTuplesPerPage);
+	vacrelstats->page_dead[vacrelstats->num_page_dead++] = offnum;
 }
 
 /*
  *	lazy_tid_reaped() -- is a particular tid deletable?
  *
  *		This has the right signature to be an IndexBulkDeleteCallback.
- *
- *		Assumes dead_tuples array is in sorted order.
  */
 static bool
 lazy_tid_reaped(ItemPointer itemptr, void *state)
 {
-	LVRelStats *vacrelstats = (LVRelStats *) state;
-	ItemPointer res;
+	TidStore   *dead_tuples = (TidStore *) state;
 
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) vacrelstats->dead_tuples,
-								vacrelstats->num_dead_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
-
-	return (res != NULL);
-}
-
-/*
- * Comparator routines for use with qsort() and bsearch().
- */
-static int
-vac_cmp_itemptr(const void *left, const void *right)
-{
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
-
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
-
-	if (lblk < rblk)
-		return -1;
-	if (lblk > rblk)
-		return 1;
-
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
-
-	if (loff < roff)
-		return -1;
-	if (loff > roff)
-		return 1;
-
-	return 0;
+	return TidStoreIsMember(dead_tuples, itemptr);
 }
 
 /*
@@ -2194,3 +2292,332 @@ heap_page_is_all_visible(Relation rel, Buffer buf,
 
 	return all_visible;
 }
+
+/*
+ * compute_parallel_workers - how many workers to use for the indexes
+ *
+ * Only indexes at least min_parallel_index_scan_size large are worth a
+ * worker of their own, and the leader takes one of them.  Returns 0 if the
+ * indexes should be vacuumed serially.
+ */
+static int
+compute_parallel_workers(Relation onerel, Relation *Irel, int nindexes)
+{
+	int			max_workers;
+	int			nindexes_parallel = 0;
+	int			i;
+
+	max_workers = IsAutoVacuumWorkerProcess() ?
+		autovacuum_max_parallel_workers : max_parallel_maintenance_workers;
+
+	/* Temporary tables' buffers can't be seen by workers */
+	if (max_workers == 0 || nindexes < 2 || RelationUsesLocalBuffers(onerel))
+		return 0;
+
+	for (i = 0; i < nindexes; i++)
+	{
+		if (RelationGetNumberOfBlocks(Irel[i]) >=
+			(BlockNumber) min_parallel_index_scan_size)
+			nindexes_parallel++;
+	}
+
+	if (nindexes_parallel < 2)
+		return 0;
+
+	return Min(nindexes_parallel - 1, max_workers);
+}
+
+/*
+ * begin_parallel_vacuum - set up parallel index vacuuming
+ *
+ * Enters parallel mode and creates a parallel context, with a dead tuple
+ * store of at most maxbytes in its shared memory segment.  If no workers
+ * can be used after all, everything's undone and NULL is returned.
+ */
+static LVParallelState *
+begin_parallel_vacuum(Oid relid, LVRelStats *vacrelstats,
+					  BlockNumber nblocks, Size maxbytes,
+					  int nindexes, int nrequested)
+{
+	LVParallelState *lps;
+	ParallelContext *pcxt;
+	LVShared   *shared;
+	Size		est_shared;
+	Size		est_dead_tuples;
+	char	   *dead_tuples_space;
+
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "parallel_vacuum_main",
+								 nrequested);
+
+	est_shared = add_size(offsetof(LVShared, indstats),
+						  mul_size(sizeof(LVSharedIndStats), nindexes));
+	shm_toc_estimate_chunk(&pcxt->estimator, est_shared);
+	est_dead_tuples = TidStoreEstimate(maxbytes, nblocks,
+									   MaxHeapTuplesPerPage);
+	shm_toc_estimate_chunk(&pcxt->estimator, est_dead_tuples);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	InitializeParallelDSM(pcxt);
+
+	if (pcxt->nworkers == 0)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return NULL;
+	}
+
+	shared = (LVShared *) shm_toc_allocate(pcxt->toc, est_shared);
+	MemSet(shared, 0, est_shared);
+	shared->relid = relid;
+	shared->elevel = elevel;
+	shared->cost_delay = VacuumCostDelay;
+	shared->cost_limit = VacuumCostLimit;
+	pg_atomic_init_u32(&shared->cost_balance, 0);
+	pg_atomic_init_u32(&shared->active_nworkers, 0);
+	pg_atomic_init_u32(&shared->nextidx, 0);
+	shared->nindexes = nindexes;
+	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_SHARED, shared);
+
+	dead_tuples_space = shm_toc_allocate(pcxt->toc, est_dead_tuples);
+	vacrelstats->dead_tuples = TidStoreInitialize(dead_tuples_space,
+												  est_dead_tuples, nblocks,
+												  MaxHeapTuplesPerPage);
+	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_DEAD_TUPLES,
+				   dead_tuples_space);
+
+	lps = (LVParallelState *) palloc(sizeof(LVParallelState));
+	lps->pcxt = pcxt;
+	lps->lvshared = shared;
+	lps->relaunch = false;
+
+	return lps;
+}
+
+/*
+ * end_parallel_vacuum - finish parallel index vacuuming
+ *
+ * The final index statistics are copied to local memory, into 'stats',
+ * before the shared memory segment goes away.  The dead tuple store goes
+ * with it.
+ */
+static void
+end_parallel_vacuum(LVParallelState *lps, LVRelStats *vacrelstats,
+					IndexBulkDeleteResult **stats, int nindexes)
+{
+	LVShared   *shared = lps->lvshared;
+	int			i;
+
+	for (i = 0; i < nindexes; i++)
+	{
+		if (shared->indstats[i].updated)
+		{
+			stats[i] = (IndexBulkDeleteResult *)
+				palloc(sizeof(IndexBulkDeleteResult));
+			memcpy(stats[i], &shared->indstats[i].stats,
+				   sizeof(IndexBulkDeleteResult));
+		}
+		else
+			stats[i] = NULL;
+	}
+
+	DestroyParallelContext(lps->pcxt);
+	ExitParallelMode();
+
+	vacrelstats->dead_tuples = NULL;
+	pfree(lps);
+}
+
+/*
+ * lazy_parallel_vacuum_indexes - one round of parallel index vacuuming
+ *
+ * Launches the workers and helps them to bulk-delete the dead tuples from,
+ * or clean up, every index, and waits until they're all done.
+ */
+static void
+lazy_parallel_vacuum_indexes(Relation *Irel, int nindexes,
+							 LVRelStats *vacrelstats, LVParallelState *lps,
+							 bool for_cleanup)
+{
+	LVShared   *shared = lps->lvshared;
+	ParallelContext *pcxt = lps->pcxt;
+
+	shared->for_cleanup = for_cleanup;
+	if (for_cleanup)
+	{
+		shared->reltuples = vacrelstats->new_rel_tuples;
+		shared->estimated_count =
+			(vacrelstats->tupcount_pages < vacrelstats->rel_pages);
+	}
+	else
+	{
+		shared->reltuples = vacrelstats->old_rel_tuples;
+		shared->estimated_count = true;
+	}
+	pg_atomic_write_u32(&shared->nextidx, 0);
+
+	/*
+	 * The workers share our cost balance, so that all of us together stay
+	 * within the cost limit; see compute_parallel_delay.
+	 */
+	if (VacuumCostActive)
+	{
+		pg_atomic_write_u32(&shared->cost_balance, VacuumCostBalance);
+		pg_atomic_write_u32(&shared->active_nworkers, 0);
+		VacuumSharedCostBalance = &shared->cost_balance;
+		VacuumActiveNWorkers = &shared->active_nworkers;
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+	}
+
+	if (lps->relaunch)
+		ReinitializeParallelDSM(pcxt);
+	LaunchParallelWorkers(pcxt);
+	lps->relaunch = true;
+
+	if (for_cleanup)
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel vacuum worker for index cleanup (planned: %d)",
+								 "launched %d parallel vacuum workers for index cleanup (planned: %d)",
+								 pcxt->nworkers_launched),
+						pcxt->nworkers_launched, pcxt->nworkers)));
+	else
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel vacuum worker for index vacuuming (planned: %d)",
+								 "launched %d parallel vacuum workers for index vacuuming (planned: %d)",
+								 pcxt->nworkers_launched),
+						pcxt->nworkers_launched, pcxt->nworkers)));
+
+	/* Do our share, which is all of it if no workers could be launched */
+	parallel_vacuum_indexes(Irel, nindexes, shared, vacrelstats->dead_tuples);
+
+	WaitForParallelWorkersToFinish(pcxt);
+
+	/* Carry what's left of the shared balance over to the heap scan */
+	if (VacuumSharedCostBalance != NULL)
+	{
+		VacuumCostBalance += pg_atomic_read_u32(&shared->cost_balance);
+		VacuumCostBalanceLocal = 0;
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
+	}
+}
+
+/*
+ * parallel_vacuum_indexes - process indexes until none are left
+ *
+ * Used by the leader and by the workers alike.  Each index's statistics are
+ * kept in shared memory, so that whoever processes it in the next round
+ * can pass them to the index AM.
+ */
+static void
+parallel_vacuum_indexes(Relation *Irel, int nindexes, LVShared *lvshared,
+						TidStore *dead_tuples)
+{
+	/* Count ourselves in for compute_parallel_delay */
+	if (VacuumActiveNWorkers != NULL)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+	for (;;)
+	{
+		uint32		idx;
+		LVSharedIndStats *indstats;
+		IndexBulkDeleteResult *stats;
+
+		idx = pg_atomic_fetch_add_u32(&lvshared->nextidx, 1);
+		if (idx >= (uint32) nindexes)
+			break;
+
+		indstats = &lvshared->indstats[idx];
+		stats = indstats->updated ? &indstats->stats : NULL;
+
+		if (lvshared->for_cleanup)
+			lazy_cleanup_index(Irel[idx], &stats, lvshared->reltuples,
+							   lvshared->estimated_count);
+		else
+			lazy_vacuum_index(Irel[idx], &stats, dead_tuples,
+							  lvshared->reltuples);
+
+		/*
+		 * The AM allocates the stats in local memory the first time, and
+		 * might in principle do so again; copy them to shared memory.
+		 */
+		if (stats == NULL)
+			indstats->updated = false;
+		else if (stats != &indstats->stats)
+		{
+			memcpy(&indstats->stats, stats, sizeof(IndexBulkDeleteResult));
+			indstats->updated = true;
+			pfree(stats);
+		}
+	}
+
+	if (VacuumActiveNWorkers != NULL)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+}
+
+/*
+ * parallel_vacuum_main - entry point of parallel vacuum workers
+ *
+ * A worker only vacuums indexes, so it opens the table and its indexes the
+ * same way the leader did and works through the shared list of indexes.
+ * The transaction, snapshot and GUC settings have already been restored
+ * from the leader by parallel.c.
+ */
+void
+parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
+{
+	LVShared   *lvshared;
+	TidStore   *dead_tuples;
+	Relation	onerel;
+	Relation   *Irel;
+	int			nindexes;
+
+	lvshared = (LVShared *) shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_SHARED,
+										   false);
+	dead_tuples = (TidStore *) shm_toc_lookup(toc,
+											  PARALLEL_VACUUM_KEY_DEAD_TUPLES,
+											  false);
+	elevel = lvshared->elevel;
+
+	/* Like the leader, don't hold back other vacuums' OldestXmin */
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+	MyPgXact->vacuumFlags |= PROC_IN_VACUUM;
+	LWLockRelease(ProcArrayLock);
+
+	/* The leader's locks are shared with us, so these don't block */
+	onerel = heap_open(lvshared->relid, ShareUpdateExclusiveLock);
+	vac_open_indexes(onerel, RowExclusiveLock, &nindexes, &Irel);
+	if (nindexes != lvshared->nindexes)
+		elog(ERROR, "parallel vacuum worker found %d indexes on \"%s\", expected %d",
+			 nindexes, RelationGetRelationName(onerel), lvshared->nindexes);
+
+	vac_strategy = GetAccessStrategy(BAS_VACUUM);
+
+	/*
+	 * Use the leader's cost-based delay settings, which autovacuum doesn't
+	 * set through GUCs, and share its cost balance.
+	 */
+	VacuumCostDelay = lvshared->cost_delay;
+	VacuumCostLimit = lvshared->cost_limit;
+	VacuumCostActive = (VacuumCostDelay > 0);
+	VacuumCostBalance = 0;
+	VacuumCostBalanceLocal = 0;
+	if (VacuumCostActive)
+	{
+		VacuumSharedCostBalance = &lvshared->cost_balance;
+		VacuumActiveNWorkers = &lvshared->active_nworkers;
+	}
+	VacuumPageHit = 0;
+	VacuumPageMiss = 0;
+	VacuumPageDirty = 0;
+
+	parallel_vacuum_indexes(Irel, nindexes, lvshared, dead_tuples);
+
+	VacuumCostActive = false;
+	VacuumSharedCostBalance = NULL;
+	VacuumActiveNWorkers = NULL;
+	FreeAccessStrategy(vac_strategy);
+	vac_close_indexes(nindexes, Irel, RowExclusiveLock);
+	heap_close(onerel, ShareUpdateExclusiveLock);
+}
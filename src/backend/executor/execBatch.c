@@ -0,0 +1,353 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.c
+ *	  Support for batch-at-a-time execution.
+ *
+ * Normally each plan node returns one tuple per call, and every qual and
+ * aggregate input is evaluated one tuple at a time by the expression
+ * interpreter.  For simple plans consisting of an aggregate directly over a
+ * sequential scan, that overhead can dominate the actual work.  When
+ * executor_batch_size is set, such plans instead pass TupleBatches, which
+ * hold up to that many rows deformed into per-column arrays, from the scan
+ * to the aggregate.  Simple comparisons between a column and a constant are
+ * evaluated over a whole column at once, narrowing the batch's selection
+ * vector, and the aggregate runs tight loops over the selected rows; see
+ * nodeSeqscan.c and nodeAgg.c.
+ *
+ * Batches only handle a few common types that are passed by value.
+ * Everything else runs tuple-at-a-time as usual.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/execBatch.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "catalog/pg_type.h"
+#include "executor/execBatch.h"
+#include "utils/builtins.h"
+#include "utils/fmgroids.h"
+#include "utils/lsyscache.h"
+
+
+/* GUC parameter */
+int			executor_batch_size = 0;
+
+typedef enum BatchType
+{
+	BATCH_INT4,
+	BATCH_INT8,
+	BATCH_FLOAT8
+} BatchType;
+
+typedef enum BatchCmp
+{
+	BATCH_CMP_EQ,
+	BATCH_CMP_NE,
+	BATCH_CMP_LT,
+	BATCH_CMP_LE,
+	BATCH_CMP_GT,
+	BATCH_CMP_GE
+} BatchCmp;
+
+struct BatchQual
+{
+	AttrNumber	attno;			/* column compared */
+	BatchType	type;			/* its type */
+	BatchCmp	cmp;			/* column <cmp> constvalue */
+	Datum		constvalue;		/* comparison value, never NULL */
+};
+
+/* Comparison functions that ExecInitBatchQual knows how to vectorize */
+static const struct
+{
+	Oid			funcid;
+	BatchType	type;
+	BatchCmp	cmp;
+}			batch_cmp_funcs[] =
+{
+	{F_INT4EQ, BATCH_INT4, BATCH_CMP_EQ},
+	{F_INT4NE, BATCH_INT4, BATCH_CMP_NE},
+	{F_INT4LT, BATCH_INT4, BATCH_CMP_LT},
+	{F_INT4LE, BATCH_INT4, BATCH_CMP_LE},
+	{F_INT4GT, BATCH_INT4, BATCH_CMP_GT},
+	{F_INT4GE, BATCH_INT4, BATCH_CMP_GE},
+	{F_INT8EQ, BATCH_INT8, BATCH_CMP_EQ},
+	{F_INT8NE, BATCH_INT8, BATCH_CMP_NE},
+	{F_INT8LT, BATCH_INT8, BATCH_CMP_LT},
+	{F_INT8LE, BATCH_INT8, BATCH_CMP_LE},
+	{F_INT8GT, BATCH_INT8, BATCH_CMP_GT},
+	{F_INT8GE, BATCH_INT8, BATCH_CMP_GE},
+	{F_FLOAT8EQ, BATCH_FLOAT8, BATCH_CMP_EQ},
+	{F_FLOAT8NE, BATCH_FLOAT8, BATCH_CMP_NE},
+	{F_FLOAT8LT, BATCH_FLOAT8, BATCH_CMP_LT},
+	{F_FLOAT8LE, BATCH_FLOAT8, BATCH_CMP_LE},
+	{F_FLOAT8GT, BATCH_FLOAT8, BATCH_CMP_GT},
+	{F_FLOAT8GE, BATCH_FLOAT8, BATCH_CMP_GE}
+};
+
+/*
+ * ExecBatchTypeSupported
+ *		Can values of this type be stored in a batch and used by quals and
+ *		aggregates?
+ *
+ * int8 and float8 qualify only if they're passed by value, since a batch
+ * outlives the buffer pins of the tuples it was built from.
+ */
+bool
+ExecBatchTypeSupported(Oid typid)
+{
+	switch (typid)
+	{
+		case INT4OID:
+			return true;
+		case INT8OID:
+		case FLOAT8OID:
+			return FLOAT8PASSBYVAL;
+		default:
+			return false;
+	}
+}
+
+/*
+ * ExecCreateTupleBatch
+ *		Create an empty batch of up to maxrows rows of the given tuple
+ *		descriptor, storing only the columns whose attribute numbers are in
+ *		attnums.
+ *
+ * The batch is allocated in CurrentMemoryContext.
+ */
+TupleBatch *
+ExecCreateTupleBatch(TupleDesc tupdesc, Bitmapset *attnums, int maxrows)
+{
+	TupleBatch *batch;
+	int			attno;
+
+	Assert(maxrows > 0);
+
+	batch = (TupleBatch *) palloc(sizeof(TupleBatch));
+	batch->natts = tupdesc->natts;
+	batch->maxrows = maxrows;
+	batch->nrows = 0;
+	batch->values = (Datum **) palloc0(tupdesc->natts * sizeof(Datum *));
+	batch->isnull = (bool **) palloc0(tupdesc->natts * sizeof(bool *));
+	batch->nselected = 0;
+	batch->selection = (int *) palloc(maxrows * sizeof(int));
+
+	attno = -1;
+	while ((attno = bms_next_member(attnums, attno)) >= 0)
+	{
+		Assert(attno > 0 && attno <= tupdesc->natts);
+		batch->values[attno - 1] = (Datum *) palloc(maxrows * sizeof(Datum));
+		batch->isnull[attno - 1] = (bool *) palloc(maxrows * sizeof(bool));
+	}
+
+	return batch;
+}
+
+/*
+ * ExecInitBatchQual
+ *		Prepare a qual clause for evaluation over whole batches.
+ *
+ * Only comparisons between a column of a supported type and a non-null
+ * constant are handled; NULL is returned for anything else, which must then
+ * be evaluated tuple-at-a-time.
+ */
+BatchQual *
+ExecInitBatchQual(Expr *clause)
+{
+	OpExpr	   *opexpr;
+	Var		   *var;
+	Const	   *con;
+	Oid			funcid;
+	bool		commuted;
+	BatchQual  *qual;
+	int			i;
+
+	if (!IsA(clause, OpExpr))
+		return NULL;
+	opexpr = (OpExpr *) clause;
+	if (list_length(opexpr->args) != 2)
+		return NULL;
+
+	if (IsA(linitial(opexpr->args), Var) && IsA(lsecond(opexpr->args), Const))
+	{
+		var = (Var *) linitial(opexpr->args);
+		con = (Const *) lsecond(opexpr->args);
+		commuted = false;
+	}
+	else if (IsA(linitial(opexpr->args), Const) && IsA(lsecond(opexpr->args), Var))
+	{
+		con = (Const *) linitial(opexpr->args);
+		var = (Var *) lsecond(opexpr->args);
+		commuted = true;
+	}
+	else
+		return NULL;
+
+	if (var->varattno <= 0 || var->varlevelsup != 0 || con->constisnull)
+		return NULL;
+	if (!ExecBatchTypeSupported(var->vartype) ||
+		!ExecBatchTypeSupported(con->consttype))
+		return NULL;
+
+	funcid = opexpr->opfuncid;
+	if (!OidIsValid(funcid))
+		funcid = get_opcode(opexpr->opno);
+
+	for (i = 0; i < lengthof(batch_cmp_funcs); i++)
+	{
+		if (batch_cmp_funcs[i].funcid == funcid)
+			break;
+	}
+	if (i >= lengthof(batch_cmp_funcs))
+		return NULL;
+
+	qual = (BatchQual *) palloc(sizeof(BatchQual));
+	qual->attno = var->varattno;
+	qual->type = batch_cmp_funcs[i].type;
+	qual->cmp = batch_cmp_funcs[i].cmp;
+	qual->constvalue = con->constvalue;
+
+	/* "const < var" is "var > const", etc */
+	if (commuted)
+	{
+		switch (qual->cmp)
+		{
+			case BATCH_CMP_LT:
+				qual->cmp = BATCH_CMP_GT;
+				break;
+			case BATCH_CMP_LE:
+				qual->cmp = BATCH_CMP_GE;
+				break;
+			case BATCH_CMP_GT:
+				qual->cmp = BATCH_CMP_LT;
+				break;
+			case BATCH_CMP_GE:
+				qual->cmp = BATCH_CMP_LE;
+				break;
+			default:
+				break;
+		}
+	}
+
+	return qual;
+}
+
+/*
+ * ExecBatchQualAttno
+ *		Return the column a batch qual needs stored in the batch.
+ */
+AttrNumber
+ExecBatchQualAttno(BatchQual *qual)
+{
+	return qual->attno;
+}
+
+/*
+ * Loop over the selected rows, keeping those for which "test" (an expression
+ * over the non-null column value "v") holds.
+ */
+#define BATCH_FILTER_LOOP(ctype, getvalue, test) \
+	do { \
+		for (i = 0; i < n; i++) \
+		{ \
+			int			row = sel[i]; \
+			ctype		v; \
+			\
+			if (isnull[row]) \
+				continue; \
+			v = getvalue(values[row]); \
+			if (test) \
+				sel[nout++] = row; \
+		} \
+	} while (0)
+
+/*
+ * Expand one tight loop per comparison, with "cmpfn(v)" yielding a value that
+ * is compared against zero like a qsort comparator.
+ */
+#define BATCH_FILTER_CMP(ctype, getvalue, cmpfn) \
+	do { \
+		switch (qual->cmp) \
+		{ \
+			case BATCH_CMP_EQ: \
+				BATCH_FILTER_LOOP(ctype, getvalue, cmpfn(v) == 0); \
+				break; \
+			case BATCH_CMP_NE: \
+				BATCH_FILTER_LOOP(ctype, getvalue, cmpfn(v) != 0); \
+				break; \
+			case BATCH_CMP_LT: \
+				BATCH_FILTER_LOOP(ctype, getvalue, cmpfn(v) < 0); \
+				break; \
+			case BATCH_CMP_LE: \
+				BATCH_FILTER_LOOP(ctype, getvalue, cmpfn(v) <= 0); \
+				break; \
+			case BATCH_CMP_GT: \
+				BATCH_FILTER_LOOP(ctype, getvalue, cmpfn(v) > 0); \
+				break; \
+			case BATCH_CMP_GE: \
+				BATCH_FILTER_LOOP(ctype, getvalue, cmpfn(v) >= 0); \
+				break; \
+		} \
+	} while (0)
+
+/*
+ * ExecBatchQualFilter
+ *		Remove the rows that don't satisfy the qual from the batch's
+ *		selection vector.
+ *
+ * Like the comparison functions, which are strict, a NULL column value fails
+ * the qual.
+ */
+void
+ExecBatchQualFilter(BatchQual *qual, TupleBatch *batch)
+{
+	Datum	   *values = batch->values[qual->attno - 1];
+	bool	   *isnull = batch->isnull[qual->attno - 1];
+	int		   *sel = batch->selection;
+	int			n = batch->nselected;
+	int			nout = 0;
+	int			i;
+
+	Assert(values != NULL && isnull != NULL);
+
+	switch (qual->type)
+	{
+		case BATCH_INT4:
+			{
+				int32		c = DatumGetInt32(qual->constvalue);
+
+#define INT4_CMP(v) ((v) < c ? -1 : ((v) > c ? 1 : 0))
+				BATCH_FILTER_CMP(int32, DatumGetInt32, INT4_CMP);
+#undef INT4_CMP
+				break;
+			}
+		case BATCH_INT8:
+			{
+				int64		c = DatumGetInt64(qual->constvalue);
+
+#define INT8_CMP(v) ((v) < c ? -1 : ((v) > c ? 1 : 0))
+				BATCH_FILTER_CMP(int64, DatumGetInt64, INT8_CMP);
+#undef INT8_CMP
+				break;
+			}
+		case BATCH_FLOAT8:
+			{
+				float8		c = DatumGetFloat8(qual->constvalue);
+
+				/* use the same NaN-aware ordering as the float8 operators */
+#define FLOAT8_CMP(v) float8_cmp_internal(v, c)
+				BATCH_FILTER_CMP(float8, DatumGetFloat8, FLOAT8_CMP);
+#undef FLOAT8_CMP
+				break;
+			}
+	}
+
+	batch->nselected = nout;
+}
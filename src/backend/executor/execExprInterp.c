@@ -149,6 +149,8 @@ static Datum ExecJustConst(ExprState *state, ExprContext *econtext, bool *isnull
 static Datum ExecJustAssignInnerVar(ExprState *state, ExprContext *econtext, bool *isnull);
 static Datum ExecJustAssignOuterVar(ExprState *state, ExprContext *econtext, bool *isnull);
 static Datum ExecJustAssignScanVar(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustScanVarConstQualFirst(ExprState *state, ExprContext *econtext, bool *isnull);
+static Datum ExecJustScanVarConstQual(ExprState *state, ExprContext *econtext, bool *isnull);
 
 
 /*
@@ -237,6 +239,24 @@ ExecReadyInterpretedExpr(ExprState *state)
 		state->evalfunc = ExecJustConst;
 		return;
 	}
+	else if (state->steps_len == 6 &&
+			 state->steps[0].opcode == EEOP_SCAN_FETCHSOME &&
+			 ((state->steps[1].opcode == EEOP_SCAN_VAR_FIRST &&
+			   state->steps[2].opcode == EEOP_CONST) ||
+			  (state->steps[1].opcode == EEOP_CONST &&
+			   state->steps[2].opcode == EEOP_SCAN_VAR_FIRST)) &&
+			 state->steps[3].opcode == EEOP_FUNCEXPR_STRICT &&
+			 state->steps[3].d.func.nargs == 2 &&
+			 state->steps[4].opcode == EEOP_QUAL)
+	{
+		/*
+		 * A qual consisting of a single strict two-argument function (most
+		 * often an operator) comparing a scan Var with a Const, such as
+		 * "col = 42", is common enough in scans to deserve a fast path.
+		 */
+		state->evalfunc = ExecJustScanVarConstQualFirst;
+		return;
+	}
 
 #if defined(EEO_USE_COMPUTED_GOTO)
 
@@ -1787,6 +1807,65 @@ ExecJustAssignScanVar(ExprState *state, ExprContext *econtext, bool *isnull)
 }
 
 
+/* Qual "scanvar op const" or "const op scanvar", first time through */
+static Datum
+ExecJustScanVarConstQualFirst(ExprState *state, ExprContext *econtext,
+							  bool *isnull)
+{
+	ExprEvalStep *op;
+
+	op = &state->steps[state->steps[1].opcode == EEOP_SCAN_VAR_FIRST ? 1 : 2];
+	CheckVarSlotCompatibility(econtext->ecxt_scantuple,
+							  op->d.var.attnum + 1, op->d.var.vartype);
+	op->opcode = EEOP_SCAN_VAR; /* just for cleanliness */
+	state->evalfunc = ExecJustScanVarConstQual;
+
+	return ExecJustScanVarConstQual(state, econtext, isnull);
+}
+
+/* Qual "scanvar op const" or "const op scanvar" */
+static Datum
+ExecJustScanVarConstQual(ExprState *state, ExprContext *econtext, bool *isnull)
+{
+	ExprEvalStep *op;
+	FunctionCallInfo fcinfo;
+	Datum		d;
+	int			i;
+
+	/* Load the Var and the Const into the function's arguments */
+	for (i = 1; i <= 2; i++)
+	{
+		op = &state->steps[i];
+		if (op->opcode == EEOP_CONST)
+		{
+			*op->resnull = op->d.constval.isnull;
+			*op->resvalue = op->d.constval.value;
+		}
+		else
+		{
+			/* See comments in ExecJustInnerVarFirst */
+			*op->resvalue = slot_getattr(econtext->ecxt_scantuple,
+										 op->d.var.attnum + 1,
+										 op->resnull);
+		}
+	}
+
+	/* A NULL argument to the strict function makes the qual false */
+	op = &state->steps[3];
+	fcinfo = op->d.func.fcinfo_data;
+	*isnull = false;
+	if (fcinfo->argnull[0] || fcinfo->argnull[1])
+		return BoolGetDatum(false);
+
+	fcinfo->isnull = false;
+	d = (op->d.func.fn_addr) (fcinfo);
+	if (fcinfo->isnull || !DatumGetBool(d))
+		return BoolGetDatum(false);
+
+	return BoolGetDatum(true);
+}
+
+
 /*
  * Do one-time initialization of interpretation machinery.
  */
@@ -74,6 +74,9 @@ ExecutorEnd_hook_type ExecutorEnd_hook = NULL;
 /* Hook for plugin to get control in ExecCheckRTPerms() */
 ExecutorCheckPerms_hook_type ExecutorCheckPerms_hook = NULL;
 
+/* GUC parameter: plan cost above which to specialize tuple deforming */
+double		specialize_above_cost = 100000;
+
 /* decls for local routines only used within this module */
 static void InitPlan(QueryDesc *queryDesc, int eflags);
 static void CheckValidRowMarkRel(Relation rel, RowMarkType markType);
@@ -250,6 +253,14 @@ standard_ExecutorStart(QueryDesc *queryDesc, int eflags)
 	estate->es_top_eflags = eflags;
 	estate->es_instrument = queryDesc->instrument_options;
 
+	/*
+	 * Decide whether the query is expensive enough to be worth spending some
+	 * setup time on specialized execution paths.
+	 */
+	estate->es_specialize = (specialize_above_cost >= 0 &&
+							 queryDesc->plannedstmt->planTree->total_cost >=
+							 specialize_above_cost);
+
 	/*
 	 * Initialize the plan state tree
 	 */
@@ -3213,104 +3224,152 @@ EvalPlanQualEnd(EPQState *epqstate)
  * ExecSetupPartitionTupleRouting - set up information needed during
  * tuple routing for partitioned tables
  *
- * Output arguments:
- * 'pd' receives an array of PartitionDispatch objects with one entry for
- *		every partitioned table in the partition tree
- * 'partitions' receives an array of ResultRelInfo objects with one entry for
- *		every leaf partition in the partition tree
- * 'tup_conv_maps' receives an array of TupleConversionMap objects with one
- *		entry for every leaf partition (required to convert input tuple based
- *		on the root table's rowtype to a leaf partition's rowtype after tuple
- *		routing is done)
- * 'partition_tuple_slot' receives a standalone TupleTableSlot to be used
- *		to manipulate any given leaf partition's rowtype after that partition
- *		is chosen by tuple-routing.
- * 'num_parted' receives the number of partitioned tables in the partition
- *		tree (= the number of entries in the 'pd' output array)
- * 'num_partitions' receives the number of leaf partitions in the partition
- *		tree (= the number of entries in the 'partitions' and 'tup_conv_maps'
- *		output arrays
+ * The returned PartitionTupleRouting holds a PartitionDispatch object for
+ * every partitioned table in the partition tree, and room for a
+ * ResultRelInfo for every leaf partition.  The latter are only initialized
+ * by ExecInitPartitionResultRel when the first tuple is routed to the
+ * partition, since a table can have many partitions of which a statement
+ * touches only a few.  The slot in it is used to manipulate tuples of any
+ * given partition's rowtype; it is released by ExecCleanupTupleRouting,
+ * along with the relations.
  *
  * Note that all the relations in the partition tree are locked using the
  * RowExclusiveLock mode upon return from this function.
  */
-void
-ExecSetupPartitionTupleRouting(Relation rel,
-							   Index resultRTindex,
-							   PartitionDispatch **pd,
-							   ResultRelInfo **partitions,
-							   TupleConversionMap ***tup_conv_maps,
-							   TupleTableSlot **partition_tuple_slot,
-							   int *num_parted, int *num_partitions)
+PartitionTupleRouting *
+ExecSetupPartitionTupleRouting(Relation rel, Index resultRTindex)
 {
-	TupleDesc	tupDesc = RelationGetDescr(rel);
+	PartitionTupleRouting *proute;
 	List	   *leaf_parts;
 	ListCell   *cell;
 	int			i;
-	ResultRelInfo *leaf_part_rri;
+
+	proute = (PartitionTupleRouting *) palloc0(sizeof(PartitionTupleRouting));
+	proute->rootrel = rel;
+	proute->resultRTindex = resultRTindex;
 
 	/* Get the tuple-routing information and lock partitions */
-	*pd = RelationGetPartitionDispatchInfo(rel, RowExclusiveLock, num_parted,
-										   &leaf_parts);
-	*num_partitions = list_length(leaf_parts);
-	*partitions = (ResultRelInfo *) palloc(*num_partitions *
-										   sizeof(ResultRelInfo));
-	*tup_conv_maps = (TupleConversionMap **) palloc0(*num_partitions *
-													 sizeof(TupleConversionMap *));
+	proute->partition_dispatch_info =
+		RelationGetPartitionDispatchInfo(rel, RowExclusiveLock,
+										 &proute->num_dispatch, &leaf_parts);
+	proute->num_partitions = list_length(leaf_parts);
+	proute->partition_oids = (Oid *) palloc(proute->num_partitions *
+											sizeof(Oid));
+	i = 0;
+	foreach(cell, leaf_parts)
+		proute->partition_oids[i++] = lfirst_oid(cell);
+
+	proute->partitions = (ResultRelInfo **)
+		palloc0(proute->num_partitions * sizeof(ResultRelInfo *));
+	proute->partition_tupconv_maps = (TupleConversionMap **)
+		palloc0(proute->num_partitions * sizeof(TupleConversionMap *));
+
+	proute->partition_tuple_slot = MakeTupleTableSlot();
+
+	return proute;
+}
+
+/*
+ * ExecInitPartitionResultRel -- Set up the ResultRelInfo of the leaf
+ * partition with index partidx, the first time a tuple is routed to it
+ *
+ * Also saves the map to convert tuples from the root table's rowtype to
+ * the partition's.  The caller must still set up whatever depends on the
+ * plan, such as WITH CHECK OPTION constraints and RETURNING projections.
+ */
+ResultRelInfo *
+ExecInitPartitionResultRel(PartitionTupleRouting *proute, int partidx,
+						   EState *estate)
+{
+	ResultRelInfo *leaf_part_rri;
+	Relation	partrel;
+	MemoryContext oldcxt;
+
+	Assert(partidx >= 0 && partidx < proute->num_partitions);
+	Assert(proute->partitions[partidx] == NULL);
+
+	/* COPY calls us in a per-tuple context, but this lasts for the query */
+	oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
 
 	/*
-	 * Initialize an empty slot that will be used to manipulate tuples of any
-	 * given partition's rowtype.  It is attached to the caller-specified node
-	 * (such as ModifyTableState) and released when the node finishes
-	 * processing.
+	 * We locked all the partitions in ExecSetupPartitionTupleRouting.  The
+	 * relation is eventually closed by ExecCleanupTupleRouting.
 	 */
-	*partition_tuple_slot = MakeTupleTableSlot();
+	partrel = heap_open(proute->partition_oids[partidx], NoLock);
 
-	leaf_part_rri = *partitions;
-	i = 0;
-	foreach(cell, leaf_parts)
-	{
-		Relation	partrel;
-		TupleDesc	part_tupdesc;
+	/*
+	 * Verify result relation is a valid target for the current operation.
+	 */
+	CheckValidResultRel(partrel, CMD_INSERT);
 
-		/*
-		 * We locked all the partitions above including the leaf partitions.
-		 * Note that each of the relations in *partitions are eventually
-		 * closed by the caller.
-		 */
-		partrel = heap_open(lfirst_oid(cell), NoLock);
-		part_tupdesc = RelationGetDescr(partrel);
+	/*
+	 * Save a tuple conversion map to convert a tuple routed to this partition
+	 * from the parent's type to the partition's.
+	 */
+	proute->partition_tupconv_maps[partidx] =
+		convert_tuples_by_name(RelationGetDescr(proute->rootrel),
+							   RelationGetDescr(partrel),
+							   gettext_noop("could not convert row type"));
 
-		/*
-		 * Verify result relation is a valid target for the current operation.
-		 */
-		CheckValidResultRel(partrel, CMD_INSERT);
+	leaf_part_rri = (ResultRelInfo *) palloc(sizeof(ResultRelInfo));
+	InitResultRelInfo(leaf_part_rri,
+					  partrel,
+					  proute->resultRTindex,
+					  proute->rootrel,
+					  0);
 
-		/*
-		 * Save a tuple conversion map to convert a tuple routed to this
-		 * partition from the parent's type to the partition's.
-		 */
-		(*tup_conv_maps)[i] = convert_tuples_by_name(tupDesc, part_tupdesc,
-													 gettext_noop("could not convert row type"));
+	/*
+	 * Open partition indices (remember we do not support ON CONFLICT in case
+	 * of partitioned tables, so we do not need support information for
+	 * speculative insertion)
+	 */
+	if (leaf_part_rri->ri_RelationDesc->rd_rel->relhasindex &&
+		leaf_part_rri->ri_IndexRelationDescs == NULL)
+		ExecOpenIndices(leaf_part_rri, false);
 
-		InitResultRelInfo(leaf_part_rri,
-						  partrel,
-						  resultRTindex,
-						  rel,
-						  0);
+	proute->partitions[partidx] = leaf_part_rri;
 
-		/*
-		 * Open partition indices (remember we do not support ON CONFLICT in
-		 * case of partitioned tables, so we do not need support information
-		 * for speculative insertion)
-		 */
-		if (leaf_part_rri->ri_RelationDesc->rd_rel->relhasindex &&
-			leaf_part_rri->ri_IndexRelationDescs == NULL)
-			ExecOpenIndices(leaf_part_rri, false);
+	MemoryContextSwitchTo(oldcxt);
 
-		leaf_part_rri++;
-		i++;
+	return leaf_part_rri;
+}
+
+/*
+ * ExecCleanupTupleRouting -- Close the relations opened for tuple routing
+ * and release the standalone slot
+ */
+void
+ExecCleanupTupleRouting(PartitionTupleRouting *proute)
+{
+	int			i;
+
+	/*
+	 * Remember partition_dispatch_info[0] corresponds to the root partitioned
+	 * table, which we must not try to close, because it is the main target
+	 * table of the query that will be closed by the caller.  Also, tupslot is
+	 * NULL for the root partitioned table.
+	 */
+	for (i = 1; i < proute->num_dispatch; i++)
+	{
+		PartitionDispatch pd = proute->partition_dispatch_info[i];
+
+		heap_close(pd->reldesc, NoLock);
+		ExecDropSingleTupleTableSlot(pd->tupslot);
 	}
+
+	for (i = 0; i < proute->num_partitions; i++)
+	{
+		ResultRelInfo *resultRelInfo = proute->partitions[i];
+
+		/* Skip the partitions that no tuple was routed to */
+		if (resultRelInfo == NULL)
+			continue;
+
+		ExecCloseIndices(resultRelInfo);
+		heap_close(resultRelInfo->ri_RelationDesc, NoLock);
+	}
+
+	ExecDropSingleTupleTableSlot(proute->partition_tuple_slot);
 }
 
 /*
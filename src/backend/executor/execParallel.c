@@ -25,9 +25,11 @@
 
 #include "executor/execParallel.h"
 #include "executor/executor.h"
+#include "executor/nodeAppend.h"
 #include "executor/nodeBitmapHeapscan.h"
 #include "executor/nodeCustom.h"
 #include "executor/nodeForeignscan.h"
+#include "executor/nodeHashjoin.h"
 #include "executor/nodeSeqscan.h"
 #include "executor/nodeIndexscan.h"
 #include "executor/nodeIndexonlyscan.h"
@@ -107,6 +109,8 @@ static bool ExecParallelEstimate(PlanState *node,
 					 ExecParallelEstimateContext *e);
 static bool ExecParallelInitializeDSM(PlanState *node,
 						  ExecParallelInitializeDSMContext *d);
+static bool ExecParallelWorkersLaunchedWalker(PlanState *planstate,
+								  ParallelContext *pcxt);
 static shm_mq_handle **ExecParallelSetupTupleQueues(ParallelContext *pcxt,
 							 bool reinitialize);
 static bool ExecParallelRetrieveInstrumentation(PlanState *planstate,
@@ -239,6 +243,14 @@ ExecParallelEstimate(PlanState *planstate, ExecParallelEstimateContext *e)
 				ExecBitmapHeapEstimate((BitmapHeapScanState *) planstate,
 									   e->pcxt);
 				break;
+			case T_HashJoinState:
+				ExecHashJoinEstimate((HashJoinState *) planstate,
+									 e->pcxt);
+				break;
+			case T_AppendState:
+				ExecAppendEstimate((AppendState *) planstate,
+								   e->pcxt);
+				break;
 			default:
 				break;
 		}
@@ -303,6 +315,14 @@ ExecParallelInitializeDSM(PlanState *planstate,
 				ExecBitmapHeapInitializeDSM((BitmapHeapScanState *) planstate,
 											d->pcxt);
 				break;
+			case T_HashJoinState:
+				ExecHashJoinInitializeDSM((HashJoinState *) planstate,
+										  d->pcxt);
+				break;
+			case T_AppendState:
+				ExecAppendInitializeDSM((AppendState *) planstate,
+										d->pcxt);
+				break;
 
 			default:
 				break;
@@ -312,6 +332,33 @@ ExecParallelInitializeDSM(PlanState *planstate,
 	return planstate_tree_walker(planstate, ExecParallelInitializeDSM, d);
 }
 
+/*
+ * Let parallel-aware plan nodes know how many workers were launched.
+ */
+static bool
+ExecParallelWorkersLaunchedWalker(PlanState *planstate, ParallelContext *pcxt)
+{
+	if (planstate == NULL)
+		return false;
+
+	if (planstate->plan->parallel_aware)
+	{
+		switch (nodeTag(planstate))
+		{
+			case T_HashJoinState:
+				ExecHashJoinWorkersLaunched((HashJoinState *) planstate,
+											pcxt);
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	return planstate_tree_walker(planstate, ExecParallelWorkersLaunchedWalker,
+								 pcxt);
+}
+
 /*
  * It sets up the response queues for backend workers to return tuples
  * to the main backend and start the workers.
@@ -376,6 +423,18 @@ ExecParallelReinitialize(ParallelExecutorInfo *pei)
 	pei->finished = false;
 }
 
+/*
+ * To be called by Gather and Gather Merge right after launching the workers,
+ * for the benefit of parallel-aware nodes that need to know how many workers
+ * they can count on.  Some workers may have started executing the plan by
+ * the time this is called.
+ */
+void
+ExecParallelWorkersLaunched(ParallelExecutorInfo *pei)
+{
+	ExecParallelWorkersLaunchedWalker(pei->planstate, pei->pcxt);
+}
+
 /*
  * Sets up the required infrastructure for backend workers to perform
  * execution and return results to the main backend.
@@ -806,6 +865,12 @@ ExecParallelInitializeWorker(PlanState *planstate, shm_toc *toc)
 				ExecBitmapHeapInitializeWorker(
 											   (BitmapHeapScanState *) planstate, toc);
 				break;
+			case T_HashJoinState:
+				ExecHashJoinInitializeWorker((HashJoinState *) planstate, toc);
+				break;
+			case T_AppendState:
+				ExecAppendInitializeWorker((AppendState *) planstate, toc);
+				break;
 			default:
 				break;
 		}
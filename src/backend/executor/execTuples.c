@@ -123,6 +123,7 @@ MakeTupleTableSlot(void)
 	slot->tts_values = NULL;
 	slot->tts_isnull = NULL;
 	slot->tts_mintuple = NULL;
+	slot->tts_deform = NULL;
 
 	return slot;
 }
@@ -177,6 +178,8 @@ ExecResetTupleTable(List *tupleTable,	/* tuple table */
 				pfree(slot->tts_values);
 			if (slot->tts_isnull)
 				pfree(slot->tts_isnull);
+			if (slot->tts_deform)
+				pfree(slot->tts_deform);
 			pfree(slot);
 		}
 	}
@@ -224,6 +227,8 @@ ExecDropSingleTupleTableSlot(TupleTableSlot *slot)
 		pfree(slot->tts_values);
 	if (slot->tts_isnull)
 		pfree(slot->tts_isnull);
+	if (slot->tts_deform)
+		pfree(slot->tts_deform);
 	pfree(slot);
 }
 
@@ -261,6 +266,9 @@ ExecSetSlotDescriptor(TupleTableSlot *slot, /* slot to change */
 		pfree(slot->tts_values);
 	if (slot->tts_isnull)
 		pfree(slot->tts_isnull);
+	if (slot->tts_deform)
+		pfree(slot->tts_deform);
+	slot->tts_deform = NULL;
 
 	/*
 	 * Install the new descriptor; if it's refcounted, bump its refcount.
@@ -278,6 +286,96 @@ ExecSetSlotDescriptor(TupleTableSlot *slot, /* slot to change */
 		MemoryContextAlloc(slot->tts_mcxt, tupdesc->natts * sizeof(bool));
 }
 
+/* --------------------------------
+ *		ExecSetSlotDeformProgram
+ *
+ *		Precompute the layout of the leading fixed-width columns of the
+ *		slot's tuple descriptor, so that slot_deform_tuple can extract
+ *		them from their known offsets instead of stepping through the
+ *		columns one by one.  This costs a little at setup, so it's only
+ *		worth doing for slots that will see many tuples.
+ *
+ *		The program is discarded if the slot's descriptor changes.
+ * --------------------------------
+ */
+void
+ExecSetSlotDeformProgram(TupleTableSlot *slot)
+{
+	TupleDesc	tupdesc = slot->tts_tupleDescriptor;
+	TupleDeformProgram *prog;
+	int			nfixed;
+	int			attnum;
+	long		off = 0;
+
+	Assert(tupdesc != NULL);
+
+	if (slot->tts_deform)
+	{
+		pfree(slot->tts_deform);
+		slot->tts_deform = NULL;
+	}
+
+	for (nfixed = 0; nfixed < tupdesc->natts; nfixed++)
+	{
+		if (tupdesc->attrs[nfixed]->attlen <= 0)
+			break;
+	}
+	if (nfixed == 0)
+		return;					/* nothing to gain */
+
+	prog = (TupleDeformProgram *)
+		MemoryContextAlloc(slot->tts_mcxt,
+						   offsetof(TupleDeformProgram, attrs) +
+						   nfixed * sizeof(DeformAttr));
+	prog->nfixed = nfixed;
+	prog->nnotnull = 0;
+
+	for (attnum = 0; attnum < nfixed; attnum++)
+	{
+		Form_pg_attribute att = tupdesc->attrs[attnum];
+		DeformAttr *dattr = &prog->attrs[attnum];
+
+		/* not varlena, so safe to use att_align_nominal */
+		off = att_align_nominal(off, att->attalign);
+		dattr->off = off;
+		dattr->len = att->attlen;
+
+		if (!att->attbyval)
+			dattr->fetch = DEFORM_FETCH_POINTER;
+		else
+		{
+			switch (att->attlen)
+			{
+				case sizeof(char):
+					dattr->fetch = DEFORM_FETCH_CHAR;
+					break;
+				case sizeof(int16):
+					dattr->fetch = DEFORM_FETCH_INT16;
+					break;
+				case sizeof(int32):
+					dattr->fetch = DEFORM_FETCH_INT32;
+					break;
+#if SIZEOF_DATUM == 8
+				case sizeof(Datum):
+					dattr->fetch = DEFORM_FETCH_DATUM;
+					break;
+#endif
+				default:
+					elog(ERROR, "unsupported byval length: %d",
+						 (int) att->attlen);
+			}
+		}
+
+		off += att->attlen;
+
+		/* dropped columns are always null, whatever attnotnull says */
+		if (prog->nnotnull == attnum && att->attnotnull && !att->attisdropped)
+			prog->nnotnull++;
+	}
+
+	slot->tts_deform = prog;
+}
+
 /* --------------------------------
  *		ExecStoreTuple
  *
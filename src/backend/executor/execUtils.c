@@ -542,6 +542,10 @@ ExecAssignScanType(ScanState *scanstate, TupleDesc tupDesc)
 	TupleTableSlot *slot = scanstate->ss_ScanTupleSlot;
 
 	ExecSetSlotDescriptor(slot, tupDesc);
+
+	/* scan slots see the most tuples, so specialize their deforming */
+	if (scanstate->ps.state->es_specialize)
+		ExecSetSlotDeformProgram(slot);
 }
 
 /* ----------------
@@ -194,6 +194,30 @@
  *	  transition values.  hashcontext is the single context created to support
  *	  all hash tables.
  *
+ *	  Batch mode:
+ *
+ *	  When executor_batch_size is set and an ungrouped aggregate sits directly
+ *	  on a sequential scan, and every aggregate is one of a few common ones
+ *	  over a plain column (count, and sum/min/max of int4, int8 or float8),
+ *	  we read the scan's output a batch at a time and run the transition
+ *	  steps as tight loops over each batch's selected rows, instead of calling
+ *	  the transition functions once per row; see execBatch.c.
+ *
+ *	  Spilling to disk:
+ *
+ *	  In AGG_HASHED mode with a single hash table (that is, without grouping
+ *	  sets), we don't let the table grow without bound if the planner's group
+ *	  count estimate turns out to be badly wrong.  Once the table's estimated
+ *	  memory use exceeds work_mem, we stop creating new groups: input tuples
+ *	  belonging to groups already in the table are still aggregated into
+ *	  them, but all other tuples are written out to a set of temporary files,
+ *	  partitioned by their hash value.  Since every tuple of a group either
+ *	  finds the group in the table or goes to the same partition, each group
+ *	  ends up being processed in exactly one pass.  After the in-memory groups
+ *	  have been emitted, the table is emptied and each partition is read back
+ *	  in turn as if it were the input, which may spill again into smaller
+ *	  partitions using further bits of the hash value.
+ *
  *
  * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -206,13 +230,18 @@
 
 #include "postgres.h"
 
+#include <math.h>
+
 #include "access/htup_details.h"
 #include "catalog/objectaccess.h"
 #include "catalog/pg_aggregate.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
+#include "commands/tablespace.h"
+#include "executor/execBatch.h"
 #include "executor/executor.h"
 #include "executor/nodeAgg.h"
+#include "executor/nodeSeqscan.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
@@ -222,13 +251,36 @@
 #include "parser/parse_coerce.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/dynahash.h"
+#include "utils/fmgroids.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/syscache.h"
+#include "storage/buffile.h"
 #include "utils/tuplesort.h"
 #include "utils/datum.h"
 
 
+/*
+ * Transition steps that can be applied to a whole batch at once (see
+ * agg_batch_init).  Each one must give the same result as calling the
+ * aggregate's transition function once per row.
+ */
+typedef enum AggBatchKind
+{
+	AGG_BATCH_NONE,				/* not in batch mode */
+	AGG_BATCH_COUNT_STAR,		/* count(*) */
+	AGG_BATCH_COUNT,			/* count(col) */
+	AGG_BATCH_SUM_INT4,			/* sum(int4) */
+	AGG_BATCH_SUM_FLOAT8,		/* sum(float8) */
+	AGG_BATCH_MIN_INT4,			/* min(int4) */
+	AGG_BATCH_MAX_INT4,			/* max(int4) */
+	AGG_BATCH_MIN_INT8,			/* min(int8) */
+	AGG_BATCH_MAX_INT8,			/* max(int8) */
+	AGG_BATCH_MIN_FLOAT8,		/* min(float8) */
+	AGG_BATCH_MAX_FLOAT8		/* max(float8) */
+} AggBatchKind;
+
 /*
  * AggStatePerTransData - per aggregate state value information
  *
@@ -391,6 +443,10 @@ typedef struct AggStatePerTransData
 	FunctionCallInfoData serialfn_fcinfo;
 
 	FunctionCallInfoData deserialfn_fcinfo;
+
+	/* Batch transition step and its input column, if in batch mode */
+	AggBatchKind batchkind;
+	AttrNumber	batchattno;
 }			AggStatePerTransData;
 
 /*
@@ -517,6 +573,17 @@ typedef struct AggStatePerHashData
 	Agg		   *aggnode;		/* original Agg node, for numGroups etc. */
 }			AggStatePerHashData;
 
+/*
+ * HashAggBatch - a partition of the input that was spilled to disk while
+ * filling a hash table, waiting to be processed by a later pass
+ */
+typedef struct HashAggBatch
+{
+	BufFile    *file;			/* the spilled input tuples */
+	int			used_bits;		/* # of hash bits used to select this file */
+	double		ntuples;		/* # of tuples in the file */
+} HashAggBatch;
+
 
 static void select_current_set(AggState *aggstate, int setno, bool is_hash);
 static void initialize_phase(AggState *aggstate, int newphase);
@@ -556,11 +623,21 @@ static void finalize_aggregates(AggState *aggstate,
 static TupleTableSlot *project_aggregates(AggState *aggstate);
 static Bitmapset *find_unaggregated_cols(AggState *aggstate);
 static bool find_unaggregated_cols_walker(Node *node, Bitmapset **colnos);
-static void build_hash_table(AggState *aggstate);
+static void build_hash_table(AggState *aggstate, double ngroups);
 static TupleHashEntryData *lookup_hash_entry(AggState *aggstate);
 static AggStatePerGroup *lookup_hash_entries(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_direct(AggState *aggstate);
 static void agg_fill_hash_table(AggState *aggstate);
+static bool agg_batch_init(AggState *aggstate);
+static void advance_aggregates_batch(AggState *aggstate,
+						 AggStatePerGroup pergroup, TupleBatch *batch);
+static TupleTableSlot *agg_retrieve_batch(AggState *aggstate);
+static void agg_hash_input_tuple(AggState *aggstate, TupleTableSlot *slot);
+static bool agg_refill_hash_table(AggState *aggstate);
+static void hash_agg_check_limits(AggState *aggstate);
+static void hash_agg_spill_tuple(AggState *aggstate, TupleTableSlot *slot);
+static void hash_agg_finish_spill(AggState *aggstate);
+static void hash_agg_reset_spill(AggState *aggstate);
 static TupleTableSlot *agg_retrieve_hash_table(AggState *aggstate);
 static Datum GetAggInitVal(Datum textInitVal, Oid transtype);
 static void build_pertrans_for_aggref(AggStatePerTrans pertrans,
@@ -1852,9 +1929,13 @@ find_unaggregated_cols_walker(Node *node, Bitmapset **colnos)
  * The hash tables always live in the hashcontext's per-tuple memory context
  * (there is only one of these for all tables together, since they are all
  * reset at the same time).
+ *
+ * If ngroups is positive, it replaces the planner's estimate of the number
+ * of groups when sizing the table; this is used when processing a batch of
+ * spilled tuples, which can't contain more groups than tuples.
  */
 static void
-build_hash_table(AggState *aggstate)
+build_hash_table(AggState *aggstate, double ngroups)
 {
 	MemoryContext tmpmem = aggstate->tmpcontext->ecxt_per_tuple_memory;
 	Size		additionalsize;
@@ -1867,14 +1948,18 @@ build_hash_table(AggState *aggstate)
 	for (i = 0; i < aggstate->num_hashes; ++i)
 	{
 		AggStatePerHash perhash = &aggstate->perhash[i];
+		long		nbuckets = perhash->aggnode->numGroups;
 
 		Assert(perhash->aggnode->numGroups > 0);
 
+		if (ngroups > 0 && ngroups < nbuckets)
+			nbuckets = Max((long) ngroups, 1);
+
 		perhash->hashtable = BuildTupleHashTable(perhash->numCols,
 												 perhash->hashGrpColIdxHash,
 												 perhash->eqfunctions,
 												 perhash->hashfunctions,
-												 perhash->aggnode->numGroups,
+												 nbuckets,
 												 additionalsize,
 												 aggstate->hashcontext->ecxt_per_tuple_memory,
 												 tmpmem,
@@ -2023,6 +2108,9 @@ hash_agg_entry_size(int numAggs)
  * set (which the caller must have selected - note that initialize_aggregate
  * depends on this).
  *
+ * If the table has started spilling, no new entries are created, and NULL is
+ * returned if the group isn't already present.
+ *
  * When called, CurrentMemoryContext should be the per-query context.
  */
 static TupleHashEntryData *
@@ -2048,6 +2136,10 @@ lookup_hash_entry(AggState *aggstate)
 	}
 	ExecStoreVirtualTuple(hashslot);
 
+	/* only look for an existing entry if we can't create any more */
+	if (aggstate->hash_spill_mode)
+		return LookupTupleHashEntry(perhash->hashtable, hashslot, NULL);
+
 	/* find or create the hashtable entry using the filtered tuple */
 	entry = LookupTupleHashEntry(perhash->hashtable, hashslot, &isnew);
 
@@ -2059,6 +2151,18 @@ lookup_hash_entry(AggState *aggstate)
 		/* initialize aggregates for new tuple group */
 		initialize_aggregates(aggstate, (AggStatePerGroup) entry->additional,
 							  -1);
+
+		/*
+		 * Keep track of the space used by the new group.  Like
+		 * hash_agg_entry_size, this doesn't count pass-by-reference
+		 * transition values; the planner doesn't choose a hashed Agg that
+		 * is expected to exceed work_mem if there are any, see
+		 * hashagg_memory_ok.
+		 */
+		aggstate->hash_mem_used += MAXALIGN(entry->firstTuple->t_len) +
+			MAXALIGN(sizeof(AggStatePerGroupData) * aggstate->numtrans);
+		if (aggstate->hash_spill_enabled)
+			hash_agg_check_limits(aggstate);
 	}
 
 	return entry;
@@ -2068,6 +2172,9 @@ lookup_hash_entry(AggState *aggstate)
  * Look up hash entries for the current tuple in all hashed grouping sets,
  * returning an array of pergroup pointers suitable for advance_aggregates.
  *
+ * Returns NULL if the (single) hash table is spilling and the tuple's group
+ * isn't in it; the caller must then spill the tuple.
+ *
  * Be aware that lookup_hash_entry can reset the tmpcontext.
  */
 static AggStatePerGroup *
@@ -2079,8 +2186,16 @@ lookup_hash_entries(AggState *aggstate)
 
 	for (setno = 0; setno < numHashes; setno++)
 	{
+		TupleHashEntryData *entry;
+
 		select_current_set(aggstate, setno, true);
-		pergroup[setno] = lookup_hash_entry(aggstate)->additional;
+		entry = lookup_hash_entry(aggstate);
+		if (entry == NULL)
+		{
+			Assert(aggstate->hash_spill_mode && numHashes == 1);
+			return NULL;
+		}
+		pergroup[setno] = entry->additional;
 	}
 
 	return pergroup;
@@ -2120,6 +2235,12 @@ ExecAgg(PlanState *pstate)
 				result = agg_retrieve_hash_table(node);
 				break;
 			case AGG_PLAIN:
+				if (node->batch_mode)
+				{
+					result = agg_retrieve_batch(node);
+					break;
+				}
+				/* FALLTHROUGH */
 			case AGG_SORTED:
 				result = agg_retrieve_direct(node);
 				break;
@@ -2485,6 +2606,351 @@ agg_retrieve_direct(AggState *aggstate)
 	return NULL;
 }
 
+/*
+ * ExecAgg for ungrouped aggregation in batch mode
+ *
+ * This is the batch equivalent of agg_retrieve_direct for AGG_PLAIN: it
+ * aggregates all the input and returns the single result row, if it passes
+ * the HAVING qual.
+ */
+static TupleTableSlot *
+agg_retrieve_batch(AggState *aggstate)
+{
+	SeqScanState *scanstate = castNode(SeqScanState, outerPlanState(aggstate));
+	ExprContext *econtext = aggstate->ss.ps.ps_ExprContext;
+	AggStatePerGroup pergroup = aggstate->pergroup;
+	TupleTableSlot *firstSlot = aggstate->ss.ss_ScanTupleSlot;
+	TupleBatch *batch;
+
+	ReScanExprContext(econtext);
+	ReScanExprContext(aggstate->aggcontexts[0]);
+
+	select_current_set(aggstate, 0, false);
+	initialize_aggregates(aggstate, pergroup, 1);
+
+	while ((batch = ExecSeqScanNextBatch(scanstate)) != NULL)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		if (batch->nselected > 0)
+			advance_aggregates_batch(aggstate, pergroup, batch);
+	}
+
+	aggstate->agg_done = true;
+
+	/*
+	 * As in agg_retrieve_direct with no input rows, there can't be any
+	 * references to non-aggregated input columns, so an empty representative
+	 * tuple will do.
+	 */
+	ExecClearTuple(firstSlot);
+	econtext->ecxt_outertuple = firstSlot;
+
+	aggstate->projected_set = 0;
+	prepare_projection_slot(aggstate, econtext->ecxt_outertuple, 0);
+	finalize_aggregates(aggstate, aggstate->peragg, pergroup);
+
+	return project_aggregates(aggstate);
+}
+
+/*
+ * Advance the transition states by all the selected rows of a batch.
+ *
+ * Every kernel works like its transition function applied once per row.
+ * For the strict ones (all but sum(int4)), NULL inputs are skipped and the
+ * first non-NULL input becomes the initial state if there was none.
+ * sum(int4)'s transition function isn't strict, but treats NULLs the same
+ * way.  All the transition values are passed by value.
+ */
+static void
+advance_aggregates_batch(AggState *aggstate, AggStatePerGroup pergroup,
+						 TupleBatch *batch)
+{
+	int		   *sel = batch->selection;
+	int			n = batch->nselected;
+	int			transno;
+
+	for (transno = 0; transno < aggstate->numtrans; transno++)
+	{
+		AggStatePerTrans pertrans = &aggstate->pertrans[transno];
+		AggStatePerGroup pergroupstate = &pergroup[transno];
+		AggBatchKind kind = pertrans->batchkind;
+		Datum		trans = pergroupstate->transValue;
+		bool		found = !pergroupstate->transValueIsNull;
+		Datum	   *values = NULL;
+		bool	   *isnull = NULL;
+		int			i;
+
+		if (pertrans->batchattno > 0)
+		{
+			values = batch->values[pertrans->batchattno - 1];
+			isnull = batch->isnull[pertrans->batchattno - 1];
+		}
+
+		switch (kind)
+		{
+			case AGG_BATCH_COUNT_STAR:
+				trans = Int64GetDatum(DatumGetInt64(trans) + n);
+				break;
+
+			case AGG_BATCH_COUNT:
+				{
+					int64		count = DatumGetInt64(trans);
+
+					for (i = 0; i < n; i++)
+					{
+						if (!isnull[sel[i]])
+							count++;
+					}
+					trans = Int64GetDatum(count);
+					break;
+				}
+
+			case AGG_BATCH_SUM_INT4:
+				{
+					int64		sum = found ? DatumGetInt64(trans) : 0;
+
+					for (i = 0; i < n; i++)
+					{
+						int			row = sel[i];
+
+						if (isnull[row])
+							continue;
+						sum += DatumGetInt32(values[row]);
+						found = true;
+					}
+					trans = Int64GetDatum(sum);
+					break;
+				}
+
+			case AGG_BATCH_SUM_FLOAT8:
+				{
+					float8		sum = found ? DatumGetFloat8(trans) : 0;
+
+					for (i = 0; i < n; i++)
+					{
+						int			row = sel[i];
+						float8		v;
+						float8		result;
+
+						if (isnull[row])
+							continue;
+						v = DatumGetFloat8(values[row]);
+						if (!found)
+						{
+							sum = v;
+							found = true;
+							continue;
+						}
+						/* same overflow check as float8pl */
+						result = sum + v;
+						if (isinf(result) && !isinf(sum) && !isinf(v))
+							ereport(ERROR,
+									(errcode(ERRCODE_NUMERIC_VALUE_OUT_OF_RANGE),
+									 errmsg("value out of range: overflow")));
+						sum = result;
+					}
+					trans = Float8GetDatum(sum);
+					break;
+				}
+
+			case AGG_BATCH_MIN_INT4:
+			case AGG_BATCH_MAX_INT4:
+				{
+					int32		result = found ? DatumGetInt32(trans) : 0;
+					bool		max = (kind == AGG_BATCH_MAX_INT4);
+
+					for (i = 0; i < n; i++)
+					{
+						int			row = sel[i];
+						int32		v;
+
+						if (isnull[row])
+							continue;
+						v = DatumGetInt32(values[row]);
+						if (!found || (max ? v > result : v < result))
+							result = v;
+						found = true;
+					}
+					trans = Int32GetDatum(result);
+					break;
+				}
+
+			case AGG_BATCH_MIN_INT8:
+			case AGG_BATCH_MAX_INT8:
+				{
+					int64		result = found ? DatumGetInt64(trans) : 0;
+					bool		max = (kind == AGG_BATCH_MAX_INT8);
+
+					for (i = 0; i < n; i++)
+					{
+						int			row = sel[i];
+						int64		v;
+
+						if (isnull[row])
+							continue;
+						v = DatumGetInt64(values[row]);
+						if (!found || (max ? v > result : v < result))
+							result = v;
+						found = true;
+					}
+					trans = Int64GetDatum(result);
+					break;
+				}
+
+			case AGG_BATCH_MIN_FLOAT8:
+			case AGG_BATCH_MAX_FLOAT8:
+				{
+					float8		result = found ? DatumGetFloat8(trans) : 0;
+					bool		max = (kind == AGG_BATCH_MAX_FLOAT8);
+
+					for (i = 0; i < n; i++)
+					{
+						int			row = sel[i];
+						float8		v;
+						int			cmp;
+
+						if (isnull[row])
+							continue;
+						v = DatumGetFloat8(values[row]);
+
+						/*
+						 * Compare like float8larger/float8smaller, which
+						 * return the new value if the values are equal.
+						 */
+						cmp = found ? float8_cmp_internal(result, v) : 0;
+						if (max ? cmp <= 0 : cmp >= 0)
+							result = v;
+						found = true;
+					}
+					trans = Float8GetDatum(result);
+					break;
+				}
+
+			case AGG_BATCH_NONE:
+				elog(ERROR, "aggregate is not supported in batch mode");
+				break;
+		}
+
+		if (found)
+		{
+			pergroupstate->transValue = trans;
+			pergroupstate->transValueIsNull = false;
+			pergroupstate->noTransValue = false;
+		}
+	}
+}
+
+/*
+ * Decide whether the aggregate can run in batch mode, and if so, set up the
+ * input scan to return batches.
+ *
+ * We require an ungrouped aggregate directly over a sequential scan that
+ * doesn't project, and every transition to be one we have a batch kernel for,
+ * taking no arguments or a single plain column of the scan.
+ */
+static bool
+agg_batch_init(AggState *aggstate)
+{
+	Agg		   *node = (Agg *) aggstate->ss.ps.plan;
+	PlanState  *outerstate = outerPlanState(aggstate);
+	Bitmapset  *attnums = NULL;
+	int			transno;
+
+	if (executor_batch_size <= 0)
+		return false;
+	if (node->aggstrategy != AGG_PLAIN || node->groupingSets != NIL ||
+		aggstate->aggsplit != AGGSPLIT_SIMPLE || aggstate->numtrans == 0)
+		return false;
+	if (!IsA(outerstate, SeqScanState) ||
+		aggstate->ss.ps.state->es_epqTuple != NULL)
+		return false;
+
+	for (transno = 0; transno < aggstate->numtrans; transno++)
+	{
+		AggStatePerTrans pertrans = &aggstate->pertrans[transno];
+		Aggref	   *aggref = pertrans->aggref;
+		Oid			inputtype = InvalidOid;
+		Var		   *var = NULL;
+
+		if (aggref->aggkind != AGGKIND_NORMAL || aggref->aggfilter != NULL ||
+			pertrans->numSortCols > 0 || pertrans->numInputs > 1)
+			return false;
+
+		if (pertrans->numInputs == 1)
+		{
+			TargetEntry *tle = linitial_node(TargetEntry, aggref->args);
+
+			if (!IsA(tle->expr, Var))
+				return false;
+			var = (Var *) tle->expr;
+			if (var->varno != OUTER_VAR || var->varattno <= 0)
+				return false;
+			inputtype = var->vartype;
+		}
+
+		switch (pertrans->transfn_oid)
+		{
+			case F_INT8INC:
+				pertrans->batchkind = AGG_BATCH_COUNT_STAR;
+				break;
+			case F_INT8INC_ANY:
+				/* only looks at null flags, so any input type will do */
+				pertrans->batchkind = AGG_BATCH_COUNT;
+				break;
+			case F_INT4_SUM:
+				pertrans->batchkind = AGG_BATCH_SUM_INT4;
+				break;
+			case F_FLOAT8PL:
+				pertrans->batchkind = AGG_BATCH_SUM_FLOAT8;
+				break;
+			case F_INT4SMALLER:
+				pertrans->batchkind = AGG_BATCH_MIN_INT4;
+				break;
+			case F_INT4LARGER:
+				pertrans->batchkind = AGG_BATCH_MAX_INT4;
+				break;
+			case F_INT8SMALLER:
+				pertrans->batchkind = AGG_BATCH_MIN_INT8;
+				break;
+			case F_INT8LARGER:
+				pertrans->batchkind = AGG_BATCH_MAX_INT8;
+				break;
+			case F_FLOAT8SMALLER:
+				pertrans->batchkind = AGG_BATCH_MIN_FLOAT8;
+				break;
+			case F_FLOAT8LARGER:
+				pertrans->batchkind = AGG_BATCH_MAX_FLOAT8;
+				break;
+			default:
+				return false;
+		}
+
+		/* the kernels keep the transition value in a Datum */
+		if (!pertrans->transtypeByVal)
+			return false;
+
+		if (pertrans->batchkind == AGG_BATCH_COUNT_STAR)
+		{
+			if (var != NULL)
+				return false;
+		}
+		else
+		{
+			if (var == NULL)
+				return false;
+			if (pertrans->batchkind != AGG_BATCH_COUNT &&
+				!ExecBatchTypeSupported(inputtype))
+				return false;
+			pertrans->batchattno = var->varattno;
+			attnums = bms_add_member(attnums, var->varattno);
+		}
+	}
+
+	return ExecSeqScanInitBatch((SeqScanState *) outerstate, attnums,
+								executor_batch_size);
+}
+
 /*
  * ExecAgg for hashed case: read input and build hash table
  */
@@ -2492,7 +2958,6 @@ static void
 agg_fill_hash_table(AggState *aggstate)
 {
 	TupleTableSlot *outerslot;
-	ExprContext *tmpcontext = aggstate->tmpcontext;
 
 	/*
 	 * Process each outer-plan tuple, and then fetch the next one, until we
@@ -2500,36 +2965,331 @@ agg_fill_hash_table(AggState *aggstate)
 	 */
 	for (;;)
 	{
-		AggStatePerGroup *pergroups;
-
 		outerslot = fetch_input_tuple(aggstate);
 		if (TupIsNull(outerslot))
 			break;
 
-		/* set up for lookup_hash_entries and advance_aggregates */
-		tmpcontext->ecxt_outertuple = outerslot;
+		agg_hash_input_tuple(aggstate, outerslot);
+	}
 
-		/* Find or build hashtable entries */
-		pergroups = lookup_hash_entries(aggstate);
+	/* Close the files of any partitions we spilled */
+	if (aggstate->hash_spill_mode)
+		hash_agg_finish_spill(aggstate);
 
-		/* Advance the aggregates */
-		if (DO_AGGSPLIT_COMBINE(aggstate->aggsplit))
-			combine_aggregates(aggstate, pergroups[0]);
-		else
-			advance_aggregates(aggstate, NULL, pergroups);
+	aggstate->table_filled = true;
+	/* Initialize to walk the first hash table */
+	select_current_set(aggstate, 0, true);
+	ResetTupleHashIterator(aggstate->perhash[0].hashtable,
+						   &aggstate->perhash[0].hashiter);
+}
+
+/*
+ * Aggregate one input tuple into the hash tables, or spill it to disk if its
+ * group isn't in the table and there's no room to add it.
+ */
+static void
+agg_hash_input_tuple(AggState *aggstate, TupleTableSlot *slot)
+{
+	ExprContext *tmpcontext = aggstate->tmpcontext;
+	AggStatePerGroup *pergroups;
+
+	/* set up for lookup_hash_entries and advance_aggregates */
+	tmpcontext->ecxt_outertuple = slot;
+
+	/* Find or build hashtable entries */
+	pergroups = lookup_hash_entries(aggstate);
+
+	if (pergroups == NULL)
+		hash_agg_spill_tuple(aggstate, slot);
+	/* Advance the aggregates */
+	else if (DO_AGGSPLIT_COMBINE(aggstate->aggsplit))
+		combine_aggregates(aggstate, pergroups[0]);
+	else
+		advance_aggregates(aggstate, NULL, pergroups);
+
+	/*
+	 * Reset per-input-tuple context after each tuple, but note that the hash
+	 * lookups do this too
+	 */
+	ResetExprContext(aggstate->tmpcontext);
+}
+
+/*
+ * Empty the hash table and fill it again from the next batch of spilled
+ * tuples.  Returns false if there are no batches left.
+ */
+static bool
+agg_refill_hash_table(AggState *aggstate)
+{
+	HashAggBatch *batch;
+	TupleTableSlot *slot = aggstate->hash_spill_slot;
+
+	if (aggstate->hash_batches == NIL)
+		return false;
+
+	batch = (HashAggBatch *) linitial(aggstate->hash_batches);
+	aggstate->hash_batches = list_delete_first(aggstate->hash_batches);
+
+	/*
+	 * Throw away the groups of the previous pass, which have all been
+	 * returned by now, and start over with an empty table.  (We use rescan
+	 * rather than just reset because transfns may have registered callbacks
+	 * that need to be run now.)
+	 */
+	ReScanExprContext(aggstate->hashcontext);
+	build_hash_table(aggstate, batch->ntuples);
+	aggstate->hash_mem_used = 0;
+	aggstate->hash_spill_bits = batch->used_bits;
+	aggstate->hash_ngroups_estimate = batch->ntuples;
+	aggstate->hash_batches_used++;
+
+	if (BufFileSeek(batch->file, 0, 0L, SEEK_SET))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not rewind hash-aggregate temporary file: %m")));
+
+	for (;;)
+	{
+		uint32		t_len;
+		MinimalTuple tuple;
+		size_t		nread;
 
 		/*
-		 * Reset per-input-tuple context after each tuple, but note that the
-		 * hash lookups do this too
+		 * We check for interrupts here because this is an alternative code
+		 * path to an ExecProcNode() call, which would include such a check.
 		 */
-		ResetExprContext(aggstate->tmpcontext);
+		CHECK_FOR_INTERRUPTS();
+
+		nread = BufFileRead(batch->file, (void *) &t_len, sizeof(t_len));
+		if (nread == 0)			/* end of file */
+			break;
+		if (nread != sizeof(t_len))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from hash-aggregate temporary file: %m")));
+		tuple = (MinimalTuple) palloc(t_len);
+		tuple->t_len = t_len;
+		nread = BufFileRead(batch->file,
+							(void *) ((char *) tuple + sizeof(uint32)),
+							t_len - sizeof(uint32));
+		if (nread != t_len - sizeof(uint32))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from hash-aggregate temporary file: %m")));
+
+		ExecStoreMinimalTuple(tuple, slot, true);
+		agg_hash_input_tuple(aggstate, slot);
 	}
 
-	aggstate->table_filled = true;
-	/* Initialize to walk the first hash table */
+	BufFileClose(batch->file);
+	pfree(batch);
+	ExecClearTuple(slot);
+
+	if (aggstate->hash_spill_mode)
+		hash_agg_finish_spill(aggstate);
+
 	select_current_set(aggstate, 0, true);
 	ResetTupleHashIterator(aggstate->perhash[0].hashtable,
 						   &aggstate->perhash[0].hashiter);
+
+	return true;
+}
+
+/*
+ * Called after a new group has been added to the hash table: switch to
+ * spilling if the table has grown past the memory limit.
+ *
+ * We can only partition the input by so many bits of the hash value; when
+ * they run out, we just let the table keep growing.
+ */
+static void
+hash_agg_check_limits(AggState *aggstate)
+{
+	TupleHashTable hashtable = aggstate->perhash[0].hashtable;
+	Size		mem_used;
+	double		ngroups;
+	double		nbatches;
+	int			npartitions;
+	int			partition_bits;
+
+	mem_used = aggstate->hash_mem_used +
+		hashtable->hashtab->size * sizeof(TupleHashEntryData);
+	if (mem_used <= aggstate->hash_mem_limit)
+		return;
+
+	/*
+	 * Choose enough partitions that each one's groups can be expected to fit
+	 * in memory, going by the average size of the groups seen so far.
+	 */
+	ngroups = Max(aggstate->hash_ngroups_estimate - hashtable->hashtab->members,
+				  1.0);
+	nbatches = ngroups * mem_used /
+		(Max(hashtable->hashtab->members, 1) * (double) aggstate->hash_mem_limit);
+	npartitions = HASHAGG_MIN_PARTITIONS;
+	while (npartitions < nbatches && npartitions < HASHAGG_MAX_PARTITIONS)
+		npartitions <<= 1;
+	partition_bits = my_log2(npartitions);
+
+	if (aggstate->hash_spill_bits + partition_bits > 32)
+		partition_bits = 32 - aggstate->hash_spill_bits;
+	if (partition_bits <= 0)
+		return;
+
+	aggstate->hash_spill_mode = true;
+	aggstate->hash_spill_npartitions = 1 << partition_bits;
+	aggstate->hash_spill_files = (BufFile **)
+		MemoryContextAllocZero(aggstate->ss.ps.state->es_query_cxt,
+							   aggstate->hash_spill_npartitions * sizeof(BufFile *));
+	aggstate->hash_spill_ntuples = (double *)
+		MemoryContextAllocZero(aggstate->ss.ps.state->es_query_cxt,
+							   aggstate->hash_spill_npartitions * sizeof(double));
+	/* make sure we have temp tablespaces established for the files */
+	PrepareTempTablespaces();
+}
+
+/*
+ * Write an input tuple whose group isn't in the hash table to the partition
+ * chosen by its hash value.  lookup_hash_entry has left the grouping columns
+ * in the hash slot for us.
+ *
+ * The partition is selected by the highest hash bits not used by earlier
+ * passes, since the hash table itself uses the lowest ones.
+ */
+static void
+hash_agg_spill_tuple(AggState *aggstate, TupleTableSlot *slot)
+{
+	AggStatePerHash perhash = &aggstate->perhash[0];
+	TupleTableSlot *hashslot = perhash->hashslot;
+	MemoryContext oldContext;
+	MinimalTuple tuple;
+	uint32		hashkey = 0;
+	int			partition_bits = my_log2(aggstate->hash_spill_npartitions);
+	int			partition;
+	BufFile    *file;
+	size_t		written;
+	int			i;
+
+	/* Need to run the hash functions in short-lived context */
+	oldContext = MemoryContextSwitchTo(aggstate->tmpcontext->ecxt_per_tuple_memory);
+
+	/* This must match TupleHashTableHash */
+	for (i = 0; i < perhash->numCols; i++)
+	{
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		if (!hashslot->tts_isnull[i])	/* treat nulls as having hash key 0 */
+		{
+			uint32		hkey;
+
+			hkey = DatumGetUInt32(FunctionCall1(&perhash->hashfunctions[i],
+												hashslot->tts_values[i]));
+			hashkey ^= hkey;
+		}
+	}
+
+	MemoryContextSwitchTo(oldContext);
+
+	partition = (hashkey >> (32 - aggstate->hash_spill_bits - partition_bits)) &
+		(aggstate->hash_spill_npartitions - 1);
+
+	file = aggstate->hash_spill_files[partition];
+	if (file == NULL)
+	{
+		/* First write to this partition, so open it. */
+		oldContext = MemoryContextSwitchTo(aggstate->ss.ps.state->es_query_cxt);
+		file = BufFileCreateTemp(false);
+		aggstate->hash_spill_files[partition] = file;
+		MemoryContextSwitchTo(oldContext);
+	}
+
+	tuple = ExecFetchSlotMinimalTuple(slot);
+	written = BufFileWrite(file, (void *) tuple, tuple->t_len);
+	if (written != tuple->t_len)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to hash-aggregate temporary file: %m")));
+
+	aggstate->hash_spill_ntuples[partition] += 1;
+	aggstate->hash_disk_used += tuple->t_len;
+}
+
+/*
+ * Turn the partitions written during the current pass into batches for later
+ * passes, and stop spilling.
+ */
+static void
+hash_agg_finish_spill(AggState *aggstate)
+{
+	int			used_bits;
+	int			i;
+
+	used_bits = aggstate->hash_spill_bits +
+		my_log2(aggstate->hash_spill_npartitions);
+
+	for (i = 0; i < aggstate->hash_spill_npartitions; i++)
+	{
+		HashAggBatch *batch;
+
+		if (aggstate->hash_spill_files[i] == NULL)
+			continue;
+
+		batch = (HashAggBatch *)
+			MemoryContextAlloc(aggstate->ss.ps.state->es_query_cxt,
+							   sizeof(HashAggBatch));
+		batch->file = aggstate->hash_spill_files[i];
+		batch->used_bits = used_bits;
+		batch->ntuples = aggstate->hash_spill_ntuples[i];
+		aggstate->hash_batches = lcons(batch, aggstate->hash_batches);
+	}
+
+	pfree(aggstate->hash_spill_files);
+	pfree(aggstate->hash_spill_ntuples);
+	aggstate->hash_spill_files = NULL;
+	aggstate->hash_spill_ntuples = NULL;
+	aggstate->hash_spill_npartitions = 0;
+	aggstate->hash_spill_mode = false;
+	aggstate->hash_spilled = true;
+}
+
+/*
+ * Release all temporary files and forget about any spilled batches, so that
+ * the hash table can be built again from scratch.
+ */
+static void
+hash_agg_reset_spill(AggState *aggstate)
+{
+	ListCell   *lc;
+	int			i;
+
+	for (i = 0; i < aggstate->hash_spill_npartitions; i++)
+	{
+		if (aggstate->hash_spill_files[i] != NULL)
+			BufFileClose(aggstate->hash_spill_files[i]);
+	}
+	if (aggstate->hash_spill_files != NULL)
+	{
+		pfree(aggstate->hash_spill_files);
+		pfree(aggstate->hash_spill_ntuples);
+		aggstate->hash_spill_files = NULL;
+		aggstate->hash_spill_ntuples = NULL;
+	}
+	aggstate->hash_spill_npartitions = 0;
+	aggstate->hash_spill_mode = false;
+
+	foreach(lc, aggstate->hash_batches)
+	{
+		HashAggBatch *batch = (HashAggBatch *) lfirst(lc);
+
+		BufFileClose(batch->file);
+	}
+	list_free_deep(aggstate->hash_batches);
+	aggstate->hash_batches = NIL;
+
+	aggstate->hash_spilled = false;
+	aggstate->hash_spill_bits = 0;
+	aggstate->hash_mem_used = 0;
+	aggstate->hash_ngroups_estimate = aggstate->perhash[0].aggnode->numGroups;
 }
 
 /*
@@ -2594,6 +3354,12 @@ agg_retrieve_hash_table(AggState *aggstate)
 
 				continue;
 			}
+			else if (agg_refill_hash_table(aggstate))
+			{
+				/* Loaded the next batch of spilled groups; scan them */
+				perhash = &aggstate->perhash[aggstate->current_set];
+				continue;
+			}
 			else
 			{
 				/* No more hashtables, so done */
@@ -3011,8 +3777,22 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 		aggstate->hash_pergroup = palloc0(sizeof(AggStatePerGroup) * numHashes);
 
 		find_hash_columns(aggstate);
-		build_hash_table(aggstate);
+		build_hash_table(aggstate, 0);
 		aggstate->table_filled = false;
+
+		/*
+		 * A single hash table may spill to disk if it grows beyond work_mem;
+		 * we need a slot to read the spilled input tuples back into.
+		 */
+		if (node->aggstrategy == AGG_HASHED && numHashes == 1)
+		{
+			aggstate->hash_spill_enabled = true;
+			aggstate->hash_mem_limit = work_mem * 1024L;
+			aggstate->hash_ngroups_estimate = aggstate->perhash[0].aggnode->numGroups;
+			aggstate->hash_spill_slot = ExecInitExtraTupleSlot(estate);
+			ExecSetSlotDescriptor(aggstate->hash_spill_slot,
+								  ExecGetResultType(outerPlanState(aggstate)));
+		}
 	}
 
 	if (node->aggstrategy != AGG_HASHED)
@@ -3391,6 +4171,9 @@ ExecInitAgg(Agg *node, EState *estate, int eflags)
 												 NULL);
 	ExecSetSlotDescriptor(aggstate->evalslot, aggstate->evaldesc);
 
+	/* Use batch-at-a-time processing if possible */
+	aggstate->batch_mode = agg_batch_init(aggstate);
+
 	return aggstate;
 }
 
@@ -3868,6 +4651,10 @@ ExecEndAgg(AggState *node)
 		}
 	}
 
+	/* Release any temporary files used by a spilled hash table */
+	if (node->hash_spill_enabled)
+		hash_agg_reset_spill(node);
+
 	/* And ensure any agg shutdown callbacks have been called */
 	for (setno = 0; setno < numGroupingSets; setno++)
 		ReScanExprContext(node->aggcontexts[setno]);
@@ -3915,10 +4702,13 @@ ExecReScanAgg(AggState *node)
 		 * If we do have the hash table, and the subplan does not have any
 		 * parameter changes, and none of our own parameter changes affect
 		 * input expressions of the aggregated functions, then we can just
-		 * rescan the existing hash table; no need to build it again.
+		 * rescan the existing hash table; no need to build it again.  That's
+		 * not possible if it spilled to disk, though, since it then doesn't
+		 * hold all the groups.
 		 */
 		if (outerPlan->chgParam == NULL &&
-			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams))
+			!bms_overlap(node->ss.ps.chgParam, aggnode->aggParams) &&
+			!node->hash_spilled)
 		{
 			ResetTupleHashIterator(node->perhash[0].hashtable,
 								   &node->perhash[0].hashiter);
@@ -3974,9 +4764,11 @@ ExecReScanAgg(AggState *node)
 	 */
 	if (node->aggstrategy == AGG_HASHED || node->aggstrategy == AGG_MIXED)
 	{
+		if (node->hash_spill_enabled)
+			hash_agg_reset_spill(node);
 		ReScanExprContext(node->hashcontext);
 		/* Rebuild an empty hash table */
-		build_hash_table(node);
+		build_hash_table(node, 0);
 		node->table_filled = false;
 		/* iterator will be reset when the table is filled */
 	}
@@ -17,6 +17,9 @@
  *		ExecAppend		- retrieve the next tuple from the node
  *		ExecEndAppend	- shut down the append node
  *		ExecReScanAppend - rescan the append node
+ *		ExecAppendEstimate - estimate space for parallel coordination
+ *		ExecAppendInitializeDSM - set up shared state in the leader
+ *		ExecAppendInitializeWorker - attach to shared state in a worker
  *
  *	 NOTES
  *		Each append node contains a list of one or more subplans which
@@ -53,59 +56,66 @@
  *			  nil	nil		 Scan	 Scan	  Scan	   Scan
  *							  |		  |		   |		|
  *							person employee student student-emp
+ *
+ *		When the subplans scan the partitions of a partitioned table, the
+ *		planner may give us steps for pruning partitions based on values
+ *		only known at run time (see PartitionPruneInfo).  Partitions ruled
+ *		out at executor startup don't get their subplans initialized at
+ *		all; those depending on PARAM_EXEC Params are pruned again before
+ *		each scan, by leaving them out of as_valid_subplans.
+ *
+ *		A parallel-aware Append doesn't run all of its subplans in every
+ *		process.  Instead, the participants pick subplans to run from a
+ *		ParallelAppendState in shared memory.  The planner puts the
+ *		subplans that must be run by a single process (non-partial plans)
+ *		first, in descending order of cost, followed by the partial plans,
+ *		which any number of processes can help with.  A non-partial plan is
+ *		marked finished as soon as someone picks it; a partial plan once the
+ *		first participant to get there runs out of tuples.  The workers take
+ *		the subplans in order, going round the partial plans once they've
+ *		reached the end, while the leader, which has to read the workers'
+ *		tuples too, starts from the cheap end of the list.
  */
 
 #include "postgres.h"
 
+#include "catalog/partition.h"
 #include "executor/execdebug.h"
 #include "executor/nodeAppend.h"
 #include "miscadmin.h"
+#include "storage/lwlock.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
 
-static TupleTableSlot *ExecAppend(PlanState *pstate);
-static bool exec_append_initialize_next(AppendState *appendstate);
-
-
-/* ----------------------------------------------------------------
- *		exec_append_initialize_next
- *
- *		Sets up the append state node for the "next" scan.
- *
- *		Returns t iff there is a "next" scan to process.
- * ----------------------------------------------------------------
- */
-static bool
-exec_append_initialize_next(AppendState *appendstate)
+/* Shared state for parallel-aware Append. */
+struct ParallelAppendState
 {
-	int			whichplan;
+	LWLock		pa_lock;		/* mutual exclusion to choose next subplan */
+	int			pa_next_plan;	/* next plan for a worker to try */
 
 	/*
-	 * get information from the append node
+	 * pa_finished[i] is true if no more processes should start on the i'th
+	 * entry of as_valid_subplans.  Non-partial plans are marked finished as
+	 * soon as they are picked.  Since the pruning steps give the same result
+	 * in every process, the positions mean the same subplans everywhere.
 	 */
-	whichplan = appendstate->as_whichplan;
+	bool		pa_finished[FLEXIBLE_ARRAY_MEMBER];
+};
+
+#define INVALID_SUBPLAN_INDEX		-1
+
+static TupleTableSlot *ExecAppend(PlanState *pstate);
+static bool choose_next_subplan_locally(AppendState *node);
+static bool choose_next_subplan_for_leader(AppendState *node);
+static bool choose_next_subplan_for_worker(AppendState *node);
+static void exec_append_set_first_partial(AppendState *appendstate);
+static PartitionPruneState *exec_append_setup_pruning(AppendState *appendstate,
+						   PartitionPruneInfo *pinfo);
+static Bitmapset *exec_append_prune_steps(AppendState *appendstate,
+						int nsteps, StrategyNumber *strategies,
+						ExprState **exprs, Bitmapset *partitions);
+static void exec_append_find_valid_subplans(AppendState *appendstate);
 
-	if (whichplan < 0)
-	{
-		/*
-		 * if scanning in reverse, we start at the last scan in the list and
-		 * then proceed back to the first.. in any case we inform ExecAppend
-		 * that we are at the end of the line by returning FALSE
-		 */
-		appendstate->as_whichplan = 0;
-		return FALSE;
-	}
-	else if (whichplan >= appendstate->as_nplans)
-	{
-		/*
-		 * as above, end the scan if we go beyond the last scan in our list..
-		 */
-		appendstate->as_whichplan = appendstate->as_nplans - 1;
-		return FALSE;
-	}
-	else
-	{
-		return TRUE;
-	}
-}
 
 /* ----------------------------------------------------------------
  *		ExecInitAppend
@@ -123,8 +133,12 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 {
 	AppendState *appendstate = makeNode(AppendState);
 	PlanState **appendplanstates;
+	PartitionPruneState *prunestate = NULL;
+	int		   *planmap = NULL;
+	bool		nomatch = false;
 	int			nplans;
-	int			i;
+	int			i,
+				j;
 	ListCell   *lc;
 
 	/* check for unsupported flags */
@@ -136,28 +150,98 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	 */
 	ExecLockNonLeafAppendTables(node->partitioned_rels, estate);
 
-	/*
-	 * Set up empty vector of subplan states
-	 */
-	nplans = list_length(node->appendplans);
-
-	appendplanstates = (PlanState **) palloc0(nplans * sizeof(PlanState *));
-
 	/*
 	 * create new AppendState for our append node
 	 */
 	appendstate->ps.plan = (Plan *) node;
 	appendstate->ps.state = estate;
 	appendstate->ps.ExecProcNode = ExecAppend;
-	appendstate->appendplans = appendplanstates;
-	appendstate->as_nplans = nplans;
+
+	/* Let choose_next_subplan_* function handle setting the first subplan */
+	appendstate->as_whichplan = INVALID_SUBPLAN_INDEX;
+
+	/* If parallel-aware, this will be overridden later. */
+	appendstate->choose_next_subplan = choose_next_subplan_locally;
+
+	nplans = list_length(node->appendplans);
+	appendstate->as_first_partial_plan = node->first_partial_plan;
 
 	/*
-	 * Miscellaneous initialization
+	 * If we're to prune partitions at run time, find out which subplans
+	 * survive the values known at startup.  planmap[i] is set to the new
+	 * index of the i'th subplan in the plan's list, or -1 if it's pruned.
 	 *
-	 * Append plans don't have expression contexts because they never call
-	 * ExecQual or ExecProject.
+	 * Append plans otherwise don't have expression contexts because they
+	 * never call ExecQual or ExecProject, but we need one to evaluate the
+	 * pruning steps.
+	 */
+	if (node->part_prune_info != NULL)
+	{
+		Bitmapset  *partitions;
+		int			nvalid = 0;
+
+		ExecAssignExprContext(estate, &appendstate->ps);
+		prunestate = exec_append_setup_pruning(appendstate,
+											   node->part_prune_info);
+		appendstate->as_prune_state = prunestate;
+
+		partitions = exec_append_prune_steps(appendstate,
+											 prunestate->n_init_steps,
+											 prunestate->init_strategies,
+											 prunestate->init_exprs,
+											 NULL);
+
+		planmap = (int *) palloc(nplans * sizeof(int));
+		for (i = 0; i < nplans; i++)
+			planmap[i] = -1;
+		j = -1;
+		while ((j = bms_next_member(partitions, j)) >= 0)
+		{
+			if (prunestate->subplan_map[j] >= 0)
+				planmap[prunestate->subplan_map[j]] = 0;
+		}
+		for (i = 0; i < nplans; i++)
+		{
+			if (i == node->first_partial_plan)
+				appendstate->as_first_partial_plan = nvalid;
+			if (planmap[i] >= 0)
+				planmap[i] = nvalid++;
+		}
+		if (node->first_partial_plan >= nplans)
+			appendstate->as_first_partial_plan = nvalid;
+
+		/*
+		 * If no subplan survives, we still initialize the first one, since
+		 * EXPLAIN needs a subplan to print the targetlist of the Append, but
+		 * we never scan it.
+		 */
+		if (nvalid == 0)
+		{
+			planmap[0] = 0;
+			nvalid = 1;
+			nomatch = true;
+		}
+
+		/* Renumber the subplans in the partition map */
+		for (j = 0; j < prunestate->nparts; j++)
+		{
+			if (prunestate->subplan_map[j] >= 0)
+				prunestate->subplan_map[j] =
+					planmap[prunestate->subplan_map[j]];
+		}
+
+		nplans = nvalid;
+		appendstate->as_first_partial_plan =
+			Min(appendstate->as_first_partial_plan, nplans);
+	}
+
+	/*
+	 * Set up empty vector of subplan states
 	 */
+	appendplanstates = (PlanState **) palloc0(nplans * sizeof(PlanState *));
+
+	appendstate->appendplans = appendplanstates;
+	appendstate->as_nplans = nplans;
 
 	/*
 	 * append nodes still have Result slots, which hold pointers to tuples, so
@@ -170,13 +254,16 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	 * results into the array "appendplans".
 	 */
 	i = 0;
+	j = 0;
 	foreach(lc, node->appendplans)
 	{
 		Plan	   *initNode = (Plan *) lfirst(lc);
 
-		appendplanstates[i] = ExecInitNode(initNode, estate, eflags);
+		if (planmap == NULL || planmap[i] >= 0)
+			appendplanstates[j++] = ExecInitNode(initNode, estate, eflags);
 		i++;
 	}
+	Assert(j == nplans);
 
 	/*
 	 * initialize output tuple type
@@ -185,14 +272,189 @@ ExecInitAppend(Append *node, EState *estate, int eflags)
 	appendstate->ps.ps_ProjInfo = NULL;
 
 	/*
-	 * initialize to scan first subplan
+	 * Set up the list of subplans to scan.  If some steps depend on
+	 * PARAM_EXEC Params, we can't evaluate them until the first scan.
 	 */
-	appendstate->as_whichplan = 0;
-	exec_append_initialize_next(appendstate);
+	appendstate->as_valid_subplans = (int *) palloc(nplans * sizeof(int));
+	if (nomatch)
+		appendstate->as_nvalid = 0;
+	else if (prunestate != NULL && prunestate->n_exec_steps > 0)
+		appendstate->as_nvalid = -1;
+	else
+	{
+		for (i = 0; i < nplans; i++)
+			appendstate->as_valid_subplans[i] = i;
+		appendstate->as_nvalid = nplans;
+	}
+	exec_append_set_first_partial(appendstate);
 
 	return appendstate;
 }
 
+/*
+ * exec_append_set_first_partial
+ *		Find the first entry of as_valid_subplans that is a partial plan.
+ */
+static void
+exec_append_set_first_partial(AppendState *appendstate)
+{
+	int			i;
+
+	for (i = 0; i < appendstate->as_nvalid; i++)
+	{
+		if (appendstate->as_valid_subplans[i] >=
+			appendstate->as_first_partial_plan)
+			break;
+	}
+	appendstate->as_first_partial = i;
+}
+
+/*
+ * exec_append_setup_pruning
+ *		Build the run-time state for the partition pruning steps.
+ */
+static PartitionPruneState *
+exec_append_setup_pruning(AppendState *appendstate, PartitionPruneInfo *pinfo)
+{
+	PartitionPruneState *prunestate;
+	PartitionDesc partdesc;
+	ListCell   *lc1,
+			   *lc2;
+	int			i;
+
+	prunestate = (PartitionPruneState *) palloc(sizeof(PartitionPruneState));
+
+	/* The table was locked by ExecLockNonLeafAppendTables */
+	prunestate->partrel = heap_open(pinfo->reloid, NoLock);
+	partdesc = RelationGetPartitionDesc(prunestate->partrel);
+
+	/* Plan invalidation should prevent this */
+	if (partdesc->nparts != pinfo->nparts)
+		elog(ERROR, "partitions of relation \"%s\" changed since planning",
+			 RelationGetRelationName(prunestate->partrel));
+
+	prunestate->n_init_steps = list_length(pinfo->init_exprs);
+	prunestate->init_strategies = (StrategyNumber *)
+		palloc(prunestate->n_init_steps * sizeof(StrategyNumber));
+	prunestate->init_exprs = (ExprState **)
+		palloc(prunestate->n_init_steps * sizeof(ExprState *));
+	i = 0;
+	forboth(lc1, pinfo->init_strategies, lc2, pinfo->init_exprs)
+	{
+		prunestate->init_strategies[i] = (StrategyNumber) lfirst_int(lc1);
+		prunestate->init_exprs[i] = ExecInitExpr((Expr *) lfirst(lc2),
+												 &appendstate->ps);
+		i++;
+	}
+
+	prunestate->n_exec_steps = list_length(pinfo->exec_exprs);
+	prunestate->exec_strategies = (StrategyNumber *)
+		palloc(prunestate->n_exec_steps * sizeof(StrategyNumber));
+	prunestate->exec_exprs = (ExprState **)
+		palloc(prunestate->n_exec_steps * sizeof(ExprState *));
+	i = 0;
+	forboth(lc1, pinfo->exec_strategies, lc2, pinfo->exec_exprs)
+	{
+		prunestate->exec_strategies[i] = (StrategyNumber) lfirst_int(lc1);
+		prunestate->exec_exprs[i] = ExecInitExpr((Expr *) lfirst(lc2),
+												 &appendstate->ps);
+		i++;
+	}
+
+	prunestate->execparamids = pinfo->execparamids;
+	prunestate->nparts = pinfo->nparts;
+	prunestate->subplan_map = (int *) palloc(pinfo->nparts * sizeof(int));
+	memcpy(prunestate->subplan_map, pinfo->subplan_map,
+		   pinfo->nparts * sizeof(int));
+
+	return prunestate;
+}
+
+/*
+ * exec_append_prune_steps
+ *		Evaluate the given pruning steps, and return the set of partitions
+ *		(as indexes in the partition descriptor) that satisfy all of them.
+ *
+ * If 'partitions' isn't NULL, the result is limited to its members.
+ * Otherwise we start out with all the partitions.  The result is allocated
+ * in the current memory context.
+ */
+static Bitmapset *
+exec_append_prune_steps(AppendState *appendstate, int nsteps,
+						StrategyNumber *strategies, ExprState **exprs,
+						Bitmapset *partitions)
+{
+	PartitionPruneState *prunestate = appendstate->as_prune_state;
+	ExprContext *econtext = appendstate->ps.ps_ExprContext;
+	PartitionKey key = RelationGetPartitionKey(prunestate->partrel);
+	PartitionDesc partdesc = RelationGetPartitionDesc(prunestate->partrel);
+	Bitmapset  *result;
+	int			i;
+
+	if (partitions != NULL)
+		result = bms_copy(partitions);
+	else
+		result = bms_add_range(NULL, 0, partdesc->nparts - 1);
+
+	for (i = 0; i < nsteps && !bms_is_empty(result); i++)
+	{
+		Datum		value;
+		bool		isnull;
+		Bitmapset  *matches;
+		MemoryContext oldcontext;
+
+		/* Evaluate the comparison value in short-lived memory */
+		ResetExprContext(econtext);
+		oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+		value = ExecEvalExpr(exprs[i], econtext, &isnull);
+		MemoryContextSwitchTo(oldcontext);
+
+		matches = get_partitions_for_key_value(key, partdesc, strategies[i],
+											   value, isnull);
+		result = bms_int_members(result, matches);
+		bms_free(matches);
+	}
+
+	return result;
+}
+
+/*
+ * exec_append_find_valid_subplans
+ *		Evaluate the pruning steps that depend on PARAM_EXEC Params, and set
+ *		up the list of subplans to scan accordingly.
+ */
+static void
+exec_append_find_valid_subplans(AppendState *appendstate)
+{
+	PartitionPruneState *prunestate = appendstate->as_prune_state;
+	Bitmapset  *partitions;
+	Bitmapset  *subplans = NULL;
+	int			nvalid = 0;
+	int			i;
+
+	partitions = exec_append_prune_steps(appendstate,
+										 prunestate->n_exec_steps,
+										 prunestate->exec_strategies,
+										 prunestate->exec_exprs,
+										 NULL);
+
+	i = -1;
+	while ((i = bms_next_member(partitions, i)) >= 0)
+	{
+		if (prunestate->subplan_map[i] >= 0)
+			subplans = bms_add_member(subplans, prunestate->subplan_map[i]);
+	}
+
+	i = -1;
+	while ((i = bms_next_member(subplans, i)) >= 0)
+		appendstate->as_valid_subplans[nvalid++] = i;
+	appendstate->as_nvalid = nvalid;
+	exec_append_set_first_partial(appendstate);
+
+	bms_free(partitions);
+	bms_free(subplans);
+}
+
 /* ----------------------------------------------------------------
  *	   ExecAppend
  *
@@ -204,6 +466,20 @@ ExecAppend(PlanState *pstate)
 {
 	AppendState *node = castNode(AppendState, pstate);
 
+	if (node->as_whichplan < 0)
+	{
+		/* If the subplans to scan depend on Params, find them now */
+		if (node->as_nvalid < 0)
+			exec_append_find_valid_subplans(node);
+
+		/*
+		 * Nothing to do if all the subplans were pruned, or if a parallel
+		 * Append has no subplans left for us.
+		 */
+		if (node->as_nvalid == 0 || !node->choose_next_subplan(node))
+			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
+	}
+
 	for (;;)
 	{
 		PlanState  *subnode;
@@ -214,7 +490,7 @@ ExecAppend(PlanState *pstate)
 		/*
 		 * figure out which subplan we are currently processing
 		 */
-		subnode = node->appendplans[node->as_whichplan];
+		subnode = node->appendplans[node->as_valid_subplans[node->as_whichplan]];
 
 		/*
 		 * get a tuple from the subplan
@@ -232,15 +508,10 @@ ExecAppend(PlanState *pstate)
 		}
 
 		/*
-		 * Go on to the "next" subplan in the appropriate direction. If no
-		 * more subplans, return the empty slot set up for us by
-		 * ExecInitAppend.
+		 * Go on to the "next" subplan. If no more subplans, return the empty
+		 * slot set up for us by ExecInitAppend.
 		 */
-		if (ScanDirectionIsForward(node->ps.state->es_direction))
-			node->as_whichplan++;
-		else
-			node->as_whichplan--;
-		if (!exec_append_initialize_next(node))
+		if (!node->choose_next_subplan(node))
 			return ExecClearTuple(node->ps.ps_ResultTupleSlot);
 
 		/* Else loop back and try to get a tuple from the new subplan */
@@ -273,6 +544,12 @@ ExecEndAppend(AppendState *node)
 	 */
 	for (i = 0; i < nplans; i++)
 		ExecEndNode(appendplans[i]);
+
+	/*
+	 * release the partitioned table used for pruning
+	 */
+	if (node->as_prune_state != NULL)
+		heap_close(node->as_prune_state->partrel, NoLock);
 }
 
 void
@@ -280,6 +557,15 @@ ExecReScanAppend(AppendState *node)
 {
 	int			i;
 
+	/*
+	 * If the Params the pruning steps depend on changed, the set of
+	 * subplans to scan must be recomputed.
+	 */
+	if (node->as_prune_state != NULL &&
+		node->as_prune_state->n_exec_steps > 0 &&
+		bms_overlap(node->ps.chgParam, node->as_prune_state->execparamids))
+		node->as_nvalid = -1;
+
 	for (i = 0; i < node->as_nplans; i++)
 	{
 		PlanState  *subnode = node->appendplans[i];
@@ -298,6 +584,251 @@ ExecReScanAppend(AppendState *node)
 		if (subnode->chgParam == NULL)
 			ExecReScan(subnode);
 	}
-	node->as_whichplan = 0;
-	exec_append_initialize_next(node);
+
+	/*
+	 * All the subplans have to be available to the participants of the next
+	 * scan again.  This is called in the leader while no workers are
+	 * running, so no locking is needed.
+	 */
+	if (node->as_pstate != NULL)
+	{
+		node->as_pstate->pa_next_plan = 0;
+		memset(node->as_pstate->pa_finished, 0,
+			   sizeof(bool) * node->as_nplans);
+	}
+
+	/* Let choose_next_subplan_* function handle setting the first subplan */
+	node->as_whichplan = INVALID_SUBPLAN_INDEX;
+}
+
+/* ----------------------------------------------------------------
+ *						Parallel Append Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecAppendEstimate
+ *
+ *		Compute the amount of space we'll need in the parallel
+ *		query DSM, and inform pcxt->estimator about our needs.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAppendEstimate(AppendState *node,
+				   ParallelContext *pcxt)
+{
+	node->pstate_len =
+		add_size(offsetof(ParallelAppendState, pa_finished),
+				 sizeof(bool) * node->as_nplans);
+
+	shm_toc_estimate_chunk(&pcxt->estimator, node->pstate_len);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAppendInitializeDSM
+ *
+ *		Set up shared state for Parallel Append.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAppendInitializeDSM(AppendState *node,
+						ParallelContext *pcxt)
+{
+	ParallelAppendState *pstate;
+
+	pstate = shm_toc_allocate(pcxt->toc, node->pstate_len);
+	memset(pstate, 0, node->pstate_len);
+	LWLockInitialize(&pstate->pa_lock, LWTRANCHE_PARALLEL_APPEND);
+	shm_toc_insert(pcxt->toc, node->ps.plan->plan_node_id, pstate);
+
+	node->as_pstate = pstate;
+	node->choose_next_subplan = choose_next_subplan_for_leader;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecAppendInitializeWorker
+ *
+ *		Copy relevant information from TOC into planstate, and initialize
+ *		whatever is required to choose and execute the optimal subplan.
+ * ----------------------------------------------------------------
+ */
+void
+ExecAppendInitializeWorker(AppendState *node, shm_toc *toc)
+{
+	node->as_pstate = shm_toc_lookup(toc, node->ps.plan->plan_node_id, false);
+	node->choose_next_subplan = choose_next_subplan_for_worker;
+}
+
+/* ----------------------------------------------------------------
+ *		choose_next_subplan_locally
+ *
+ *		Choose next subplan for a non-parallel-aware Append,
+ *		returning false if there are no more.
+ * ----------------------------------------------------------------
+ */
+static bool
+choose_next_subplan_locally(AppendState *node)
+{
+	int			whichplan = node->as_whichplan;
+
+	/* We start at the first subplan, whatever the direction */
+	if (whichplan == INVALID_SUBPLAN_INDEX)
+	{
+		node->as_whichplan = 0;
+		return true;
+	}
+
+	if (ScanDirectionIsForward(node->ps.state->es_direction))
+		whichplan++;
+	else
+		whichplan--;
+
+	/*
+	 * If we go beyond either end of the list, stay at that end, so that we
+	 * can continue from there if the direction changes.
+	 */
+	if (whichplan < 0)
+	{
+		node->as_whichplan = 0;
+		return false;
+	}
+	if (whichplan >= node->as_nvalid)
+	{
+		node->as_whichplan = node->as_nvalid - 1;
+		return false;
+	}
+
+	node->as_whichplan = whichplan;
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		choose_next_subplan_for_leader
+ *
+ *      Try to pick a plan which doesn't commit us to doing much
+ *      work locally, so that as much work as possible is done in
+ *      the workers.  Cheapest subplans are at the end.
+ * ----------------------------------------------------------------
+ */
+static bool
+choose_next_subplan_for_leader(AppendState *node)
+{
+	ParallelAppendState *pstate = node->as_pstate;
+
+	/* Backward scan is not supported by parallel-aware plans */
+	Assert(ScanDirectionIsForward(node->ps.state->es_direction));
+
+	LWLockAcquire(&pstate->pa_lock, LW_EXCLUSIVE);
+
+	if (node->as_whichplan != INVALID_SUBPLAN_INDEX)
+	{
+		/* Mark just-completed subplan as finished. */
+		pstate->pa_finished[node->as_whichplan] = true;
+	}
+	else
+	{
+		/* Start with last subplan. */
+		node->as_whichplan = node->as_nvalid - 1;
+	}
+
+	/* Loop until we find a subplan to execute. */
+	while (pstate->pa_finished[node->as_whichplan])
+	{
+		if (node->as_whichplan == 0)
+		{
+			/* Everything after our starting point is done, too. */
+			pstate->pa_next_plan = INVALID_SUBPLAN_INDEX;
+			node->as_whichplan = INVALID_SUBPLAN_INDEX;
+			LWLockRelease(&pstate->pa_lock);
+			return false;
+		}
+		node->as_whichplan--;
+	}
+
+	/* If non-partial, immediately mark as finished. */
+	if (node->as_whichplan < node->as_first_partial)
+		pstate->pa_finished[node->as_whichplan] = true;
+
+	LWLockRelease(&pstate->pa_lock);
+
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		choose_next_subplan_for_worker
+ *
+ *		Choose next subplan for a parallel-aware Append, returning
+ *		false if there are no more.
+ *
+ *		We start from the first plan and advance through the list;
+ *		when we get back to the end, we loop back to the first
+ *		partial plan.  This assigns the non-partial plans first in
+ *		order of descending cost and then spreads out the workers
+ *		as evenly as possible across the remaining partial plans.
+ * ----------------------------------------------------------------
+ */
+static bool
+choose_next_subplan_for_worker(AppendState *node)
+{
+	ParallelAppendState *pstate = node->as_pstate;
+	int			nvalid = node->as_nvalid;
+	int			wrapto;
+	int			ntried;
+
+	/* Backward scan is not supported by parallel-aware plans */
+	Assert(ScanDirectionIsForward(node->ps.state->es_direction));
+
+	/* After the last plan, go back to the first partial plan, if any. */
+	wrapto = node->as_first_partial < nvalid ? node->as_first_partial : 0;
+
+	LWLockAcquire(&pstate->pa_lock, LW_EXCLUSIVE);
+
+	/* Mark just-completed subplan as finished. */
+	if (node->as_whichplan != INVALID_SUBPLAN_INDEX)
+		pstate->pa_finished[node->as_whichplan] = true;
+
+	/* If all the plans are already done, we have nothing to do */
+	if (pstate->pa_next_plan == INVALID_SUBPLAN_INDEX)
+	{
+		node->as_whichplan = INVALID_SUBPLAN_INDEX;
+		LWLockRelease(&pstate->pa_lock);
+		return false;
+	}
+
+	/*
+	 * Loop until we find a subplan to execute.  The non-partial plans before
+	 * pa_next_plan have all been picked already, so once we've looked at
+	 * every position we're done.
+	 */
+	ntried = 0;
+	while (pstate->pa_finished[pstate->pa_next_plan])
+	{
+		if (++ntried >= nvalid)
+		{
+			pstate->pa_next_plan = INVALID_SUBPLAN_INDEX;
+			node->as_whichplan = INVALID_SUBPLAN_INDEX;
+			LWLockRelease(&pstate->pa_lock);
+			return false;
+		}
+		if (pstate->pa_next_plan < nvalid - 1)
+			pstate->pa_next_plan++;
+		else
+			pstate->pa_next_plan = wrapto;
+	}
+
+	/* Pick the plan we found, and advance pa_next_plan one more time. */
+	node->as_whichplan = pstate->pa_next_plan;
+	if (pstate->pa_next_plan < nvalid - 1)
+		pstate->pa_next_plan++;
+	else
+		pstate->pa_next_plan = wrapto;
+
+	/* If non-partial, immediately mark as finished. */
+	if (node->as_whichplan < node->as_first_partial)
+		pstate->pa_finished[node->as_whichplan] = true;
+
+	LWLockRelease(&pstate->pa_lock);
+
+	return true;
 }
@@ -196,6 +196,7 @@ ExecGatherMerge(PlanState *pstate)
 			pcxt = node->pei->pcxt;
 			LaunchParallelWorkers(pcxt);
 			node->nworkers_launched = pcxt->nworkers_launched;
+			ExecParallelWorkersLaunched(node->pei);
 
 			/* Set up tuple queue readers to read the results. */
 			if (pcxt->nworkers_launched > 0)
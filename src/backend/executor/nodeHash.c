@@ -17,6 +17,12 @@
  *		MultiExecHash	- generate an in-memory hash table of the relation
  *		ExecInitHash	- initialize node and subnodes
  *		ExecEndHash		- shutdown node and subnodes
+ *
+ * NOTES
+ *		If the parent HashJoin is parallel-aware, it gives us a shared
+ *		ParallelHashJoinState, and all participants then build a single hash
+ *		table in the query's DSA area instead of each building its own.  See
+ *		the notes in executor/hashjoin.h.
  */
 
 #include "postgres.h"
@@ -32,6 +38,8 @@
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/spin.h"
 #include "utils/dynahash.h"
 #include "utils/memutils.h"
 #include "utils/lsyscache.h"
@@ -50,6 +58,24 @@ static void ExecHashRemoveNextSkewBucket(HashJoinTable hashtable);
 
 static void *dense_alloc(HashJoinTable hashtable, Size size);
 
+static void MultiExecPrivateHash(HashState *node);
+static void MultiExecParallelHash(HashState *node);
+static void ExecParallelHashWaitForPhase(ParallelHashJoinState *pstate,
+							 SharedHashJoinPhase phase);
+static void ExecParallelHashAllocate(HashJoinTable hashtable);
+static void ExecParallelHashAttach(HashJoinTable hashtable);
+static void ExecParallelHashTableInsert(HashJoinTable hashtable,
+							TupleTableSlot *slot,
+							uint32 hashvalue);
+static void ExecParallelHashIncreaseNumBuckets(HashJoinTable hashtable);
+static HashJoinTuple ExecParallelHashTupleAlloc(HashJoinTable hashtable,
+						   Size size,
+						   dsa_pointer *shared);
+static inline HashJoinTuple ExecParallelHashFirstTuple(HashJoinTable hashtable,
+						   int bucketno);
+static inline HashJoinTuple ExecParallelHashNextTuple(HashJoinTable hashtable,
+						  HashJoinTuple tuple);
+
 /* ----------------------------------------------------------------
  *		ExecHash
  *
@@ -72,6 +98,38 @@ ExecHash(PlanState *pstate)
  */
 Node *
 MultiExecHash(HashState *node)
+{
+	/* must provide our own instrumentation support */
+	if (node->ps.instrument)
+		InstrStartNode(node->ps.instrument);
+
+	if (node->parallel_state != NULL)
+		MultiExecParallelHash(node);
+	else
+		MultiExecPrivateHash(node);
+
+	/* must provide our own instrumentation support */
+	if (node->ps.instrument)
+		InstrStopNode(node->ps.instrument, node->hashtable->partialTuples);
+
+	/*
+	 * We do not return the hash table directly because it's not a subtype of
+	 * Node, and so would violate the MultiExecProcNode API.  Instead, our
+	 * parent Hashjoin node is expected to know how to fish it out of our node
+	 * state.  Ugly but not really worth cleaning up, since Hashjoin knows
+	 * quite a bit more about Hash besides that.
+	 */
+	return NULL;
+}
+
+/* ----------------------------------------------------------------
+ *		MultiExecPrivateHash
+ *
+ *		build a hash table of our own, for a non-parallel-aware hashjoin.
+ * ----------------------------------------------------------------
+ */
+static void
+MultiExecPrivateHash(HashState *node)
 {
 	PlanState  *outerNode;
 	List	   *hashkeys;
@@ -80,10 +138,6 @@ MultiExecHash(HashState *node)
 	ExprContext *econtext;
 	uint32		hashvalue;
 
-	/* must provide our own instrumentation support */
-	if (node->ps.instrument)
-		InstrStartNode(node->ps.instrument);
-
 	/*
 	 * get state info from node
 	 */
@@ -138,18 +192,116 @@ MultiExecHash(HashState *node)
 	if (hashtable->spaceUsed > hashtable->spacePeak)
 		hashtable->spacePeak = hashtable->spaceUsed;
 
-	/* must provide our own instrumentation support */
-	if (node->ps.instrument)
-		InstrStopNode(node->ps.instrument, hashtable->totalTuples);
+	hashtable->partialTuples = hashtable->totalTuples;
+}
+
+/* ----------------------------------------------------------------
+ *		MultiExecParallelHash
+ *
+ *		build a hash table shared with the other participants of a
+ *		parallel-aware hashjoin.  Each participant inserts the tuples it
+ *		gets from its share of the partial inner plan, and then waits until
+ *		all others have finished inserting theirs.
+ *
+ *		A participant that arrives after all the builders have finished has
+ *		nothing to contribute, since the inner plan has then been run to
+ *		completion by the others, so it merely waits for the table to be
+ *		marked done.
+ * ----------------------------------------------------------------
+ */
+static void
+MultiExecParallelHash(HashState *node)
+{
+	ParallelHashJoinState *pstate = node->parallel_state;
+	HashJoinTable hashtable = node->hashtable;
+	PlanState  *outerNode = outerPlanState(node);
+	List	   *hashkeys = node->hashkeys;
+	ExprContext *econtext = node->ps.ps_ExprContext;
+	SharedHashJoinPhase phase;
 
 	/*
-	 * We do not return the hash table directly because it's not a subtype of
-	 * Node, and so would violate the MultiExecProcNode API.  Instead, our
-	 * parent Hashjoin node is expected to know how to fish it out of our node
-	 * state.  Ugly but not really worth cleaning up, since Hashjoin knows
-	 * quite a bit more about Hash besides that.
+	 * Register as a builder, unless it's already too late to be one.  The
+	 * first participant to get here is responsible for allocating the bucket
+	 * array; anyone else arriving while that's in progress must wait for it.
 	 */
-	return NULL;
+	SpinLockAcquire(&pstate->mutex);
+	phase = pstate->phase;
+	if (phase < PHJ_PHASE_RESIZING)
+	{
+		pstate->nbuilders++;
+		if (phase == PHJ_PHASE_INIT)
+			pstate->phase = PHJ_PHASE_ALLOCATING;
+	}
+	SpinLockRelease(&pstate->mutex);
+
+	if (phase == PHJ_PHASE_INIT)
+		ExecParallelHashAllocate(hashtable);
+	else if (phase == PHJ_PHASE_ALLOCATING)
+		ExecParallelHashWaitForPhase(pstate, PHJ_PHASE_BUILDING);
+
+	if (phase < PHJ_PHASE_RESIZING)
+	{
+		TupleTableSlot *slot;
+		uint32		hashvalue;
+		bool		last;
+
+		ExecParallelHashAttach(hashtable);
+
+		/*
+		 * get all of our inner tuples and insert them into the shared hash
+		 * table
+		 */
+		for (;;)
+		{
+			slot = ExecProcNode(outerNode);
+			if (TupIsNull(slot))
+				break;
+			econtext->ecxt_innertuple = slot;
+			if (ExecHashGetHashValue(hashtable, econtext, hashkeys,
+									 false, hashtable->keepNulls,
+									 &hashvalue))
+			{
+				ExecParallelHashTableInsert(hashtable, slot, hashvalue);
+				hashtable->partialTuples += 1;
+			}
+		}
+
+		/*
+		 * Deregister.  If we were the last builder, nobody else can insert
+		 * any more tuples, so it's our job to resize the bucket array if the
+		 * estimate was too low, and then release the waiters.
+		 */
+		SpinLockAcquire(&pstate->mutex);
+		pstate->totalTuples += hashtable->partialTuples;
+		last = (--pstate->nbuilders == 0);
+		if (last)
+			pstate->phase = PHJ_PHASE_RESIZING;
+		SpinLockRelease(&pstate->mutex);
+
+		if (last)
+		{
+			ExecParallelHashIncreaseNumBuckets(hashtable);
+
+			SpinLockAcquire(&pstate->mutex);
+			pstate->phase = PHJ_PHASE_DONE;
+			SpinLockRelease(&pstate->mutex);
+			ConditionVariableBroadcast(&pstate->cv);
+		}
+	}
+
+	ExecParallelHashWaitForPhase(pstate, PHJ_PHASE_DONE);
+
+	/*
+	 * The bucket array may have been replaced while resizing, so pick up the
+	 * final shape of the table, along with the statistics we report.
+	 */
+	ExecParallelHashAttach(hashtable);
+	SpinLockAcquire(&pstate->mutex);
+	hashtable->totalTuples = pstate->totalTuples;
+	hashtable->spaceUsed = pstate->spaceUsed;
+	hashtable->spaceAllowed = pstate->spaceAllowed;
+	SpinLockRelease(&pstate->mutex);
+	hashtable->spacePeak = hashtable->spaceUsed;
 }
 
 /* ----------------------------------------------------------------
@@ -240,10 +392,13 @@ ExecEndHash(HashState *node)
  * ----------------------------------------------------------------
  */
 HashJoinTable
-ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
+ExecHashTableCreate(HashState *state, List *hashOperators, bool keepNulls)
 {
+	Hash	   *node = (Hash *) state->ps.plan;
+	ParallelHashJoinState *pstate = state->parallel_state;
 	HashJoinTable hashtable;
 	Plan	   *outerNode;
+	double		rows;
 	int			nbuckets;
 	int			nbatch;
 	int			num_skew_mcvs;
@@ -257,12 +412,22 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 	 * Get information about the size of the relation to be hashed (it's the
 	 * "outer" subtree of this node, but the inner relation of the hashjoin).
 	 * Compute the appropriate size of the hash table.
+	 *
+	 * If this is a parallel-aware Hash, our input is a partial plan whose
+	 * plan_rows is only one participant's share, so we use the planner's
+	 * estimate for the whole relation instead.  A shared table never uses
+	 * skew buckets and never spills into batches, as explained in
+	 * executor/hashjoin.h.
 	 */
 	outerNode = outerPlan(node);
+	rows = node->plan.parallel_aware ? node->rows_total : outerNode->plan_rows;
 
-	ExecChooseHashTableSize(outerNode->plan_rows, outerNode->plan_width,
-							OidIsValid(node->skewTable),
+	ExecChooseHashTableSize(rows, outerNode->plan_width,
+							OidIsValid(node->skewTable) && pstate == NULL,
+							pstate ? pstate->nparticipants - 1 : 0,
 							&nbuckets, &nbatch, &num_skew_mcvs);
+	if (pstate != NULL)
+		nbatch = 1;
 
 	/* nbuckets must be a power of 2 */
 	log2_nbuckets = my_log2(nbuckets);
@@ -293,6 +458,7 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 	hashtable->nbatch_outstart = nbatch;
 	hashtable->growEnabled = true;
 	hashtable->totalTuples = 0;
+	hashtable->partialTuples = 0;
 	hashtable->skewTuples = 0;
 	hashtable->innerBatchFile = NULL;
 	hashtable->outerBatchFile = NULL;
@@ -303,6 +469,11 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 	hashtable->spaceAllowedSkew =
 		hashtable->spaceAllowed * SKEW_WORK_MEM_PERCENT / 100;
 	hashtable->chunks = NULL;
+	hashtable->parallel_state = pstate;
+	hashtable->area = pstate ? state->ps.state->es_query_dsa : NULL;
+	hashtable->shared_buckets = NULL;
+	hashtable->current_chunk = NULL;
+	hashtable->current_chunk_shared = InvalidDsaPointer;
 
 #ifdef HJDEBUG
 	printf("Hashjoin %p: initial nbatch = %d, nbuckets = %d\n",
@@ -365,6 +536,16 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 		PrepareTempTablespaces();
 	}
 
+	/*
+	 * A shared table's bucket array lives in the DSA area, and is allocated
+	 * by whichever participant starts building it first.
+	 */
+	if (pstate != NULL)
+	{
+		MemoryContextSwitchTo(oldcxt);
+		return hashtable;
+	}
+
 	/*
 	 * Prepare context for the first-scan space allocations; allocate the
 	 * hashbucket array therein, and set each bucket "empty".
@@ -391,6 +572,10 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
  * Compute appropriate size for hashtable given the estimated size of the
  * relation to be hashed (number of rows and average row width).
  *
+ * If parallel_workers is greater than zero, the table is to be shared by that
+ * many workers plus the leader, and may use the combined work_mem of all of
+ * them.
+ *
  * This is exported so that the planner's costsize.c can use it.
  */
 
@@ -399,6 +584,7 @@ ExecHashTableCreate(Hash *node, List *hashOperators, bool keepNulls)
 
 void
 ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
+						int parallel_workers,
 						int *numbuckets,
 						int *numbatches,
 						int *num_skew_mcvs)
@@ -429,9 +615,18 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	inner_rel_bytes = ntuples * tupsize;
 
 	/*
-	 * Target in-memory hashtable size is work_mem kilobytes.
+	 * Target in-memory hashtable size is work_mem kilobytes, or that much
+	 * per participant for a shared table.
 	 */
 	hash_table_bytes = work_mem * 1024L;
+	if (parallel_workers > 0)
+	{
+		double		shared_bytes;
+
+		shared_bytes = (double) hash_table_bytes * (parallel_workers + 1);
+		shared_bytes = Min(shared_bytes, (double) (LONG_MAX / 2));
+		hash_table_bytes = (long) shared_bytes;
+	}
 
 	/*
 	 * If skew optimization is possible, estimate the number of skew buckets
@@ -479,6 +674,8 @@ ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
 	 * ExecHashGetBucketAndBatch fast.
 	 */
 	max_pointers = (work_mem * 1024L) / sizeof(HashJoinTuple);
+	if (parallel_workers > 0)
+		max_pointers = Min(max_pointers * (parallel_workers + 1), LONG_MAX / 2);
 	max_pointers = Min(max_pointers, MaxAllocSize / sizeof(HashJoinTuple));
 	/* If max_pointers isn't a power of 2, must round it down to one */
 	mppow2 = 1L << my_log2(max_pointers);
@@ -673,7 +870,7 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 	/* so, let's scan through the old chunks, and all tuples in each chunk */
 	while (oldchunks != NULL)
 	{
-		HashMemoryChunk nextchunk = oldchunks->next;
+		HashMemoryChunk nextchunk = oldchunks->next.unshared;
 
 		/* position within the buffer (up to oldchunks->used) */
 		size_t		idx = 0;
@@ -700,7 +897,7 @@ ExecHashIncreaseNumBatches(HashJoinTable hashtable)
 				memcpy(copyTuple, hashTuple, hashTupleSize);
 
 				/* and add it back to the appropriate bucket */
-				copyTuple->next = hashtable->buckets[bucketno];
+				copyTuple->next.unshared = hashtable->buckets[bucketno];
 				hashtable->buckets[bucketno] = copyTuple;
 			}
 			else
@@ -789,7 +986,7 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 	memset(hashtable->buckets, 0, hashtable->nbuckets * sizeof(HashJoinTuple));
 
 	/* scan through all tuples in all chunks to rebuild the hash table */
-	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next)
+	for (chunk = hashtable->chunks; chunk != NULL; chunk = chunk->next.unshared)
 	{
 		/* process all tuples stored in this chunk */
 		size_t		idx = 0;
@@ -804,7 +1001,7 @@ ExecHashIncreaseNumBuckets(HashJoinTable hashtable)
 									  &bucketno, &batchno);
 
 			/* add the tuple to the proper bucket */
-			hashTuple->next = hashtable->buckets[bucketno];
+			hashTuple->next.unshared = hashtable->buckets[bucketno];
 			hashtable->buckets[bucketno] = hashTuple;
 
 			/* advance index past the tuple */
@@ -869,7 +1066,7 @@ ExecHashTableInsert(HashJoinTable hashtable,
 		HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
 
 		/* Push it onto the front of the bucket's list */
-		hashTuple->next = hashtable->buckets[bucketno];
+		hashTuple->next.unshared = hashtable->buckets[bucketno];
 		hashtable->buckets[bucketno] = hashTuple;
 
 		/*
@@ -1073,10 +1270,19 @@ ExecScanHashBucket(HashJoinState *hjstate,
 	 * bucket, or NULL if it's time to start scanning a new bucket.
 	 *
 	 * If the tuple hashed to a skew bucket then scan the skew bucket
-	 * otherwise scan the standard hashtable bucket.
+	 * otherwise scan the standard hashtable bucket.  A shared table has no
+	 * skew buckets.
 	 */
-	if (hashTuple != NULL)
-		hashTuple = hashTuple->next;
+	if (hashtable->parallel_state != NULL)
+	{
+		if (hashTuple != NULL)
+			hashTuple = ExecParallelHashNextTuple(hashtable, hashTuple);
+		else
+			hashTuple = ExecParallelHashFirstTuple(hashtable,
+												   hjstate->hj_CurBucketNo);
+	}
+	else if (hashTuple != NULL)
+		hashTuple = hashTuple->next.unshared;
 	else if (hjstate->hj_CurSkewBucketNo != INVALID_SKEW_BUCKET_NO)
 		hashTuple = hashtable->skewBucket[hjstate->hj_CurSkewBucketNo]->tuples;
 	else
@@ -1104,7 +1310,10 @@ ExecScanHashBucket(HashJoinState *hjstate,
 			}
 		}
 
-		hashTuple = hashTuple->next;
+		if (hashtable->parallel_state != NULL)
+			hashTuple = ExecParallelHashNextTuple(hashtable, hashTuple);
+		else
+			hashTuple = hashTuple->next.unshared;
 	}
 
 	/*
@@ -1155,7 +1364,7 @@ ExecScanHashTableForUnmatched(HashJoinState *hjstate, ExprContext *econtext)
 		 * bucket.
 		 */
 		if (hashTuple != NULL)
-			hashTuple = hashTuple->next;
+			hashTuple = hashTuple->next.unshared;
 		else if (hjstate->hj_CurBucketNo < hashtable->nbuckets)
 		{
 			hashTuple = hashtable->buckets[hjstate->hj_CurBucketNo];
@@ -1194,7 +1403,7 @@ ExecScanHashTableForUnmatched(HashJoinState *hjstate, ExprContext *econtext)
 				return true;
 			}
 
-			hashTuple = hashTuple->next;
+			hashTuple = hashTuple->next.unshared;
 		}
 
 		/* allow this loop to be cancellable */
@@ -1250,7 +1459,7 @@ ExecHashTableResetMatchFlags(HashJoinTable hashtable)
 	/* Reset all flags in the main table ... */
 	for (i = 0; i < hashtable->nbuckets; i++)
 	{
-		for (tuple = hashtable->buckets[i]; tuple != NULL; tuple = tuple->next)
+		for (tuple = hashtable->buckets[i]; tuple != NULL; tuple = tuple->next.unshared)
 			HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(tuple));
 	}
 
@@ -1260,7 +1469,7 @@ ExecHashTableResetMatchFlags(HashJoinTable hashtable)
 		int			j = hashtable->skewBucketNums[i];
 		HashSkewBucket *skewBucket = hashtable->skewBucket[j];
 
-		for (tuple = skewBucket->tuples; tuple != NULL; tuple = tuple->next)
+		for (tuple = skewBucket->tuples; tuple != NULL; tuple = tuple->next.unshared)
 			HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(tuple));
 	}
 }
@@ -1505,7 +1714,7 @@ ExecHashSkewTableInsert(HashJoinTable hashtable,
 	HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
 
 	/* Push it onto the front of the skew bucket's list */
-	hashTuple->next = hashtable->skewBucket[bucketNumber]->tuples;
+	hashTuple->next.unshared = hashtable->skewBucket[bucketNumber]->tuples;
 	hashtable->skewBucket[bucketNumber]->tuples = hashTuple;
 
 	/* Account for space used, and back off if we've used too much */
@@ -1554,7 +1763,7 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 	hashTuple = bucket->tuples;
 	while (hashTuple != NULL)
 	{
-		HashJoinTuple nextHashTuple = hashTuple->next;
+		HashJoinTuple nextHashTuple = hashTuple->next.unshared;
 		MinimalTuple tuple;
 		Size		tupleSize;
 
@@ -1580,7 +1789,7 @@ ExecHashRemoveNextSkewBucket(HashJoinTable hashtable)
 			memcpy(copyTuple, hashTuple, tupleSize);
 			pfree(hashTuple);
 
-			copyTuple->next = hashtable->buckets[bucketno];
+			copyTuple->next.unshared = hashtable->buckets[bucketno];
 			hashtable->buckets[bucketno] = copyTuple;
 
 			/* We have reduced skew space, but overall space doesn't change */
@@ -1668,12 +1877,12 @@ dense_alloc(HashJoinTable hashtable, Size size)
 		 */
 		if (hashtable->chunks != NULL)
 		{
-			newChunk->next = hashtable->chunks->next;
-			hashtable->chunks->next = newChunk;
+			newChunk->next.unshared = hashtable->chunks->next.unshared;
+			hashtable->chunks->next.unshared = newChunk;
 		}
 		else
 		{
-			newChunk->next = hashtable->chunks;
+			newChunk->next.unshared = hashtable->chunks;
 			hashtable->chunks = newChunk;
 		}
 
@@ -1698,7 +1907,7 @@ dense_alloc(HashJoinTable hashtable, Size size)
 		newChunk->used = size;
 		newChunk->ntuples = 1;
 
-		newChunk->next = hashtable->chunks;
+		newChunk->next.unshared = hashtable->chunks;
 		hashtable->chunks = newChunk;
 
 		return newChunk->data;
@@ -1712,3 +1921,363 @@ dense_alloc(HashJoinTable hashtable, Size size)
 	/* return pointer to the start of the tuple memory */
 	return ptr;
 }
+
+/*
+ * Wait until the shared hash table has reached the given phase.
+ */
+static void
+ExecParallelHashWaitForPhase(ParallelHashJoinState *pstate,
+							 SharedHashJoinPhase phase)
+{
+	for (;;)
+	{
+		SharedHashJoinPhase current;
+
+		SpinLockAcquire(&pstate->mutex);
+		current = pstate->phase;
+		SpinLockRelease(&pstate->mutex);
+
+		if (current >= phase)
+			break;
+
+		ConditionVariableSleep(&pstate->cv, WAIT_EVENT_HASH_BUILD);
+	}
+	ConditionVariableCancelSleep();
+}
+
+/*
+ * Allocate the shared bucket array, using the size this participant chose in
+ * ExecHashTableCreate, and let everyone start inserting.  Only the first
+ * participant to arrive does this.
+ */
+static void
+ExecParallelHashAllocate(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	dsa_pointer_atomic *buckets;
+	dsa_pointer dp;
+	int			i;
+
+	dp = dsa_allocate(hashtable->area,
+					  hashtable->nbuckets * sizeof(dsa_pointer_atomic));
+	buckets = (dsa_pointer_atomic *) dsa_get_address(hashtable->area, dp);
+	for (i = 0; i < hashtable->nbuckets; ++i)
+		dsa_pointer_atomic_init(&buckets[i], InvalidDsaPointer);
+
+	SpinLockAcquire(&pstate->mutex);
+	Assert(pstate->phase == PHJ_PHASE_ALLOCATING);
+	pstate->nbuckets = hashtable->nbuckets;
+	pstate->log2_nbuckets = hashtable->log2_nbuckets;
+	pstate->buckets = dp;
+	pstate->spaceUsed = hashtable->nbuckets * sizeof(dsa_pointer_atomic);
+	pstate->phase = PHJ_PHASE_BUILDING;
+	SpinLockRelease(&pstate->mutex);
+
+	ConditionVariableBroadcast(&pstate->cv);
+}
+
+/*
+ * Adopt the current shape of the shared hash table.
+ */
+static void
+ExecParallelHashAttach(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	dsa_pointer buckets;
+
+	SpinLockAcquire(&pstate->mutex);
+	hashtable->nbuckets = pstate->nbuckets;
+	hashtable->log2_nbuckets = pstate->log2_nbuckets;
+	buckets = pstate->buckets;
+	SpinLockRelease(&pstate->mutex);
+
+	hashtable->nbuckets_optimal = hashtable->nbuckets;
+	hashtable->log2_nbuckets_optimal = hashtable->log2_nbuckets;
+	hashtable->shared_buckets = (dsa_pointer_atomic *)
+		dsa_get_address(hashtable->area, buckets);
+}
+
+/*
+ * Allocate space for a tuple in the shared hash table.
+ *
+ * Each participant fills a chunk of its own, so that the only contention is
+ * on getting a new chunk, which is linked into the shared list of chunks.
+ * As in dense_alloc, oversized tuples get a chunk to themselves.
+ *
+ * A shared table can't grow the number of batches, so if the planner's
+ * estimate was so badly off that the table would exceed spaceAllowed, all we
+ * can do is give up.  spaceAllowed is only final once the leader has
+ * launched the workers, see ExecHashJoinWorkersLaunched; until then, which
+ * is but a moment, it isn't enforced.
+ */
+static HashJoinTuple
+ExecParallelHashTupleAlloc(HashJoinTable hashtable, Size size,
+						   dsa_pointer *shared)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	HashMemoryChunk chunk = hashtable->current_chunk;
+	dsa_pointer chunk_shared;
+	Size		chunk_size;
+	Size		spaceAllowed;
+	bool		overLimit;
+	HashJoinTuple result;
+
+	size = MAXALIGN(size);
+
+	/* Is there enough space in our current chunk? */
+	if (chunk != NULL && size <= HASH_CHUNK_THRESHOLD &&
+		chunk->maxlen - chunk->used >= size)
+	{
+		*shared = hashtable->current_chunk_shared +
+			offsetof(HashMemoryChunkData, data) + chunk->used;
+		result = (HashJoinTuple) (chunk->data + chunk->used);
+		chunk->used += size;
+		chunk->ntuples += 1;
+		return result;
+	}
+
+	/* No; account for a new chunk, if we may. */
+	chunk_size = (size > HASH_CHUNK_THRESHOLD) ? size : HASH_CHUNK_SIZE;
+
+	SpinLockAcquire(&pstate->mutex);
+	spaceAllowed = pstate->spaceAllowed;
+	overLimit = (pstate->workers_launched &&
+				 pstate->spaceUsed + chunk_size > spaceAllowed);
+	if (!overLimit)
+		pstate->spaceUsed += chunk_size;
+	SpinLockRelease(&pstate->mutex);
+
+	if (overLimit)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("shared hash table exceeds its memory limit of %zu kB",
+						spaceAllowed / 1024),
+				 errdetail("The inner relation of a parallel hash join is much larger than estimated."),
+				 errhint("Increase work_mem, or set enable_parallel_hash to off.")));
+
+	/* Allocate the chunk and link it into the shared list. */
+	chunk_shared = dsa_allocate(hashtable->area,
+								offsetof(HashMemoryChunkData, data) + chunk_size);
+	chunk = (HashMemoryChunk) dsa_get_address(hashtable->area, chunk_shared);
+	chunk->maxlen = chunk_size;
+	chunk->used = size;
+	chunk->ntuples = 1;
+
+	SpinLockAcquire(&pstate->mutex);
+	chunk->next.shared = pstate->chunks;
+	pstate->chunks = chunk_shared;
+	SpinLockRelease(&pstate->mutex);
+
+	/*
+	 * Oversized tuples don't become the current chunk, so that we don't
+	 * waste what's left of the one we're filling.
+	 */
+	if (size <= HASH_CHUNK_THRESHOLD)
+	{
+		hashtable->current_chunk = chunk;
+		hashtable->current_chunk_shared = chunk_shared;
+	}
+
+	*shared = chunk_shared + offsetof(HashMemoryChunkData, data);
+	return (HashJoinTuple) chunk->data;
+}
+
+/*
+ * Insert a tuple into the shared hash table.  Any number of participants may
+ * be doing this at the same time, so the tuple is pushed onto the front of
+ * its bucket's list with compare-and-swap.
+ */
+static void
+ExecParallelHashTableInsert(HashJoinTable hashtable,
+							TupleTableSlot *slot,
+							uint32 hashvalue)
+{
+	MinimalTuple tuple = ExecFetchSlotMinimalTuple(slot);
+	HashJoinTuple hashTuple;
+	dsa_pointer shared;
+	dsa_pointer_atomic *bucket;
+	int			bucketno;
+	int			batchno;
+
+	ExecHashGetBucketAndBatch(hashtable, hashvalue, &bucketno, &batchno);
+	Assert(batchno == 0);
+
+	hashTuple = ExecParallelHashTupleAlloc(hashtable,
+										   HJTUPLE_OVERHEAD + tuple->t_len,
+										   &shared);
+	hashTuple->hashvalue = hashvalue;
+	memcpy(HJTUPLE_MINTUPLE(hashTuple), tuple, tuple->t_len);
+	HeapTupleHeaderClearMatch(HJTUPLE_MINTUPLE(hashTuple));
+
+	bucket = &hashtable->shared_buckets[bucketno];
+	hashTuple->next.shared = dsa_pointer_atomic_read(bucket);
+	while (!dsa_pointer_atomic_compare_exchange(bucket,
+												&hashTuple->next.shared,
+												shared))
+		;
+}
+
+/*
+ * Grow the shared bucket array if more tuples were loaded than the planner
+ * expected.  This is done by the last participant to finish inserting, while
+ * everyone else waits, so no interlocking is needed on the buckets or the
+ * tuples.
+ */
+static void
+ExecParallelHashIncreaseNumBuckets(HashJoinTable hashtable)
+{
+	ParallelHashJoinState *pstate = hashtable->parallel_state;
+	dsa_area   *area = hashtable->area;
+	dsa_pointer_atomic *buckets;
+	dsa_pointer new_buckets;
+	dsa_pointer chunk_shared;
+	double		ntuples;
+	int			nbuckets;
+	int			log2_nbuckets;
+	Size		spaceLeft;
+	int			i;
+
+	SpinLockAcquire(&pstate->mutex);
+	Assert(pstate->phase == PHJ_PHASE_RESIZING);
+	ntuples = pstate->totalTuples;
+	nbuckets = pstate->nbuckets;
+	log2_nbuckets = pstate->log2_nbuckets;
+	chunk_shared = pstate->chunks;
+	if (!pstate->workers_launched)
+		spaceLeft = MaxAllocSize;
+	else if (pstate->spaceUsed < pstate->spaceAllowed)
+		spaceLeft = pstate->spaceAllowed - pstate->spaceUsed;
+	else
+		spaceLeft = 0;
+	SpinLockRelease(&pstate->mutex);
+
+	/*
+	 * Guard against integer overflow and alloc size overflow.  Longer bucket
+	 * chains are better than failing, so we don't grow the bucket array past
+	 * the memory limit either.
+	 */
+	while (ntuples > (double) nbuckets * NTUP_PER_BUCKET &&
+		   nbuckets <= INT_MAX / 2 &&
+		   nbuckets * 2 <= MaxAllocSize / sizeof(dsa_pointer_atomic) &&
+		   (nbuckets * 2 - pstate->nbuckets) * sizeof(dsa_pointer_atomic) <=
+		   spaceLeft)
+	{
+		nbuckets *= 2;
+		log2_nbuckets += 1;
+	}
+
+	if (nbuckets == pstate->nbuckets)
+		return;
+
+#ifdef HJDEBUG
+	printf("Hashjoin %p: increasing shared nbuckets %d => %d\n",
+		   hashtable, pstate->nbuckets, nbuckets);
+#endif
+
+	dsa_free(area, pstate->buckets);
+	new_buckets = dsa_allocate(area, nbuckets * sizeof(dsa_pointer_atomic));
+	buckets = (dsa_pointer_atomic *) dsa_get_address(area, new_buckets);
+	for (i = 0; i < nbuckets; ++i)
+		dsa_pointer_atomic_init(&buckets[i], InvalidDsaPointer);
+
+	/* scan through all tuples in all chunks to rebuild the hash table */
+	while (DsaPointerIsValid(chunk_shared))
+	{
+		HashMemoryChunk chunk;
+		size_t		idx = 0;
+
+		chunk = (HashMemoryChunk) dsa_get_address(area, chunk_shared);
+		while (idx < chunk->used)
+		{
+			HashJoinTuple hashTuple = (HashJoinTuple) (chunk->data + idx);
+			dsa_pointer shared = chunk_shared +
+			offsetof(HashMemoryChunkData, data) + idx;
+			int			bucketno;
+
+			bucketno = hashTuple->hashvalue & (nbuckets - 1);
+			hashTuple->next.shared =
+				dsa_pointer_atomic_read(&buckets[bucketno]);
+			dsa_pointer_atomic_write(&buckets[bucketno], shared);
+
+			/* advance index past the tuple */
+			idx += MAXALIGN(HJTUPLE_OVERHEAD +
+							HJTUPLE_MINTUPLE(hashTuple)->t_len);
+		}
+
+		chunk_shared = chunk->next.shared;
+
+		/* allow this loop to be cancellable */
+		CHECK_FOR_INTERRUPTS();
+	}
+
+	SpinLockAcquire(&pstate->mutex);
+	pstate->spaceUsed += (nbuckets - pstate->nbuckets) *
+		sizeof(dsa_pointer_atomic);
+	pstate->nbuckets = nbuckets;
+	pstate->log2_nbuckets = log2_nbuckets;
+	pstate->buckets = new_buckets;
+	SpinLockRelease(&pstate->mutex);
+}
+
+/*
+ * Get the first tuple in a given bucket of the shared hash table.
+ */
+static inline HashJoinTuple
+ExecParallelHashFirstTuple(HashJoinTable hashtable, int bucketno)
+{
+	dsa_pointer p;
+
+	p = dsa_pointer_atomic_read(&hashtable->shared_buckets[bucketno]);
+	if (!DsaPointerIsValid(p))
+		return NULL;
+	return (HashJoinTuple) dsa_get_address(hashtable->area, p);
+}
+
+/*
+ * Get the next tuple in the same bucket of the shared hash table.
+ */
+static inline HashJoinTuple
+ExecParallelHashNextTuple(HashJoinTable hashtable, HashJoinTuple tuple)
+{
+	if (!DsaPointerIsValid(tuple->next.shared))
+		return NULL;
+	return (HashJoinTuple) dsa_get_address(hashtable->area,
+										   tuple->next.shared);
+}
+
+/*
+ * ExecParallelHashTableReset
+ *		free the shared hash table's memory and return its control block to
+ *		the initial state, so that the join can be run again
+ *
+ * This must only be called while no participant is using the table, namely
+ * from the leader while no workers are running.
+ */
+void
+ExecParallelHashTableReset(ParallelHashJoinState *pstate, dsa_area *area)
+{
+	dsa_pointer chunk_shared = pstate->chunks;
+
+	while (DsaPointerIsValid(chunk_shared))
+	{
+		HashMemoryChunk chunk;
+		dsa_pointer next;
+
+		chunk = (HashMemoryChunk) dsa_get_address(area, chunk_shared);
+		next = chunk->next.shared;
+		dsa_free(area, chunk_shared);
+		chunk_shared = next;
+	}
+	if (DsaPointerIsValid(pstate->buckets))
+		dsa_free(area, pstate->buckets);
+
+	pstate->phase = PHJ_PHASE_INIT;
+	pstate->nbuilders = 0;
+	pstate->nbuckets = 0;
+	pstate->log2_nbuckets = 0;
+	pstate->buckets = InvalidDsaPointer;
+	pstate->chunks = InvalidDsaPointer;
+	pstate->totalTuples = 0;
+	pstate->spaceUsed = 0;
+	pstate->workers_launched = false;
+}
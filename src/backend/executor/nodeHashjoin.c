@@ -21,6 +21,7 @@
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
+#include "storage/spin.h"
 #include "utils/memutils.h"
 
 
@@ -157,7 +158,7 @@ ExecHashJoin(PlanState *pstate)
 				/*
 				 * create the hash table
 				 */
-				hashtable = ExecHashTableCreate((Hash *) hashNode->ps.plan,
+				hashtable = ExecHashTableCreate(hashNode,
 												node->hj_HashOperators,
 												HJ_FILL_INNER(node));
 				node->hj_HashTable = hashtable;
@@ -280,7 +281,14 @@ ExecHashJoin(PlanState *pstate)
 				if (joinqual == NULL || ExecQual(joinqual, econtext))
 				{
 					node->hj_MatchedOuter = true;
-					HeapTupleHeaderSetMatch(HJTUPLE_MINTUPLE(node->hj_CurTuple));
+
+					/*
+					 * Match flags are only needed for right and full joins,
+					 * which never use a shared hash table; don't scribble on
+					 * tuples that other processes may be reading.
+					 */
+					if (hashtable->parallel_state == NULL)
+						HeapTupleHeaderSetMatch(HJTUPLE_MINTUPLE(node->hj_CurTuple));
 
 					/* In an antijoin, we never return a matched tuple */
 					if (node->js.jointype == JOIN_ANTI)
@@ -897,6 +905,31 @@ ExecHashJoinGetSavedTuple(HashJoinState *hjstate,
 void
 ExecReScanHashJoin(HashJoinState *node)
 {
+	HashState  *hashNode = (HashState *) innerPlanState(node);
+
+	/*
+	 * A shared hash table has to be rebuilt from scratch by whichever
+	 * participants take part in the next scan, since the partial inner plan
+	 * will be divided among them differently.  This is called in the leader
+	 * while no workers are running, so it's safe to release the shared
+	 * memory here.  The inner plan must be rescanned even if we never built
+	 * a hash table ourselves, so that its shared scan state is reset too.
+	 */
+	if (hashNode->parallel_state != NULL)
+	{
+		if (node->hj_HashTable != NULL)
+		{
+			ExecHashTableDestroy(node->hj_HashTable);
+			node->hj_HashTable = NULL;
+		}
+		ExecParallelHashTableReset(hashNode->parallel_state,
+								   node->js.ps.state->es_query_dsa);
+		node->hj_JoinState = HJ_BUILD_HASHTABLE;
+
+		if (node->js.ps.righttree->chgParam == NULL)
+			ExecReScan(node->js.ps.righttree);
+	}
+
 	/*
 	 * In a multi-batch join, we currently have to do rescans the hard way,
 	 * primarily because batch temp files may have already been released. But
@@ -904,7 +937,7 @@ ExecReScanHashJoin(HashJoinState *node)
 	 * inner subnode, then we can just re-use the existing hash table without
 	 * rebuilding it.
 	 */
-	if (node->hj_HashTable != NULL)
+	else if (node->hj_HashTable != NULL)
 	{
 		if (node->hj_HashTable->nbatch == 1 &&
 			node->js.ps.righttree->chgParam == NULL)
@@ -964,3 +997,101 @@ ExecReScanHashJoin(HashJoinState *node)
 	if (node->js.ps.lefttree->chgParam == NULL)
 		ExecReScan(node->js.ps.lefttree);
 }
+
+/* ----------------------------------------------------------------
+ *						Parallel Hash Join Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecHashJoinEstimate
+ *
+ *		estimates the space required for the shared hash table's
+ *		control block.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashJoinEstimate(HashJoinState *state, ParallelContext *pcxt)
+{
+	shm_toc_estimate_chunk(&pcxt->estimator, sizeof(ParallelHashJoinState));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecHashJoinInitializeDSM
+ *
+ *		Set up the shared hash table's control block, and hand it to
+ *		our Hash node.  The table itself is allocated from the query's
+ *		DSA area once building starts.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashJoinInitializeDSM(HashJoinState *state, ParallelContext *pcxt)
+{
+	HashState  *hashNode = (HashState *) innerPlanState(state);
+	ParallelHashJoinState *pstate;
+
+	/*
+	 * If we couldn't get a DSA area there are no workers either, and the
+	 * leader will just build a private hash table.
+	 */
+	if (state->js.ps.state->es_query_dsa == NULL)
+		return;
+
+	pstate = shm_toc_allocate(pcxt->toc, sizeof(ParallelHashJoinState));
+
+	SpinLockInit(&pstate->mutex);
+	pstate->phase = PHJ_PHASE_INIT;
+	pstate->nbuilders = 0;
+	pstate->nparticipants = pcxt->nworkers + 1;
+	pstate->workers_launched = false;
+	pstate->nbuckets = 0;
+	pstate->log2_nbuckets = 0;
+	pstate->buckets = InvalidDsaPointer;
+	pstate->chunks = InvalidDsaPointer;
+	pstate->totalTuples = 0;
+	pstate->spaceUsed = 0;
+	pstate->spaceAllowed = (Size) work_mem * 1024L * pstate->nparticipants;
+	ConditionVariableInit(&pstate->cv);
+
+	shm_toc_insert(pcxt->toc, state->js.ps.plan->plan_node_id, pstate);
+	hashNode->parallel_state = pstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecHashJoinInitializeWorker
+ *
+ *		Find the shared hash table's control block in the TOC.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashJoinInitializeWorker(HashJoinState *state, shm_toc *toc)
+{
+	HashState  *hashNode = (HashState *) innerPlanState(state);
+
+	hashNode->parallel_state =
+		shm_toc_lookup(toc, state->js.ps.plan->plan_node_id, false);
+}
+
+/* ----------------------------------------------------------------
+ *		ExecHashJoinWorkersLaunched
+ *
+ *		Now that we know how many workers we got, limit the shared
+ *		hash table to the work_mem of those workers and the leader.
+ * ----------------------------------------------------------------
+ */
+void
+ExecHashJoinWorkersLaunched(HashJoinState *state, ParallelContext *pcxt)
+{
+	HashState  *hashNode = (HashState *) innerPlanState(state);
+	ParallelHashJoinState *pstate = hashNode->parallel_state;
+
+	if (pstate == NULL)
+		return;
+
+	SpinLockAcquire(&pstate->mutex);
+	pstate->nparticipants = pcxt->nworkers_launched + 1;
+	pstate->spaceAllowed = (Size) work_mem * 1024L * pstate->nparticipants;
+	pstate->workers_launched = true;
+	SpinLockRelease(&pstate->mutex);
+}
@@ -0,0 +1,356 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeIncrementalSort.c
+ *	  Routines to handle incremental sorting of relations.
+ *
+ * An incremental sort is used when the input is already sorted on a
+ * leading subset of the requested sort keys.  Then each group of tuples
+ * having equal values in those presorted columns can be sorted on its own,
+ * so that tuples can be returned as soon as the first group has been read,
+ * and only one group at a time needs to be held in memory.  This makes a
+ * big difference for queries with a LIMIT, which may need to read only a
+ * small part of the input.
+ *
+ * Groups can be very small, though, in which case starting a separate sort
+ * for each of them would be expensive.  So we always put at least
+ * INCSORT_MIN_BATCH_SIZE tuples into a sort, and then keep reading until
+ * the presorted columns change, so that the batch consists of complete
+ * groups.  Sorting such a batch on all the sort columns yields the same
+ * order as sorting each of its groups separately.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeIncrementalSort.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "executor/execdebug.h"
+#include "executor/nodeIncrementalSort.h"
+#include "miscadmin.h"
+#include "utils/lsyscache.h"
+#include "utils/memutils.h"
+#include "utils/tuplesort.h"
+
+
+/*
+ * Finish with the current batch's sort, if any.
+ */
+static void
+incsort_end_batch(IncrementalSortState *node)
+{
+	if (node->tuplesortstate != NULL)
+		tuplesort_end((Tuplesortstate *) node->tuplesortstate);
+	node->tuplesortstate = NULL;
+	node->batch_sorted = false;
+}
+
+/*
+ * Read the next batch of input tuples into a new tuplesort and sort it.
+ *
+ * Returns false if there is no more input.
+ */
+static bool
+incsort_sort_batch(IncrementalSortState *node)
+{
+	IncrementalSort *plannode = (IncrementalSort *) node->ss.ps.plan;
+	PlanState  *outerNode = outerPlanState(node);
+	Tuplesortstate *tuplesortstate;
+	TupleTableSlot *slot;
+	int64		ntuples = 0;
+	bool		have_pivot = false;
+	const char *sortMethod;
+	const char *spaceType;
+	long		spaceUsed;
+
+	if (node->input_done && TupIsNull(node->transfer_tuple))
+		return false;
+
+	tuplesortstate = tuplesort_begin_heap(ExecGetResultType(outerNode),
+										  plannode->sort.numCols,
+										  plannode->sort.sortColIdx,
+										  plannode->sort.sortOperators,
+										  plannode->sort.collations,
+										  plannode->sort.nullsFirst,
+										  work_mem,
+										  false);
+	node->tuplesortstate = (void *) tuplesortstate;
+
+	/*
+	 * If bounded, this batch only needs to supply the tuples that previous
+	 * batches didn't.
+	 */
+	if (node->bounded && node->bound > node->bound_Done)
+		tuplesort_set_bound(tuplesortstate, node->bound - node->bound_Done);
+
+	/* Start with the tuple left over from the previous batch, if any */
+	if (!TupIsNull(node->transfer_tuple))
+	{
+		tuplesort_puttupleslot(tuplesortstate, node->transfer_tuple);
+		ExecClearTuple(node->transfer_tuple);
+		ntuples++;
+	}
+
+	while (!node->input_done)
+	{
+		slot = ExecProcNode(outerNode);
+
+		if (TupIsNull(slot))
+		{
+			node->input_done = true;
+			break;
+		}
+
+		/*
+		 * Once the batch is big enough, it ends where the presorted columns
+		 * change.  Keep the tuple that starts the next batch.
+		 */
+		if (have_pivot &&
+			!execTuplesMatch(node->group_pivot, slot,
+							 plannode->presortedCols,
+							 plannode->sort.sortColIdx,
+							 node->eqfunctions,
+							 node->tempContext))
+		{
+			ExecCopySlot(node->transfer_tuple, slot);
+			break;
+		}
+
+		tuplesort_puttupleslot(tuplesortstate, slot);
+		ntuples++;
+
+		if (ntuples == INCSORT_MIN_BATCH_SIZE)
+		{
+			ExecCopySlot(node->group_pivot, slot);
+			have_pivot = true;
+		}
+	}
+
+	ExecClearTuple(node->group_pivot);
+
+	if (ntuples == 0)
+	{
+		incsort_end_batch(node);
+		return false;
+	}
+
+	SO1_printf("ExecIncrementalSort: sorting batch of " INT64_FORMAT " tuples\n",
+			   ntuples);
+
+	tuplesort_performsort(tuplesortstate);
+	node->batch_sorted = true;
+
+	/* Remember the stats of the most expensive batch for EXPLAIN */
+	node->nbatches++;
+	tuplesort_get_stats(tuplesortstate, &sortMethod, &spaceType, &spaceUsed);
+	if (node->maxSpaceType == NULL ||
+		(strcmp(spaceType, "Disk") == 0 &&
+		 strcmp(node->maxSpaceType, "Disk") != 0) ||
+		(strcmp(spaceType, node->maxSpaceType) == 0 &&
+		 spaceUsed > node->maxSpaceUsed))
+	{
+		node->maxSpaceType = spaceType;
+		node->maxSpaceUsed = spaceUsed;
+	}
+
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecIncrementalSort
+ *
+ *		Returns the next tuple of the sorted output, reading and sorting
+ *		another batch of input tuples whenever the previous one has been
+ *		returned completely.
+ *
+ *		Conditions:
+ *		  -- the outer child returns tuples sorted on the presorted
+ *			 columns.
+ *
+ *		Initial States:
+ *		  -- the outer child is prepared to return the first tuple.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecIncrementalSort(PlanState *pstate)
+{
+	IncrementalSortState *node = castNode(IncrementalSortState, pstate);
+	TupleTableSlot *slot = node->ss.ps.ps_ResultTupleSlot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	/* We only ever scan forward */
+	Assert(ScanDirectionIsForward(node->ss.ps.state->es_direction));
+
+	for (;;)
+	{
+		if (node->batch_sorted)
+		{
+			if (tuplesort_gettupleslot((Tuplesortstate *) node->tuplesortstate,
+									   true, false, slot, NULL))
+			{
+				node->bound_Done++;
+				return slot;
+			}
+			incsort_end_batch(node);
+		}
+
+		if (!incsort_sort_batch(node))
+			return ExecClearTuple(slot);
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitIncrementalSort
+ *
+ *		Creates the run-time state information for the incremental sort
+ *		node produced by the planner and initializes its outer subtree.
+ * ----------------------------------------------------------------
+ */
+IncrementalSortState *
+ExecInitIncrementalSort(IncrementalSort *node, EState *estate, int eflags)
+{
+	IncrementalSortState *sortstate;
+	Oid		   *eqOperators;
+	TupleDesc	tupDesc;
+	int			i;
+
+	/* check for unsupported flags */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	sortstate = makeNode(IncrementalSortState);
+	sortstate->ss.ps.plan = (Plan *) node;
+	sortstate->ss.ps.state = estate;
+	sortstate->ss.ps.ExecProcNode = ExecIncrementalSort;
+
+	sortstate->bounded = false;
+	sortstate->batch_sorted = false;
+	sortstate->input_done = false;
+	sortstate->bound_Done = 0;
+	sortstate->tuplesortstate = NULL;
+	sortstate->nbatches = 0;
+	sortstate->maxSpaceUsed = 0;
+	sortstate->maxSpaceType = NULL;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * Like Sort, we never call ExecQual or ExecProject, but we do need a
+	 * short-term context for comparing the presorted columns.
+	 */
+	sortstate->tempContext =
+		AllocSetContextCreate(CurrentMemoryContext,
+							  "IncrementalSort",
+							  ALLOCSET_DEFAULT_SIZES);
+
+	/*
+	 * tuple table initialization
+	 */
+	ExecInitResultTupleSlot(estate, &sortstate->ss.ps);
+	ExecInitScanTupleSlot(estate, &sortstate->ss);
+	sortstate->group_pivot = ExecInitExtraTupleSlot(estate);
+	sortstate->transfer_tuple = ExecInitExtraTupleSlot(estate);
+
+	/*
+	 * initialize child nodes
+	 *
+	 * Since we re-read the input on rescan anyway, the child needn't
+	 * support REWIND.
+	 */
+	eflags &= ~EXEC_FLAG_REWIND;
+
+	outerPlanState(sortstate) = ExecInitNode(outerPlan(node), estate, eflags);
+
+	/*
+	 * initialize tuple type.  no need to initialize projection info because
+	 * this node doesn't do projections.
+	 */
+	ExecAssignResultTypeFromTL(&sortstate->ss.ps);
+	ExecAssignScanTypeFromOuterPlan(&sortstate->ss);
+	sortstate->ss.ps.ps_ProjInfo = NULL;
+
+	tupDesc = ExecGetResultType(outerPlanState(sortstate));
+	ExecSetSlotDescriptor(sortstate->group_pivot, tupDesc);
+	ExecSetSlotDescriptor(sortstate->transfer_tuple, tupDesc);
+
+	/*
+	 * Look up the equality operators that go with the presorted columns'
+	 * ordering operators, to detect group boundaries.
+	 */
+	eqOperators = (Oid *) palloc(node->presortedCols * sizeof(Oid));
+	for (i = 0; i < node->presortedCols; i++)
+	{
+		eqOperators[i] = get_equality_op_for_ordering_op(node->sort.sortOperators[i],
+														 NULL);
+		if (!OidIsValid(eqOperators[i]))
+			elog(ERROR, "missing equality operator for ordering operator %u",
+				 node->sort.sortOperators[i]);
+	}
+	sortstate->eqfunctions = execTuplesMatchPrepare(node->presortedCols,
+													eqOperators);
+	pfree(eqOperators);
+
+	return sortstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndIncrementalSort(node)
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndIncrementalSort(IncrementalSortState *node)
+{
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ss_ScanTupleSlot);
+	/* must drop pointer to sort result tuple */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+	ExecClearTuple(node->transfer_tuple);
+
+	/*
+	 * Release tuplesort resources
+	 */
+	incsort_end_batch(node);
+
+	MemoryContextDelete(node->tempContext);
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+}
+
+void
+ExecReScanIncrementalSort(IncrementalSortState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	/*
+	 * Only the current batch is kept, so we always have to re-read the
+	 * subplan and sort it again.
+	 */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->group_pivot);
+	ExecClearTuple(node->transfer_tuple);
+	incsort_end_batch(node);
+
+	node->input_done = false;
+	node->bound_Done = 0;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+}
@@ -239,6 +239,99 @@ ExecCheckTIDVisible(EState *estate,
 	ReleaseBuffer(buffer);
 }
 
+/*
+ * ExecInitRoutedPartition
+ *		Set up a leaf partition of the target table for INSERT, the first
+ *		time a tuple is routed to it.
+ *
+ * Besides the ResultRelInfo, this builds the WITH CHECK OPTION constraints
+ * and RETURNING projection of the partition, and its transition tuple
+ * conversion map if needed.  We didn't build the withCheckOptionList or
+ * returningList of each partition within the planner, but simple
+ * translation of the varattnos of the target table's ones will suffice.
+ */
+static ResultRelInfo *
+ExecInitRoutedPartition(ModifyTableState *mtstate, int partidx,
+						EState *estate)
+{
+	ModifyTable *node = (ModifyTable *) mtstate->ps.plan;
+	PartitionTupleRouting *proute = mtstate->mt_partition_tuple_routing;
+	Relation	rootrel = proute->rootrel;
+	ResultRelInfo *leaf_part_rri;
+	Relation	partrel;
+	MemoryContext oldcxt;
+
+	leaf_part_rri = ExecInitPartitionResultRel(proute, partidx, estate);
+	partrel = leaf_part_rri->ri_RelationDesc;
+
+	oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+
+	/*
+	 * In case of INSERT on partitioned tables, there is only one plan.
+	 * Likewise, there is only one WITH CHECK OPTIONS list, not one per
+	 * partition.  Note that, if there are SubPlans in there, they all end up
+	 * attached to the one parent Plan node.
+	 */
+	if (node->withCheckOptionLists != NIL)
+	{
+		List	   *wcoList;
+		List	   *wcoExprs = NIL;
+		ListCell   *ll;
+
+		Assert(list_length(node->withCheckOptionLists) == 1 &&
+			   mtstate->mt_nplans == 1);
+
+		/* varno = node->nominalRelation */
+		wcoList = map_partition_varattnos(linitial(node->withCheckOptionLists),
+										  node->nominalRelation,
+										  partrel, rootrel, NULL);
+		foreach(ll, wcoList)
+		{
+			WithCheckOption *wco = castNode(WithCheckOption, lfirst(ll));
+			ExprState  *wcoExpr = ExecInitQual(castNode(List, wco->qual),
+											   mtstate->mt_plans[0]);
+
+			wcoExprs = lappend(wcoExprs, wcoExpr);
+		}
+
+		leaf_part_rri->ri_WithCheckOptions = wcoList;
+		leaf_part_rri->ri_WithCheckOptionExprs = wcoExprs;
+	}
+
+	/*
+	 * The result tuple slot and expression context were set up along with
+	 * the target table's RETURNING projection.
+	 */
+	if (node->returningLists != NIL)
+	{
+		List	   *rlist;
+
+		/* varno = node->nominalRelation */
+		rlist = map_partition_varattnos(linitial(node->returningLists),
+										node->nominalRelation,
+										partrel, rootrel, NULL);
+		leaf_part_rri->ri_projectReturning =
+			ExecBuildProjectionInfo(rlist, mtstate->ps.ps_ExprContext,
+									mtstate->ps.ps_ResultTupleSlot,
+									&mtstate->ps,
+									RelationGetDescr(partrel));
+	}
+
+	/*
+	 * If we're capturing transition tuples, we might need to convert tuples
+	 * back from the partition's rowtype.
+	 */
+	if (mtstate->mt_transition_capture != NULL)
+		mtstate->mt_transition_tupconv_maps[partidx] =
+			convert_tuples_by_name(RelationGetDescr(partrel),
+								   RelationGetDescr(rootrel),
+								   gettext_noop("could not convert row type"));
+
+	MemoryContextSwitchTo(oldcxt);
+
+	return leaf_part_rri;
+}
+
 /* ----------------------------------------------------------------
  *		ExecInsert
  *
@@ -277,8 +370,9 @@ ExecInsert(ModifyTableState *mtstate,
 	resultRelInfo = estate->es_result_relation_info;
 
 	/* Determine the partition to heap_insert the tuple into */
-	if (mtstate->mt_partition_dispatch_info)
+	if (mtstate->mt_partition_tuple_routing)
 	{
+		PartitionTupleRouting *proute = mtstate->mt_partition_tuple_routing;
 		int			leaf_part_index;
 		TupleConversionMap *map;
 
@@ -286,23 +380,27 @@ ExecInsert(ModifyTableState *mtstate,
 		 * Away we go ... If we end up not finding a partition after all,
 		 * ExecFindPartition() does not return and errors out instead.
 		 * Otherwise, the returned value is to be used as an index into arrays
-		 * mt_partitions[] and mt_partition_tupconv_maps[] that will get us
-		 * the ResultRelInfo and TupleConversionMap for the partition,
+		 * partitions[] and partition_tupconv_maps[] that will get us the
+		 * ResultRelInfo and TupleConversionMap for the partition,
 		 * respectively.
 		 */
 		leaf_part_index = ExecFindPartition(resultRelInfo,
-											mtstate->mt_partition_dispatch_info,
+											proute->partition_dispatch_info,
 											slot,
 											estate);
 		Assert(leaf_part_index >= 0 &&
-			   leaf_part_index < mtstate->mt_num_partitions);
+			   leaf_part_index < proute->num_partitions);
 
 		/*
 		 * Save the old ResultRelInfo and switch to the one corresponding to
-		 * the selected partition.
+		 * the selected partition, setting that up if this is the first tuple
+		 * routed to it.
 		 */
 		saved_resultRelInfo = resultRelInfo;
-		resultRelInfo = mtstate->mt_partitions + leaf_part_index;
+		resultRelInfo = proute->partitions[leaf_part_index];
+		if (resultRelInfo == NULL)
+			resultRelInfo = ExecInitRoutedPartition(mtstate, leaf_part_index,
+													estate);
 
 		/* We do not yet have a way to insert into a foreign partition */
 		if (resultRelInfo->ri_FdwRoutine)
@@ -347,7 +445,7 @@ ExecInsert(ModifyTableState *mtstate,
 		 * We might need to convert from the parent rowtype to the partition
 		 * rowtype.
 		 */
-		map = mtstate->mt_partition_tupconv_maps[leaf_part_index];
+		map = proute->partition_tupconv_maps[leaf_part_index];
 		if (map)
 		{
 			Relation	partrel = resultRelInfo->ri_RelationDesc;
@@ -359,7 +457,7 @@ ExecInsert(ModifyTableState *mtstate,
 			 * on, until we're finished dealing with the partition. Use the
 			 * dedicated slot for that.
 			 */
-			slot = mtstate->mt_partition_tuple_slot;
+			slot = proute->partition_tuple_slot;
 			Assert(slot != NULL);
 			ExecSetSlotDescriptor(slot, RelationGetDescr(partrel));
 			ExecStoreTuple(tuple, slot, InvalidBuffer, true);
@@ -1482,38 +1580,30 @@ ExecSetupTransitionCaptureState(ModifyTableState *mtstate, EState *estate)
 	 */
 	if (mtstate->mt_transition_capture != NULL)
 	{
-		ResultRelInfo *resultRelInfos;
-		int			numResultRelInfos;
-
-		/* Find the set of partitions so that we can find their TupleDescs. */
-		if (mtstate->mt_partition_dispatch_info != NULL)
-		{
-			/*
-			 * For INSERT via partitioned table, so we need TupleDescs based
-			 * on the partition routing table.
-			 */
-			resultRelInfos = mtstate->mt_partitions;
-			numResultRelInfos = mtstate->mt_num_partitions;
-		}
-		else
+		/*
+		 * For INSERT via partitioned table, the maps for the partitions are
+		 * built along with their ResultRelInfos, by ExecInitRoutedPartition.
+		 */
+		if (mtstate->mt_partition_tuple_routing != NULL)
 		{
-			/* Otherwise we need the ResultRelInfo for each subplan. */
-			resultRelInfos = mtstate->resultRelInfo;
-			numResultRelInfos = mtstate->mt_nplans;
+			mtstate->mt_transition_tupconv_maps = (TupleConversionMap **)
+				palloc0(sizeof(TupleConversionMap *) *
+						mtstate->mt_partition_tuple_routing->num_partitions);
+			return;
 		}
 
 		/*
-		 * Build array of conversion maps from each child's TupleDesc to the
-		 * one used in the tuplestore.  The map pointers may be NULL when no
-		 * conversion is necessary, which is hopefully a common case for
-		 * partitions.
+		 * Otherwise, build array of conversion maps from each subplan's
+		 * TupleDesc to the one used in the tuplestore.  The map pointers may
+		 * be NULL when no conversion is necessary, which is hopefully a
+		 * common case for inheritance children.
 		 */
 		mtstate->mt_transition_tupconv_maps = (TupleConversionMap **)
-			palloc0(sizeof(TupleConversionMap *) * numResultRelInfos);
-		for (i = 0; i < numResultRelInfos; ++i)
+			palloc0(sizeof(TupleConversionMap *) * mtstate->mt_nplans);
+		for (i = 0; i < mtstate->mt_nplans; ++i)
 		{
 			mtstate->mt_transition_tupconv_maps[i] =
-				convert_tuples_by_name(RelationGetDescr(resultRelInfos[i].ri_RelationDesc),
+				convert_tuples_by_name(RelationGetDescr(mtstate->resultRelInfo[i].ri_RelationDesc),
 									   RelationGetDescr(targetRelInfo->ri_RelationDesc),
 									   gettext_noop("could not convert row type"));
 		}
@@ -1909,28 +1999,8 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 	/* Build state for INSERT tuple routing */
 	if (operation == CMD_INSERT &&
 		rel->rd_rel->relkind == RELKIND_PARTITIONED_TABLE)
-	{
-		PartitionDispatch *partition_dispatch_info;
-		ResultRelInfo *partitions;
-		TupleConversionMap **partition_tupconv_maps;
-		TupleTableSlot *partition_tuple_slot;
-		int			num_parted,
-					num_partitions;
-
-		ExecSetupPartitionTupleRouting(rel,
-									   node->nominalRelation,
-									   &partition_dispatch_info,
-									   &partitions,
-									   &partition_tupconv_maps,
-									   &partition_tuple_slot,
-									   &num_parted, &num_partitions);
-		mtstate->mt_partition_dispatch_info = partition_dispatch_info;
-		mtstate->mt_num_dispatch = num_parted;
-		mtstate->mt_partitions = partitions;
-		mtstate->mt_num_partitions = num_partitions;
-		mtstate->mt_partition_tupconv_maps = partition_tupconv_maps;
-		mtstate->mt_partition_tuple_slot = partition_tuple_slot;
-	}
+		mtstate->mt_partition_tuple_routing =
+			ExecSetupPartitionTupleRouting(rel, node->nominalRelation);
 
 	/* Build state for collecting transition tuples */
 	ExecSetupTransitionCaptureState(mtstate, estate);
@@ -1961,57 +2031,6 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 		i++;
 	}
 
-	/*
-	 * Build WITH CHECK OPTION constraints for each leaf partition rel. Note
-	 * that we didn't build the withCheckOptionList for each partition within
-	 * the planner, but simple translation of the varattnos for each partition
-	 * will suffice.  This only occurs for the INSERT case; UPDATE/DELETE
-	 * cases are handled above.
-	 */
-	if (node->withCheckOptionLists != NIL && mtstate->mt_num_partitions > 0)
-	{
-		List	   *wcoList;
-		PlanState  *plan;
-
-		/*
-		 * In case of INSERT on partitioned tables, there is only one plan.
-		 * Likewise, there is only one WITH CHECK OPTIONS list, not one per
-		 * partition.  We make a copy of the WCO qual for each partition; note
-		 * that, if there are SubPlans in there, they all end up attached to
-		 * the one parent Plan node.
-		 */
-		Assert(operation == CMD_INSERT &&
-			   list_length(node->withCheckOptionLists) == 1 &&
-			   mtstate->mt_nplans == 1);
-		wcoList = linitial(node->withCheckOptionLists);
-		plan = mtstate->mt_plans[0];
-		resultRelInfo = mtstate->mt_partitions;
-		for (i = 0; i < mtstate->mt_num_partitions; i++)
-		{
-			Relation	partrel = resultRelInfo->ri_RelationDesc;
-			List	   *mapped_wcoList;
-			List	   *wcoExprs = NIL;
-			ListCell   *ll;
-
-			/* varno = node->nominalRelation */
-			mapped_wcoList = map_partition_varattnos(wcoList,
-													 node->nominalRelation,
-													 partrel, rel, NULL);
-			foreach(ll, mapped_wcoList)
-			{
-				WithCheckOption *wco = castNode(WithCheckOption, lfirst(ll));
-				ExprState  *wcoExpr = ExecInitQual(castNode(List, wco->qual),
-												   plan);
-
-				wcoExprs = lappend(wcoExprs, wcoExpr);
-			}
-
-			resultRelInfo->ri_WithCheckOptions = mapped_wcoList;
-			resultRelInfo->ri_WithCheckOptionExprs = wcoExprs;
-			resultRelInfo++;
-		}
-	}
-
 	/*
 	 * Initialize RETURNING projections if needed.
 	 */
@@ -2019,7 +2038,6 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 	{
 		TupleTableSlot *slot;
 		ExprContext *econtext;
-		List	   *returningList;
 
 		/*
 		 * Initialize result tuple slot and assign its rowtype using the first
@@ -2053,28 +2071,9 @@ ExecInitModifyTable(ModifyTable *node, EState *estate, int eflags)
 		}
 
 		/*
-		 * Build a projection for each leaf partition rel.  Note that we
-		 * didn't build the returningList for each partition within the
-		 * planner, but simple translation of the varattnos for each partition
-		 * will suffice.  This only occurs for the INSERT case; UPDATE/DELETE
-		 * are handled above.
+		 * The projections of the leaf partitions of a partitioned table are
+		 * built as tuples get routed to them; see ExecInitRoutedPartition.
 		 */
-		resultRelInfo = mtstate->mt_partitions;
-		returningList = linitial(node->returningLists);
-		for (i = 0; i < mtstate->mt_num_partitions; i++)
-		{
-			Relation	partrel = resultRelInfo->ri_RelationDesc;
-			List	   *rlist;
-
-			/* varno = node->nominalRelation */
-			rlist = map_partition_varattnos(returningList,
-											node->nominalRelation,
-											partrel, rel, NULL);
-			resultRelInfo->ri_projectReturning =
-				ExecBuildProjectionInfo(rlist, econtext, slot, &mtstate->ps,
-										resultRelInfo->ri_RelationDesc->rd_att);
-			resultRelInfo++;
-		}
 	}
 	else
 	{
@@ -2334,32 +2333,9 @@ ExecEndModifyTable(ModifyTableState *node)
 														   resultRelInfo);
 	}
 
-	/*
-	 * Close all the partitioned tables, leaf partitions, and their indices
-	 *
-	 * Remember node->mt_partition_dispatch_info[0] corresponds to the root
-	 * partitioned table, which we must not try to close, because it is the
-	 * main target table of the query that will be closed by ExecEndPlan().
-	 * Also, tupslot is NULL for the root partitioned table.
-	 */
-	for (i = 1; i < node->mt_num_dispatch; i++)
-	{
-		PartitionDispatch pd = node->mt_partition_dispatch_info[i];
-
-		heap_close(pd->reldesc, NoLock);
-		ExecDropSingleTupleTableSlot(pd->tupslot);
-	}
-	for (i = 0; i < node->mt_num_partitions; i++)
-	{
-		ResultRelInfo *resultRelInfo = node->mt_partitions + i;
-
-		ExecCloseIndices(resultRelInfo);
-		heap_close(resultRelInfo->ri_RelationDesc, NoLock);
-	}
-
-	/* Release the standalone partition tuple descriptor, if any */
-	if (node->mt_partition_tuple_slot)
-		ExecDropSingleTupleTableSlot(node->mt_partition_tuple_slot);
+	/* Close all the partitioned tables, leaf partitions, and their indices */
+	if (node->mt_partition_tuple_routing)
+		ExecCleanupTupleRouting(node->mt_partition_tuple_routing);
 
 	/*
 	 * Free the exprcontext
@@ -0,0 +1,701 @@
+/*-------------------------------------------------------------------------
+ *
+ * nodeResultCache.c
+ *	  Routines to handle caching of results from parameterized nodes
+ *
+ * A ResultCache node sits above the inner side of a nested loop whose
+ * inner side is parameterized by the outer side, typically an index scan
+ * on a lookup table.  It keeps the tuples the subplan returned for each set
+ * of parameter values in a hash table, so when the same values come around
+ * again, they can be returned straight from the cache instead of running
+ * the subplan again.
+ *
+ * The cache may use up to work_mem.  When it's full, the least recently
+ * used entries are evicted to make room.  If the tuples for a single set of
+ * parameter values don't fit even in an otherwise empty cache, we give up
+ * caching them and just pass the subplan's tuples through for that scan.
+ *
+ * A cache entry is only usable once the subplan has been run to
+ * completion for it.  If the parent stops reading before that, the entry
+ * is refilled the next time its parameter values are looked up; except
+ * that when the planner told us the subplan returns at most one row for a
+ * given set of values (singlerow), an entry is complete after one tuple.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/executor/nodeResultCache.c
+ *
+ *-------------------------------------------------------------------------
+ */
+/*
+ * INTERFACE ROUTINES
+ *		ExecResultCache			- lookup the cache, or run the subplan
+ *		ExecInitResultCache		- initialize node and subnodes
+ *		ExecEndResultCache		- shutdown node and subnodes
+ *		ExecReScanResultCache	- prepare for lookup of new parameter values
+ */
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "executor/executor.h"
+#include "executor/nodeResultCache.h"
+#include "miscadmin.h"
+#include "utils/memutils.h"
+
+/* States of the ExecResultCache state machine */
+#define RC_CACHE_LOOKUP				1	/* look up the current parameters */
+#define RC_CACHE_FETCH_NEXT_TUPLE	2	/* return tuples from a cache entry */
+#define RC_FILLING_CACHE			3	/* read subplan into a cache entry */
+#define RC_CACHE_BYPASS_MODE		4	/* entry too big; read subplan only */
+#define RC_END_OF_SCAN				5	/* done with this set of parameters */
+
+/* Initial size of the hash table */
+#define RC_INITIAL_TABLE_SIZE		256
+
+/* A tuple stored in a cache entry */
+typedef struct ResultCacheTuple
+{
+	MinimalTuple mintuple;		/* the cached tuple */
+	struct ResultCacheTuple *next;	/* next tuple of the entry, or NULL */
+} ResultCacheTuple;
+
+/* The key of a cache entry; it lives in the LRU list */
+typedef struct ResultCacheKey
+{
+	MinimalTuple params;		/* the parameter values */
+	dlist_node	lru_node;		/* position in ResultCacheState.lru_list */
+} ResultCacheKey;
+
+/* A hash table entry */
+typedef struct ResultCacheEntry
+{
+	ResultCacheKey *key;		/* hash key */
+	ResultCacheTuple *tuplehead;	/* first cached tuple, or NULL */
+	uint32		hash;			/* hash value (cached) */
+	char		status;			/* hash status */
+	bool		complete;		/* did we read the subplan to the end? */
+} ResultCacheEntry;
+
+/* Memory accounted to an entry and its key, and to a cached tuple */
+#define EMPTY_ENTRY_MEMORY_BYTES(e) \
+	(sizeof(ResultCacheEntry) + sizeof(ResultCacheKey) + \
+	 (e)->key->params->t_len)
+#define CACHE_TUPLE_BYTES(t) \
+	(sizeof(ResultCacheTuple) + (t)->mintuple->t_len)
+
+static uint32 ResultCacheHash_hash(struct resultcache_hash *tb,
+					 const ResultCacheKey *key);
+static bool ResultCacheHash_equal(struct resultcache_hash *tb,
+					  const ResultCacheKey *key1,
+					  const ResultCacheKey *key2);
+
+/*
+ * A NULL key stands for the current parameter values in the probeslot; it
+ * is used for lookups and inserts.  Otherwise, a key only matches itself,
+ * which is all that's needed to delete an entry.
+ */
+#define SH_PREFIX resultcache
+#define SH_ELEMENT_TYPE ResultCacheEntry
+#define SH_KEY_TYPE ResultCacheKey *
+#define SH_KEY key
+#define SH_HASH_KEY(tb, key) ResultCacheHash_hash(tb, key)
+#define SH_EQUAL(tb, a, b) ResultCacheHash_equal(tb, a, b)
+#define SH_SCOPE static inline
+#define SH_STORE_HASH
+#define SH_GET_HASH(tb, a) a->hash
+#define SH_DECLARE
+#define SH_DEFINE
+#include "lib/simplehash.h"
+
+
+/*
+ * Hash the current parameter values (key == NULL), or the values of a
+ * stored key.
+ */
+static uint32
+ResultCacheHash_hash(struct resultcache_hash *tb, const ResultCacheKey *key)
+{
+	ResultCacheState *rcstate = (ResultCacheState *) tb->private_data;
+	TupleTableSlot *slot;
+	uint32		hashkey = 0;
+	int			i;
+
+	if (key == NULL)
+		slot = rcstate->probeslot;
+	else
+	{
+		slot = rcstate->tableslot;
+		ExecStoreMinimalTuple(key->params, slot, false);
+	}
+
+	for (i = 0; i < rcstate->nkeys; i++)
+	{
+		Datum		attr;
+		bool		isNull;
+
+		/* rotate hashkey left 1 bit at each step */
+		hashkey = (hashkey << 1) | ((hashkey & 0x80000000) ? 1 : 0);
+
+		attr = slot_getattr(slot, i + 1, &isNull);
+
+		if (!isNull)			/* treat nulls as having hash key 0 */
+		{
+			uint32		hkey;
+
+			hkey = DatumGetUInt32(FunctionCall1(&rcstate->hashfunctions[i],
+												attr));
+			hashkey ^= hkey;
+		}
+	}
+
+	return hashkey;
+}
+
+/*
+ * Compare a stored key (key1) against the current parameter values
+ * (key2 == NULL), or against another stored key.
+ */
+static bool
+ResultCacheHash_equal(struct resultcache_hash *tb, const ResultCacheKey *key1,
+					  const ResultCacheKey *key2)
+{
+	ResultCacheState *rcstate = (ResultCacheState *) tb->private_data;
+
+	if (key2 != NULL)
+		return key1 == key2;
+
+	ExecStoreMinimalTuple(key1->params, rcstate->tableslot, false);
+
+	return execTuplesMatch(rcstate->probeslot,
+						   rcstate->tableslot,
+						   rcstate->nkeys,
+						   rcstate->keyColIdx,
+						   rcstate->eqfunctions,
+						   rcstate->tempContext);
+}
+
+/*
+ * Evaluate the parameter values for the current scan into the probeslot.
+ */
+static void
+prepare_probe_slot(ResultCacheState *rcstate)
+{
+	TupleTableSlot *slot = rcstate->probeslot;
+	ExprContext *econtext = rcstate->ss.ps.ps_ExprContext;
+	MemoryContext oldcontext;
+	int			i;
+
+	ResetExprContext(econtext);
+	oldcontext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+
+	ExecClearTuple(slot);
+	for (i = 0; i < rcstate->nkeys; i++)
+		slot->tts_values[i] = ExecEvalExpr(rcstate->param_exprs[i],
+										   econtext,
+										   &slot->tts_isnull[i]);
+	ExecStoreVirtualTuple(slot);
+
+	MemoryContextSwitchTo(oldcontext);
+}
+
+/*
+ * Free the tuples cached in an entry, leaving it empty.
+ */
+static void
+entry_purge_tuples(ResultCacheState *rcstate, ResultCacheEntry *entry)
+{
+	ResultCacheTuple *tuple = entry->tuplehead;
+
+	while (tuple != NULL)
+	{
+		ResultCacheTuple *next = tuple->next;
+
+		rcstate->mem_used -= CACHE_TUPLE_BYTES(tuple);
+		pfree(tuple->mintuple);
+		pfree(tuple);
+
+		tuple = next;
+	}
+
+	entry->tuplehead = NULL;
+	entry->complete = false;
+}
+
+/*
+ * Remove an entry from the cache, along with its tuples.
+ *
+ * This may move other entries around in the hash table, so pointers to
+ * them must be looked up again afterwards.
+ */
+static void
+remove_cache_entry(ResultCacheState *rcstate, ResultCacheEntry *entry)
+{
+	ResultCacheKey *key = entry->key;
+
+	entry_purge_tuples(rcstate, entry);
+	rcstate->mem_used -= EMPTY_ENTRY_MEMORY_BYTES(entry);
+	dlist_delete(&key->lru_node);
+
+	resultcache_delete(rcstate->hashtable, key);
+
+	pfree(key->params);
+	pfree(key);
+}
+
+/*
+ * Evict least recently used entries until the cache fits in its memory
+ * limit again, sparing the entry for 'specialkey'.
+ *
+ * Returns false if even that wasn't enough, meaning that the entry for
+ * 'specialkey' is too big to cache by itself.
+ */
+static bool
+cache_reduce_memory(ResultCacheState *rcstate, ResultCacheKey *specialkey)
+{
+	dlist_mutable_iter iter;
+	MemoryContext oldcontext;
+
+	/* Hashing the keys may allocate memory */
+	oldcontext = MemoryContextSwitchTo(rcstate->tempContext);
+
+	dlist_foreach_modify(iter, &rcstate->lru_list)
+	{
+		ResultCacheKey *key = dlist_container(ResultCacheKey, lru_node,
+											  iter.cur);
+		ResultCacheEntry *entry;
+
+		if (rcstate->mem_used <= rcstate->mem_limit)
+			break;
+
+		if (key == specialkey)
+			continue;
+
+		entry = resultcache_lookup(rcstate->hashtable, key);
+		Assert(entry != NULL);
+
+		remove_cache_entry(rcstate, entry);
+		rcstate->cache_evictions++;
+	}
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return rcstate->mem_used <= rcstate->mem_limit;
+}
+
+/*
+ * Account for memory newly used by the cache, and evict other entries if
+ * needed to make room for it.  The current entry is looked up again, as
+ * evictions may have moved it.
+ *
+ * Returns false if the current entry doesn't fit in the cache by itself.
+ */
+static bool
+cache_add_memory(ResultCacheState *rcstate, Size nbytes)
+{
+	rcstate->mem_used += nbytes;
+
+	if (rcstate->mem_used > rcstate->mem_limit)
+	{
+		ResultCacheKey *key = rcstate->entry->key;
+
+		if (!cache_reduce_memory(rcstate, key))
+			return false;
+
+		rcstate->entry = resultcache_lookup(rcstate->hashtable, key);
+		Assert(rcstate->entry != NULL);
+	}
+
+	rcstate->mem_peak = Max(rcstate->mem_peak, rcstate->mem_used);
+
+	return true;
+}
+
+/*
+ * Look up the cache entry for the current parameter values, creating an
+ * empty one if there is none yet.  *found is set to whether it existed.
+ *
+ * Returns NULL if a new entry couldn't be made to fit in the cache.
+ */
+static ResultCacheEntry *
+cache_lookup(ResultCacheState *rcstate, bool *found)
+{
+	ResultCacheEntry *entry;
+	ResultCacheKey *key;
+	MemoryContext oldcontext;
+
+	prepare_probe_slot(rcstate);
+
+	/* Hash and compare the keys in the short-term context */
+	MemoryContextReset(rcstate->tempContext);
+	oldcontext = MemoryContextSwitchTo(rcstate->tempContext);
+	entry = resultcache_insert(rcstate->hashtable, NULL, found);
+	MemoryContextSwitchTo(oldcontext);
+
+	if (*found)
+	{
+		/* Mark the entry as most recently used */
+		dlist_delete(&entry->key->lru_node);
+		dlist_push_tail(&rcstate->lru_list, &entry->key->lru_node);
+		return entry;
+	}
+
+	oldcontext = MemoryContextSwitchTo(rcstate->tableContext);
+
+	key = (ResultCacheKey *) palloc(sizeof(ResultCacheKey));
+	key->params = ExecCopySlotMinimalTuple(rcstate->probeslot);
+	dlist_push_tail(&rcstate->lru_list, &key->lru_node);
+
+	entry->key = key;
+	entry->tuplehead = NULL;
+	entry->complete = false;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	rcstate->entry = entry;
+	if (!cache_add_memory(rcstate, EMPTY_ENTRY_MEMORY_BYTES(entry)))
+	{
+		remove_cache_entry(rcstate, rcstate->entry);
+		rcstate->entry = NULL;
+	}
+
+	return rcstate->entry;
+}
+
+/*
+ * Add a tuple to the current cache entry.
+ *
+ * Returns false if the entry no longer fits in the cache.
+ */
+static bool
+cache_store_tuple(ResultCacheState *rcstate, TupleTableSlot *slot)
+{
+	ResultCacheTuple *tuple;
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(rcstate->tableContext);
+
+	tuple = (ResultCacheTuple *) palloc(sizeof(ResultCacheTuple));
+	tuple->mintuple = ExecCopySlotMinimalTuple(slot);
+	tuple->next = NULL;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	if (rcstate->last_tuple != NULL)
+		rcstate->last_tuple->next = tuple;
+	else
+		rcstate->entry->tuplehead = tuple;
+	rcstate->last_tuple = tuple;
+
+	return cache_add_memory(rcstate, CACHE_TUPLE_BYTES(tuple));
+}
+
+/*
+ * The current entry turned out to be too big to cache; drop it and pass
+ * the rest of the subplan's tuples through uncached.
+ */
+static void
+cache_overflow(ResultCacheState *rcstate)
+{
+	remove_cache_entry(rcstate, rcstate->entry);
+	rcstate->entry = NULL;
+	rcstate->last_tuple = NULL;
+	rcstate->cache_overflows++;
+	rcstate->rc_status = RC_CACHE_BYPASS_MODE;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecResultCache
+ *
+ *		Returns tuples for the current parameter values, from the
+ *		cache if we've seen them before, else from the subplan while
+ *		adding them to the cache.
+ * ----------------------------------------------------------------
+ */
+static TupleTableSlot *
+ExecResultCache(PlanState *pstate)
+{
+	ResultCacheState *node = castNode(ResultCacheState, pstate);
+	PlanState  *outerNode = outerPlanState(node);
+	TupleTableSlot *resultslot = node->ss.ps.ps_ResultTupleSlot;
+	TupleTableSlot *outerslot;
+
+	CHECK_FOR_INTERRUPTS();
+
+	switch (node->rc_status)
+	{
+		case RC_CACHE_LOOKUP:
+			{
+				ResultCacheEntry *entry;
+				bool		found;
+
+				entry = cache_lookup(node, &found);
+				node->entry = entry;
+
+				if (found && entry->complete)
+				{
+					node->cache_hits++;
+					node->last_tuple = entry->tuplehead;
+
+					if (node->last_tuple == NULL)
+					{
+						node->rc_status = RC_END_OF_SCAN;
+						return ExecClearTuple(resultslot);
+					}
+
+					node->rc_status = RC_CACHE_FETCH_NEXT_TUPLE;
+					return ExecStoreMinimalTuple(node->last_tuple->mintuple,
+												 resultslot, false);
+				}
+
+				node->cache_misses++;
+				node->last_tuple = NULL;
+
+				if (entry == NULL)
+				{
+					/* Couldn't even make room for an empty entry */
+					node->cache_overflows++;
+					node->rc_status = RC_CACHE_BYPASS_MODE;
+					outerslot = ExecProcNode(outerNode);
+					if (TupIsNull(outerslot))
+						node->rc_status = RC_END_OF_SCAN;
+					return outerslot;
+				}
+
+				/* A previous scan didn't finish filling the entry; redo it */
+				if (found)
+					entry_purge_tuples(node, entry);
+
+				outerslot = ExecProcNode(outerNode);
+				if (TupIsNull(outerslot))
+				{
+					/* No tuples for these parameters; cache that, too */
+					node->entry->complete = true;
+					node->rc_status = RC_END_OF_SCAN;
+					return ExecClearTuple(resultslot);
+				}
+
+				if (!cache_store_tuple(node, outerslot))
+				{
+					cache_overflow(node);
+					return outerslot;
+				}
+
+				/*
+				 * If the subplan returns at most one tuple for these
+				 * parameters, we're done, even if the caller never asks
+				 * for another tuple.
+				 */
+				node->entry->complete = node->singlerow;
+				node->rc_status = RC_FILLING_CACHE;
+
+				return ExecStoreMinimalTuple(node->last_tuple->mintuple,
+											 resultslot, false);
+			}
+
+		case RC_CACHE_FETCH_NEXT_TUPLE:
+			node->last_tuple = node->last_tuple->next;
+			if (node->last_tuple == NULL)
+			{
+				node->rc_status = RC_END_OF_SCAN;
+				return ExecClearTuple(resultslot);
+			}
+			return ExecStoreMinimalTuple(node->last_tuple->mintuple,
+										 resultslot, false);
+
+		case RC_FILLING_CACHE:
+			outerslot = ExecProcNode(outerNode);
+			if (TupIsNull(outerslot))
+			{
+				node->entry->complete = true;
+				node->rc_status = RC_END_OF_SCAN;
+				return ExecClearTuple(resultslot);
+			}
+
+			if (!cache_store_tuple(node, outerslot))
+			{
+				cache_overflow(node);
+				return outerslot;
+			}
+
+			return ExecStoreMinimalTuple(node->last_tuple->mintuple,
+										 resultslot, false);
+
+		case RC_CACHE_BYPASS_MODE:
+			outerslot = ExecProcNode(outerNode);
+			if (TupIsNull(outerslot))
+				node->rc_status = RC_END_OF_SCAN;
+			return outerslot;
+
+		case RC_END_OF_SCAN:
+			return ExecClearTuple(resultslot);
+
+		default:
+			elog(ERROR, "unrecognized resultcache state: %d",
+				 node->rc_status);
+			return NULL;		/* keep compiler quiet */
+	}
+}
+
+/* ----------------------------------------------------------------
+ *		ExecInitResultCache
+ * ----------------------------------------------------------------
+ */
+ResultCacheState *
+ExecInitResultCache(ResultCache *node, EState *estate, int eflags)
+{
+	ResultCacheState *rcstate;
+	Plan	   *outerPlan;
+	ListCell   *lc;
+	int			nkeys;
+	int			i;
+
+	/* check for unsupported flags */
+	Assert(!(eflags & (EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK)));
+
+	/*
+	 * create state structure
+	 */
+	rcstate = makeNode(ResultCacheState);
+	rcstate->ss.ps.plan = (Plan *) node;
+	rcstate->ss.ps.state = estate;
+	rcstate->ss.ps.ExecProcNode = ExecResultCache;
+
+	/*
+	 * Miscellaneous initialization
+	 *
+	 * We need an expression context to compute the parameter values in.
+	 */
+	ExecAssignExprContext(estate, &rcstate->ss.ps);
+
+	/*
+	 * tuple table initialization
+	 */
+	ExecInitResultTupleSlot(estate, &rcstate->ss.ps);
+	rcstate->probeslot = ExecInitExtraTupleSlot(estate);
+	rcstate->tableslot = ExecInitExtraTupleSlot(estate);
+
+	/*
+	 * initialize child nodes
+	 *
+	 * We only ever rescan the child, so it needn't support REWIND.
+	 */
+	eflags &= ~EXEC_FLAG_REWIND;
+
+	outerPlan = outerPlan(node);
+	outerPlanState(rcstate) = ExecInitNode(outerPlan, estate, eflags);
+
+	/*
+	 * initialize tuple type.  no need to initialize projection info because
+	 * this node doesn't do projections.
+	 */
+	ExecAssignResultTypeFromTL(&rcstate->ss.ps);
+	rcstate->ss.ps.ps_ProjInfo = NULL;
+
+	/*
+	 * Set up the cache keys: their tuple descriptor, the expressions
+	 * computing them, and the functions to hash and compare them.
+	 */
+	nkeys = rcstate->nkeys = node->numKeys;
+	Assert(nkeys == list_length(node->param_exprs));
+
+	rcstate->hashkeydesc = ExecTypeFromExprList(node->param_exprs);
+	ExecSetSlotDescriptor(rcstate->probeslot, rcstate->hashkeydesc);
+	ExecSetSlotDescriptor(rcstate->tableslot, rcstate->hashkeydesc);
+
+	rcstate->param_exprs = (ExprState **) palloc(nkeys * sizeof(ExprState *));
+	rcstate->keyColIdx = (AttrNumber *) palloc(nkeys * sizeof(AttrNumber));
+	i = 0;
+	foreach(lc, node->param_exprs)
+	{
+		rcstate->param_exprs[i] = ExecInitExpr((Expr *) lfirst(lc),
+											   (PlanState *) rcstate);
+		rcstate->keyColIdx[i] = i + 1;
+		i++;
+	}
+
+	execTuplesHashPrepare(nkeys, node->hashOperators,
+						  &rcstate->eqfunctions, &rcstate->hashfunctions);
+
+	/*
+	 * Set up the cache itself.  The hash table, its keys and the cached
+	 * tuples all live in tableContext.
+	 */
+	rcstate->tableContext = AllocSetContextCreate(CurrentMemoryContext,
+												  "ResultCacheHashTable",
+												  ALLOCSET_DEFAULT_SIZES);
+	rcstate->tempContext = AllocSetContextCreate(CurrentMemoryContext,
+												 "ResultCache",
+												 ALLOCSET_DEFAULT_SIZES);
+	rcstate->hashtable = resultcache_create(rcstate->tableContext,
+											RC_INITIAL_TABLE_SIZE,
+											rcstate);
+	dlist_init(&rcstate->lru_list);
+	rcstate->mem_used = 0;
+	rcstate->mem_limit = work_mem * 1024L;
+	rcstate->singlerow = node->singlerow;
+
+	rcstate->rc_status = RC_CACHE_LOOKUP;
+	rcstate->entry = NULL;
+	rcstate->last_tuple = NULL;
+
+	rcstate->cache_hits = 0;
+	rcstate->cache_misses = 0;
+	rcstate->cache_evictions = 0;
+	rcstate->cache_overflows = 0;
+	rcstate->mem_peak = 0;
+
+	return rcstate;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecEndResultCache
+ * ----------------------------------------------------------------
+ */
+void
+ExecEndResultCache(ResultCacheState *node)
+{
+	/*
+	 * Free the exprcontext
+	 */
+	ExecFreeExprContext(&node->ss.ps);
+
+	/*
+	 * clean out the tuple table
+	 */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	ExecClearTuple(node->probeslot);
+	ExecClearTuple(node->tableslot);
+
+	/*
+	 * Release the cache
+	 */
+	MemoryContextDelete(node->tableContext);
+	MemoryContextDelete(node->tempContext);
+
+	/*
+	 * shut down the subplan
+	 */
+	ExecEndNode(outerPlanState(node));
+}
+
+void
+ExecReScanResultCache(ResultCacheState *node)
+{
+	PlanState  *outerPlan = outerPlanState(node);
+
+	/* Look up the new parameter values on the next call */
+	ExecClearTuple(node->ss.ps.ps_ResultTupleSlot);
+	node->rc_status = RC_CACHE_LOOKUP;
+	node->entry = NULL;
+	node->last_tuple = NULL;
+
+	/*
+	 * if chgParam of subnode is not null then plan will be re-scanned by
+	 * first ExecProcNode.
+	 */
+	if (outerPlan->chgParam == NULL)
+		ExecReScan(outerPlan);
+}
@@ -20,6 +20,9 @@
  *		ExecEndSeqScan			releases any storage allocated.
  *		ExecReScanSeqScan		rescans the relation
  *
+ *		ExecSeqScanInitBatch	prepares to return tuples in batches
+ *		ExecSeqScanNextBatch	retrieve next batch of qualifying tuples
+ *
  *		ExecSeqScanEstimate		estimates DSM space needed for parallel scan
  *		ExecSeqScanInitializeDSM initialize DSM for parallel scan
  *		ExecSeqScanInitializeWorker attach to DSM info in parallel worker
@@ -28,7 +31,10 @@
 
 #include "access/relscan.h"
 #include "executor/execdebug.h"
+#include "executor/instrument.h"
 #include "executor/nodeSeqscan.h"
+#include "miscadmin.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 
 static void InitScanRelation(SeqScanState *node, EState *estate, int eflags);
@@ -277,9 +283,173 @@ ExecReScanSeqScan(SeqScanState *node)
 		heap_rescan(scan,		/* scan desc */
 					NULL);		/* new scan keys */
 
+	node->batchdone = false;
+
 	ExecScanReScan((ScanState *) node);
 }
 
+/* ----------------------------------------------------------------
+ *						Batch Support
+ * ----------------------------------------------------------------
+ */
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanInitBatch
+ *
+ *		Prepare to return the scan's qualifying tuples in batches of up
+ *		to maxrows rows, storing at least the columns in attnums.  This
+ *		is for use by a parent node that reads the scan tuples directly
+ *		instead of calling ExecProcNode, so it fails (returning false)
+ *		if the node has to project.
+ *
+ *		Quals that ExecInitBatchQual can handle are applied to whole
+ *		batches; any others are checked tuple by tuple while filling
+ *		the batch.
+ * ----------------------------------------------------------------
+ */
+bool
+ExecSeqScanInitBatch(SeqScanState *node, Bitmapset *attnums, int maxrows)
+{
+	Plan	   *plan = node->ss.ps.plan;
+	List	   *residual = NIL;
+	ListCell   *lc;
+	int			attno;
+
+	if (node->ss.ps.ps_ProjInfo != NULL)
+		return false;
+
+	attnums = bms_copy(attnums);
+	foreach(lc, plan->qual)
+	{
+		Expr	   *clause = (Expr *) lfirst(lc);
+		BatchQual  *qual = ExecInitBatchQual(clause);
+
+		if (qual != NULL)
+		{
+			node->batchquals = lappend(node->batchquals, qual);
+			attnums = bms_add_member(attnums, ExecBatchQualAttno(qual));
+		}
+		else
+			residual = lappend(residual, clause);
+	}
+
+	node->batchresidual = ExecInitQual(residual, (PlanState *) node);
+	node->batchlastattno = 0;
+	node->batchdone = false;
+	while ((attno = bms_next_member(attnums, node->batchlastattno)) >= 0)
+		node->batchlastattno = attno;
+	node->batch = ExecCreateTupleBatch(node->ss.ss_ScanTupleSlot->tts_tupleDescriptor,
+									   attnums, maxrows);
+
+	return true;
+}
+
+/* ----------------------------------------------------------------
+ *		ExecSeqScanNextBatch
+ *
+ *		Fill the batch with the next tuples that pass the residual
+ *		quals, then narrow its selection vector with the batch quals.
+ *		Returns NULL once the scan is exhausted.  Note that the returned
+ *		batch may have no rows selected.
+ * ----------------------------------------------------------------
+ */
+TupleBatch *
+ExecSeqScanNextBatch(SeqScanState *node)
+{
+	TupleBatch *batch = node->batch;
+	EState	   *estate = node->ss.ps.state;
+	ExprContext *econtext = node->ss.ps.ps_ExprContext;
+	TupleTableSlot *slot = node->ss.ss_ScanTupleSlot;
+	ExprState  *residual = node->batchresidual;
+	int			lastattno = node->batchlastattno;
+	HeapScanDesc scandesc;
+	long		nfiltered = 0;
+	ListCell   *lc;
+	int			i;
+
+	Assert(batch != NULL);
+
+	/*
+	 * heap_getnext() starts over once it has returned NULL, so we must
+	 * remember that the scan is done.
+	 */
+	if (node->batchdone)
+		return NULL;
+
+	if (node->ss.ps.instrument)
+		InstrStartNode(node->ss.ps.instrument);
+
+	scandesc = node->ss.ss_currentScanDesc;
+	if (scandesc == NULL)
+	{
+		/* as in SeqNext */
+		scandesc = heap_beginscan(node->ss.ss_currentRelation,
+								  estate->es_snapshot,
+								  0, NULL);
+		node->ss.ss_currentScanDesc = scandesc;
+	}
+
+	batch->nrows = 0;
+	while (batch->nrows < batch->maxrows)
+	{
+		HeapTuple	tuple;
+		int			row;
+		int			attno;
+
+		CHECK_FOR_INTERRUPTS();
+
+		tuple = heap_getnext(scandesc, ForwardScanDirection);
+		if (tuple == NULL)
+		{
+			node->batchdone = true;
+			break;
+		}
+		ExecStoreTuple(tuple, slot, scandesc->rs_cbuf, false);
+
+		if (residual)
+		{
+			econtext->ecxt_scantuple = slot;
+			ResetExprContext(econtext);
+			if (!ExecQual(residual, econtext))
+			{
+				nfiltered++;
+				continue;
+			}
+		}
+
+		/* copy out the needed columns */
+		slot_getsomeattrs(slot, lastattno);
+		row = batch->nrows++;
+		for (attno = 0; attno < lastattno; attno++)
+		{
+			if (batch->values[attno] == NULL)
+				continue;
+			batch->values[attno][row] = slot->tts_values[attno];
+			batch->isnull[attno][row] = slot->tts_isnull[attno];
+		}
+	}
+
+	/* don't keep the last buffer pinned */
+	ExecClearTuple(slot);
+
+	for (i = 0; i < batch->nrows; i++)
+		batch->selection[i] = i;
+	batch->nselected = batch->nrows;
+
+	foreach(lc, node->batchquals)
+		ExecBatchQualFilter((BatchQual *) lfirst(lc), batch);
+
+	nfiltered += batch->nrows - batch->nselected;
+	InstrCountFiltered1(node, nfiltered);
+
+	if (node->ss.ps.instrument)
+		InstrStopNode(node->ss.ps.instrument, batch->nselected);
+
+	if (batch->nrows == 0)
+		return NULL;
+	return batch;
+}
+
 /* ----------------------------------------------------------------
  *						Parallel Scan Support
  * ----------------------------------------------------------------
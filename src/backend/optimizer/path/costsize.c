@@ -80,7 +80,9 @@
 #include "access/htup_details.h"
 #include "access/tsmapi.h"
 #include "executor/executor.h"
+#include "executor/nodeAgg.h"
 #include "executor/nodeHash.h"
+#include "executor/nodeIncrementalSort.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
@@ -121,12 +123,18 @@ bool		enable_indexonlyscan = true;
 bool		enable_bitmapscan = true;
 bool		enable_tidscan = true;
 bool		enable_sort = true;
+bool		enable_incrementalsort = true;
 bool		enable_hashagg = true;
 bool		enable_nestloop = true;
 bool		enable_material = true;
 bool		enable_mergejoin = true;
 bool		enable_hashjoin = true;
 bool		enable_gathermerge = true;
+bool		enable_parallel_append = true;
+bool		enable_parallel_hash = true;
+bool		enable_resultcache = true;
+bool		enable_partitionwise_join = false;
+bool		enable_partitionwise_aggregate = false;
 
 typedef struct
 {
@@ -138,6 +146,10 @@ static List *extract_nonindex_conditions(List *qual_clauses, List *indexquals);
 static MergeScanSelCache *cached_scansel(PlannerInfo *root,
 			   RestrictInfo *rinfo,
 			   PathKey *pathkey);
+static void cost_tuplesort(Cost *startup_cost, Cost *run_cost,
+			   double tuples, int width,
+			   Cost comparison_cost, int sort_mem,
+			   double limit_tuples);
 static void cost_rescan(PlannerInfo *root, Path *path,
 			Cost *rescan_startup_cost, Cost *rescan_total_cost);
 static bool cost_qual_eval_walker(Node *node, cost_qual_eval_context *context);
@@ -163,6 +175,8 @@ static void set_rel_width(PlannerInfo *root, RelOptInfo *rel);
 static double relation_byte_size(double tuples, int width);
 static double page_size(double tuples, int width);
 static double get_parallel_divisor(Path *path);
+static Cost append_nonpartial_cost(List *subpaths, int numpaths,
+					   int parallel_workers);
 
 
 /*
@@ -1646,17 +1660,42 @@ cost_sort(Path *path, PlannerInfo *root,
 		  Cost comparison_cost, int sort_mem,
 		  double limit_tuples)
 {
-	Cost		startup_cost = input_cost;
-	Cost		run_cost = 0;
-	double		input_bytes = relation_byte_size(tuples, width);
-	double		output_bytes;
-	double		output_tuples;
-	long		sort_mem_bytes = sort_mem * 1024L;
+	Cost		startup_cost;
+	Cost		run_cost;
+
+	cost_tuplesort(&startup_cost, &run_cost,
+				   tuples, width, comparison_cost, sort_mem,
+				   limit_tuples);
 
+	startup_cost += input_cost;
 	if (!enable_sort)
 		startup_cost += disable_cost;
 
 	path->rows = tuples;
+	path->startup_cost = startup_cost;
+	path->total_cost = startup_cost + run_cost;
+}
+
+/*
+ * cost_tuplesort
+ *	  Determines the cost of sorting tuples with tuplesort.c, not counting
+ *	  the cost of reading the input; see cost_sort.
+ *
+ * The cost of sorting is returned in *startup_cost, and the cost of
+ * fetching the sorted tuples in *run_cost.
+ */
+static void
+cost_tuplesort(Cost *startup_cost, Cost *run_cost,
+			   double tuples, int width,
+			   Cost comparison_cost, int sort_mem,
+			   double limit_tuples)
+{
+	double		input_bytes = relation_byte_size(tuples, width);
+	double		output_bytes;
+	double		output_tuples;
+	long		sort_mem_bytes = sort_mem * 1024L;
+
+	*startup_cost = 0;
 
 	/*
 	 * We want to be sure the cost of a sort is never estimated as zero, even
@@ -1696,7 +1735,7 @@ cost_sort(Path *path, PlannerInfo *root,
 		 *
 		 * Assume about N log2 N comparisons
 		 */
-		startup_cost += comparison_cost * tuples * LOG2(tuples);
+		*startup_cost += comparison_cost * tuples * LOG2(tuples);
 
 		/* Disk costs */
 
@@ -1707,7 +1746,7 @@ cost_sort(Path *path, PlannerInfo *root,
 			log_runs = 1.0;
 		npageaccesses = 2.0 * npages * log_runs;
 		/* Assume 3/4ths of accesses are sequential, 1/4th are not */
-		startup_cost += npageaccesses *
+		*startup_cost += npageaccesses *
 			(seq_page_cost * 0.75 + random_page_cost * 0.25);
 	}
 	else if (tuples > 2 * output_tuples || input_bytes > sort_mem_bytes)
@@ -1718,12 +1757,12 @@ cost_sort(Path *path, PlannerInfo *root,
 		 * factor is a bit higher than for quicksort.  Tweak it so that the
 		 * cost curve is continuous at the crossover point.
 		 */
-		startup_cost += comparison_cost * tuples * LOG2(2.0 * output_tuples);
+		*startup_cost += comparison_cost * tuples * LOG2(2.0 * output_tuples);
 	}
 	else
 	{
 		/* We'll use plain quicksort on all the input tuples */
-		startup_cost += comparison_cost * tuples * LOG2(tuples);
+		*startup_cost += comparison_cost * tuples * LOG2(tuples);
 	}
 
 	/*
@@ -1734,12 +1773,272 @@ cost_sort(Path *path, PlannerInfo *root,
 	 * here --- the upper LIMIT will pro-rate the run cost so we'd be double
 	 * counting the LIMIT otherwise.
 	 */
-	run_cost += cpu_operator_cost * tuples;
+	*run_cost = cpu_operator_cost * tuples;
+}
+
+/*
+ * cost_incremental_sort
+ *	  Determines and returns the cost of an incremental sort, which sorts
+ *	  input that is already sorted on the first 'presorted_keys' of the
+ *	  pathkeys one batch of complete groups at a time.
+ *
+ * We estimate the number of groups of equal presorted keys with
+ * estimate_num_groups, and cost each batch as a separate sort of its share
+ * of the input.  Since tuples are returned as soon as the first batch has
+ * been sorted, only that batch and its share of the input contribute to
+ * the startup cost, which is what makes this attractive below a LIMIT.
+ *
+ * 'presorted_keys' is the number of leading pathkeys the input is sorted on
+ * 'input_startup_cost' and 'input_total_cost' are the input path's costs
+ * The other parameters are as for cost_sort.
+ */
+void
+cost_incremental_sort(Path *path, PlannerInfo *root,
+					  List *pathkeys, int presorted_keys,
+					  Cost input_startup_cost, Cost input_total_cost,
+					  double input_tuples, int width,
+					  Cost comparison_cost, int sort_mem,
+					  double limit_tuples)
+{
+	Cost		startup_cost;
+	Cost		run_cost;
+	Cost		batch_startup_cost;
+	Cost		batch_run_cost;
+	Cost		input_run_cost = input_total_cost - input_startup_cost;
+	List	   *presortedExprs = NIL;
+	ListCell   *l;
+	int			i = 0;
+	double		input_groups;
+	double		batch_tuples;
+	double		nbatches;
+
+	Assert(presorted_keys > 0 && presorted_keys < list_length(pathkeys));
+
+	path->rows = input_tuples;
+
+	/* Mustn't do log(0) in cost_tuplesort; also see cost_sort */
+	if (input_tuples < 2.0)
+		input_tuples = 2.0;
+
+	/* Estimate the number of groups of equal presorted keys */
+	foreach(l, pathkeys)
+	{
+		PathKey    *key = (PathKey *) lfirst(l);
+		EquivalenceMember *member = (EquivalenceMember *)
+		linitial(key->pk_eclass->ec_members);
+
+		presortedExprs = lappend(presortedExprs, member->em_expr);
+
+		if (++i >= presorted_keys)
+			break;
+	}
+	input_groups = estimate_num_groups(root, presortedExprs, input_tuples,
+									   NULL);
+
+	/*
+	 * Each batch holds at least INCSORT_MIN_BATCH_SIZE tuples, and at least
+	 * one complete group.  Group sizes are rarely uniform, so hedge against
+	 * the first group being bigger than average.
+	 */
+	batch_tuples = 1.5 * input_tuples / input_groups;
+	batch_tuples = Max(batch_tuples, INCSORT_MIN_BATCH_SIZE);
+	batch_tuples = Min(batch_tuples, input_tuples);
+	nbatches = ceil(input_tuples / batch_tuples);
+
+	cost_tuplesort(&batch_startup_cost, &batch_run_cost,
+				   batch_tuples, width, comparison_cost, sort_mem,
+				   limit_tuples);
+
+	/*
+	 * The first batch must be read and sorted before anything is returned.
+	 * Also charge a little (arbitrarily, a few tuples' worth) for setting
+	 * up each batch's sort.
+	 */
+	startup_cost = input_startup_cost +
+		input_run_cost * (batch_tuples / input_tuples) +
+		batch_startup_cost + 10.0 * cpu_tuple_cost;
+
+	/* The remaining batches, and fetching all the sorted tuples */
+	run_cost = input_run_cost * (1.0 - batch_tuples / input_tuples) +
+		(nbatches - 1) * (batch_startup_cost + 10.0 * cpu_tuple_cost) +
+		nbatches * batch_run_cost;
+
+	/* Checking for the end of each batch compares the presorted keys */
+	run_cost += cpu_operator_cost * presorted_keys * input_tuples;
+
+	if (!enable_incrementalsort)
+		startup_cost += disable_cost;
 
 	path->startup_cost = startup_cost;
 	path->total_cost = startup_cost + run_cost;
 }
 
+/*
+ * append_nonpartial_cost
+ *	  Estimate the cost of running the non-partial subpaths of a Parallel
+ *	  Append, which are the first 'numpaths' entries of 'subpaths', sorted
+ *	  by descending total cost.
+ *
+ * Each non-partial subpath is run to completion by a single participant.
+ * Assuming that the participants pick up the subpaths in order, each
+ * subpath goes to the participant that finishes its previous work first;
+ * we return the time at which the last of them is done.
+ */
+static Cost
+append_nonpartial_cost(List *subpaths, int numpaths, int parallel_workers)
+{
+	Cost	   *costarr;
+	int			arrlen;
+	ListCell   *l;
+	int			path_index;
+	int			min_index;
+	int			max_index;
+	int			i;
+
+	if (numpaths == 0)
+		return 0;
+
+	/*
+	 * Array length is number of workers or number of relevant paths,
+	 * whichever is less.
+	 */
+	arrlen = Min(parallel_workers, numpaths);
+	costarr = (Cost *) palloc(sizeof(Cost) * arrlen);
+
+	path_index = 0;
+	foreach(l, subpaths)
+	{
+		Path	   *subpath = (Path *) lfirst(l);
+
+		if (path_index == numpaths)
+			break;
+
+		if (path_index < arrlen)
+		{
+			/* The first few paths are each claimed by a different worker */
+			costarr[path_index] = subpath->total_cost;
+		}
+		else
+		{
+			/* Add the others to the worker that becomes free first */
+			min_index = 0;
+			for (i = 1; i < arrlen; i++)
+			{
+				if (costarr[i] < costarr[min_index])
+					min_index = i;
+			}
+			costarr[min_index] += subpath->total_cost;
+		}
+		path_index++;
+	}
+
+	/* Return the highest cost from the array */
+	max_index = 0;
+	for (i = 1; i < arrlen; i++)
+	{
+		if (costarr[i] > costarr[max_index])
+			max_index = i;
+	}
+
+	return costarr[max_index];
+}
+
+/*
+ * cost_append
+ *	  Determines and returns the cost of an Append node.
+ *
+ * A plain Append runs its subpaths one after another, so its rows and costs
+ * are the sums of theirs; we charge nothing extra for the Append itself,
+ * which perhaps is too optimistic, but since it doesn't do any selection or
+ * projection, it is a pretty cheap node.
+ *
+ * The participants of a Parallel Append share the partial subpaths, while
+ * each non-partial subpath is run by just one of them; see
+ * append_nonpartial_cost.
+ */
+void
+cost_append(AppendPath *apath)
+{
+	ListCell   *l;
+
+	apath->path.rows = 0;
+	apath->path.startup_cost = 0;
+	apath->path.total_cost = 0;
+
+	if (apath->subpaths == NIL)
+		return;
+
+	if (!apath->path.parallel_aware)
+	{
+		Path	   *subpath = (Path *) linitial(apath->subpaths);
+
+		/*
+		 * Startup cost of non-parallel-aware Append is the startup cost of
+		 * first subpath.
+		 */
+		apath->path.startup_cost = subpath->startup_cost;
+
+		/* Compute rows and costs as sums of subplan rows and costs. */
+		foreach(l, apath->subpaths)
+		{
+			subpath = (Path *) lfirst(l);
+
+			apath->path.rows += subpath->rows;
+			apath->path.total_cost += subpath->total_cost;
+		}
+	}
+	else						/* parallel-aware */
+	{
+		int			i = 0;
+		double		parallel_divisor = get_parallel_divisor(&apath->path);
+
+		foreach(l, apath->subpaths)
+		{
+			Path	   *subpath = (Path *) lfirst(l);
+
+			/*
+			 * Append will start returning tuples when the child node having
+			 * lowest startup cost is done setting up.  We consider only the
+			 * first few subplans that immediately get a worker assigned.
+			 */
+			if (i == 0)
+				apath->path.startup_cost = subpath->startup_cost;
+			else if (i < apath->path.parallel_workers)
+				apath->path.startup_cost = Min(apath->path.startup_cost,
+											   subpath->startup_cost);
+
+			/*
+			 * Each participant returns its share of the rows.  A partial
+			 * subpath's row count is already divided among the workers it
+			 * was planned for, so scale it to our own number of workers.
+			 * Partial subpaths' costs are per participant too, so they can
+			 * simply be added up; non-partial ones are handled below.
+			 */
+			if (i < apath->first_partial_path)
+				apath->path.rows += subpath->rows / parallel_divisor;
+			else
+			{
+				double		subpath_parallel_divisor;
+
+				subpath_parallel_divisor = get_parallel_divisor(subpath);
+				apath->path.rows += subpath->rows * (subpath_parallel_divisor /
+													 parallel_divisor);
+				apath->path.total_cost += subpath->total_cost;
+			}
+
+			apath->path.rows = clamp_row_est(apath->path.rows);
+
+			i++;
+		}
+
+		/* Add cost for non-partial subpaths. */
+		apath->path.total_cost +=
+			append_nonpartial_cost(apath->subpaths,
+								   apath->first_partial_path,
+								   apath->path.parallel_workers);
+	}
+}
+
 /*
  * cost_merge_append
  *	  Determines and returns the cost of a MergeAppend node.
@@ -1874,7 +2173,7 @@ cost_agg(Path *path, PlannerInfo *root,
 		 AggStrategy aggstrategy, const AggClauseCosts *aggcosts,
 		 int numGroupCols, double numGroups,
 		 Cost input_startup_cost, Cost input_total_cost,
-		 double input_tuples)
+		 double input_tuples, int input_width)
 {
 	double		output_tuples;
 	Cost		startup_cost;
@@ -1952,6 +2251,46 @@ cost_agg(Path *path, PlannerInfo *root,
 		total_cost += aggcosts->finalCost * numGroups;
 		total_cost += cpu_tuple_cost * numGroups;
 		output_tuples = numGroups;
+
+		/*
+		 * If the hash table is expected to exceed work_mem, the executor
+		 * will spill input tuples to disk and process them in later passes.
+		 * Charge for writing and reading back the input once per pass after
+		 * the first; each pass divides the remaining groups into up to
+		 * HASHAGG_MAX_PARTITIONS partitions.  Some of the input is always
+		 * aggregated in the first pass, but ignore that here.
+		 */
+		if (numGroups > 1)
+		{
+			double		hashentrysize;
+			double		hashtablesize;
+			double		mem_limit = work_mem * 1024.0;
+
+			hashentrysize = MAXALIGN(input_width) +
+				MAXALIGN(SizeofMinimalTupleHeader) +
+				aggcosts->transitionSpace +
+				hash_agg_entry_size(aggcosts->numAggs);
+			hashtablesize = hashentrysize * numGroups;
+
+			if (hashtablesize > mem_limit)
+			{
+				double		pages = page_size(input_tuples, input_width);
+				double		depth;
+
+				depth = ceil(log(hashtablesize / mem_limit) /
+							 log(HASHAGG_MAX_PARTITIONS));
+				depth = Max(depth, 1.0);
+
+				/* pages are written and read sequentially */
+				startup_cost += 2.0 * seq_page_cost * pages * depth;
+				/* and each spilled tuple must be looked up again */
+				startup_cost += (cpu_operator_cost * numGroupCols) *
+					input_tuples * depth;
+				total_cost = startup_cost;
+				total_cost += aggcosts->finalCost * numGroups;
+				total_cost += cpu_tuple_cost * numGroups;
+			}
+		}
 	}
 
 	path->rows = output_tuples;
@@ -2915,18 +3254,22 @@ cached_scansel(PlannerInfo *root, RestrictInfo *rinfo, PathKey *pathkey)
  * 'outer_path' is the outer input to the join
  * 'inner_path' is the inner input to the join
  * 'extra' contains miscellaneous information about the join
+ * 'parallel_hash' indicates that inner_path is partial and that a shared hash
+ *		table will be built from it by all participants
  */
 void
 initial_cost_hashjoin(PlannerInfo *root, JoinCostWorkspace *workspace,
 					  JoinType jointype,
 					  List *hashclauses,
 					  Path *outer_path, Path *inner_path,
-					  JoinPathExtraData *extra)
+					  JoinPathExtraData *extra,
+					  bool parallel_hash)
 {
 	Cost		startup_cost = 0;
 	Cost		run_cost = 0;
 	double		outer_path_rows = outer_path->rows;
 	double		inner_path_rows = inner_path->rows;
+	double		inner_path_rows_total = inner_path_rows;
 	int			num_hashclauses = list_length(hashclauses);
 	int			numbuckets;
 	int			numbatches;
@@ -2960,10 +3303,21 @@ initial_cost_hashjoin(PlannerInfo *root, JoinCostWorkspace *workspace,
 	 *
 	 * XXX at some point it might be interesting to try to account for skew
 	 * optimization in the cost estimate, but for now, we don't.
+	 *
+	 * A shared hash table is built from the whole of the partial inner
+	 * relation, while each participant only hashes its own share of it
+	 * above.  The executor doesn't use skew buckets for a shared table.  It
+	 * lets the table use the work_mem of the leader and of every worker that
+	 * was launched, but we can't count on any workers being available at
+	 * execution time, so we only count on the leader's work_mem here.
 	 */
-	ExecChooseHashTableSize(inner_path_rows,
+	if (parallel_hash)
+		inner_path_rows_total = inner_path_rows *
+			get_parallel_divisor(inner_path);
+	ExecChooseHashTableSize(inner_path_rows_total,
 							inner_path->pathtarget->width,
-							true,	/* useskew */
+							!parallel_hash, /* useskew */
+							0,	/* parallel_workers */
 							&numbuckets,
 							&numbatches,
 							&num_skew_mcvs);
@@ -2995,6 +3349,7 @@ initial_cost_hashjoin(PlannerInfo *root, JoinCostWorkspace *workspace,
 	workspace->run_cost = run_cost;
 	workspace->numbuckets = numbuckets;
 	workspace->numbatches = numbatches;
+	workspace->inner_rows_total = inner_path_rows_total;
 }
 
 /*
@@ -3016,7 +3371,7 @@ final_cost_hashjoin(PlannerInfo *root, HashPath *path,
 	Path	   *outer_path = path->jpath.outerjoinpath;
 	Path	   *inner_path = path->jpath.innerjoinpath;
 	double		outer_path_rows = outer_path->rows;
-	double		inner_path_rows = inner_path->rows;
+	double		inner_path_rows = workspace->inner_rows_total;
 	List	   *hashclauses = path->path_hashclauses;
 	Cost		startup_cost = workspace->startup_cost;
 	Cost		run_cost = workspace->run_cost;
@@ -3338,6 +3693,78 @@ cost_subplan(PlannerInfo *root, SubPlan *subplan, Plan *plan)
 }
 
 
+/*
+ * cost_resultcache_rescan
+ *		Estimate the cost of rescanning a ResultCache path.
+ *
+ * Each rescan either finds the current parameter values in the cache, and
+ * returns the cached tuples cheaply, or runs the subpath.  We estimate the
+ * fraction of hits from the number of distinct parameter values expected
+ * over all the calls, and the number of entries that fit in work_mem; once
+ * the cache is full, we assume that a proportional fraction of lookups
+ * miss because their entry was evicted.
+ */
+static void
+cost_resultcache_rescan(PlannerInfo *root, ResultCachePath *rcpath,
+						Cost *rescan_startup_cost, Cost *rescan_total_cost)
+{
+	Path	   *subpath = rcpath->subpath;
+	double		tuples = rcpath->path.rows;
+	double		calls = rcpath->calls;
+	double		ndistinct;
+	double		est_entry_bytes;
+	double		est_cache_entries;
+	double		hit_ratio;
+	long		work_mem_bytes = work_mem * 1024L;
+	ListCell   *lc;
+
+	ndistinct = estimate_num_groups(root, rcpath->param_exprs, calls, NULL);
+
+	/*
+	 * estimate_num_groups() falls back on a default for keys it knows
+	 * nothing about, which would make us expect hits that may never happen.
+	 * Assume the values are all distinct if we can't tell.
+	 */
+	foreach(lc, rcpath->param_exprs)
+	{
+		VariableStatData vardata;
+		bool		isdefault;
+
+		examine_variable(root, (Node *) lfirst(lc), 0, &vardata);
+		(void) get_variable_numdistinct(&vardata, &isdefault);
+		ReleaseVariableStats(vardata);
+
+		if (isdefault)
+		{
+			ndistinct = calls;
+			break;
+		}
+	}
+	ndistinct = clamp_row_est(Min(ndistinct, calls));
+
+	/* Each entry holds the key plus the tuples for it */
+	est_entry_bytes = relation_byte_size(tuples, subpath->pathtarget->width) +
+		MAXALIGN(SizeofMinimalTupleHeader) * 2;
+	est_cache_entries = floor(work_mem_bytes / est_entry_bytes);
+
+	/*
+	 * The first call for each distinct value is a miss.  Of the others, only
+	 * those whose entry is still in the cache are hits.
+	 */
+	hit_ratio = ((calls - ndistinct) / calls) *
+		(Min(est_cache_entries, ndistinct) / ndistinct);
+	hit_ratio = Max(hit_ratio, 0.0);
+
+	/*
+	 * Misses cost a scan of the subpath; hits cost only returning the
+	 * cached tuples.  Charge cpu_tuple_cost for the lookup either way.
+	 */
+	*rescan_startup_cost = subpath->startup_cost * (1.0 - hit_ratio) +
+		cpu_tuple_cost;
+	*rescan_total_cost = subpath->total_cost * (1.0 - hit_ratio) +
+		cpu_operator_cost * tuples * hit_ratio + cpu_tuple_cost;
+}
+
 /*
  * cost_rescan
  *		Given a finished Path, estimate the costs of rescanning it after
@@ -3442,6 +3869,10 @@ cost_rescan(PlannerInfo *root, Path *path,
 				*rescan_total_cost = run_cost;
 			}
 			break;
+		case T_ResultCache:
+			cost_resultcache_rescan(root, (ResultCachePath *) path,
+									rescan_startup_cost, rescan_total_cost);
+			break;
 		default:
 			*rescan_startup_cost = path->startup_cost;
 			*rescan_total_cost = path->total_cost;
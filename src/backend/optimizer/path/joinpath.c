@@ -18,10 +18,13 @@
 
 #include "executor/executor.h"
 #include "foreign/fdwapi.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/planmain.h"
+#include "utils/lsyscache.h"
 
 /* Hook for plugins to get control in add_paths_to_joinrel() */
 set_join_pathlist_hook_type set_join_pathlist_hook = NULL;
@@ -329,6 +332,129 @@ allow_star_schema_join(PlannerInfo *root,
 			bms_nonempty_difference(inner_paramrels, outerrelids));
 }
 
+/*
+ * get_resultcache_path
+ *	  If possible, make a ResultCache path to cache the results of
+ *	  'inner_path' across the rescans of a nestloop with 'outer_path' on
+ *	  the outside.  Returns NULL if that's not possible or not useful.
+ *
+ * The cache key consists of the outer-side expressions of the join clauses
+ * that were pushed down into the inner path, which must be all the inner
+ * path depends on.  So we insist on a base relation on the inside, one
+ * whose parameters come only from the outer rel, through simple operator
+ * clauses that are hashjoinable.  The cache hashes and compares outer-side
+ * values with each other, so we use the same-type equality operator from
+ * the hash opfamily of the clause's own operator, never the type's default.
+ */
+static Path *
+get_resultcache_path(PlannerInfo *root, RelOptInfo *innerrel,
+					 RelOptInfo *outerrel, Path *inner_path,
+					 Path *outer_path, JoinType jointype,
+					 JoinPathExtraData *extra)
+{
+	List	   *param_exprs = NIL;
+	List	   *hash_operators = NIL;
+	List	   *ppi_clauses;
+	ListCell   *lc;
+
+	if (!enable_resultcache)
+		return NULL;
+
+	/* A cache is pointless unless we expect to rescan the inner side */
+	if (outer_path->parent->rows < 2)
+		return NULL;
+
+	if (inner_path->param_info == NULL ||
+		innerrel->reloptkind != RELOPT_BASEREL ||
+		!bms_is_empty(innerrel->lateral_relids) ||
+		!bms_is_subset(PATH_REQ_OUTER(inner_path), outerrel->relids))
+		return NULL;
+
+	/*
+	 * A semi or anti join stops reading the inner side after the first
+	 * match, which would leave the cache entry incomplete.  We only allow
+	 * that when the inner side is proven unique; see below.
+	 */
+	if ((jointype == JOIN_SEMI || jointype == JOIN_ANTI) &&
+		!extra->inner_unique)
+		return NULL;
+
+	ppi_clauses = inner_path->param_info->ppi_clauses;
+
+	/*
+	 * If the inner side is unique, the nestloop stops reading it after the
+	 * first match, so a cache entry is only complete if every join clause
+	 * is checked by the inner path itself.
+	 */
+	if (extra->inner_unique)
+	{
+		foreach(lc, extra->restrictlist)
+		{
+			if (!list_member_ptr(ppi_clauses, lfirst(lc)))
+				return NULL;
+		}
+	}
+
+	foreach(lc, ppi_clauses)
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) lfirst(lc);
+		OpExpr	   *opexpr = (OpExpr *) rinfo->clause;
+		Node	   *expr;
+		Oid			left_eq_opr;
+		Oid			right_eq_opr;
+		Oid			eq_opr;
+		bool		outer_is_left;
+
+		if (!IsA(opexpr, OpExpr) || list_length(opexpr->args) != 2 ||
+			contain_volatile_functions((Node *) opexpr))
+			return NULL;
+
+		if (bms_is_subset(rinfo->left_relids, outerrel->relids) &&
+			bms_is_subset(rinfo->right_relids, innerrel->relids))
+		{
+			expr = (Node *) linitial(opexpr->args);
+			outer_is_left = true;
+		}
+		else if (bms_is_subset(rinfo->right_relids, outerrel->relids) &&
+				 bms_is_subset(rinfo->left_relids, innerrel->relids))
+		{
+			expr = (Node *) lsecond(opexpr->args);
+			outer_is_left = false;
+		}
+		else
+			return NULL;
+
+		if (!op_hashjoinable(opexpr->opno, exprType(expr)) ||
+			!get_compatible_hash_operators(opexpr->opno,
+										   &left_eq_opr, &right_eq_opr))
+			return NULL;
+
+		eq_opr = outer_is_left ? left_eq_opr : right_eq_opr;
+		if (!OidIsValid(eq_opr))
+			return NULL;
+
+		param_exprs = lappend(param_exprs, expr);
+		hash_operators = lappend_oid(hash_operators, eq_opr);
+	}
+
+	if (param_exprs == NIL)
+		return NULL;
+
+	/*
+	 * If the outer rel is known to produce each key at most once, every
+	 * lookup would miss.
+	 */
+	if (outerrel->reloptkind == RELOPT_BASEREL &&
+		relation_has_unique_index_for(root, outerrel, NIL,
+									  param_exprs, hash_operators))
+		return NULL;
+
+	return (Path *) create_resultcache_path(root, innerrel, inner_path,
+											param_exprs, hash_operators,
+											extra->inner_unique,
+											outer_path->parent->rows);
+}
+
 /*
  * try_nestloop_path
  *	  Consider a nestloop join path; if it appears useful, push it into
@@ -661,7 +787,7 @@ try_hashjoin_path(PlannerInfo *root,
 	 * never have any output pathkeys, per comments in create_hashjoin_path.
 	 */
 	initial_cost_hashjoin(root, &workspace, jointype, hashclauses,
-						  outer_path, inner_path, extra);
+						  outer_path, inner_path, extra, false);
 
 	if (add_path_precheck(joinrel,
 						  workspace.startup_cost, workspace.total_cost,
@@ -677,7 +803,8 @@ try_hashjoin_path(PlannerInfo *root,
 									  inner_path,
 									  extra->restrictlist,
 									  required_outer,
-									  hashclauses));
+									  hashclauses,
+									  false));
 	}
 	else
 	{
@@ -690,6 +817,9 @@ try_hashjoin_path(PlannerInfo *root,
  * try_partial_hashjoin_path
  *	  Consider a partial hashjoin join path; if it appears useful, push it into
  *	  the joinrel's partial_pathlist via add_partial_path().
+ *
+ * If parallel_hash is true, inner_path is partial too, and all participants
+ * will cooperate in building one shared hash table from it.
  */
 static void
 try_partial_hashjoin_path(PlannerInfo *root,
@@ -698,7 +828,8 @@ try_partial_hashjoin_path(PlannerInfo *root,
 						  Path *inner_path,
 						  List *hashclauses,
 						  JoinType jointype,
-						  JoinPathExtraData *extra)
+						  JoinPathExtraData *extra,
+						  bool parallel_hash)
 {
 	JoinCostWorkspace workspace;
 
@@ -722,10 +853,17 @@ try_partial_hashjoin_path(PlannerInfo *root,
 	 * cost.  Bail out right away if it looks terrible.
 	 */
 	initial_cost_hashjoin(root, &workspace, jointype, hashclauses,
-						  outer_path, inner_path, extra);
+						  outer_path, inner_path, extra, parallel_hash);
 	if (!add_partial_path_precheck(joinrel, workspace.total_cost, NIL))
 		return;
 
+	/*
+	 * A shared hash table can't be split into batches, so don't try one if
+	 * the inner relation isn't expected to fit in memory.
+	 */
+	if (parallel_hash && workspace.numbatches > 1)
+		return;
+
 	/* Might be good enough to be worth trying, so let's try it. */
 	add_partial_path(joinrel, (Path *)
 					 create_hashjoin_path(root,
@@ -737,7 +875,8 @@ try_partial_hashjoin_path(PlannerInfo *root,
 										  inner_path,
 										  extra->restrictlist,
 										  NULL,
-										  hashclauses));
+										  hashclauses,
+										  parallel_hash));
 }
 
 /*
@@ -1378,6 +1517,7 @@ match_unsorted_outer(PlannerInfo *root,
 			foreach(lc2, innerrel->cheapest_parameterized_paths)
 			{
 				Path	   *innerpath = (Path *) lfirst(lc2);
+				Path	   *rcpath;
 
 				try_nestloop_path(root,
 								  joinrel,
@@ -1386,6 +1526,19 @@ match_unsorted_outer(PlannerInfo *root,
 								  merge_pathkeys,
 								  jointype,
 								  extra);
+
+				/* Also try caching the inner path's results across rescans */
+				rcpath = get_resultcache_path(root, innerrel, outerrel,
+											  innerpath, outerpath, jointype,
+											  extra);
+				if (rcpath != NULL)
+					try_nestloop_path(root,
+									  joinrel,
+									  outerpath,
+									  rcpath,
+									  merge_pathkeys,
+									  jointype,
+									  extra);
 			}
 
 			/* Also consider materialized form of the cheapest inner path */
@@ -1541,6 +1694,7 @@ consider_parallel_nestloop(PlannerInfo *root,
 		foreach(lc2, innerrel->cheapest_parameterized_paths)
 		{
 			Path	   *innerpath = (Path *) lfirst(lc2);
+			Path	   *rcpath;
 
 			/* Can't join to an inner path that is not parallel-safe */
 			if (!innerpath->parallel_safe)
@@ -1565,6 +1719,14 @@ consider_parallel_nestloop(PlannerInfo *root,
 
 			try_partial_nestloop_path(root, joinrel, outerpath, innerpath,
 									  pathkeys, jointype, extra);
+
+			/* Also try caching the inner path's results across rescans */
+			rcpath = get_resultcache_path(root, innerrel, outerrel,
+										  innerpath, outerpath, jointype,
+										  extra);
+			if (rcpath != NULL)
+				try_partial_nestloop_path(root, joinrel, outerpath, rcpath,
+										  pathkeys, jointype, extra);
 		}
 	}
 }
@@ -1784,7 +1946,23 @@ hash_inner_and_outer(PlannerInfo *root,
 				try_partial_hashjoin_path(root, joinrel,
 										  cheapest_partial_outer,
 										  cheapest_safe_inner,
-										  hashclauses, jointype, extra);
+										  hashclauses, jointype, extra,
+										  false);
+
+			/*
+			 * We can also try building one hash table shared by all
+			 * participants from a partial inner path, instead of having each
+			 * of them build a complete copy.  That's not possible for
+			 * JOIN_UNIQUE_INNER, since a partial path can't be unique-ified.
+			 */
+			if (enable_parallel_hash &&
+				save_jointype != JOIN_UNIQUE_INNER &&
+				innerrel->partial_pathlist != NIL)
+				try_partial_hashjoin_path(root, joinrel,
+										  cheapest_partial_outer,
+										  (Path *) linitial(innerrel->partial_pathlist),
+										  hashclauses, jointype, extra,
+										  true);
 		}
 	}
 }
@@ -14,9 +14,13 @@
  */
 #include "postgres.h"
 
+#include "catalog/partition.h"
+#include "optimizer/clauses.h"
+#include "optimizer/cost.h"
 #include "optimizer/joininfo.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
+#include "optimizer/prep.h"
 #include "utils/memutils.h"
 
 
@@ -32,6 +36,13 @@ static bool is_dummy_rel(RelOptInfo *rel);
 static void mark_dummy_rel(RelOptInfo *rel);
 static bool restriction_is_constant_false(List *restrictlist,
 							  bool only_pushed_down);
+static void try_partitionwise_join(PlannerInfo *root, RelOptInfo *rel1,
+					   RelOptInfo *rel2, RelOptInfo *joinrel,
+					   SpecialJoinInfo *parent_sjinfo,
+					   List *parent_restrictlist);
+static bool have_partkey_equi_join(RelOptInfo *rel1, RelOptInfo *rel2,
+					   List *restrictlist);
+static int	match_expr_to_partition_keys(Expr *expr, RelOptInfo *rel);
 static void populate_joinrel_with_paths(PlannerInfo *root, RelOptInfo *rel1,
 							RelOptInfo *rel2, RelOptInfo *joinrel,
 							SpecialJoinInfo *sjinfo, List *restrictlist);
@@ -731,6 +742,9 @@ make_join_rel(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2)
 	populate_joinrel_with_paths(root, rel1, rel2, joinrel, sjinfo,
 								restrictlist);
 
+	/* Consider joining the matching partitions of partitioned tables. */
+	try_partitionwise_join(root, rel1, rel2, joinrel, sjinfo, restrictlist);
+
 	bms_free(joinrelids);
 
 	return joinrel;
@@ -1173,6 +1187,246 @@ have_dangerous_phv(PlannerInfo *root,
 }
 
 
+/*
+ * try_partitionwise_join
+ *	  Build the joins between the matching partitions of two partitioned
+ *	  relations ("child joins"), if the join can be done partition-wise.
+ *
+ * That's the case when both relations are partitioned the same way, with
+ * identical partition bounds, and there is an equi-join condition between
+ * every pair of partition key columns: then a row of one partition can only
+ * join with rows of the matching partition of the other relation, so the
+ * join is the union of the joins between matching partitions.  These are
+ * much smaller, and may each be executed with a different plan.
+ *
+ * The child joins are saved in joinrel->part_rels, and paths are added to
+ * them for this pair of input relations.  The Append paths for the parent
+ * join are built by generate_partitionwise_join_paths, once all pairs have
+ * been considered.
+ *
+ * Only inner joins are handled for now.  Also, child joins only get
+ * unparameterized paths, so we don't try this for joins that would need to
+ * pass down lateral references or compute PlaceHolderVars.
+ */
+static void
+try_partitionwise_join(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2,
+					   RelOptInfo *joinrel, SpecialJoinInfo *parent_sjinfo,
+					   List *parent_restrictlist)
+{
+	PartitionScheme part_scheme = rel1->part_scheme;
+	int			nparts;
+	int			cnt_parts;
+
+	if (!enable_partitionwise_join)
+		return;
+
+	if (parent_sjinfo->jointype != JOIN_INNER || is_dummy_rel(joinrel))
+		return;
+
+	/* Both sides must be partitioned the same way, with the same bounds */
+	if (part_scheme == NULL || rel2->part_scheme != part_scheme ||
+		rel1->nparts != rel2->nparts ||
+		!partition_bounds_equal(part_scheme->partnatts,
+								part_scheme->parttyplen,
+								part_scheme->parttypbyval,
+								rel1->boundinfo, rel2->boundinfo))
+		return;
+
+	if (root->placeholder_list != NIL ||
+		rel1->lateral_relids != NULL || rel2->lateral_relids != NULL)
+		return;
+
+	if (!have_partkey_equi_join(rel1, rel2, parent_restrictlist))
+		return;
+
+	nparts = rel1->nparts;
+
+	/*
+	 * The first pair of input relations found to qualify determines the
+	 * partitioning of the join.  Any pair that qualifies partitions it the
+	 * same way, since the same base relations are joined.
+	 */
+	if (joinrel->part_scheme == NULL)
+	{
+		int			partnatts = part_scheme->partnatts;
+		int			cnt;
+
+		joinrel->part_scheme = part_scheme;
+		joinrel->nparts = nparts;
+		joinrel->boundinfo = rel1->boundinfo;
+		joinrel->part_rels =
+			(RelOptInfo **) palloc0(sizeof(RelOptInfo *) * nparts);
+
+		/*
+		 * After an inner join, a partition key column is equal to the
+		 * partition key expressions of both sides.
+		 */
+		joinrel->partexprs = (List **) palloc0(sizeof(List *) * partnatts);
+		for (cnt = 0; cnt < partnatts; cnt++)
+			joinrel->partexprs[cnt] = list_concat(list_copy(rel1->partexprs[cnt]),
+												  list_copy(rel2->partexprs[cnt]));
+	}
+	else if (joinrel->part_scheme != part_scheme ||
+			 joinrel->nparts != nparts ||
+			 !partition_bounds_equal(part_scheme->partnatts,
+									 part_scheme->parttyplen,
+									 part_scheme->parttypbyval,
+									 joinrel->boundinfo, rel1->boundinfo))
+		return;
+
+	for (cnt_parts = 0; cnt_parts < nparts; cnt_parts++)
+	{
+		RelOptInfo *child_rel1 = rel1->part_rels[cnt_parts];
+		RelOptInfo *child_rel2 = rel2->part_rels[cnt_parts];
+		RelOptInfo *child_joinrel;
+		SpecialJoinInfo *child_sjinfo;
+		List	   *child_restrictlist;
+		AppendRelInfo **appinfos;
+		int			nappinfos;
+
+		Assert(child_rel1 != NULL && child_rel2 != NULL);
+
+		/* Translate the join clauses to refer to the children */
+		appinfos = find_appinfos_by_relids(root,
+										   bms_union(child_rel1->relids,
+													 child_rel2->relids),
+										   &nappinfos);
+		child_restrictlist = (List *)
+			adjust_appendrel_attrs(root, (Node *) parent_restrictlist,
+								   nappinfos, appinfos);
+		pfree(appinfos);
+
+		/* A plain inner join's SpecialJoinInfo just names the two sides */
+		child_sjinfo = makeNode(SpecialJoinInfo);
+		memcpy(child_sjinfo, parent_sjinfo, sizeof(SpecialJoinInfo));
+		child_sjinfo->min_lefthand = child_rel1->relids;
+		child_sjinfo->min_righthand = child_rel2->relids;
+		child_sjinfo->syn_lefthand = child_rel1->relids;
+		child_sjinfo->syn_righthand = child_rel2->relids;
+
+		child_joinrel = joinrel->part_rels[cnt_parts];
+		if (child_joinrel == NULL)
+		{
+			child_joinrel = build_child_join_rel(root, child_rel1, child_rel2,
+												 joinrel, child_restrictlist,
+												 child_sjinfo);
+			joinrel->part_rels[cnt_parts] = child_joinrel;
+		}
+
+		populate_joinrel_with_paths(root, child_rel1, child_rel2,
+									child_joinrel, child_sjinfo,
+									child_restrictlist);
+	}
+}
+
+/*
+ * have_partkey_equi_join
+ *	  Does the join between rel1 and rel2 have an equi-join condition
+ *	  between each pair of their partition key columns?
+ *
+ * The equality operator must belong to the partitioning operator family, so
+ * that values it considers equal are placed in matching partitions.
+ */
+static bool
+have_partkey_equi_join(RelOptInfo *rel1, RelOptInfo *rel2, List *restrictlist)
+{
+	PartitionScheme part_scheme = rel1->part_scheme;
+	bool		pk_has_clause[PARTITION_MAX_KEYS];
+	ListCell   *lc;
+	int			cnt_pks;
+
+	memset(pk_has_clause, 0, sizeof(pk_has_clause));
+	foreach(lc, restrictlist)
+	{
+		RestrictInfo *rinfo = lfirst_node(RestrictInfo, lc);
+		OpExpr	   *opexpr;
+		Expr	   *expr1;
+		Expr	   *expr2;
+		int			ipk1;
+		int			ipk2;
+
+		/* Skip clauses which can not be used for a join. */
+		if (!rinfo->can_join)
+			continue;
+
+		/* Skip clauses which are not mergejoinable equalities. */
+		if (rinfo->mergeopfamilies == NIL)
+			continue;
+
+		opexpr = (OpExpr *) rinfo->clause;
+		Assert(is_opclause(opexpr));
+
+		/* Match the operands to the relations. */
+		if (bms_is_subset(rinfo->left_relids, rel1->relids) &&
+			bms_is_subset(rinfo->right_relids, rel2->relids))
+		{
+			expr1 = linitial(opexpr->args);
+			expr2 = lsecond(opexpr->args);
+		}
+		else if (bms_is_subset(rinfo->left_relids, rel2->relids) &&
+				 bms_is_subset(rinfo->right_relids, rel1->relids))
+		{
+			expr1 = lsecond(opexpr->args);
+			expr2 = linitial(opexpr->args);
+		}
+		else
+			continue;
+
+		ipk1 = match_expr_to_partition_keys(expr1, rel1);
+		if (ipk1 < 0)
+			continue;
+		ipk2 = match_expr_to_partition_keys(expr2, rel2);
+		if (ipk2 != ipk1)
+			continue;
+
+		if (!list_member_oid(rinfo->mergeopfamilies,
+							 part_scheme->partopfamily[ipk1]))
+			continue;
+
+		pk_has_clause[ipk1] = true;
+	}
+
+	for (cnt_pks = 0; cnt_pks < part_scheme->partnatts; cnt_pks++)
+	{
+		if (!pk_has_clause[cnt_pks])
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * match_expr_to_partition_keys
+ *	  Find the partition key column that the given expression is equal to,
+ *	  returning its index, or -1 if none.
+ */
+static int
+match_expr_to_partition_keys(Expr *expr, RelOptInfo *rel)
+{
+	int			cnt;
+
+	/* This function should be called only for partitioned relations. */
+	Assert(rel->part_scheme != NULL);
+
+	/* Remove any relabel decorations. */
+	while (IsA(expr, RelabelType))
+		expr = (Expr *) (castNode(RelabelType, expr))->arg;
+
+	for (cnt = 0; cnt < rel->part_scheme->partnatts; cnt++)
+	{
+		ListCell   *lc;
+
+		foreach(lc, rel->partexprs[cnt])
+		{
+			if (equal(lfirst(lc), expr))
+				return cnt;
+		}
+	}
+
+	return -1;
+}
+
+
 /*
  * is_dummy_rel --- has relation been proven empty?
  */
@@ -1217,7 +1471,8 @@ mark_dummy_rel(RelOptInfo *rel)
 	rel->partial_pathlist = NIL;
 
 	/* Set up the dummy path */
-	add_path(rel, (Path *) create_append_path(rel, NIL, NULL, 0, NIL));
+	add_path(rel, (Path *) create_append_path(rel, NIL, NIL, NULL,
+											  0, false, NIL));
 
 	/* Set or update cheapest_total_path and related fields */
 	set_cheapest(rel);
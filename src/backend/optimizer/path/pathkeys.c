@@ -22,6 +22,7 @@
 #include "nodes/nodeFuncs.h"
 #include "nodes/plannodes.h"
 #include "optimizer/clauses.h"
+#include "optimizer/cost.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "optimizer/tlist.h"
@@ -327,6 +328,37 @@ pathkeys_contained_in(List *keys1, List *keys2)
 	return false;
 }
 
+/*
+ * pathkeys_count_contained_in
+ *	  Like pathkeys_contained_in, but also report in *n_common the length of
+ *	  the longest leading part of keys1 that keys2 begins with.
+ *
+ * If the result is false, keys2 (typically an input path's pathkeys) can
+ * still be used by an incremental sort to produce keys1, provided that
+ * *n_common > 0.
+ */
+bool
+pathkeys_count_contained_in(List *keys1, List *keys2, int *n_common)
+{
+	int			n = 0;
+	ListCell   *key1,
+			   *key2;
+
+	/* As in compare_pathkeys, pathkeys are canonical, so compare pointers */
+	forboth(key1, keys1, key2, keys2)
+	{
+		if (lfirst(key1) != lfirst(key2))
+		{
+			*n_common = n;
+			return false;
+		}
+		n++;
+	}
+
+	*n_common = n;
+	return (key1 == NULL);
+}
+
 /*
  * get_cheapest_path_for_pathkeys
  *	  Find the cheapest path (according to the specified criterion) that
@@ -1488,25 +1520,33 @@ right_merge_direction(PlannerInfo *root, PathKey *pathkey)
  *		Count the number of pathkeys that are useful for meeting the
  *		query's requested output ordering.
  *
- * Unlike merge pathkeys, this is an all-or-nothing affair: it does us
- * no good to order by just the first key(s) of the requested ordering.
- * So the result is always either 0 or list_length(root->query_pathkeys).
+ * A path that is sorted on only the first key(s) of the requested ordering
+ * is useful too, as the input of an incremental sort, so we return the
+ * length of the common leading part.  If incremental sort is disabled,
+ * though, this is an all-or-nothing affair, and the result is always either
+ * 0 or list_length(root->query_pathkeys).
  */
 static int
 pathkeys_useful_for_ordering(PlannerInfo *root, List *pathkeys)
 {
+	int			n_common;
+
 	if (root->query_pathkeys == NIL)
 		return 0;				/* no special ordering requested */
 
 	if (pathkeys == NIL)
 		return 0;				/* unordered path */
 
-	if (pathkeys_contained_in(root->query_pathkeys, pathkeys))
+	if (pathkeys_count_contained_in(root->query_pathkeys, pathkeys,
+									&n_common))
 	{
 		/* It's useful ... or at least the first N keys are */
 		return list_length(root->query_pathkeys);
 	}
 
+	if (enable_incrementalsort)
+		return n_common;
+
 	return 0;					/* path ordering not useful */
 }
 
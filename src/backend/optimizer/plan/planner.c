@@ -133,11 +133,21 @@ static double get_number_of_groups(PlannerInfo *root,
 static Size estimate_hashagg_tablesize(Path *path,
 						   const AggClauseCosts *agg_costs,
 						   double dNumGroups);
+static bool hashagg_memory_ok(Path *path, const AggClauseCosts *agg_costs,
+				  double dNumGroups);
 static RelOptInfo *create_grouping_paths(PlannerInfo *root,
 					  RelOptInfo *input_rel,
 					  PathTarget *target,
 					  const AggClauseCosts *agg_costs,
 					  grouping_sets_data *gd);
+static void create_partitionwise_grouping_paths(PlannerInfo *root,
+									RelOptInfo *input_rel,
+									RelOptInfo *grouped_rel,
+									PathTarget *target,
+									const AggClauseCosts *agg_costs,
+									double dNumGroups);
+static bool group_by_has_partkey(RelOptInfo *input_rel, List *targetList,
+					 List *groupClause);
 static void consider_groupingsets_paths(PlannerInfo *root,
 							RelOptInfo *grouped_rel,
 							Path *path,
@@ -3482,6 +3492,26 @@ estimate_hashagg_tablesize(Path *path, const AggClauseCosts *agg_costs,
 	return hashentrysize * dNumGroups;
 }
 
+/*
+ * hashagg_memory_ok
+ *	  may we use a hash aggregate, as far as its memory use is concerned?
+ *
+ * A hashed Agg spills to disk once its hashtable outgrows work_mem, but it
+ * only keeps track of the fixed-size part of each group, not of pass-by-ref
+ * transition values.  If there are any of those, the table must be expected
+ * to fit in work_mem, as it had to be before hashed Aggs could spill.
+ */
+static bool
+hashagg_memory_ok(Path *path, const AggClauseCosts *agg_costs,
+				  double dNumGroups)
+{
+	if (agg_costs->transitionSpace == 0)
+		return true;
+
+	return estimate_hashagg_tablesize(path, agg_costs, dNumGroups) <
+		work_mem * 1024L;
+}
+
 /*
  * create_grouping_paths
  *
@@ -3515,7 +3545,6 @@ create_grouping_paths(PlannerInfo *root,
 	PathTarget *partial_grouping_target = NULL;
 	AggClauseCosts agg_partial_costs;	/* parallel only */
 	AggClauseCosts agg_final_costs; /* parallel only */
-	Size		hashaggtablesize;
 	double		dNumGroups;
 	double		dNumPartialGroups = 0;
 	bool		can_hash;
@@ -3589,8 +3618,10 @@ create_grouping_paths(PlannerInfo *root,
 			path = (Path *)
 				create_append_path(grouped_rel,
 								   paths,
+								   NIL,
 								   NULL,
 								   0,
+								   false,
 								   NIL);
 			path->pathtarget = target;
 		}
@@ -3794,34 +3825,29 @@ create_grouping_paths(PlannerInfo *root,
 			}
 		}
 
-		if (can_hash)
+		if (can_hash &&
+			hashagg_memory_ok(cheapest_partial_path, &agg_partial_costs,
+							  dNumPartialGroups))
 		{
 			/* Checked above */
 			Assert(parse->hasAggs || parse->groupClause);
 
-			hashaggtablesize =
-				estimate_hashagg_tablesize(cheapest_partial_path,
-										   &agg_partial_costs,
-										   dNumPartialGroups);
-
 			/*
-			 * Tentatively produce a partial HashAgg Path, depending on if it
-			 * looks as if the hash table will fit in work_mem.
+			 * Tentatively produce a partial HashAgg Path.  If the hash table
+			 * won't fit in work_mem, it will spill to disk, which cost_agg
+			 * accounts for.
 			 */
-			if (hashaggtablesize < work_mem * 1024L)
-			{
-				add_partial_path(grouped_rel, (Path *)
-								 create_agg_path(root,
-												 grouped_rel,
-												 cheapest_partial_path,
-												 partial_grouping_target,
-												 AGG_HASHED,
-												 AGGSPLIT_INITIAL_SERIAL,
-												 parse->groupClause,
-												 NIL,
-												 &agg_partial_costs,
-												 dNumPartialGroups));
-			}
+			add_partial_path(grouped_rel, (Path *)
+							 create_agg_path(root,
+											 grouped_rel,
+											 cheapest_partial_path,
+											 partial_grouping_target,
+											 AGG_HASHED,
+											 AGGSPLIT_INITIAL_SERIAL,
+											 parse->groupClause,
+											 NIL,
+											 &agg_partial_costs,
+											 dNumPartialGroups));
 		}
 	}
 
@@ -4024,77 +4050,68 @@ create_grouping_paths(PlannerInfo *root,
 										cheapest_path, false, true, target,
 										gd, agg_costs, dNumGroups);
 		}
-		else
+		else if (hashagg_memory_ok(cheapest_path, agg_costs, dNumGroups) ||
+				 grouped_rel->pathlist == NIL)
 		{
-			hashaggtablesize = estimate_hashagg_tablesize(cheapest_path,
-														  agg_costs,
-														  dNumGroups);
-
 			/*
-			 * Provided that the estimated size of the hashtable does not
-			 * exceed work_mem, we'll generate a HashAgg Path, although if we
-			 * were unable to sort above, then we'd better generate a Path, so
-			 * that we at least have one.
+			 * We just need an Agg over the cheapest-total input path, since
+			 * input order won't matter.  If the hash table won't fit in
+			 * work_mem, it will spill to disk, which cost_agg accounts for.
+			 * If we were unable to sort above, we'd better generate a Path
+			 * in any case, so that we at least have one.
 			 */
-			if (hashaggtablesize < work_mem * 1024L ||
-				grouped_rel->pathlist == NIL)
-			{
-				/*
-				 * We just need an Agg over the cheapest-total input path,
-				 * since input order won't matter.
-				 */
-				add_path(grouped_rel, (Path *)
-						 create_agg_path(root, grouped_rel,
-										 cheapest_path,
-										 target,
-										 AGG_HASHED,
-										 AGGSPLIT_SIMPLE,
-										 parse->groupClause,
-										 (List *) parse->havingQual,
-										 agg_costs,
-										 dNumGroups));
-			}
+			add_path(grouped_rel, (Path *)
+					 create_agg_path(root, grouped_rel,
+									 cheapest_path,
+									 target,
+									 AGG_HASHED,
+									 AGGSPLIT_SIMPLE,
+									 parse->groupClause,
+									 (List *) parse->havingQual,
+									 agg_costs,
+									 dNumGroups));
 		}
 
 		/*
-		 * Generate a HashAgg Path atop of the cheapest partial path. Once
-		 * again, we'll only do this if it looks as though the hash table
-		 * won't exceed work_mem.
+		 * Generate a HashAgg Path atop of the cheapest partial path.
 		 */
-		if (grouped_rel->partial_pathlist)
+		if (grouped_rel->partial_pathlist &&
+			hashagg_memory_ok((Path *) linitial(grouped_rel->partial_pathlist),
+							  &agg_final_costs, dNumGroups))
 		{
 			Path	   *path = (Path *) linitial(grouped_rel->partial_pathlist);
+			double		total_groups = path->rows * path->parallel_workers;
 
-			hashaggtablesize = estimate_hashagg_tablesize(path,
-														  &agg_final_costs,
-														  dNumGroups);
-
-			if (hashaggtablesize < work_mem * 1024L)
-			{
-				double		total_groups = path->rows * path->parallel_workers;
-
-				path = (Path *) create_gather_path(root,
-												   grouped_rel,
-												   path,
-												   partial_grouping_target,
-												   NULL,
-												   &total_groups);
+			path = (Path *) create_gather_path(root,
+											   grouped_rel,
+											   path,
+											   partial_grouping_target,
+											   NULL,
+											   &total_groups);
 
-				add_path(grouped_rel, (Path *)
-						 create_agg_path(root,
-										 grouped_rel,
-										 path,
-										 target,
-										 AGG_HASHED,
-										 AGGSPLIT_FINAL_DESERIAL,
-										 parse->groupClause,
-										 (List *) parse->havingQual,
-										 &agg_final_costs,
-										 dNumGroups));
-			}
+			add_path(grouped_rel, (Path *)
+					 create_agg_path(root,
+									 grouped_rel,
+									 path,
+									 target,
+									 AGG_HASHED,
+									 AGGSPLIT_FINAL_DESERIAL,
+									 parse->groupClause,
+									 (List *) parse->havingQual,
+									 &agg_final_costs,
+									 dNumGroups));
 		}
 	}
 
+	/*
+	 * If the GROUP BY clause includes the partition keys of the input, each
+	 * group comes from a single partition, so we can aggregate each one
+	 * separately and append the results.
+	 */
+	if (can_hash && !parse->groupingSets && enable_partitionwise_aggregate)
+		create_partitionwise_grouping_paths(root, input_rel, grouped_rel,
+											target, agg_costs, dNumGroups);
+
 	/* Give a helpful error if we failed to find any implementation */
 	if (grouped_rel->pathlist == NIL)
 		ereport(ERROR,
@@ -4132,6 +4149,180 @@ create_grouping_paths(PlannerInfo *root,
 	return grouped_rel;
 }
 
+/*
+ * create_partitionwise_grouping_paths
+ *
+ * If the input relation is partitioned, or is a partition-wise join, and the
+ * grouping columns include all its partition keys, then no group spans more
+ * than one partition.  Each partition can then be aggregated on its own, and
+ * the grouped output is simply the Append of the per-partition results.
+ * The per-partition hash tables are much smaller than one for the whole
+ * input, and each partition's plan can be chosen separately.
+ *
+ * We only build a hashed aggregate over each partition's cheapest path, with
+ * no partial aggregation; add_path decides whether that beats aggregating
+ * the whole input at once.
+ */
+static void
+create_partitionwise_grouping_paths(PlannerInfo *root,
+									RelOptInfo *input_rel,
+									RelOptInfo *grouped_rel,
+									PathTarget *target,
+									const AggClauseCosts *agg_costs,
+									double dNumGroups)
+{
+	Query	   *parse = root->parse;
+	PathTarget *input_target = input_rel->cheapest_total_path->pathtarget;
+	double		input_rows = input_rel->cheapest_total_path->rows;
+	List	   *subpaths = NIL;
+	List	   *partitioned_rels = NIL;
+	Path	   *path;
+	int			relid;
+	int			cnt_parts;
+
+	if (input_rel->part_scheme == NULL || input_rel->nparts == 0 ||
+		parse->hasTargetSRFs || root->placeholder_list != NIL)
+		return;
+
+	if (!group_by_has_partkey(input_rel, parse->targetList,
+							  parse->groupClause))
+		return;
+
+	for (cnt_parts = 0; cnt_parts < input_rel->nparts; cnt_parts++)
+	{
+		RelOptInfo *child_rel = input_rel->part_rels[cnt_parts];
+		RelOptInfo *child_grouped_rel;
+		AppendRelInfo **appinfos;
+		int			nappinfos;
+		PathTarget *child_input_target;
+		PathTarget *child_target;
+		List	   *child_having;
+		Path	   *child_path;
+		double		child_groups;
+
+		/* Partitions that were proven empty produce no groups */
+		if (IS_DUMMY_REL(child_rel))
+			continue;
+
+		/* Translate the parent's targets and HAVING qual for the child */
+		appinfos = find_appinfos_by_relids(root, child_rel->relids,
+										   &nappinfos);
+		child_input_target = copy_pathtarget(input_target);
+		child_input_target->exprs = (List *)
+			adjust_appendrel_attrs(root, (Node *) input_target->exprs,
+								   nappinfos, appinfos);
+		child_target = copy_pathtarget(target);
+		child_target->exprs = (List *)
+			adjust_appendrel_attrs(root, (Node *) target->exprs,
+								   nappinfos, appinfos);
+		child_having = (List *)
+			adjust_appendrel_attrs(root, parse->havingQual,
+								   nappinfos, appinfos);
+		pfree(appinfos);
+
+		child_grouped_rel = fetch_upper_rel(root, UPPERREL_GROUP_AGG,
+											child_rel->relids);
+		child_grouped_rel->consider_parallel = grouped_rel->consider_parallel;
+
+		child_path = child_rel->cheapest_total_path;
+		if (child_path->param_info != NULL)
+			return;
+		child_path = (Path *) create_projection_path(root, child_rel,
+													 child_path,
+													 child_input_target);
+
+		/* The groups are spread over the partitions like the input rows */
+		child_groups = dNumGroups;
+		if (input_rows > 0)
+			child_groups *= child_path->rows / input_rows;
+		child_groups = clamp_row_est(Min(child_groups, child_path->rows));
+
+		if (!hashagg_memory_ok(child_path, agg_costs, child_groups))
+			return;
+
+		child_path = (Path *) create_agg_path(root,
+											  child_grouped_rel,
+											  child_path,
+											  child_target,
+											  AGG_HASHED,
+											  AGGSPLIT_SIMPLE,
+											  parse->groupClause,
+											  child_having,
+											  agg_costs,
+											  child_groups);
+		subpaths = lappend(subpaths, child_path);
+	}
+
+	/* Collect the partitioned tables being scanned, as for any Append */
+	relid = -1;
+	while ((relid = bms_next_member(input_rel->relids, relid)) >= 0)
+	{
+		RelOptInfo *component = root->simple_rel_array[relid];
+
+		if (component->part_scheme)
+			partitioned_rels =
+				list_concat(partitioned_rels,
+							list_copy(get_partitioned_child_rels(root, relid)));
+	}
+
+	path = (Path *) create_append_path(grouped_rel, subpaths, NIL,
+									   NULL, 0, false,
+									   partitioned_rels);
+	path->pathtarget = target;
+	add_path(grouped_rel, path);
+}
+
+/*
+ * group_by_has_partkey
+ *
+ * Returns true if every partition key column of the input relation is
+ * equal to one of the GROUP BY expressions, using an equality operator
+ * that agrees with the partitioning.
+ */
+static bool
+group_by_has_partkey(RelOptInfo *input_rel, List *targetList,
+					 List *groupClause)
+{
+	PartitionScheme part_scheme = input_rel->part_scheme;
+	int			cnt;
+
+	for (cnt = 0; cnt < part_scheme->partnatts; cnt++)
+	{
+		bool		found = false;
+		ListCell   *lc;
+
+		foreach(lc, groupClause)
+		{
+			SortGroupClause *sgc = (SortGroupClause *) lfirst(lc);
+			Expr	   *groupexpr = (Expr *) get_sortgroupclause_expr(sgc,
+																	  targetList);
+			ListCell   *lc2;
+
+			/* Remove any relabel decorations. */
+			while (IsA(groupexpr, RelabelType))
+				groupexpr = ((RelabelType *) groupexpr)->arg;
+
+			if (!op_in_opfamily(sgc->eqop, part_scheme->partopfamily[cnt]))
+				continue;
+
+			foreach(lc2, input_rel->partexprs[cnt])
+			{
+				if (equal(lfirst(lc2), groupexpr))
+				{
+					found = true;
+					break;
+				}
+			}
+			if (found)
+				break;
+		}
+
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
 
 /*
  * For a given input path, consider the possible ways of doing grouping sets on
@@ -4910,21 +5101,48 @@ create_ordered_paths(PlannerInfo *root,
 	{
 		Path	   *path = (Path *) lfirst(lc);
 		bool		is_sorted;
+		int			presorted_keys;
 
-		is_sorted = pathkeys_contained_in(root->sort_pathkeys,
-										  path->pathkeys);
+		is_sorted = pathkeys_count_contained_in(root->sort_pathkeys,
+												path->pathkeys,
+												&presorted_keys);
 		if (path == cheapest_input_path || is_sorted)
 		{
+			Path	   *sorted_path = path;
+
 			if (!is_sorted)
 			{
 				/* An explicit sort here can take advantage of LIMIT */
-				path = (Path *) create_sort_path(root,
-												 ordered_rel,
-												 path,
-												 root->sort_pathkeys,
-												 limit_tuples);
+				sorted_path = (Path *) create_sort_path(root,
+														ordered_rel,
+														path,
+														root->sort_pathkeys,
+														limit_tuples);
 			}
 
+			/* Add projection step if needed */
+			if (sorted_path->pathtarget != target)
+				sorted_path = apply_projection_to_path(root, ordered_rel,
+													   sorted_path, target);
+
+			add_path(ordered_rel, sorted_path);
+		}
+
+		/*
+		 * If the path is sorted on some leading part of the requested order,
+		 * an incremental sort can finish the job.  Since that returns rows
+		 * long before it has read all of its input, it may win out over a
+		 * full sort of a cheaper path if there's a LIMIT.
+		 */
+		if (!is_sorted && presorted_keys > 0 && enable_incrementalsort)
+		{
+			path = (Path *) create_incremental_sort_path(root,
+														 ordered_rel,
+														 path,
+														 root->sort_pathkeys,
+														 presorted_keys,
+														 limit_tuples);
+
 			/* Add projection step if needed */
 			if (path->pathtarget != target)
 				path = apply_projection_to_path(root, ordered_rel,
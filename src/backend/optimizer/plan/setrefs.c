@@ -631,9 +631,25 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			set_upper_references(root, plan, rtoffset);
 			break;
 
+		case T_ResultCache:
+			{
+				ResultCache *rcplan = (ResultCache *) plan;
+
+				/*
+				 * Like Material, this doesn't evaluate its targetlist.  The
+				 * cache key only refers to nestloop params, but still needs
+				 * the usual processing of its expressions.
+				 */
+				set_dummy_tlist_references(plan, rtoffset);
+				rcplan->param_exprs = fix_scan_list(root, rcplan->param_exprs,
+													rtoffset);
+			}
+			break;
+
 		case T_Hash:
 		case T_Material:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_SetOp:
 
@@ -921,6 +937,15 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 											  (Plan *) lfirst(l),
 											  rtoffset);
 				}
+				if (splan->part_prune_info)
+				{
+					PartitionPruneInfo *pinfo = splan->part_prune_info;
+
+					pinfo->init_exprs = fix_scan_list(root, pinfo->init_exprs,
+													  rtoffset);
+					pinfo->exec_exprs = fix_scan_list(root, pinfo->exec_exprs,
+													  rtoffset);
+				}
 			}
 			break;
 		case T_MergeAppend:
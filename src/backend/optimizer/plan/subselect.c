@@ -2561,6 +2561,11 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 													  valid_params,
 													  scan_params));
 				}
+
+				/* The run-time pruning steps may use Params, too */
+				if (((Append *) plan)->part_prune_info)
+					finalize_primnode((Node *) ((Append *) plan)->part_prune_info->exec_exprs,
+									  &context);
 			}
 			break;
 
@@ -2697,10 +2702,16 @@ finalize_plan(PlannerInfo *root, Plan *plan, Bitmapset *valid_params,
 							  &context);
 			break;
 
+		case T_ResultCache:
+			finalize_primnode((Node *) ((ResultCache *) plan)->param_exprs,
+							  &context);
+			break;
+
 		case T_ProjectSet:
 		case T_Hash:
 		case T_Material:
 		case T_Sort:
+		case T_IncrementalSort:
 		case T_Unique:
 		case T_Gather:
 		case T_GatherMerge:
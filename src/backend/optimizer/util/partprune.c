@@ -0,0 +1,282 @@
+/*-------------------------------------------------------------------------
+ *
+ * partprune.c
+ *	  Routines to set up run-time pruning of the partitions of an Append
+ *
+ * Constraint exclusion removes the partitions that the quals rule out at
+ * plan time, but it can't use values that aren't known until execution:
+ * the Params of a generic plan, the outer values of a parameterized
+ * nestloop, or stable functions.  For comparisons of the partition key with
+ * such values, we build a PartitionPruneInfo that lets the executor skip the
+ * partitions those values rule out; see nodeAppend.c.
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/optimizer/util/partprune.c
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/heapam.h"
+#include "access/nbtree.h"
+#include "catalog/partition.h"
+#include "catalog/pg_class.h"
+#include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
+#include "optimizer/partprune.h"
+#include "optimizer/var.h"
+#include "parser/parsetree.h"
+#include "rewrite/rewriteManip.h"
+#include "utils/lsyscache.h"
+#include "utils/rel.h"
+
+
+static Expr *get_partition_key_expr(PartitionKey key, Index varno);
+static bool match_clause_to_partition_key(Expr *clause, Expr *keyexpr,
+							  PartitionKey key,
+							  StrategyNumber *strategy, Expr **value);
+static bool pull_exec_paramids_walker(Node *node, Bitmapset **paramids);
+
+
+/*
+ * make_partition_pruneinfo
+ *		Build a PartitionPruneInfo for an Append of the partitions of 'rel',
+ *		or return NULL if run-time pruning wouldn't help.
+ *
+ * 'subpaths' are the Append's children, each scanning one leaf partition.
+ * 'clauses' are the quals the Append's output must satisfy, as bare
+ * expressions; references to the outer rels of a parameterized path must
+ * have been replaced by nestloop Params already.
+ */
+PartitionPruneInfo *
+make_partition_pruneinfo(PlannerInfo *root, RelOptInfo *rel,
+						 List *subpaths, List *clauses)
+{
+	RangeTblEntry *rte = planner_rt_fetch(rel->relid, root);
+	PartitionPruneInfo *pinfo;
+	Relation	partrel;
+	PartitionKey key;
+	PartitionDesc partdesc;
+	Expr	   *keyexpr;
+	List	   *init_strategies = NIL;
+	List	   *init_exprs = NIL;
+	List	   *exec_strategies = NIL;
+	List	   *exec_exprs = NIL;
+	Bitmapset  *execparamids = NULL;
+	ListCell   *lc;
+	int			i;
+
+	if (clauses == NIL || rte->rtekind != RTE_RELATION ||
+		rte->relkind != RELKIND_PARTITIONED_TABLE)
+		return NULL;
+
+	/* The table is locked already */
+	partrel = heap_open(rte->relid, NoLock);
+	key = RelationGetPartitionKey(partrel);
+	partdesc = RelationGetPartitionDesc(partrel);
+
+	/* We only know how to handle a single key column */
+	if (key->partnatts != 1)
+	{
+		heap_close(partrel, NoLock);
+		return NULL;
+	}
+
+	keyexpr = get_partition_key_expr(key, rel->relid);
+
+	foreach(lc, clauses)
+	{
+		Expr	   *clause = (Expr *) lfirst(lc);
+		StrategyNumber strategy;
+		Expr	   *value;
+		Bitmapset  *paramids = NULL;
+
+		if (!match_clause_to_partition_key(clause, keyexpr, key,
+										   &strategy, &value))
+			continue;
+
+		(void) pull_exec_paramids_walker((Node *) value, &paramids);
+		if (paramids == NULL)
+		{
+			init_strategies = lappend_int(init_strategies, strategy);
+			init_exprs = lappend(init_exprs, value);
+		}
+		else
+		{
+			exec_strategies = lappend_int(exec_strategies, strategy);
+			exec_exprs = lappend(exec_exprs, value);
+			execparamids = bms_join(execparamids, paramids);
+		}
+	}
+
+	if (init_exprs == NIL && exec_exprs == NIL)
+	{
+		heap_close(partrel, NoLock);
+		return NULL;
+	}
+
+	pinfo = makeNode(PartitionPruneInfo);
+	pinfo->reloid = rte->relid;
+	pinfo->init_strategies = init_strategies;
+	pinfo->init_exprs = init_exprs;
+	pinfo->exec_strategies = exec_strategies;
+	pinfo->exec_exprs = exec_exprs;
+	pinfo->execparamids = execparamids;
+	pinfo->nparts = partdesc->nparts;
+	pinfo->subplan_map = (int *) palloc(partdesc->nparts * sizeof(int));
+	for (i = 0; i < partdesc->nparts; i++)
+		pinfo->subplan_map[i] = -1;
+
+	/* Find the partition each subpath scans */
+	i = 0;
+	foreach(lc, subpaths)
+	{
+		Path	   *subpath = (Path *) lfirst(lc);
+		RelOptInfo *childrel = subpath->parent;
+		Oid			childoid;
+		int			partidx;
+
+		if (childrel->reloptkind != RELOPT_OTHER_MEMBER_REL)
+			break;
+		childoid = planner_rt_fetch(childrel->relid, root)->relid;
+
+		for (partidx = 0; partidx < partdesc->nparts; partidx++)
+		{
+			if (partdesc->oids[partidx] == childoid)
+				break;
+		}
+		if (partidx >= partdesc->nparts)
+			break;
+
+		pinfo->subplan_map[partidx] = i++;
+	}
+
+	heap_close(partrel, NoLock);
+
+	/* Give up if some subpath isn't a scan of one of the partitions */
+	if (i != list_length(subpaths))
+		return NULL;
+
+	return pinfo;
+}
+
+/*
+ * get_partition_key_expr
+ *		Build an expression for the (single) partition key column, in terms
+ *		of the partitioned table's range table index 'varno'.
+ */
+static Expr *
+get_partition_key_expr(PartitionKey key, Index varno)
+{
+	Expr	   *keyexpr;
+
+	if (key->partattrs[0] != 0)
+		return (Expr *) makeVar(varno, key->partattrs[0],
+								key->parttypid[0], key->parttypmod[0],
+								key->parttypcoll[0], 0);
+
+	/* Partition key expressions are stored with varno 1 */
+	keyexpr = (Expr *) copyObject(linitial(key->partexprs));
+	if (varno != 1)
+		ChangeVarNodes((Node *) keyexpr, 1, varno, 0);
+
+	return keyexpr;
+}
+
+/*
+ * match_clause_to_partition_key
+ *		Is 'clause' a comparison of the partition key with a value that can
+ *		be computed at execution time, which constraint exclusion couldn't
+ *		use?
+ *
+ * If so, return true, along with the btree strategy number of the
+ * comparison with the key on the left, and the value.
+ */
+static bool
+match_clause_to_partition_key(Expr *clause, Expr *keyexpr, PartitionKey key,
+							  StrategyNumber *strategy, Expr **value)
+{
+	OpExpr	   *opexpr;
+	Expr	   *leftop;
+	Expr	   *rightop;
+	Oid			opno;
+	int			op_strategy;
+	Oid			lefttype;
+	Oid			righttype;
+
+	if (!is_opclause(clause) || list_length(((OpExpr *) clause)->args) != 2)
+		return false;
+	opexpr = (OpExpr *) clause;
+
+	leftop = (Expr *) get_leftop(clause);
+	if (IsA(leftop, RelabelType))
+		leftop = ((RelabelType *) leftop)->arg;
+	rightop = (Expr *) get_rightop(clause);
+	if (IsA(rightop, RelabelType))
+		rightop = ((RelabelType *) rightop)->arg;
+
+	if (equal(leftop, keyexpr))
+	{
+		opno = opexpr->opno;
+		*value = rightop;
+	}
+	else if (equal(rightop, keyexpr))
+	{
+		opno = get_commutator(opexpr->opno);
+		if (!OidIsValid(opno))
+			return false;
+		*value = leftop;
+	}
+	else
+		return false;
+
+	/*
+	 * Constants were handled by constraint exclusion.  Otherwise the value
+	 * must not depend on the table's rows, nor change during the scan.
+	 */
+	if (IsA(*value, Const) ||
+		contain_var_clause((Node *) *value) ||
+		contain_volatile_functions((Node *) *value))
+		return false;
+
+	/* The comparison must agree with how the partition bounds are sorted */
+	if (OidIsValid(key->partcollation[0]) &&
+		opexpr->inputcollid != key->partcollation[0])
+		return false;
+	if (!op_in_opfamily(opno, key->partopfamily[0]))
+		return false;
+	get_op_opfamily_properties(opno, key->partopfamily[0], false,
+							   &op_strategy, &lefttype, &righttype);
+	if (lefttype != key->partopcintype[0] ||
+		righttype != key->partopcintype[0])
+		return false;
+
+	*strategy = (StrategyNumber) op_strategy;
+	return true;
+}
+
+/*
+ * Collect the IDs of the PARAM_EXEC Params in an expression.
+ */
+static bool
+pull_exec_paramids_walker(Node *node, Bitmapset **paramids)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, Param))
+	{
+		Param	   *param = (Param *) node;
+
+		if (param->paramkind == PARAM_EXEC)
+			*paramids = bms_add_member(*paramids, param->paramid);
+		return false;
+	}
+	return expression_tree_walker(node, pull_exec_paramids_walker,
+								  (void *) paramids);
+}
@@ -16,6 +16,8 @@
 
 #include <limits.h>
 
+#include "access/heapam.h"
+#include "catalog/partition.h"
 #include "miscadmin.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
@@ -23,9 +25,11 @@
 #include "optimizer/paths.h"
 #include "optimizer/placeholder.h"
 #include "optimizer/plancat.h"
+#include "optimizer/prep.h"
 #include "optimizer/restrictinfo.h"
 #include "optimizer/tlist.h"
 #include "utils/hsearch.h"
+#include "utils/rel.h"
 
 
 typedef struct JoinHashEntry
@@ -52,6 +56,8 @@ static List *subbuild_joinrel_joinlist(RelOptInfo *joinrel,
 static void set_foreign_rel_properties(RelOptInfo *joinrel,
 						   RelOptInfo *outer_rel, RelOptInfo *inner_rel);
 static void add_join_rel(PlannerInfo *root, RelOptInfo *joinrel);
+static void set_partition_child_rel(PlannerInfo *root, RelOptInfo *parent,
+						RelOptInfo *childrel);
 
 
 /*
@@ -146,6 +152,11 @@ build_simple_rel(PlannerInfo *root, int relid, RelOptInfo *parent)
 	rel->baserestrict_min_security = UINT_MAX;
 	rel->joininfo = NIL;
 	rel->has_eclass_joins = false;
+	rel->part_scheme = NULL;
+	rel->nparts = 0;
+	rel->boundinfo = NULL;
+	rel->part_rels = NULL;
+	rel->partexprs = NULL;
 
 	/*
 	 * Pass top parent's relids down the inheritance hierarchy. If the parent
@@ -222,19 +233,79 @@ build_simple_rel(PlannerInfo *root, int relid, RelOptInfo *parent)
 		foreach(l, root->append_rel_list)
 		{
 			AppendRelInfo *appinfo = (AppendRelInfo *) lfirst(l);
+			RelOptInfo *childrel;
 
 			/* append_rel_list contains all append rels; ignore others */
 			if (appinfo->parent_relid != relid)
 				continue;
 
-			(void) build_simple_rel(root, appinfo->child_relid,
-									rel);
+			childrel = build_simple_rel(root, appinfo->child_relid,
+										rel);
+
+			if (rel->part_scheme)
+				set_partition_child_rel(root, rel, childrel);
+		}
+
+		if (rel->part_scheme)
+		{
+			int			i;
+
+			/*
+			 * With multi-level partitioning, the leaf partitions are
+			 * children of the topmost table and the intermediate partitioned
+			 * tables have no child rel of their own, so the children don't
+			 * line up with the partition bounds.  Don't pretend they do.
+			 */
+			for (i = 0; i < rel->nparts; i++)
+			{
+				if (rel->part_rels[i] == NULL)
+				{
+					rel->part_scheme = NULL;
+					rel->nparts = 0;
+					rel->boundinfo = NULL;
+					rel->part_rels = NULL;
+					rel->partexprs = NULL;
+					break;
+				}
+			}
 		}
 	}
 
 	return rel;
 }
 
+/*
+ * set_partition_child_rel
+ *	  Store a child rel of a partitioned table in the slot of parent's
+ *	  part_rels[] matching its partition bound.
+ */
+static void
+set_partition_child_rel(PlannerInfo *root, RelOptInfo *parent,
+						RelOptInfo *childrel)
+{
+	RangeTblEntry *parentrte = root->simple_rte_array[parent->relid];
+	Oid			childoid = root->simple_rte_array[childrel->relid]->relid;
+	Relation	relation;
+	PartitionDesc partdesc;
+	int			i;
+
+	/* The table is locked already */
+	relation = heap_open(parentrte->relid, NoLock);
+	partdesc = RelationGetPartitionDesc(relation);
+	Assert(partdesc->nparts == parent->nparts);
+
+	for (i = 0; i < partdesc->nparts; i++)
+	{
+		if (partdesc->oids[i] == childoid)
+		{
+			parent->part_rels[i] = childrel;
+			break;
+		}
+	}
+
+	heap_close(relation, NoLock);
+}
+
 /*
  * find_base_rel
  *	  Find a base or other relation entry, which must already exist.
@@ -526,6 +597,11 @@ build_join_rel(PlannerInfo *root,
 	joinrel->baserestrict_min_security = UINT_MAX;
 	joinrel->joininfo = NIL;
 	joinrel->has_eclass_joins = false;
+	joinrel->part_scheme = NULL;
+	joinrel->nparts = 0;
+	joinrel->boundinfo = NULL;
+	joinrel->part_rels = NULL;
+	joinrel->partexprs = NULL;
 	joinrel->top_parent_relids = NULL;
 
 	/* Compute information relevant to the foreign relations. */
@@ -617,6 +693,116 @@ build_join_rel(PlannerInfo *root,
 	return joinrel;
 }
 
+/*
+ * build_child_join_rel
+ *	  Builds RelOptInfo representing join between given two child relations.
+ *
+ * 'outer_rel' and 'inner_rel' are the RelOptInfos of child relations being
+ *		joined
+ * 'parent_joinrel' is the RelOptInfo representing the join between parent
+ *		relations.  Its reltarget is translated to form the child join's.
+ * 'restrictlist': list of RestrictInfo nodes that apply to this particular
+ *		pair of joinable relations, already translated for the children
+ * 'sjinfo': child-join context info
+ *
+ * Child joins are only reachable through their parent's part_rels array;
+ * they don't take part in the join search themselves.
+ */
+RelOptInfo *
+build_child_join_rel(PlannerInfo *root, RelOptInfo *outer_rel,
+					 RelOptInfo *inner_rel, RelOptInfo *parent_joinrel,
+					 List *restrictlist, SpecialJoinInfo *sjinfo)
+{
+	RelOptInfo *joinrel = makeNode(RelOptInfo);
+	AppendRelInfo **appinfos;
+	int			nappinfos;
+
+	Assert(IS_OTHER_REL(outer_rel) && IS_OTHER_REL(inner_rel));
+
+	joinrel->reloptkind = RELOPT_OTHER_JOINREL;
+	joinrel->relids = bms_union(outer_rel->relids, inner_rel->relids);
+	joinrel->rows = 0;
+	/* cheap startup cost is interesting iff not all tuples to be retrieved */
+	joinrel->consider_startup = (root->tuple_fraction > 0);
+	joinrel->consider_param_startup = false;
+	/* Child joinrel is parallel safe if parent is parallel safe */
+	joinrel->consider_parallel = parent_joinrel->consider_parallel;
+	joinrel->reltarget = create_empty_pathtarget();
+	joinrel->pathlist = NIL;
+	joinrel->ppilist = NIL;
+	joinrel->partial_pathlist = NIL;
+	joinrel->cheapest_startup_path = NULL;
+	joinrel->cheapest_total_path = NULL;
+	joinrel->cheapest_unique_path = NULL;
+	joinrel->cheapest_parameterized_paths = NIL;
+	joinrel->direct_lateral_relids = NULL;
+	joinrel->lateral_relids = NULL;
+	joinrel->relid = 0;			/* indicates not a baserel */
+	joinrel->rtekind = RTE_JOIN;
+	joinrel->min_attr = 0;
+	joinrel->max_attr = 0;
+	joinrel->attr_needed = NULL;
+	joinrel->attr_widths = NULL;
+	joinrel->lateral_vars = NIL;
+	joinrel->lateral_referencers = NULL;
+	joinrel->indexlist = NIL;
+	joinrel->statlist = NIL;
+	joinrel->pages = 0;
+	joinrel->tuples = 0;
+	joinrel->allvisfrac = 0;
+	joinrel->subroot = NULL;
+	joinrel->subplan_params = NIL;
+	joinrel->rel_parallel_workers = -1;
+	/* we don't try to push child joins down to foreign servers */
+	joinrel->serverid = InvalidOid;
+	joinrel->userid = InvalidOid;
+	joinrel->useridiscurrent = false;
+	joinrel->fdwroutine = NULL;
+	joinrel->fdw_private = NULL;
+	joinrel->unique_for_rels = NIL;
+	joinrel->non_unique_for_rels = NIL;
+	joinrel->baserestrictinfo = NIL;
+	joinrel->baserestrictcost.startup = 0;
+	joinrel->baserestrictcost.per_tuple = 0;
+	joinrel->baserestrict_min_security = UINT_MAX;
+	joinrel->joininfo = NIL;
+	joinrel->has_eclass_joins = false;
+	joinrel->part_scheme = NULL;
+	joinrel->nparts = 0;
+	joinrel->boundinfo = NULL;
+	joinrel->part_rels = NULL;
+	joinrel->partexprs = NULL;
+	joinrel->top_parent_relids = bms_union(outer_rel->top_parent_relids,
+										   inner_rel->top_parent_relids);
+
+	/* Translate the parent's targetlist and join clauses */
+	appinfos = find_appinfos_by_relids(root, joinrel->relids, &nappinfos);
+	joinrel->reltarget->exprs = (List *)
+		adjust_appendrel_attrs(root,
+							   (Node *) parent_joinrel->reltarget->exprs,
+							   nappinfos, appinfos);
+	joinrel->reltarget->cost = parent_joinrel->reltarget->cost;
+	joinrel->reltarget->width = parent_joinrel->reltarget->width;
+	joinrel->joininfo = (List *)
+		adjust_appendrel_attrs(root, (Node *) parent_joinrel->joininfo,
+							   nappinfos, appinfos);
+	pfree(appinfos);
+
+	joinrel->has_eclass_joins = parent_joinrel->has_eclass_joins;
+
+	/* Set estimates of the child-joinrel's size. */
+	set_joinrel_size_estimates(root, joinrel, outer_rel, inner_rel,
+							   sjinfo, restrictlist);
+
+	/* We build the join only once. */
+	Assert(!find_join_rel(root, joinrel->relids));
+
+	/* Add the relation to the PlannerInfo. */
+	add_join_rel(root, joinrel);
+
+	return joinrel;
+}
+
 /*
  * min_join_parameterization
  *
@@ -3,11 +3,21 @@
  * buf_table.c
  *	  routines for mapping BufferTags to buffer indexes.
  *
- * Note: the routines in this file do no locking of their own.  The caller
- * must hold a suitable lock on the appropriate BufMappingLock, as specified
- * in the comments.  We can't do the locking inside these functions because
- * in most cases the caller needs to adjust the buffer header contents
- * before the lock is released (see notes in README).
+ * Note: the routines in this file do no locking of their own, except for
+ * BufTableLookupNoLock.  The caller must hold a suitable lock on the
+ * appropriate BufMappingLock, as specified in the comments.  We can't do
+ * the locking inside these functions because in most cases the caller needs
+ * to adjust the buffer header contents before the lock is released (see
+ * notes in README).
+ *
+ * The table is a chained hash table with a fixed number of buckets, much
+ * like a partitioned dynahash table, but laid out so that it can also be
+ * searched without any lock.  The low-order bits of a tag's hash code
+ * select both its bucket and its partition, so each bucket chain belongs to
+ * exactly one partition.  Each partition has a change counter that writers
+ * advance before and after modifying one of its chains, which lets
+ * lock-free readers detect that they may have seen an inconsistent chain,
+ * in the manner of a seqlock.
  *
  *
  * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
@@ -21,8 +31,12 @@
  */
 #include "postgres.h"
 
+#include "access/hash.h"
+#include "port/atomics.h"
 #include "storage/bufmgr.h"
 #include "storage/buf_internals.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
 
 
 /* entry for buffer lookup hashtable */
@@ -30,10 +44,58 @@ typedef struct
 {
 	BufferTag	key;			/* Tag of a disk page */
 	int			id;				/* Associated buffer ID */
+	int			next;			/* next entry in chain or freelist, or -1 */
 } BufferLookupEnt;
 
-static HTAB *SharedBufHash;
+/*
+ * Per-partition state.  changecount is odd while a chain of the partition is
+ * being modified; it's only advanced while holding the partition's
+ * BufMappingLock exclusively.
+ *
+ * Unused entries are kept in per-partition freelists, protected by a
+ * spinlock rather than the BufMappingLock, so that a partition that runs out
+ * can borrow entries from the others.  That's the same arrangement dynahash
+ * uses for partitioned tables.
+ */
+typedef struct
+{
+	pg_atomic_uint32 changecount;	/* see above */
+	slock_t		mutex;			/* protects freeList */
+	int			freeList;		/* first unused entry, or -1 */
+} BufTablePartition;
 
+/* Pad to a cache line, so that partitions don't share one */
+typedef union BufTablePartitionPadded
+{
+	BufTablePartition part;
+	char		pad[PG_CACHE_LINE_SIZE];
+} BufTablePartitionPadded;
+
+/* Pointers to shared state */
+static BufTablePartitionPadded *BufTablePartitions = NULL;
+static int *BufTableBuckets = NULL;
+static BufferLookupEnt *BufTableEntries = NULL;
+
+/* Table geometry, derived from the size passed to InitBufTable */
+static uint32 BufTableBucketMask = 0;
+static int	BufTableNumEntries = 0;
+
+#define BufTablePartitionFor(hashcode) \
+	(&BufTablePartitions[BufTableHashPartition(hashcode)].part)
+
+/*
+ * Number of buckets for a table of the given size: a power of 2, so that
+ * the partition number is part of the bucket number.
+ */
+static uint32
+BufTableNumBuckets(int size)
+{
+	uint32		nbuckets = NUM_BUFFER_PARTITIONS;
+
+	while (nbuckets < (uint32) size)
+		nbuckets <<= 1;
+	return nbuckets;
+}
 
 /*
  * Estimate space needed for mapping hashtable
@@ -42,7 +104,15 @@ static HTAB *SharedBufHash;
 Size
 BufTableShmemSize(int size)
 {
-	return hash_estimate_size(size, sizeof(BufferLookupEnt));
+	Size		sz;
+
+	sz = mul_size(NUM_BUFFER_PARTITIONS, sizeof(BufTablePartitionPadded));
+	/* to allow aligning the partitions */
+	sz = add_size(sz, PG_CACHE_LINE_SIZE);
+	sz = add_size(sz, mul_size(BufTableNumBuckets(size), sizeof(int)));
+	sz = add_size(sz, mul_size(size, sizeof(BufferLookupEnt)));
+
+	return sz;
 }
 
 /*
@@ -52,19 +122,59 @@ BufTableShmemSize(int size)
 void
 InitBufTable(int size)
 {
-	HASHCTL		info;
+	uint32		nbuckets = BufTableNumBuckets(size);
+	bool		foundParts,
+				foundBuckets,
+				foundEntries;
+	char	   *ptr;
+	uint32		i;
 
 	/* assume no locking is needed yet */
 
-	/* BufferTag maps to Buffer */
-	info.keysize = sizeof(BufferTag);
-	info.entrysize = sizeof(BufferLookupEnt);
-	info.num_partitions = NUM_BUFFER_PARTITIONS;
+	BufTableBucketMask = nbuckets - 1;
+	BufTableNumEntries = size;
+
+	ptr = (char *)
+		ShmemInitStruct("Shared Buffer Lookup Partitions",
+						NUM_BUFFER_PARTITIONS * sizeof(BufTablePartitionPadded) +
+						PG_CACHE_LINE_SIZE,
+						&foundParts);
+	BufTablePartitions = (BufTablePartitionPadded *) CACHELINEALIGN(ptr);
+	BufTableBuckets = (int *)
+		ShmemInitStruct("Shared Buffer Lookup Buckets",
+						nbuckets * sizeof(int), &foundBuckets);
+	BufTableEntries = (BufferLookupEnt *)
+		ShmemInitStruct("Shared Buffer Lookup Table",
+						size * sizeof(BufferLookupEnt), &foundEntries);
 
-	SharedBufHash = ShmemInitHash("Shared Buffer Lookup Table",
-								  size, size,
-								  &info,
-								  HASH_ELEM | HASH_BLOBS | HASH_PARTITION);
+	if (foundParts || foundBuckets || foundEntries)
+	{
+		/* should find all of these, or none of them */
+		Assert(foundParts && foundBuckets && foundEntries);
+		return;
+	}
+
+	for (i = 0; i < NUM_BUFFER_PARTITIONS; i++)
+	{
+		BufTablePartition *part = &BufTablePartitions[i].part;
+
+		pg_atomic_init_u32(&part->changecount, 0);
+		SpinLockInit(&part->mutex);
+		part->freeList = -1;
+	}
+
+	for (i = 0; i < nbuckets; i++)
+		BufTableBuckets[i] = -1;
+
+	/* Deal the entries out to the partitions' freelists */
+	for (i = 0; i < (uint32) size; i++)
+	{
+		BufTablePartition *part = &BufTablePartitions[i % NUM_BUFFER_PARTITIONS].part;
+
+		BufTableEntries[i].id = -1;
+		BufTableEntries[i].next = part->freeList;
+		part->freeList = i;
+	}
 }
 
 /*
@@ -79,7 +189,38 @@ InitBufTable(int size)
 uint32
 BufTableHashCode(BufferTag *tagPtr)
 {
-	return get_hash_value(SharedBufHash, (void *) tagPtr);
+	return DatumGetUInt32(hash_any((const unsigned char *) tagPtr,
+								   sizeof(BufferTag)));
+}
+
+/*
+ * Search the bucket chain of the given tag.  Returns the entry's index, or
+ * -1 if not found.
+ *
+ * A lock-free reader may see a chain that is being modified, or follow a
+ * pointer into an entry that has been recycled since.  The links always
+ * point to valid entries though, so at worst we return a wrong answer, which
+ * the caller detects with the partition's change counter.  To be sure that
+ * we terminate even if entries keep being moved around, we never follow more
+ * links than there are entries.
+ */
+static int
+BufTableSearch(BufferTag *tagPtr, uint32 hashcode)
+{
+	int			ent;
+	int			nsteps = 0;
+
+	ent = BufTableBuckets[hashcode & BufTableBucketMask];
+	while (ent >= 0 && nsteps++ < BufTableNumEntries)
+	{
+		BufferLookupEnt *entry = &BufTableEntries[ent];
+
+		if (BUFFERTAGS_EQUAL(entry->key, *tagPtr))
+			return ent;
+		ent = entry->next;
+	}
+
+	return -1;
 }
 
 /*
@@ -91,19 +232,51 @@ BufTableHashCode(BufferTag *tagPtr)
 int
 BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 {
-	BufferLookupEnt *result;
+	int			ent;
 
-	result = (BufferLookupEnt *)
-		hash_search_with_hash_value(SharedBufHash,
-									(void *) tagPtr,
-									hashcode,
-									HASH_FIND,
-									NULL);
-
-	if (!result)
+	ent = BufTableSearch(tagPtr, hashcode);
+	if (ent < 0)
 		return -1;
 
-	return result->id;
+	return BufTableEntries[ent].id;
+}
+
+/*
+ * BufTableLookupNoLock
+ *		Lookup the given BufferTag without holding the BufMappingLock
+ *
+ * Returns false if the tag's partition was modified concurrently, in which
+ * case the caller must repeat the lookup with BufTableLookup, holding the
+ * lock.  Otherwise returns true, with *buf_id set to the buffer ID, or -1 if
+ * the tag was not found.
+ *
+ * Even then, the result can be out of date by the time the caller uses it:
+ * since the caller can't pin the buffer before the mapping changes, it must
+ * check the buffer's tag after pinning it.
+ */
+bool
+BufTableLookupNoLock(BufferTag *tagPtr, uint32 hashcode, int *buf_id)
+{
+	BufTablePartition *part = BufTablePartitionFor(hashcode);
+	uint32		before;
+	int			ent;
+	int			id = -1;
+
+	before = pg_atomic_read_u32(&part->changecount);
+	if (before & 1)
+		return false;
+	pg_read_barrier();
+
+	ent = BufTableSearch(tagPtr, hashcode);
+	if (ent >= 0)
+		id = BufTableEntries[ent].id;
+
+	pg_read_barrier();
+	if (pg_atomic_read_u32(&part->changecount) != before)
+		return false;
+
+	*buf_id = id;
+	return true;
 }
 
 /*
@@ -119,23 +292,48 @@ BufTableLookup(BufferTag *tagPtr, uint32 hashcode)
 int
 BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 {
-	BufferLookupEnt *result;
-	bool		found;
+	BufTablePartition *part = BufTablePartitionFor(hashcode);
+	int		   *bucket = &BufTableBuckets[hashcode & BufTableBucketMask];
+	BufferLookupEnt *entry;
+	int			ent;
+	int			i;
 
 	Assert(buf_id >= 0);		/* -1 is reserved for not-in-table */
 	Assert(tagPtr->blockNum != P_NEW);	/* invalid tag */
 
-	result = (BufferLookupEnt *)
-		hash_search_with_hash_value(SharedBufHash,
-									(void *) tagPtr,
-									hashcode,
-									HASH_ENTER,
-									&found);
+	ent = BufTableSearch(tagPtr, hashcode);
+	if (ent >= 0)				/* found something already in the table */
+		return BufTableEntries[ent].id;
 
-	if (found)					/* found something already in the table */
-		return result->id;
+	/*
+	 * Get an unused entry, from this partition's freelist if possible, else
+	 * from another partition's.
+	 */
+	ent = -1;
+	for (i = 0; i < NUM_BUFFER_PARTITIONS && ent < 0; i++)
+	{
+		BufTablePartition *freepart;
 
-	result->id = buf_id;
+		freepart = &BufTablePartitions[(BufTableHashPartition(hashcode) + i) %
+									   NUM_BUFFER_PARTITIONS].part;
+		SpinLockAcquire(&freepart->mutex);
+		ent = freepart->freeList;
+		if (ent >= 0)
+			freepart->freeList = BufTableEntries[ent].next;
+		SpinLockRelease(&freepart->mutex);
+	}
+	if (ent < 0)				/* shouldn't happen */
+		elog(ERROR, "out of shared buffer hash table entries");
+
+	/* Fill in the entry, then link it in at the head of the chain */
+	entry = &BufTableEntries[ent];
+	pg_atomic_fetch_add_u32(&part->changecount, 1);
+	entry->key = *tagPtr;
+	entry->id = buf_id;
+	entry->next = *bucket;
+	pg_write_barrier();
+	*bucket = ent;
+	pg_atomic_fetch_add_u32(&part->changecount, 1);
 
 	return -1;
 }
@@ -149,15 +347,31 @@ BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id)
 void
 BufTableDelete(BufferTag *tagPtr, uint32 hashcode)
 {
-	BufferLookupEnt *result;
+	BufTablePartition *part = BufTablePartitionFor(hashcode);
+	int		   *link = &BufTableBuckets[hashcode & BufTableBucketMask];
+	BufferLookupEnt *entry;
+	int			ent;
 
-	result = (BufferLookupEnt *)
-		hash_search_with_hash_value(SharedBufHash,
-									(void *) tagPtr,
-									hashcode,
-									HASH_REMOVE,
-									NULL);
+	for (ent = *link; ent >= 0; ent = *link)
+	{
+		entry = &BufTableEntries[ent];
+		if (BUFFERTAGS_EQUAL(entry->key, *tagPtr))
+			break;
+		link = &entry->next;
+	}
 
-	if (!result)				/* shouldn't happen */
+	if (ent < 0)				/* shouldn't happen */
 		elog(ERROR, "shared buffer hash table corrupted");
+
+	/* Unlink the entry, leaving its next link for concurrent readers */
+	pg_atomic_fetch_add_u32(&part->changecount, 1);
+	*link = entry->next;
+	pg_atomic_fetch_add_u32(&part->changecount, 1);
+
+	/* Return it to this partition's freelist */
+	SpinLockAcquire(&part->mutex);
+	entry->id = -1;
+	entry->next = part->freeList;
+	part->freeList = ent;
+	SpinLockRelease(&part->mutex);
 }
@@ -44,10 +44,12 @@
 #include "postmaster/bgwriter.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
+#include "storage/fd.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "storage/smgr.h"
 #include "storage/standby.h"
+#include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/resowner_private.h"
 #include "utils/timestamp.h"
@@ -67,6 +69,13 @@
 
 #define DROP_RELS_BSEARCH_THRESHOLD		20
 
+/*
+ * Dropping the buffers of relations with fewer blocks than this in total
+ * looks up each block in the buffer mapping table, rather than scanning all
+ * of shared buffers.
+ */
+#define BUF_DROP_FULL_SCAN_THRESHOLD	((uint64) (NBuffers / 32))
+
 typedef struct PrivateRefCountEntry
 {
 	Buffer		buffer;
@@ -110,6 +119,7 @@ int			bgwriter_lru_maxpages = 100;
 double		bgwriter_lru_multiplier = 2.0;
 bool		track_io_timing = false;
 int			effective_io_concurrency = 0;
+int			io_combine_limit = DEFAULT_IO_COMBINE_LIMIT;
 
 /*
  * GUC variables about triggering kernel writeback for buffers written; OS
@@ -128,8 +138,14 @@ int			backend_flush_after = 0;
  */
 int			target_prefetch_pages = 0;
 
-/* local state for StartBufferIO and related functions */
-static BufferDesc *InProgressBuf = NULL;
+/*
+ * local state for StartBufferIO and related functions
+ *
+ * Normally there is at most one buffer with I/O in progress, but
+ * ReadBufferRange can have input I/O in progress on several at once.
+ */
+static BufferDesc *InProgressBufs[MAX_IO_COMBINE_LIMIT];
+static int	NumInProgressBufs = 0;
 static bool IsForInput;
 
 /* local state for LockBufferForCleanup */
@@ -438,8 +454,11 @@ static void UnpinBuffer(BufferDesc *buf, bool fixOwner);
 static void BufferSync(int flags);
 static uint32 WaitBufHdrUnlocked(BufferDesc *buf);
 static int	SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *flush_context);
+static int	SyncBufferRun(CkptSortItem *items, int nitems,
+			  WritebackContext *wb_context, int *nwritten);
 static void WaitIO(BufferDesc *buf);
 static bool StartBufferIO(BufferDesc *buf, bool forInput);
+static bool ConditionalStartBufferIO(BufferDesc *buf, bool forInput);
 static void TerminateBufferIO(BufferDesc *buf, bool clear_dirty,
 				  uint32 set_flag_bits);
 static void shared_buffer_write_error_callback(void *arg);
@@ -449,8 +468,14 @@ static BufferDesc *BufferAlloc(SMgrRelation smgr,
 			ForkNumber forkNum,
 			BlockNumber blockNum,
 			BufferAccessStrategy strategy,
-			bool *foundPtr);
+			bool start_io, bool *foundPtr);
 static void FlushBuffer(BufferDesc *buf, SMgrRelation reln);
+static BlockNumber DropRelFileNodeForkSize(SMgrRelation smgr_reln,
+						ForkNumber forkNum);
+static void FindAndDropRelFileNodeBuffers(RelFileNode rnode,
+							  ForkNumber forkNum,
+							  BlockNumber nForkBlocks,
+							  BlockNumber firstDelBlock);
 static void AtProcExit_Buffers(int code, Datum arg);
 static void CheckForBufferLeaks(void);
 static int	rnode_comparator(const void *p1, const void *p2);
@@ -517,6 +542,68 @@ ComputeIoConcurrency(int io_concurrency, double *target)
 	return (new_prefetch_pages >= 0.0 && new_prefetch_pages < (double) INT_MAX);
 }
 
+/*
+ * PrefetchSharedBuffer -- initiate asynchronous read of a block of a
+ *		relation that lives in shared buffers
+ *
+ * This is the guts of PrefetchBuffer, for callers that have only an
+ * SMgrRelation, such as recovery.  The block must exist.  Returns true if a
+ * read was initiated, false if the block is already in buffers (or
+ * prefetching isn't compiled in).
+ */
+bool
+PrefetchSharedBuffer(SMgrRelation smgr_reln, ForkNumber forkNum,
+					 BlockNumber blockNum)
+{
+#ifdef USE_PREFETCH
+	BufferTag	newTag;			/* identity of requested block */
+	uint32		newHash;		/* hash value for newTag */
+	LWLock	   *newPartitionLock;	/* buffer partition lock for it */
+	int			buf_id;
+
+	Assert(BlockNumberIsValid(blockNum));
+
+	/* create a tag so we can lookup the buffer */
+	INIT_BUFFERTAG(newTag, smgr_reln->smgr_rnode.node, forkNum, blockNum);
+
+	/* determine its hash code and partition lock ID */
+	newHash = BufTableHashCode(&newTag);
+	newPartitionLock = BufMappingPartitionLock(newHash);
+
+	/*
+	 * See if the block is in the buffer pool already.  A stale answer does no
+	 * harm here, so we only take the lock if the lookup raced with a change
+	 * to the mapping.
+	 */
+	if (!BufTableLookupNoLock(&newTag, newHash, &buf_id))
+	{
+		LWLockAcquire(newPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&newTag, newHash);
+		LWLockRelease(newPartitionLock);
+	}
+
+	/* If not in buffers, initiate prefetch */
+	if (buf_id < 0)
+	{
+		smgrprefetch(smgr_reln, forkNum, blockNum);
+		return true;
+	}
+
+	/*
+	 * If the block *is* in buffers, we do nothing.  This is not really ideal:
+	 * the block might be just about to be evicted, which would be stupid
+	 * since we know we are going to need it soon.  But the only easy answer
+	 * is to bump the usage_count, which does not seem like a great solution:
+	 * when the caller does ultimately touch the block, usage_count would get
+	 * bumped again, resulting in too much favoritism for blocks that are
+	 * involved in a prefetch sequence. A real fix would involve some
+	 * additional per-buffer state, and it's not clear that there's enough of
+	 * a problem to justify that.
+	 */
+#endif							/* USE_PREFETCH */
+	return false;
+}
+
 /*
  * PrefetchBuffer -- initiate asynchronous read of a block of a relation
  *
@@ -548,39 +635,8 @@ PrefetchBuffer(Relation reln, ForkNumber forkNum, BlockNumber blockNum)
 	}
 	else
 	{
-		BufferTag	newTag;		/* identity of requested block */
-		uint32		newHash;	/* hash value for newTag */
-		LWLock	   *newPartitionLock;	/* buffer partition lock for it */
-		int			buf_id;
-
-		/* create a tag so we can lookup the buffer */
-		INIT_BUFFERTAG(newTag, reln->rd_smgr->smgr_rnode.node,
-					   forkNum, blockNum);
-
-		/* determine its hash code and partition lock ID */
-		newHash = BufTableHashCode(&newTag);
-		newPartitionLock = BufMappingPartitionLock(newHash);
-
-		/* see if the block is in the buffer pool already */
-		LWLockAcquire(newPartitionLock, LW_SHARED);
-		buf_id = BufTableLookup(&newTag, newHash);
-		LWLockRelease(newPartitionLock);
-
-		/* If not in buffers, initiate prefetch */
-		if (buf_id < 0)
-			smgrprefetch(reln->rd_smgr, forkNum, blockNum);
-
-		/*
-		 * If the block *is* in buffers, we do nothing.  This is not really
-		 * ideal: the block might be just about to be evicted, which would be
-		 * stupid since we know we are going to need it soon.  But the only
-		 * easy answer is to bump the usage_count, which does not seem like a
-		 * great solution: when the caller does ultimately touch the block,
-		 * usage_count would get bumped again, resulting in too much
-		 * favoritism for blocks that are involved in a prefetch sequence. A
-		 * real fix would involve some additional per-buffer state, and it's
-		 * not clear that there's enough of a problem to justify that.
-		 */
+		/* pass it to the shared buffer version */
+		(void) PrefetchSharedBuffer(reln->rd_smgr, forkNum, blockNum);
 	}
 #endif							/* USE_PREFETCH */
 }
@@ -693,6 +749,173 @@ ReadBufferWithoutRelcache(RelFileNode rnode, ForkNumber forkNum,
 							 mode, strategy, &hit);
 }
 
+/*
+ * GetAdditionalPinLimit -- how many more shared buffers we may pin at once
+ *
+ * Code that pins several buffers ahead of time, such as read-ahead, must
+ * leave enough unpinned buffers for the other backends.  We allow each
+ * backend an equal share of shared_buffers, less the pins it already holds,
+ * but always at least one.
+ */
+int
+GetAdditionalPinLimit(void)
+{
+	int			limit;
+	int			i;
+
+	limit = NBuffers / (MaxBackends + NUM_AUXILIARY_PROCS);
+
+	limit -= PrivateRefCountOverflowed;
+	for (i = 0; i < REFCOUNT_ARRAY_ENTRIES; i++)
+	{
+		if (PrivateRefCountArray[i].buffer != InvalidBuffer)
+			limit--;
+	}
+
+	return Max(limit, 1);
+}
+
+/*
+ * ReadBufferRange -- pin the consecutive blocks blockNum .. blockNum +
+ *		nblocks - 1 of a relation, reading the ones that aren't in the
+ *		buffer cache yet.
+ *
+ * The buffers are returned in buffers[], each pinned as if by
+ * ReadBufferExtended in RBM_NORMAL mode.  Runs of adjacent blocks that
+ * have to be read are read with a single smgrreadv call, of up to
+ * io_combine_limit blocks, which saves system calls and lets the kernel
+ * see the sequential access pattern.  The caller must make sure that all
+ * of the blocks exist.
+ *
+ * Temporary relations just read the blocks one at a time.
+ */
+void
+ReadBufferRange(Relation reln, ForkNumber forkNum, BlockNumber blockNum,
+				int nblocks, BufferAccessStrategy strategy, Buffer *buffers)
+{
+	SMgrRelation smgr;
+	BufferDesc *bufHdrs[MAX_IO_COMBINE_LIMIT];
+	bool		found[MAX_IO_COMBINE_LIMIT];
+	char	   *blocks[MAX_IO_COMBINE_LIMIT];
+	int			i;
+
+	StaticAssertStmt(MAX_IO_COMBINE_LIMIT <= MAX_FILE_IOV_BUFFERS,
+					 "io_combine_limit can exceed what FileReadV accepts");
+	Assert(nblocks > 0 && nblocks <= MAX_IO_COMBINE_LIMIT);
+
+	/* Open it at the smgr level if not already done */
+	RelationOpenSmgr(reln);
+	smgr = reln->rd_smgr;
+
+	if (RELATION_IS_OTHER_TEMP(reln))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("cannot access temporary tables of other sessions")));
+
+	if (SmgrIsTemp(smgr))
+	{
+		for (i = 0; i < nblocks; i++)
+			buffers[i] = ReadBufferExtended(reln, forkNum, blockNum + i,
+											RBM_NORMAL, strategy);
+		return;
+	}
+
+	/*
+	 * First pin a buffer for each block.  We don't start I/O on them yet,
+	 * since we mustn't wait for another backend's I/O while holding an
+	 * io_in_progress lock of our own.
+	 */
+	for (i = 0; i < nblocks; i++)
+	{
+		ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+		pgstat_count_buffer_read(reln);
+		bufHdrs[i] = BufferAlloc(smgr, reln->rd_rel->relpersistence, forkNum,
+								 blockNum + i, strategy, false, &found[i]);
+		buffers[i] = BufferDescriptorGetBuffer(bufHdrs[i]);
+	}
+
+	/* Now read in the missing blocks, combining adjacent ones */
+	i = 0;
+	while (i < nblocks)
+	{
+		instr_time	io_start,
+					io_time;
+		int			n;
+		int			j;
+
+		if (found[i] || !StartBufferIO(bufHdrs[i], true))
+		{
+			/* already valid, or someone else read it in meanwhile */
+			pgstat_count_buffer_hit(reln);
+			pgBufferUsage.shared_blks_hit++;
+			VacuumPageHit++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageHit;
+			i++;
+			continue;
+		}
+
+		/*
+		 * Add the following blocks to the read as long as we can start I/O
+		 * on them without waiting.
+		 */
+		blocks[0] = (char *) BufHdrGetBlock(bufHdrs[i]);
+		n = 1;
+		while (i + n < nblocks && n < io_combine_limit &&
+			   !found[i + n] && ConditionalStartBufferIO(bufHdrs[i + n], true))
+		{
+			blocks[n] = (char *) BufHdrGetBlock(bufHdrs[i + n]);
+			n++;
+		}
+
+		if (track_io_timing)
+			INSTR_TIME_SET_CURRENT(io_start);
+
+		smgrreadv(smgr, forkNum, blockNum + i, blocks, n);
+
+		if (track_io_timing)
+		{
+			INSTR_TIME_SET_CURRENT(io_time);
+			INSTR_TIME_SUBTRACT(io_time, io_start);
+			pgstat_count_buffer_read_time(INSTR_TIME_GET_MICROSEC(io_time));
+			INSTR_TIME_ADD(pgBufferUsage.blk_read_time, io_time);
+		}
+
+		for (j = 0; j < n; j++)
+		{
+			/* check for garbage data */
+			if (!PageIsVerified((Page) blocks[j], blockNum + i + j))
+			{
+				if (zero_damaged_pages)
+				{
+					ereport(WARNING,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("invalid page in block %u of relation %s; zeroing out page",
+									blockNum + i + j,
+									relpath(smgr->smgr_rnode, forkNum))));
+					MemSet(blocks[j], 0, BLCKSZ);
+				}
+				else
+					ereport(ERROR,
+							(errcode(ERRCODE_DATA_CORRUPTED),
+							 errmsg("invalid page in block %u of relation %s",
+									blockNum + i + j,
+									relpath(smgr->smgr_rnode, forkNum))));
+			}
+
+			/* Set BM_VALID, terminate IO, and wake up any waiters */
+			TerminateBufferIO(bufHdrs[i + j], false, BM_VALID);
+
+			pgBufferUsage.shared_blks_read++;
+			VacuumPageMiss++;
+			if (VacuumCostActive)
+				VacuumCostBalance += VacuumCostPageMiss;
+		}
+
+		i += n;
+	}
+}
+
 
 /*
  * ReadBuffer_common -- common logic for all ReadBuffer variants
@@ -743,7 +966,7 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		 * not currently in memory.
 		 */
 		bufHdr = BufferAlloc(smgr, relpersistence, forkNum, blockNum,
-							 strategy, &found);
+							 strategy, true, &found);
 		if (found)
 			pgBufferUsage.shared_blks_hit++;
 		else
@@ -978,6 +1201,10 @@ ReadBuffer_common(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
  * set TRUE.  Otherwise, *foundPtr is set FALSE and the buffer is marked
  * as IO_IN_PROGRESS; ReadBuffer will now need to do I/O to fill it.
  *
+ * If start_io is false, the buffer is not marked as IO_IN_PROGRESS, and
+ * *foundPtr is FALSE whenever the buffer isn't valid yet; the caller must
+ * do StartBufferIO itself before reading the page.
+ *
  * *foundPtr is actually redundant with the buffer's BM_VALID flag, but
  * we keep it for simplicity in ReadBuffer.
  *
@@ -987,7 +1214,7 @@ static BufferDesc *
 BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			BlockNumber blockNum,
 			BufferAccessStrategy strategy,
-			bool *foundPtr)
+			bool start_io, bool *foundPtr)
 {
 	BufferTag	newTag;			/* identity of requested block */
 	uint32		newHash;		/* hash value for newTag */
@@ -998,7 +1225,9 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	uint32		oldFlags;
 	int			buf_id;
 	BufferDesc *buf;
+	bool		found;
 	bool		valid;
+	bool		probation;
 	uint32		buf_state;
 
 	/* create a tag so we can lookup the buffer */
@@ -1008,23 +1237,52 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	newHash = BufTableHashCode(&newTag);
 	newPartitionLock = BufMappingPartitionLock(newHash);
 
-	/* see if the block is in the buffer pool already */
-	LWLockAcquire(newPartitionLock, LW_SHARED);
-	buf_id = BufTableLookup(&newTag, newHash);
-	if (buf_id >= 0)
+	/*
+	 * See if the block is in the buffer pool already.  First try without the
+	 * mapping lock.  If we find a buffer that way, it could have been given
+	 * to another page before we manage to pin it; but once we hold a pin,
+	 * its tag can't change anymore, so it's enough to check the tag then.
+	 */
+	buf = NULL;
+	valid = false;
+	found = BufTableLookupNoLock(&newTag, newHash, &buf_id);
+	if (found && buf_id >= 0)
 	{
-		/*
-		 * Found it.  Now, pin the buffer so no one can steal it from the
-		 * buffer pool, and check to see if the correct data has been loaded
-		 * into the buffer.
-		 */
 		buf = GetBufferDescriptor(buf_id);
 
 		valid = PinBuffer(buf, strategy);
 
-		/* Can release the mapping lock as soon as we've pinned it */
+		if (!BUFFERTAGS_EQUAL(buf->tag, newTag) ||
+			!(pg_atomic_read_u32(&buf->state) & BM_TAG_VALID))
+		{
+			UnpinBuffer(buf, true);
+			found = false;
+		}
+	}
+
+	if (!found)
+	{
+		/*
+		 * Look it up again holding the mapping lock.  If found, pin the
+		 * buffer before releasing the lock, so no one can steal it from the
+		 * buffer pool.
+		 */
+		LWLockAcquire(newPartitionLock, LW_SHARED);
+		buf_id = BufTableLookup(&newTag, newHash);
+		if (buf_id >= 0)
+		{
+			buf = GetBufferDescriptor(buf_id);
+			valid = PinBuffer(buf, strategy);
+		}
 		LWLockRelease(newPartitionLock);
+	}
 
+	if (buf_id >= 0)
+	{
+		/*
+		 * Found it.  Check to see if the correct data has been loaded into
+		 * the buffer.
+		 */
 		*foundPtr = TRUE;
 
 		if (!valid)
@@ -1036,7 +1294,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 			 * own read attempt if the page is still not BM_VALID.
 			 * StartBufferIO does it all.
 			 */
-			if (StartBufferIO(buf, true))
+			if (!start_io || StartBufferIO(buf, true))
 			{
 				/*
 				 * If we get here, previous attempts to read the buffer must
@@ -1051,9 +1309,11 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 
 	/*
 	 * Didn't find it in the buffer pool.  We'll have to initialize a new
-	 * buffer.  Remember to unlock the mapping lock while doing the work.
+	 * buffer.
 	 */
-	LWLockRelease(newPartitionLock);
+
+	/* Ask the replacement strategy whether the page starts on probation */
+	probation = StrategyAdmitBuffer(strategy, newHash);
 
 	/* Loop here in case we have to try another victim buffer */
 	for (;;)
@@ -1248,7 +1508,7 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				 * then set up our own read attempt if the page is still not
 				 * BM_VALID.  StartBufferIO does it all.
 				 */
-				if (StartBufferIO(buf, true))
+				if (!start_io || StartBufferIO(buf, true))
 				{
 					/*
 					 * If we get here, previous attempts to read the buffer
@@ -1291,7 +1551,8 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 	 * Clearing BM_VALID here is necessary, clearing the dirtybits is just
 	 * paranoia.  We also reset the usage_count since any recency of use of
 	 * the old content is no longer relevant.  (The usage_count starts out at
-	 * 1 so that the buffer can survive one clock-sweep pass.)
+	 * 1 so that the buffer can survive one clock-sweep pass, except for
+	 * buffers that the replacement strategy puts on probation.)
 	 *
 	 * Make sure BM_PERMANENT is set for buffers that must be written at every
 	 * checkpoint.  Unlogged buffers only need to be written at shutdown
@@ -1303,9 +1564,11 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 				   BM_CHECKPOINT_NEEDED | BM_IO_ERROR | BM_PERMANENT |
 				   BUF_USAGECOUNT_MASK);
 	if (relpersistence == RELPERSISTENCE_PERMANENT || forkNum == INIT_FORKNUM)
-		buf_state |= BM_TAG_VALID | BM_PERMANENT | BUF_USAGECOUNT_ONE;
+		buf_state |= BM_TAG_VALID | BM_PERMANENT;
 	else
-		buf_state |= BM_TAG_VALID | BUF_USAGECOUNT_ONE;
+		buf_state |= BM_TAG_VALID;
+	if (!probation)
+		buf_state += BUF_USAGECOUNT_ONE;
 
 	UnlockBufHdr(buf, buf_state);
 
@@ -1314,16 +1577,20 @@ BufferAlloc(SMgrRelation smgr, char relpersistence, ForkNumber forkNum,
 		BufTableDelete(&oldTag, oldHash);
 		if (oldPartitionLock != newPartitionLock)
 			LWLockRelease(oldPartitionLock);
+		StrategyBufferEvicted(strategy, oldHash);
 	}
 
 	LWLockRelease(newPartitionLock);
 
+	if (probation)
+		StrategyAddProbationBuffer(buf);
+
 	/*
 	 * Buffer contents are currently invalid.  Try to get the io_in_progress
 	 * lock.  If StartBufferIO returns false, then someone else managed to
 	 * read it before we did, so there's nothing left for BufferAlloc() to do.
 	 */
-	if (StartBufferIO(buf, true))
+	if (!start_io || StartBufferIO(buf, true))
 		*foundPtr = FALSE;
 	else
 		*foundPtr = TRUE;
@@ -1786,6 +2053,7 @@ BufferSync(int flags)
 	CkptTsStatus *per_ts_stat = NULL;
 	Oid			last_tsid;
 	binaryheap *ts_heap;
+	int			nitems;
 	int			i;
 	int			mask = BM_DIRTY;
 	WritebackContext wb_context;
@@ -1979,9 +2247,42 @@ BufferSync(int flags)
 		 * write the buffer though we didn't need to.  It doesn't seem worth
 		 * guarding against this, though.
 		 */
+		nitems = 1;
 		if (pg_atomic_read_u32(&bufHdr->state) & BM_CHECKPOINT_NEEDED)
 		{
-			if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
+			int			nrun = 1;
+
+			/*
+			 * Since the buffers are sorted by block number, dirty neighbors
+			 * on disk are next to each other in CkptBufferIds.  Gather the
+			 * following ones that still need writing, so that they can be
+			 * written with a single system call.
+			 */
+			while (nrun < io_combine_limit &&
+				   ts_stat->num_scanned + nrun < ts_stat->num_to_scan)
+			{
+				CkptSortItem *prev = &CkptBufferIds[ts_stat->index + nrun - 1];
+				CkptSortItem *next = &CkptBufferIds[ts_stat->index + nrun];
+
+				if (next->relNode != prev->relNode ||
+					next->forkNum != prev->forkNum ||
+					next->blockNum != prev->blockNum + 1 ||
+					!(pg_atomic_read_u32(&GetBufferDescriptor(next->buf_id)->state) &
+					  BM_CHECKPOINT_NEEDED))
+					break;
+				nrun++;
+			}
+
+			if (nrun > 1)
+			{
+				int			nrunwritten;
+
+				nitems = SyncBufferRun(&CkptBufferIds[ts_stat->index], nrun,
+									   &wb_context, &nrunwritten);
+				BgWriterStats.m_buf_written_checkpoints += nrunwritten;
+				num_written += nrunwritten;
+			}
+			else if (SyncOneBuffer(buf_id, false, &wb_context) & BUF_WRITTEN)
 			{
 				TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(buf_id);
 				BgWriterStats.m_buf_written_checkpoints++;
@@ -1993,9 +2294,10 @@ BufferSync(int flags)
 		 * Measure progress independent of actually having to flush the buffer
 		 * - otherwise writing become unbalanced.
 		 */
-		ts_stat->progress += ts_stat->progress_slice;
-		ts_stat->num_scanned++;
-		ts_stat->index++;
+		num_processed += nitems - 1;
+		ts_stat->progress += ts_stat->progress_slice * nitems;
+		ts_stat->num_scanned += nitems;
+		ts_stat->index += nitems;
 
 		/* Have all the buffers from the tablespace been processed? */
 		if (ts_stat->num_scanned == ts_stat->num_to_scan)
@@ -2404,6 +2706,226 @@ SyncOneBuffer(int buf_id, bool skip_recently_used, WritebackContext *wb_context)
 	return result | BUF_WRITTEN;
 }
 
+/*
+ * SyncBufferRun -- process a run of checkpoint buffers holding consecutive
+ *		blocks of one relation fork
+ *
+ * This is like calling SyncOneBuffer on each of the items in turn, but the
+ * buffers are written out with a single vectored write, after flushing WAL
+ * only once.  To avoid deadlocks we never wait for the content or I/O lock
+ * of any buffer but the first, so the run may end early; in that case, and
+ * if a buffer has been replaced or cleaned meanwhile, the remaining items
+ * are left for the caller to process.  Returns the number of items dealt
+ * with (at least one), and sets *nwritten to the number of buffers written.
+ *
+ * Note: caller must have done ResourceOwnerEnlargeBuffers.
+ */
+static int
+SyncBufferRun(CkptSortItem *items, int nitems, WritebackContext *wb_context,
+			  int *nwritten)
+{
+	static char *checksum_copies = NULL;
+	BufferDesc *bufs[MAX_IO_COMBINE_LIMIT];
+	char	   *pages[MAX_IO_COMBINE_LIMIT];
+	BufferTag	tag;
+	SMgrRelation reln;
+	XLogRecPtr	recptr = InvalidXLogRecPtr;
+	ErrorContextCallback errcallback;
+	instr_time	io_start,
+				io_time;
+	uint32		buf_state;
+	int			nbufs;
+	int			i;
+
+	Assert(nitems > 1 && nitems <= MAX_IO_COMBINE_LIMIT);
+
+	*nwritten = 0;
+
+	/*
+	 * Pin, share-lock and start I/O on as many of the buffers as we can, in
+	 * block order.  As in SyncOneBuffer, we skip buffers that turn out to be
+	 * clean; we also stop at one that no longer holds the block we expect.
+	 */
+	for (nbufs = 0; nbufs < nitems; nbufs++)
+	{
+		BufferDesc *buf = GetBufferDescriptor(items[nbufs].buf_id);
+
+		if (nbufs > 0)
+			ResourceOwnerEnlargeBuffers(CurrentResourceOwner);
+		ReservePrivateRefCountEntry();
+
+		buf_state = LockBufHdr(buf);
+
+		if (nbufs == 0)
+		{
+			tag = buf->tag;
+			if (tag.rnode.spcNode != items[0].tsId ||
+				tag.rnode.relNode != items[0].relNode ||
+				tag.forkNum != items[0].forkNum ||
+				tag.blockNum != items[0].blockNum)
+			{
+				UnlockBufHdr(buf, buf_state);
+				break;
+			}
+		}
+		else
+		{
+			tag.blockNum++;
+			if (!BUFFERTAGS_EQUAL(buf->tag, tag))
+			{
+				UnlockBufHdr(buf, buf_state);
+				break;
+			}
+		}
+
+		if (!(buf_state & BM_VALID) || !(buf_state & BM_DIRTY))
+		{
+			UnlockBufHdr(buf, buf_state);
+			break;
+		}
+
+		PinBuffer_Locked(buf);
+
+		if (nbufs == 0)
+		{
+			LWLockAcquire(BufferDescriptorGetContentLock(buf), LW_SHARED);
+			if (!StartBufferIO(buf, false))
+			{
+				LWLockRelease(BufferDescriptorGetContentLock(buf));
+				UnpinBuffer(buf, true);
+				break;
+			}
+		}
+		else
+		{
+			if (!LWLockConditionalAcquire(BufferDescriptorGetContentLock(buf),
+										  LW_SHARED))
+			{
+				UnpinBuffer(buf, true);
+				break;
+			}
+			if (!ConditionalStartBufferIO(buf, false))
+			{
+				LWLockRelease(BufferDescriptorGetContentLock(buf));
+				UnpinBuffer(buf, true);
+				break;
+			}
+		}
+
+		bufs[nbufs] = buf;
+	}
+
+	/* If we couldn't write even the first buffer, we're done with it */
+	if (nbufs == 0)
+		return 1;
+
+	/* Setup error traceback support for ereport() */
+	errcallback.callback = shared_buffer_write_error_callback;
+	errcallback.arg = (void *) bufs[0];
+	errcallback.previous = error_context_stack;
+	error_context_stack = &errcallback;
+
+	reln = smgropen(bufs[0]->tag.rnode, InvalidBackendId);
+
+	/*
+	 * Find the highest LSN of the permanent buffers, and clear
+	 * BM_JUST_DIRTIED, as in FlushBuffer.
+	 */
+	for (i = 0; i < nbufs; i++)
+	{
+		XLogRecPtr	lsn;
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_START(bufs[i]->tag.forkNum,
+											bufs[i]->tag.blockNum,
+											reln->smgr_rnode.node.spcNode,
+											reln->smgr_rnode.node.dbNode,
+											reln->smgr_rnode.node.relNode);
+
+		buf_state = LockBufHdr(bufs[i]);
+		lsn = BufferGetLSN(bufs[i]);
+		buf_state &= ~BM_JUST_DIRTIED;
+		UnlockBufHdr(bufs[i], buf_state);
+
+		if ((buf_state & BM_PERMANENT) && lsn > recptr)
+			recptr = lsn;
+	}
+
+	/* One WAL flush covers the whole run */
+	if (!XLogRecPtrIsInvalid(recptr))
+		XLogFlush(recptr);
+
+	/*
+	 * PageSetChecksumCopy has only room for one page, so make our own copies
+	 * if we do checksumming.
+	 */
+	if (DataChecksumsEnabled() && checksum_copies == NULL)
+		checksum_copies = (char *)
+			TYPEALIGN(PG_IO_ALIGN_SIZE,
+					  MemoryContextAlloc(TopMemoryContext,
+										 MAX_IO_COMBINE_LIMIT * BLCKSZ +
+										 PG_IO_ALIGN_SIZE));
+
+	for (i = 0; i < nbufs; i++)
+	{
+		pages[i] = (char *) BufHdrGetBlock(bufs[i]);
+		if (DataChecksumsEnabled() && !PageIsNew((Page) pages[i]))
+		{
+			char	   *copy = checksum_copies + i * BLCKSZ;
+
+			memcpy(copy, pages[i], BLCKSZ);
+			PageSetChecksumInplace((Page) copy, bufs[i]->tag.blockNum);
+			pages[i] = copy;
+		}
+	}
+
+	if (track_io_timing)
+		INSTR_TIME_SET_CURRENT(io_start);
+
+	smgrwritev(reln, bufs[0]->tag.forkNum, bufs[0]->tag.blockNum,
+			   pages, nbufs, false);
+
+	if (track_io_timing)
+	{
+		INSTR_TIME_SET_CURRENT(io_time);
+		INSTR_TIME_SUBTRACT(io_time, io_start);
+		pgstat_count_buffer_write_time(INSTR_TIME_GET_MICROSEC(io_time));
+		INSTR_TIME_ADD(pgBufferUsage.blk_write_time, io_time);
+	}
+
+	pgBufferUsage.shared_blks_written += nbufs;
+
+	for (i = 0; i < nbufs; i++)
+	{
+		TerminateBufferIO(bufs[i], true, 0);
+
+		TRACE_POSTGRESQL_BUFFER_FLUSH_DONE(bufs[i]->tag.forkNum,
+										   bufs[i]->tag.blockNum,
+										   reln->smgr_rnode.node.spcNode,
+										   reln->smgr_rnode.node.dbNode,
+										   reln->smgr_rnode.node.relNode);
+	}
+
+	/* Pop the error context stack */
+	error_context_stack = errcallback.previous;
+
+	for (i = 0; i < nbufs; i++)
+	{
+		LWLockRelease(BufferDescriptorGetContentLock(bufs[i]));
+
+		tag = bufs[i]->tag;
+
+		UnpinBuffer(bufs[i], true);
+
+		ScheduleBufferTagForWriteback(wb_context, &tag);
+
+		TRACE_POSTGRESQL_BUFFER_SYNC_WRITTEN(items[i].buf_id);
+	}
+
+	*nwritten = nbufs;
+
+	return nbufs;
+}
+
 /*
  *		AtEOXact_Buffers - clean up at end of transaction.
  *
@@ -2873,16 +3395,17 @@ BufferGetLSNAtomic(Buffer buffer)
  *		that no other process could be trying to load more pages of the
  *		relation into buffers.
  *
- *		XXX currently it sequentially searches the buffer pool, should be
- *		changed to more clever ways of searching.  However, this routine
- *		is used only in code paths that aren't very performance-critical,
- *		and we shouldn't slow down the hot paths to make it faster ...
+ *		If only a few blocks are to be dropped, we look each of them up in
+ *		the buffer mapping table; see DropRelFileNodeForkSize.  Otherwise we
+ *		sequentially search the buffer pool.
  * --------------------------------------------------------------------
  */
 void
-DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
+DropRelFileNodeBuffers(SMgrRelation smgr_reln, ForkNumber forkNum,
 					   BlockNumber firstDelBlock)
 {
+	RelFileNodeBackend rnode = smgr_reln->smgr_rnode;
+	BlockNumber nForkBlocks;
 	int			i;
 
 	/* If it's a local relation, it's localbuf.c's problem. */
@@ -2893,6 +3416,16 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
 		return;
 	}
 
+	nForkBlocks = DropRelFileNodeForkSize(smgr_reln, forkNum);
+	if (nForkBlocks != InvalidBlockNumber &&
+		(nForkBlocks <= firstDelBlock ||
+		 nForkBlocks - firstDelBlock < BUF_DROP_FULL_SCAN_THRESHOLD))
+	{
+		FindAndDropRelFileNodeBuffers(rnode.node, forkNum, nForkBlocks,
+									  firstDelBlock);
+		return;
+	}
+
 	for (i = 0; i < NBuffers; i++)
 	{
 		BufferDesc *bufHdr = GetBufferDescriptor(i);
@@ -2937,28 +3470,35 @@ DropRelFileNodeBuffers(RelFileNodeBackend rnode, ForkNumber forkNum,
  * --------------------------------------------------------------------
  */
 void
-DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
+DropRelFileNodesAllBuffers(SMgrRelation *smgr_reln, int nnodes)
 {
 	int			i,
 				n = 0;
+	SMgrRelation *rels;
 	RelFileNode *nodes;
+	BlockNumber (*nForkBlocks)[MAX_FORKNUM + 1];
+	uint64		nBlocksToInvalidate = 0;
+	bool		sizes_known = true;
 	bool		use_bsearch;
+	ForkNumber	forkNum;
 
 	if (nnodes == 0)
 		return;
 
-	nodes = palloc(sizeof(RelFileNode) * nnodes);	/* non-local relations */
+	rels = palloc(sizeof(SMgrRelation) * nnodes);	/* non-local relations */
 
 	/* If it's a local relation, it's localbuf.c's problem. */
 	for (i = 0; i < nnodes; i++)
 	{
-		if (RelFileNodeBackendIsTemp(rnodes[i]))
+		RelFileNodeBackend rnode = smgr_reln[i]->smgr_rnode;
+
+		if (RelFileNodeBackendIsTemp(rnode))
 		{
-			if (rnodes[i].backend == MyBackendId)
-				DropRelFileNodeAllLocalBuffers(rnodes[i].node);
+			if (rnode.backend == MyBackendId)
+				DropRelFileNodeAllLocalBuffers(rnode.node);
 		}
 		else
-			nodes[n++] = rnodes[i].node;
+			rels[n++] = smgr_reln[i];
 	}
 
 	/*
@@ -2967,10 +3507,51 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 	 */
 	if (n == 0)
 	{
-		pfree(nodes);
+		pfree(rels);
 		return;
 	}
 
+	/*
+	 * If the relations are small enough, look up their blocks one by one,
+	 * as in DropRelFileNodeBuffers.
+	 */
+	nForkBlocks = palloc(sizeof(BlockNumber) * n * (MAX_FORKNUM + 1));
+	for (i = 0; i < n && sizes_known; i++)
+	{
+		for (forkNum = 0; forkNum <= MAX_FORKNUM; forkNum++)
+		{
+			nForkBlocks[i][forkNum] = DropRelFileNodeForkSize(rels[i], forkNum);
+			if (nForkBlocks[i][forkNum] == InvalidBlockNumber)
+			{
+				sizes_known = false;
+				break;
+			}
+			nBlocksToInvalidate += nForkBlocks[i][forkNum];
+		}
+	}
+
+	if (sizes_known && nBlocksToInvalidate < BUF_DROP_FULL_SCAN_THRESHOLD)
+	{
+		for (i = 0; i < n; i++)
+		{
+			for (forkNum = 0; forkNum <= MAX_FORKNUM; forkNum++)
+				FindAndDropRelFileNodeBuffers(rels[i]->smgr_rnode.node,
+											  forkNum,
+											  nForkBlocks[i][forkNum], 0);
+		}
+
+		pfree(nForkBlocks);
+		pfree(rels);
+		return;
+	}
+
+	pfree(nForkBlocks);
+
+	nodes = palloc(sizeof(RelFileNode) * n);
+	for (i = 0; i < n; i++)
+		nodes[i] = rels[i]->smgr_rnode.node;
+	pfree(rels);
+
 	/*
 	 * For low number of relations to drop just use a simple walk through, to
 	 * save the bsearch overhead. The threshold to use is rather a guess than
@@ -3028,6 +3609,97 @@ DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes)
 	pfree(nodes);
 }
 
+/*
+ * DropRelFileNodeForkSize
+ *		Get the size of a relation fork whose buffers are to be dropped, or
+ *		InvalidBlockNumber if we can't rely on it.
+ *
+ * Knowing the size, we can drop the fork's buffers by looking up each of its
+ * blocks, instead of scanning the whole buffer pool.  That's correct only if
+ * there can't be buffers for blocks past the size we use.  Outside recovery,
+ * a backend can have a dirty buffer for a block whose smgrextend failed, or
+ * another backend can be extending the relation while we ask for its size,
+ * so the size of the file proves nothing.  During recovery, the startup
+ * process is the only one that reads or extends relations, and the size it
+ * has cached is exactly what it has extended them to.  So we only use the
+ * cached size, which smgrnblocks_cached() provides only in recovery, and do
+ * a full scan otherwise.  A fork that the startup process hasn't looked at
+ * and that doesn't exist has no buffers.
+ */
+static BlockNumber
+DropRelFileNodeForkSize(SMgrRelation smgr_reln, ForkNumber forkNum)
+{
+	BlockNumber nblocks = smgrnblocks_cached(smgr_reln, forkNum);
+
+	if (nblocks == InvalidBlockNumber && InRecovery &&
+		!smgrexists(smgr_reln, forkNum))
+		return 0;
+
+	return nblocks;
+}
+
+/*
+ * FindAndDropRelFileNodeBuffers
+ *		Drop the buffers of blocks firstDelBlock .. nForkBlocks - 1 of the
+ *		given relation fork, looking up each block in the buffer mapping
+ *		table.
+ *
+ * As in DropRelFileNodeBuffers, no one can be loading new pages of the
+ * relation, so a block we don't find can't appear later.
+ */
+static void
+FindAndDropRelFileNodeBuffers(RelFileNode rnode, ForkNumber forkNum,
+							  BlockNumber nForkBlocks,
+							  BlockNumber firstDelBlock)
+{
+	BlockNumber curBlock;
+
+	for (curBlock = firstDelBlock; curBlock < nForkBlocks; curBlock++)
+	{
+		BufferTag	bufTag;		/* identity of requested block */
+		uint32		bufHash;	/* hash value for tag */
+		LWLock	   *bufPartitionLock;	/* buffer partition lock for it */
+		int			buf_id;
+		BufferDesc *bufHdr;
+		uint32		buf_state;
+
+		/* create a tag so we can lookup the buffer */
+		INIT_BUFFERTAG(bufTag, rnode, forkNum, curBlock);
+
+		/* determine its hash code and partition lock ID */
+		bufHash = BufTableHashCode(&bufTag);
+		bufPartitionLock = BufMappingPartitionLock(bufHash);
+
+		/* Check that it is in the buffer pool. If not, do nothing. */
+		if (!BufTableLookupNoLock(&bufTag, bufHash, &buf_id))
+		{
+			LWLockAcquire(bufPartitionLock, LW_SHARED);
+			buf_id = BufTableLookup(&bufTag, bufHash);
+			LWLockRelease(bufPartitionLock);
+		}
+
+		if (buf_id < 0)
+			continue;
+
+		bufHdr = GetBufferDescriptor(buf_id);
+
+		/*
+		 * We need to lock the buffer header and recheck if the buffer is
+		 * still associated with the same block because the buffer could be
+		 * evicted by some other backend loading blocks for some other
+		 * relation after we release the lock on the BufMapping table.
+		 */
+		buf_state = LockBufHdr(bufHdr);
+
+		if (RelFileNodeEquals(bufHdr->tag.rnode, rnode) &&
+			bufHdr->tag.forkNum == forkNum &&
+			bufHdr->tag.blockNum >= firstDelBlock)
+			InvalidateBuffer(bufHdr);	/* releases spinlock */
+		else
+			UnlockBufHdr(bufHdr, buf_state);
+	}
+}
+
 /* ---------------------------------------------------------------------
  *		DropDatabaseBuffers
  *
@@ -3876,7 +4548,7 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 {
 	uint32		buf_state;
 
-	Assert(!InProgressBuf);
+	Assert(NumInProgressBufs == 0);
 
 	for (;;)
 	{
@@ -3915,12 +4587,51 @@ StartBufferIO(BufferDesc *buf, bool forInput)
 	buf_state |= BM_IO_IN_PROGRESS;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = buf;
+	InProgressBufs[NumInProgressBufs++] = buf;
 	IsForInput = forInput;
 
 	return true;
 }
 
+/*
+ * ConditionalStartBufferIO: begin I/O on another buffer
+ *
+ * Like StartBufferIO, but used by ReadBufferRange and SyncBufferRun to add
+ * more buffers to a read or write that already has I/O in progress on at
+ * least one.  Since we're holding other io_in_progress locks, we mustn't
+ * wait for anyone; if the lock isn't immediately available, or someone else
+ * has already done the I/O or is doing it, we return FALSE and the caller
+ * ends the I/O before this buffer.
+ */
+static bool
+ConditionalStartBufferIO(BufferDesc *buf, bool forInput)
+{
+	uint32		buf_state;
+
+	Assert(NumInProgressBufs > 0 && NumInProgressBufs < MAX_IO_COMBINE_LIMIT);
+	Assert(IsForInput == forInput);
+
+	if (!LWLockConditionalAcquire(BufferDescriptorGetIOLock(buf), LW_EXCLUSIVE))
+		return false;
+
+	buf_state = LockBufHdr(buf);
+
+	if ((buf_state & BM_IO_IN_PROGRESS) ||
+		(forInput ? (buf_state & BM_VALID) : !(buf_state & BM_DIRTY)))
+	{
+		UnlockBufHdr(buf, buf_state);
+		LWLockRelease(BufferDescriptorGetIOLock(buf));
+		return false;
+	}
+
+	buf_state |= BM_IO_IN_PROGRESS;
+	UnlockBufHdr(buf, buf_state);
+
+	InProgressBufs[NumInProgressBufs++] = buf;
+
+	return true;
+}
+
 /*
  * TerminateBufferIO: release a buffer we were doing I/O on
  *	(Assumptions)
@@ -3942,8 +4653,14 @@ static void
 TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 {
 	uint32		buf_state;
+	int			i;
 
-	Assert(buf == InProgressBuf);
+	for (i = NumInProgressBufs - 1; i >= 0; i--)
+	{
+		if (InProgressBufs[i] == buf)
+			break;
+	}
+	Assert(i >= 0);
 
 	buf_state = LockBufHdr(buf);
 
@@ -3956,7 +4673,7 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 	buf_state |= set_flag_bits;
 	UnlockBufHdr(buf, buf_state);
 
-	InProgressBuf = NULL;
+	InProgressBufs[i] = InProgressBufs[--NumInProgressBufs];
 
 	LWLockRelease(BufferDescriptorGetIOLock(buf));
 }
@@ -3973,10 +4690,9 @@ TerminateBufferIO(BufferDesc *buf, bool clear_dirty, uint32 set_flag_bits)
 void
 AbortBufferIO(void)
 {
-	BufferDesc *buf = InProgressBuf;
-
-	if (buf)
+	while (NumInProgressBufs > 0)
 	{
+		BufferDesc *buf = InProgressBufs[NumInProgressBufs - 1];
 		uint32		buf_state;
 
 		/*
@@ -15,6 +15,7 @@
  */
 #include "postgres.h"
 
+#include "miscadmin.h"
 #include "port/atomics.h"
 #include "storage/buf_internals.h"
 #include "storage/bufmgr.h"
@@ -22,6 +23,25 @@
 
 #define INT_ACCESS_ONCE(var)	((int)(*((volatile int *)&(var))))
 
+/*
+ * The clock sweep hand is advanced by this many buffers at a time, each
+ * backend then sweeping the buffers it claimed on its own.  That way
+ * backends don't all fight over nextVictimBuffer's cache line.
+ */
+#define CLOCK_SWEEP_BATCH_SIZE	32
+
+/*
+ * The 2Q probation queue is split into this many partitions, each with its
+ * own lock.  The replacement statistics are kept per partition too.
+ */
+#define NUM_STRATEGY_PARTITIONS 16
+
+/* Max # of probation queue entries StrategyGetBuffer looks at per call */
+#define PROBATION_MAX_TRIES		8
+
+/* GUC variable */
+int			buffer_replacement_policy = BUFFER_REPLACEMENT_CLOCK;
+
 
 /*
  * The shared freelist control information.
@@ -60,8 +80,63 @@ typedef struct
 	int			bgwprocno;
 } BufferStrategyControl;
 
+/*
+ * Per-partition state.
+ *
+ * Under the 2Q policy, a buffer that's filled with a page that hasn't been
+ * seen recently starts out with a usage_count of zero, and its ID is
+ * appended to the probation queue of partition buf_id %
+ * NUM_STRATEGY_PARTITIONS.  StrategyGetBuffer takes victims from the head
+ * of its backend's probation queue as long as the queue holds at least
+ * ProbationTarget entries, skipping the buffers that have been used again
+ * meanwhile.  So the pages of a large scan are recycled among themselves,
+ * without the clock sweep having to move past, and age, the frequently
+ * used buffers.  This is a cheap approximation of the 2Q algorithm: the
+ * probation queue is 2Q's A1in queue, and the ghost table of the hash
+ * codes of recently evicted pages stands in for A1out.  Queue entries are
+ * only hints; a buffer can be reused by the clock sweep while it's in the
+ * queue.
+ */
+typedef struct
+{
+	slock_t		lock;			/* protects head and count */
+	int			head;			/* index of oldest probation queue entry */
+	int			count;			/* # of probation queue entries */
+
+	/* statistics, see BufferReplacementStats */
+	pg_atomic_uint64 free_victims;
+	pg_atomic_uint64 clock_victims;
+	pg_atomic_uint64 clock_ticks;
+	pg_atomic_uint64 probation_victims;
+	pg_atomic_uint64 probation_promotions;
+	pg_atomic_uint64 ghost_hits;
+} StrategyPartition;
+
+/* Pad to a cache line, so that partitions don't share one */
+typedef union StrategyPartitionPadded
+{
+	StrategyPartition part;
+	char		pad[PG_CACHE_LINE_SIZE];
+} StrategyPartitionPadded;
+
 /* Pointers to shared state */
 static BufferStrategyControl *StrategyControl = NULL;
+static StrategyPartitionPadded *StrategyPartitions = NULL;
+static int *ProbationQueues = NULL;
+static uint32 *GhostHashes = NULL;
+
+/* Sizes of the 2Q structures, per partition for the probation queues */
+#define ProbationCapacity	Max(NBuffers / 2 / NUM_STRATEGY_PARTITIONS, 1)
+#define ProbationTarget		Max(NBuffers / 4 / NUM_STRATEGY_PARTITIONS, 1)
+#define NumGhostHashes		Max(NBuffers / 2, 1)
+
+/* The range of buffers this backend claimed from the clock sweep */
+static uint32 ClockSweepBatchNext = 0;
+static int	ClockSweepBatchRemaining = 0;
+
+/* The partition this backend takes probationary victims from */
+#define MyStrategyPartition() \
+	(&StrategyPartitions[MyProcPid % NUM_STRATEGY_PARTITIONS].part)
 
 /*
  * Private (non-shared) state for managing a ring of shared buffers to re-use.
@@ -102,46 +177,66 @@ static BufferDesc *GetBufferFromRing(BufferAccessStrategy strategy,
 				  uint32 *buf_state);
 static void AddBufferToRing(BufferAccessStrategy strategy,
 				BufferDesc *buf);
+static BufferDesc *GetBufferFromProbation(uint32 *buf_state);
 
 /*
  * ClockSweepTick - Helper routine for StrategyGetBuffer()
  *
- * Move the clock hand one buffer ahead of its current position and return the
- * id of the buffer now under the hand.
+ * Return the id of the next buffer to consider.  The buffers are taken from
+ * a batch of consecutive buffers that this backend claimed earlier; if
+ * that's used up, move the clock hand a batch ahead of its current position
+ * and claim the buffers it moved past.
  */
 static inline uint32
 ClockSweepTick(void)
 {
 	uint32		victim;
+	uint32		batch_end;
+	uint32		nextmult;
+	int			nbatch;
+
+	if (ClockSweepBatchRemaining > 0)
+	{
+		ClockSweepBatchRemaining--;
+		victim = ClockSweepBatchNext;
+		if (++ClockSweepBatchNext >= NBuffers)
+			ClockSweepBatchNext = 0;
+		return victim;
+	}
+
+	/* Don't let a few backends claim a large part of a small buffer pool */
+	nbatch = Max(Min(CLOCK_SWEEP_BATCH_SIZE, NBuffers / 512), 1);
 
 	/*
-	 * Atomically move hand ahead one buffer - if there's several processes
-	 * doing this, this can lead to buffers being returned slightly out of
-	 * apparent order.
+	 * Atomically move hand ahead - if there's several processes doing this,
+	 * this can lead to buffers being returned slightly out of apparent
+	 * order.
 	 */
 	victim =
-		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, 1);
+		pg_atomic_fetch_add_u32(&StrategyControl->nextVictimBuffer, nbatch);
+	batch_end = victim + nbatch;
 
-	if (victim >= NBuffers)
-	{
-		uint32		originalVictim = victim;
-
-		/* always wrap what we look up in BufferDescriptors */
-		victim = victim % NBuffers;
+	pg_atomic_fetch_add_u64(&MyStrategyPartition()->clock_ticks, nbatch);
 
+	if (batch_end > NBuffers)
+	{
 		/*
-		 * If we're the one that just caused a wraparound, force
-		 * completePasses to be incremented while holding the spinlock. We
-		 * need the spinlock so StrategySyncStart() can return a consistent
-		 * value consisting of nextVictimBuffer and completePasses.
+		 * If our batch includes the point where the hand wraps around, we
+		 * must force completePasses to be incremented while holding the
+		 * spinlock. We need the spinlock so StrategySyncStart() can return a
+		 * consistent value consisting of nextVictimBuffer and
+		 * completePasses.
 		 */
-		if (victim == 0)
+		nextmult = ((victim + NBuffers - 1) / NBuffers) * NBuffers;
+		if (nextmult == 0)
+			nextmult = NBuffers;
+		if (nextmult < batch_end)
 		{
 			uint32		expected;
 			uint32		wrapped;
 			bool		success = false;
 
-			expected = originalVictim + 1;
+			expected = batch_end;
 
 			while (!success)
 			{
@@ -164,7 +259,16 @@ ClockSweepTick(void)
 				SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 			}
 		}
+
+		/* always wrap what we look up in BufferDescriptors */
+		victim = victim % NBuffers;
 	}
+
+	ClockSweepBatchNext = victim + 1;
+	if (ClockSweepBatchNext >= NBuffers)
+		ClockSweepBatchNext = 0;
+	ClockSweepBatchRemaining = nbatch - 1;
+
 	return victim;
 }
 
@@ -287,6 +391,7 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 			{
 				if (strategy != NULL)
 					AddBufferToRing(strategy, buf);
+				pg_atomic_fetch_add_u64(&MyStrategyPartition()->free_victims, 1);
 				*buf_state = local_buf_state;
 				return buf;
 			}
@@ -295,6 +400,18 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 		}
 	}
 
+	/* Under the 2Q policy, recycle a probationary buffer if there's enough */
+	if (buffer_replacement_policy == BUFFER_REPLACEMENT_2Q)
+	{
+		buf = GetBufferFromProbation(buf_state);
+		if (buf != NULL)
+		{
+			if (strategy != NULL)
+				AddBufferToRing(strategy, buf);
+			return buf;
+		}
+	}
+
 	/* Nothing on the freelist, so run the "clock sweep" algorithm */
 	trycounter = NBuffers;
 	for (;;)
@@ -320,6 +437,7 @@ StrategyGetBuffer(BufferAccessStrategy strategy, uint32 *buf_state)
 				/* Found a usable buffer */
 				if (strategy != NULL)
 					AddBufferToRing(strategy, buf);
+				pg_atomic_fetch_add_u64(&MyStrategyPartition()->clock_victims, 1);
 				*buf_state = local_buf_state;
 				return buf;
 			}
@@ -363,6 +481,170 @@ StrategyFreeBuffer(BufferDesc *buf)
 	SpinLockRelease(&StrategyControl->buffer_strategy_lock);
 }
 
+/*
+ * GetBufferFromProbation -- take a victim from the probation queue
+ *
+ * Returns NULL if this backend's probation queue partition holds fewer
+ * than ProbationTarget entries, or we couldn't find a usable buffer in it
+ * quickly.  Otherwise, the returned buffer's header spinlock is held.
+ */
+static BufferDesc *
+GetBufferFromProbation(uint32 *buf_state)
+{
+	int			partno = MyProcPid % NUM_STRATEGY_PARTITIONS;
+	StrategyPartition *part = &StrategyPartitions[partno].part;
+	int		   *queue = ProbationQueues + partno * ProbationCapacity;
+	int			tries;
+
+	for (tries = 0; tries < PROBATION_MAX_TRIES; tries++)
+	{
+		BufferDesc *buf;
+		uint32		local_buf_state;
+
+		/* Check without the lock first, like for the freelist */
+		if (INT_ACCESS_ONCE(part->count) < ProbationTarget)
+			return NULL;
+
+		SpinLockAcquire(&part->lock);
+		if (part->count < ProbationTarget)
+		{
+			SpinLockRelease(&part->lock);
+			return NULL;
+		}
+		buf = GetBufferDescriptor(queue[part->head]);
+		if (++part->head >= ProbationCapacity)
+			part->head = 0;
+		part->count--;
+		SpinLockRelease(&part->lock);
+
+		local_buf_state = LockBufHdr(buf);
+		if (BUF_STATE_GET_USAGECOUNT(local_buf_state) != 0)
+		{
+			/* Used again, so it stays in the buffer pool */
+			UnlockBufHdr(buf, local_buf_state);
+			pg_atomic_fetch_add_u64(&part->probation_promotions, 1);
+			continue;
+		}
+		if (BUF_STATE_GET_REFCOUNT(local_buf_state) == 0)
+		{
+			pg_atomic_fetch_add_u64(&part->probation_victims, 1);
+			*buf_state = local_buf_state;
+			return buf;
+		}
+
+		/* Pinned, most likely still being read for the first time */
+		UnlockBufHdr(buf, local_buf_state);
+		StrategyAddProbationBuffer(buf);
+	}
+
+	return NULL;
+}
+
+/*
+ * StrategyAdmitBuffer -- should a page being read in start on probation?
+ *
+ * Called by BufferAlloc when a page that isn't in the buffer pool needs a
+ * buffer.  hashcode is the page's buffer tag hash code.  Returns
+ * true if the buffer should start with a usage_count of zero and be put on
+ * the probation queue with StrategyAddProbationBuffer.  That's the case
+ * under the 2Q policy, unless the page was evicted recently or is being
+ * read using a buffer ring.
+ */
+bool
+StrategyAdmitBuffer(BufferAccessStrategy strategy, uint32 hashcode)
+{
+	uint32	   *ghost;
+
+	if (buffer_replacement_policy != BUFFER_REPLACEMENT_2Q || strategy != NULL)
+		return false;
+
+	ghost = &GhostHashes[hashcode % NumGhostHashes];
+	if (hashcode != 0 && *ghost == hashcode)
+	{
+		*ghost = 0;
+		pg_atomic_fetch_add_u64(&MyStrategyPartition()->ghost_hits, 1);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * StrategyAddProbationBuffer -- append a buffer to its probation queue
+ *
+ * If the queue is full, its oldest entry is dropped; that buffer is left to
+ * the clock sweep.
+ */
+void
+StrategyAddProbationBuffer(BufferDesc *buf)
+{
+	int			partno = buf->buf_id % NUM_STRATEGY_PARTITIONS;
+	StrategyPartition *part = &StrategyPartitions[partno].part;
+	int		   *queue = ProbationQueues + partno * ProbationCapacity;
+	int			tail;
+
+	Assert(buffer_replacement_policy == BUFFER_REPLACEMENT_2Q);
+
+	SpinLockAcquire(&part->lock);
+	if (part->count >= ProbationCapacity)
+	{
+		if (++part->head >= ProbationCapacity)
+			part->head = 0;
+		part->count--;
+	}
+	tail = part->head + part->count;
+	if (tail >= ProbationCapacity)
+		tail -= ProbationCapacity;
+	queue[tail] = buf->buf_id;
+	part->count++;
+	SpinLockRelease(&part->lock);
+}
+
+/*
+ * StrategyBufferEvicted -- remember a page that was evicted
+ *
+ * Called by BufferAlloc when it has taken a buffer away from the page with
+ * buffer tag hash code hashcode.  Under the 2Q policy, if the page is read
+ * back in soon, StrategyAdmitBuffer will let it skip probation.
+ *
+ * The ghost table is a simple array indexed by hash code, updated without
+ * locking; false positives and lost entries only make the policy a little
+ * less accurate.
+ */
+void
+StrategyBufferEvicted(BufferAccessStrategy strategy, uint32 hashcode)
+{
+	if (buffer_replacement_policy != BUFFER_REPLACEMENT_2Q || strategy != NULL)
+		return;
+
+	GhostHashes[hashcode % NumGhostHashes] = hashcode;
+}
+
+/*
+ * StrategyGetReplacementStats -- sum up the buffer replacement statistics
+ *
+ * The counters are reset only at server start.
+ */
+void
+StrategyGetReplacementStats(BufferReplacementStats *stats)
+{
+	int			i;
+
+	memset(stats, 0, sizeof(BufferReplacementStats));
+
+	for (i = 0; i < NUM_STRATEGY_PARTITIONS; i++)
+	{
+		StrategyPartition *part = &StrategyPartitions[i].part;
+
+		stats->free_victims += pg_atomic_read_u64(&part->free_victims);
+		stats->clock_victims += pg_atomic_read_u64(&part->clock_victims);
+		stats->clock_ticks += pg_atomic_read_u64(&part->clock_ticks);
+		stats->probation_victims += pg_atomic_read_u64(&part->probation_victims);
+		stats->probation_promotions += pg_atomic_read_u64(&part->probation_promotions);
+		stats->ghost_hits += pg_atomic_read_u64(&part->ghost_hits);
+	}
+}
+
 /*
  * StrategySyncStart -- tell BufferSync where to start syncing
  *
@@ -444,6 +726,18 @@ StrategyShmemSize(void)
 	/* size of the shared replacement strategy control block */
 	size = add_size(size, MAXALIGN(sizeof(BufferStrategyControl)));
 
+	/* size of the partitions */
+	size = add_size(size, mul_size(NUM_STRATEGY_PARTITIONS,
+								   sizeof(StrategyPartitionPadded)));
+
+	/* size of the 2Q probation queues and ghost table */
+	if (buffer_replacement_policy == BUFFER_REPLACEMENT_2Q)
+	{
+		size = add_size(size, mul_size(NUM_STRATEGY_PARTITIONS,
+									   mul_size(ProbationCapacity, sizeof(int))));
+		size = add_size(size, mul_size(NumGhostHashes, sizeof(uint32)));
+	}
+
 	return size;
 }
 
@@ -458,6 +752,8 @@ void
 StrategyInitialize(bool init)
 {
 	bool		found;
+	bool		foundParts;
+	int			i;
 
 	/*
 	 * Initialize the shared buffer lookup hashtable.
@@ -507,6 +803,42 @@ StrategyInitialize(bool init)
 	}
 	else
 		Assert(!init);
+
+	StrategyPartitions = (StrategyPartitionPadded *)
+		ShmemInitStruct("Buffer Strategy Partitions",
+						NUM_STRATEGY_PARTITIONS * sizeof(StrategyPartitionPadded),
+						&foundParts);
+
+	if (!foundParts)
+	{
+		for (i = 0; i < NUM_STRATEGY_PARTITIONS; i++)
+		{
+			StrategyPartition *part = &StrategyPartitions[i].part;
+
+			SpinLockInit(&part->lock);
+			part->head = 0;
+			part->count = 0;
+			pg_atomic_init_u64(&part->free_victims, 0);
+			pg_atomic_init_u64(&part->clock_victims, 0);
+			pg_atomic_init_u64(&part->clock_ticks, 0);
+			pg_atomic_init_u64(&part->probation_victims, 0);
+			pg_atomic_init_u64(&part->probation_promotions, 0);
+			pg_atomic_init_u64(&part->ghost_hits, 0);
+		}
+	}
+
+	if (buffer_replacement_policy == BUFFER_REPLACEMENT_2Q)
+	{
+		ProbationQueues = (int *)
+			ShmemInitStruct("Buffer Probation Queues",
+							NUM_STRATEGY_PARTITIONS * ProbationCapacity * sizeof(int),
+							&found);
+		GhostHashes = (uint32 *)
+			ShmemInitStruct("Buffer Ghost Hashes",
+							NumGhostHashes * sizeof(uint32), &found);
+		if (!found)
+			memset(GhostHashes, 0, NumGhostHashes * sizeof(uint32));
+	}
 }
 
 
@@ -584,6 +916,20 @@ FreeAccessStrategy(BufferAccessStrategy strategy)
 		pfree(strategy);
 }
 
+/*
+ * GetAccessStrategyBufferCount -- number of buffers in the strategy's ring
+ *
+ * Returns 0 for the "default" strategy, which has no ring.
+ */
+int
+GetAccessStrategyBufferCount(BufferAccessStrategy strategy)
+{
+	if (strategy == NULL)
+		return 0;
+
+	return strategy->ring_size;
+}
+
 /*
  * GetBufferFromRing -- returns a buffer from the ring, or NULL if the
  *		ring is empty.
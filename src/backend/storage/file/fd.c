@@ -63,6 +63,7 @@
 #include <sys/stat.h>
 #ifndef WIN32
 #include <sys/mman.h>
+#include <sys/uio.h>
 #endif
 #include <limits.h>
 #include <unistd.h>
@@ -82,6 +83,7 @@
 #include "storage/ipc.h"
 #include "utils/guc.h"
 #include "utils/resowner_private.h"
+#include "utils/varlena.h"
 
 
 /* Define PG_FLUSH_DATA_WORKS if we have an implementation for pg_flush_data */
@@ -138,6 +140,13 @@ int			max_files_per_process = 1000;
  */
 int			max_safe_fds = 32;	/* default if not changed */
 
+/*
+ * Which files to open with O_DIRECT, bypassing the kernel's page cache; see
+ * the io_direct GUC.  md.c and xlog.c check these flags when opening data
+ * files and WAL segments.
+ */
+int			io_direct_flags = 0;
+
 
 /* Debugging.... */
 
@@ -1705,6 +1714,117 @@ retry:
 	return returnCode;
 }
 
+/*
+ * FileReadV --- read into several buffers of 'amount' bytes each with a
+ * single system call where possible
+ *
+ * Like FileRead, but reads consecutive data from the current seek position
+ * into buffers[0], buffers[1], ... in turn.  Returns the total number of
+ * bytes read, which is less than nbuffers * amount only at EOF, or -1 on
+ * error.
+ */
+int
+FileReadV(File file, char **buffers, int nbuffers, int amount,
+		  uint32 wait_event_info)
+{
+	int			returnCode;
+	int			total = 0;
+	Vfd		   *vfdP;
+#ifndef WIN32
+	struct iovec iov[MAX_FILE_IOV_BUFFERS];
+	struct iovec *iovp = iov;
+	int			iovcnt = nbuffers;
+	int			i;
+#else
+	int			i = 0;
+#endif
+
+	Assert(FileIsValid(file));
+	Assert(nbuffers > 0 && nbuffers <= MAX_FILE_IOV_BUFFERS);
+
+	DO_DB(elog(LOG, "FileReadV: %d (%s) " INT64_FORMAT " %d*%d %p",
+			   file, VfdCache[file].fileName,
+			   (int64) VfdCache[file].seekPos,
+			   nbuffers, amount, buffers[0]));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	vfdP = &VfdCache[file];
+
+#ifndef WIN32
+	for (i = 0; i < nbuffers; i++)
+	{
+		iov[i].iov_base = buffers[i];
+		iov[i].iov_len = amount;
+	}
+#endif
+
+retry:
+	pgstat_report_wait_start(wait_event_info);
+#ifndef WIN32
+	returnCode = readv(vfdP->fd, iovp, iovcnt);
+#else
+	/* No readv() here, so read the buffers one at a time */
+	returnCode = read(vfdP->fd, buffers[i] + total % amount,
+					  amount - total % amount);
+#endif
+	pgstat_report_wait_end();
+
+	if (returnCode > 0)
+	{
+		/* if seekPos is unknown, leave it that way */
+		if (!FilePosIsUnknown(vfdP->seekPos))
+			vfdP->seekPos += returnCode;
+		total += returnCode;
+
+		/* Continue after a short read, until we hit EOF */
+		if (total < nbuffers * amount)
+		{
+#ifndef WIN32
+			while ((size_t) returnCode >= iovp->iov_len)
+			{
+				returnCode -= iovp->iov_len;
+				iovp++;
+				iovcnt--;
+			}
+			iovp->iov_base = (char *) iovp->iov_base + returnCode;
+			iovp->iov_len -= returnCode;
+#else
+			i = total / amount;
+#endif
+			goto retry;
+		}
+	}
+	else if (returnCode < 0)
+	{
+#ifdef WIN32
+		DWORD		error = GetLastError();
+
+		switch (error)
+		{
+			case ERROR_NO_SYSTEM_RESOURCES:
+				pg_usleep(1000L);
+				errno = EINTR;
+				break;
+			default:
+				_dosmaperr(error);
+				break;
+		}
+#endif
+		/* OK to retry if interrupted */
+		if (errno == EINTR)
+			goto retry;
+
+		/* Trouble, so assume we don't know the file position anymore */
+		vfdP->seekPos = FileUnknownPos;
+		return returnCode;
+	}
+
+	return total;
+}
+
 int
 FileWrite(File file, char *buffer, int amount, uint32 wait_event_info)
 {
@@ -1826,6 +1946,133 @@ retry:
 	return returnCode;
 }
 
+/*
+ * FileWriteV --- write several buffers of 'amount' bytes each with a single
+ * system call where possible
+ *
+ * Like FileWrite, but writes buffers[0], buffers[1], ... in turn, starting
+ * at the current seek position.  The same buffer may appear more than once.
+ * Returns the total number of bytes written, which is less than nbuffers *
+ * amount only if the disk is full, or -1 on error.  Not supported for
+ * temporary files, whose size we'd have to track.
+ */
+int
+FileWriteV(File file, char **buffers, int nbuffers, int amount,
+		   uint32 wait_event_info)
+{
+	int			returnCode;
+	int			total = 0;
+	Vfd		   *vfdP;
+#ifndef WIN32
+	struct iovec iov[MAX_FILE_IOV_BUFFERS];
+	struct iovec *iovp = iov;
+	int			iovcnt = nbuffers;
+	int			i;
+#else
+	int			i = 0;
+#endif
+
+	Assert(FileIsValid(file));
+	Assert(nbuffers > 0 && nbuffers <= MAX_FILE_IOV_BUFFERS);
+
+	DO_DB(elog(LOG, "FileWriteV: %d (%s) " INT64_FORMAT " %d*%d %p",
+			   file, VfdCache[file].fileName,
+			   (int64) VfdCache[file].seekPos,
+			   nbuffers, amount, buffers[0]));
+
+	returnCode = FileAccess(file);
+	if (returnCode < 0)
+		return returnCode;
+
+	vfdP = &VfdCache[file];
+	Assert(!(vfdP->fdstate & FD_TEMPORARY));
+
+#ifndef WIN32
+	for (i = 0; i < nbuffers; i++)
+	{
+		iov[i].iov_base = buffers[i];
+		iov[i].iov_len = amount;
+	}
+#endif
+
+retry:
+	errno = 0;
+	pgstat_report_wait_start(wait_event_info);
+#ifndef WIN32
+	returnCode = writev(vfdP->fd, iovp, iovcnt);
+#else
+	/* No writev() here, so write the buffers one at a time */
+	returnCode = write(vfdP->fd, buffers[i] + total % amount,
+					   amount - total % amount);
+#endif
+	pgstat_report_wait_end();
+
+	if (returnCode > 0)
+	{
+		/* if seekPos is unknown, leave it that way */
+		if (!FilePosIsUnknown(vfdP->seekPos))
+			vfdP->seekPos += returnCode;
+		total += returnCode;
+
+		/* Continue after a short write; the next try will report ENOSPC */
+		if (total < nbuffers * amount)
+		{
+#ifndef WIN32
+			while ((size_t) returnCode >= iovp->iov_len)
+			{
+				returnCode -= iovp->iov_len;
+				iovp++;
+				iovcnt--;
+			}
+			iovp->iov_base = (char *) iovp->iov_base + returnCode;
+			iovp->iov_len -= returnCode;
+#else
+			i = total / amount;
+#endif
+			goto retry;
+		}
+	}
+	else
+	{
+		/* if write didn't set errno, assume problem is no disk space */
+		if (errno == 0)
+		{
+			errno = ENOSPC;
+			return total;
+		}
+
+#ifdef WIN32
+		{
+			DWORD		error = GetLastError();
+
+			switch (error)
+			{
+				case ERROR_NO_SYSTEM_RESOURCES:
+					pg_usleep(1000L);
+					errno = EINTR;
+					break;
+				default:
+					_dosmaperr(error);
+					break;
+			}
+		}
+#endif
+		/* OK to retry if interrupted */
+		if (errno == EINTR)
+			goto retry;
+
+		/* Trouble, so assume we don't know the file position anymore */
+		vfdP->seekPos = FileUnknownPos;
+
+		/* Report a partial write the same way as FileWrite would */
+		if (total > 0 && errno == ENOSPC)
+			return total;
+		return -1;
+	}
+
+	return total;
+}
+
 int
 FileSync(File file, uint32 wait_event_info)
 {
@@ -3213,3 +3460,77 @@ fsync_parent_path(const char *fname, int elevel)
 
 	return 0;
 }
+
+/*
+ * GUC check_hook for io_direct
+ */
+bool
+check_io_direct(char **newval, void **extra, GucSource source)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+	int			flags = 0;
+
+	/* Need a modifiable copy of string */
+	rawstring = pstrdup(*newval);
+
+	if (!SplitIdentifierString(rawstring, ',', &elemlist))
+	{
+		GUC_check_errdetail("List syntax is invalid.");
+		pfree(rawstring);
+		list_free(elemlist);
+		return false;
+	}
+
+	foreach(l, elemlist)
+	{
+		char	   *item = (char *) lfirst(l);
+
+		if (pg_strcasecmp(item, "data") == 0)
+			flags |= IO_DIRECT_DATA;
+		else if (pg_strcasecmp(item, "wal") == 0)
+			flags |= IO_DIRECT_WAL;
+		else
+		{
+			GUC_check_errdetail("Unrecognized key word: \"%s\".", item);
+			pfree(rawstring);
+			list_free(elemlist);
+			return false;
+		}
+	}
+
+	pfree(rawstring);
+	list_free(elemlist);
+
+	if (flags != 0 && PG_O_DIRECT == 0)
+	{
+		GUC_check_errdetail("Direct I/O is not supported on this platform.");
+		return false;
+	}
+
+	/* The block sizes must be multiples of the direct I/O alignment */
+	if (((flags & IO_DIRECT_DATA) && BLCKSZ < PG_IO_ALIGN_SIZE) ||
+		((flags & IO_DIRECT_WAL) && XLOG_BLCKSZ < PG_IO_ALIGN_SIZE))
+	{
+		GUC_check_errdetail("Direct I/O requires a block size of at least %d bytes.",
+							PG_IO_ALIGN_SIZE);
+		return false;
+	}
+
+	*extra = malloc(sizeof(int));
+	if (!*extra)
+		return false;
+	*((int *) *extra) = flags;
+
+	return true;
+}
+
+/*
+ * GUC assign_hook for io_direct
+ */
+void
+assign_io_direct(const char *newval, void *extra)
+{
+	io_direct_flags = *((int *) extra);
+}
@@ -171,6 +171,8 @@ static void KnownAssignedXidsReset(void);
 static inline void ProcArrayEndTransactionInternal(PGPROC *proc,
 								PGXACT *pgxact, TransactionId latestXid);
 static void ProcArrayGroupClearXid(PGPROC *proc, TransactionId latestXid);
+static bool GetSnapshotDataReuse(Snapshot snapshot);
+static void GetSnapshotDataFinish(Snapshot snapshot);
 
 /*
  * Report shared-memory space needed by CreateSharedProcArray.
@@ -351,6 +353,9 @@ ProcArrayRemove(PGPROC *proc, TransactionId latestXid)
 		if (TransactionIdPrecedes(ShmemVariableCache->latestCompletedXid,
 								  latestXid))
 			ShmemVariableCache->latestCompletedXid = latestXid;
+
+		/* Cached snapshots see the transaction as running */
+		ShmemVariableCache->xactCompletionCount++;
 	}
 	else
 	{
@@ -466,6 +471,9 @@ ProcArrayEndTransactionInternal(PGPROC *proc, PGXACT *pgxact,
 	if (TransactionIdPrecedes(ShmemVariableCache->latestCompletedXid,
 							  latestXid))
 		ShmemVariableCache->latestCompletedXid = latestXid;
+
+	/* Cached snapshots see the transaction as running */
+	ShmemVariableCache->xactCompletionCount++;
 }
 
 /*
@@ -607,11 +615,16 @@ ProcArrayClearTransaction(PGPROC *proc)
 	PGXACT	   *pgxact = &allPgXact[proc->pgprocno];
 
 	/*
-	 * We can skip locking ProcArrayLock here, because this action does not
-	 * actually change anyone's view of the set of running XIDs: our entry is
-	 * duplicate with the gxact that has already been inserted into the
-	 * ProcArray.
+	 * This action does not actually change anyone's view of the set of
+	 * running XIDs: our entry is duplicate with the gxact that has already
+	 * been inserted into the ProcArray.  But our own snapshots leave out our
+	 * XID, so we must keep GetSnapshotData from reusing them once the XID is
+	 * no longer ours.  That needs the lock.
 	 */
+	LWLockAcquire(ProcArrayLock, LW_EXCLUSIVE);
+
+	ShmemVariableCache->xactCompletionCount++;
+
 	pgxact->xid = InvalidTransactionId;
 	proc->lxid = InvalidLocalTransactionId;
 	pgxact->xmin = InvalidTransactionId;
@@ -624,6 +637,8 @@ ProcArrayClearTransaction(PGPROC *proc)
 	/* Clear the subtransaction-XID cache too */
 	pgxact->nxids = 0;
 	pgxact->overflowed = false;
+
+	LWLockRelease(ProcArrayLock);
 }
 
 /*
@@ -1502,6 +1517,12 @@ GetMaxSnapshotSubxidCount(void)
  *		RecentGlobalDataXmin: the global xmin for non-catalog tables
  *			>= RecentGlobalXmin
  *
+ * Building a snapshot means scanning the whole proc array, which gets
+ * expensive with many connections.  But as long as no transaction with an
+ * XID has ended, the set of running transactions below xmax can't have
+ * changed, so if that's the case since this snapshot was last built, we
+ * return it as it is; see GetSnapshotDataReuse.
+ *
  * Note: this function should probably not be called with an argument that's
  * not statically allocated (see xip allocation below).
  */
@@ -1559,6 +1580,13 @@ GetSnapshotData(Snapshot snapshot)
 	 */
 	LWLockAcquire(ProcArrayLock, LW_SHARED);
 
+	if (GetSnapshotDataReuse(snapshot))
+	{
+		LWLockRelease(ProcArrayLock);
+		GetSnapshotDataFinish(snapshot);
+		return snapshot;
+	}
+
 	/* xmax is always latestCompletedXid + 1 */
 	xmax = ShmemVariableCache->latestCompletedXid;
 	Assert(TransactionIdIsNormal(xmax));
@@ -1710,6 +1738,15 @@ GetSnapshotData(Snapshot snapshot)
 	if (!TransactionIdIsValid(MyPgXact->xmin))
 		MyPgXact->xmin = TransactionXmin = xmin;
 
+	/*
+	 * Recovery-shaped snapshots are not reused; transactions ending in
+	 * recovery don't advance xactCompletionCount.
+	 */
+	if (!snapshot->takenDuringRecovery)
+		snapshot->snapXactCompletionCount = ShmemVariableCache->xactCompletionCount;
+	else
+		snapshot->snapXactCompletionCount = 0;
+
 	LWLockRelease(ProcArrayLock);
 
 	/*
@@ -1749,6 +1786,53 @@ GetSnapshotData(Snapshot snapshot)
 	snapshot->subxcnt = subcount;
 	snapshot->suboverflowed = suboverflowed;
 
+	GetSnapshotDataFinish(snapshot);
+
+	return snapshot;
+}
+
+/*
+ * GetSnapshotDataReuse -- can a snapshot be returned unchanged?
+ *
+ * If no transaction with an XID has ended since the snapshot was built,
+ * every XID it considers running is still running, and nothing it considers
+ * finished can have become visible since.  (New XIDs are all >= xmax.)  Then
+ * we just advertise its xmin, if we have none, and return true.  That's safe
+ * for the same reason as in GetSnapshotData: with the running XIDs
+ * unchanged, no one can have computed a horizon beyond the snapshot's xmin.
+ *
+ * RecentGlobalXmin and RecentGlobalDataXmin are left as they were, which is
+ * conservative.
+ *
+ * Caller must hold ProcArrayLock.
+ */
+static bool
+GetSnapshotDataReuse(Snapshot snapshot)
+{
+	Assert(LWLockHeldByMe(ProcArrayLock));
+
+	if (snapshot->snapXactCompletionCount == 0 ||
+		snapshot->snapXactCompletionCount != ShmemVariableCache->xactCompletionCount)
+		return false;
+
+	Assert(!snapshot->takenDuringRecovery);
+	Assert(TransactionIdIsNormal(snapshot->xmin));
+
+	if (!TransactionIdIsValid(MyPgXact->xmin))
+		MyPgXact->xmin = TransactionXmin = snapshot->xmin;
+	RecentXmin = snapshot->xmin;
+
+	return true;
+}
+
+/*
+ * GetSnapshotDataFinish -- fill in the rest of a new or reused snapshot.
+ *
+ * Called without ProcArrayLock.
+ */
+static void
+GetSnapshotDataFinish(Snapshot snapshot)
+{
 	snapshot->curcid = GetCurrentCommandId(false);
 
 	/*
@@ -1777,10 +1861,8 @@ GetSnapshotData(Snapshot snapshot)
 		 */
 		snapshot->lsn = GetXLogInsertRecPtr();
 		snapshot->whenTaken = GetSnapshotCurrentTimestamp();
-		MaintainOldSnapshotTimeMapping(snapshot->whenTaken, xmin);
+		MaintainOldSnapshotTimeMapping(snapshot->whenTaken, snapshot->xmin);
 	}
-
-	return snapshot;
 }
 
 /*
@@ -3077,6 +3159,9 @@ XidCacheRemoveRunningXids(TransactionId xid,
 							  latestXid))
 		ShmemVariableCache->latestCompletedXid = latestXid;
 
+	/* The subtransactions are still running in cached snapshots */
+	ShmemVariableCache->xactCompletionCount++;
+
 	LWLockRelease(ProcArrayLock);
 }
 
@@ -144,6 +144,8 @@ InitShmemAllocation(void)
 	ShmemVariableCache = (VariableCache)
 		ShmemAlloc(sizeof(*ShmemVariableCache));
 	memset(ShmemVariableCache, 0, sizeof(*ShmemVariableCache));
+	/* a snapshot with snapXactCompletionCount 0 is never reused */
+	ShmemVariableCache->xactCompletionCount = 1;
 }
 
 /*
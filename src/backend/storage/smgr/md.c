@@ -178,6 +178,25 @@ static CycleCtr mdckpt_cycle_ctr = 0;
  */
 #define EXTENSION_DONT_CHECK_SIZE	(1 << 4)
 
+/* flags for opening relation segment files */
+#define MD_OPEN_FLAGS \
+	(O_RDWR | PG_BINARY | \
+	 ((io_direct_flags & IO_DIRECT_DATA) ? PG_O_DIRECT : 0))
+
+/*
+ * With io_direct = data, the buffer for each read or write must be aligned
+ * to PG_IO_ALIGN_SIZE.  Shared buffers are, but callers also pass local
+ * buffers and palloc'd pages; those are copied through this buffer.
+ */
+static char *md_bounce_buffer = NULL;
+
+/* A block of zeroes for mdzeroextend, aligned for direct I/O */
+static char *md_zero_buffer = NULL;
+
+#define MD_NEEDS_BOUNCE(buffer) \
+	((io_direct_flags & IO_DIRECT_DATA) && \
+	 (uintptr_t) (buffer) % PG_IO_ALIGN_SIZE != 0)
+
 
 /* local routines */
 static void mdunlinkfork(RelFileNodeBackend rnode, ForkNumber forkNum,
@@ -197,6 +216,8 @@ static MdfdVec *_mdfd_getseg(SMgrRelation reln, ForkNumber forkno,
 			 BlockNumber blkno, bool skipFsync, int behavior);
 static BlockNumber _mdnblocks(SMgrRelation reln, ForkNumber forknum,
 		   MdfdVec *seg);
+static char *md_get_bounce_buffer(void);
+static char *md_get_zero_buffer(void);
 
 
 /*
@@ -304,7 +325,7 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 
 	path = relpath(reln->smgr_rnode, forkNum);
 
-	fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY, 0600);
+	fd = PathNameOpenFile(path, MD_OPEN_FLAGS | O_CREAT | O_EXCL, 0600);
 
 	if (fd < 0)
 	{
@@ -317,7 +338,7 @@ mdcreate(SMgrRelation reln, ForkNumber forkNum, bool isRedo)
 		 * already, even if isRedo is not set.  (See also mdopen)
 		 */
 		if (isRedo || IsBootstrapProcessingMode())
-			fd = PathNameOpenFile(path, O_RDWR | PG_BINARY, 0600);
+			fd = PathNameOpenFile(path, MD_OPEN_FLAGS, 0600);
 		if (fd < 0)
 		{
 			/* be sure to report the error reported by create, not open */
@@ -537,6 +558,9 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 				 errmsg("could not seek to block %u in file \"%s\": %m",
 						blocknum, FilePathName(v->mdfd_vfd))));
 
+	if (MD_NEEDS_BOUNCE(buffer))
+		buffer = memcpy(md_get_bounce_buffer(), buffer, BLCKSZ);
+
 	if ((nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, WAIT_EVENT_DATA_FILE_EXTEND)) != BLCKSZ)
 	{
 		if (nbytes < 0)
@@ -560,6 +584,86 @@ mdextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
 }
 
+/*
+ *	mdzeroextend() -- Add nblocks zeroed blocks to the specified relation,
+ *		starting at blocknum.
+ *
+ *		This is much cheaper than calling mdextend for each block, since
+ *		we write up to MAX_FILE_IOV_BUFFERS blocks with each system call.
+ */
+void
+mdzeroextend(SMgrRelation reln, ForkNumber forknum,
+			 BlockNumber blocknum, int nblocks, bool skipFsync)
+{
+	char	   *zerobufs[MAX_FILE_IOV_BUFFERS];
+	int			i;
+
+	Assert(nblocks > 0);
+
+	/* see mdextend */
+	if ((uint64) blocknum + nblocks >= (uint64) InvalidBlockNumber)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+				 errmsg("cannot extend file \"%s\" beyond %u blocks",
+						relpath(reln->smgr_rnode, forknum),
+						InvalidBlockNumber)));
+
+	for (i = 0; i < MAX_FILE_IOV_BUFFERS; i++)
+		zerobufs[i] = md_get_zero_buffer();
+
+	while (nblocks > 0)
+	{
+		MdfdVec    *v;
+		off_t		seekpos;
+		int			segblocks;
+		int			nbytes;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, skipFsync, EXTENSION_CREATE);
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		/* Write as much as we can without crossing into the next segment */
+		segblocks = Min(nblocks, MAX_FILE_IOV_BUFFERS);
+		segblocks = Min(segblocks,
+						RELSEG_SIZE - (blocknum % ((BlockNumber) RELSEG_SIZE)));
+
+		if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek to block %u in file \"%s\": %m",
+							blocknum, FilePathName(v->mdfd_vfd))));
+
+		nbytes = FileWriteV(v->mdfd_vfd, zerobufs, segblocks, BLCKSZ,
+							WAIT_EVENT_DATA_FILE_EXTEND);
+		if (nbytes != segblocks * BLCKSZ)
+		{
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not extend file \"%s\": %m",
+								FilePathName(v->mdfd_vfd)),
+						 errhint("Check free disk space.")));
+			/* short write: complain appropriately */
+			ereport(ERROR,
+					(errcode(ERRCODE_DISK_FULL),
+					 errmsg("could not extend file \"%s\": wrote only %d of %d bytes at block %u",
+							FilePathName(v->mdfd_vfd),
+							nbytes, segblocks * BLCKSZ, blocknum),
+					 errhint("Check free disk space.")));
+		}
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+
+		Assert(_mdnblocks(reln, forknum, v) <= ((BlockNumber) RELSEG_SIZE));
+
+		blocknum += segblocks;
+		nblocks -= segblocks;
+	}
+}
+
 /*
  *	mdopen() -- Open the specified relation.
  *
@@ -583,7 +687,7 @@ mdopen(SMgrRelation reln, ForkNumber forknum, int behavior)
 
 	path = relpath(reln->smgr_rnode, forknum);
 
-	fd = PathNameOpenFile(path, O_RDWR | PG_BINARY, 0600);
+	fd = PathNameOpenFile(path, MD_OPEN_FLAGS, 0600);
 
 	if (fd < 0)
 	{
@@ -594,7 +698,7 @@ mdopen(SMgrRelation reln, ForkNumber forknum, int behavior)
 		 * substitute for mdcreate() in bootstrap mode only. (See mdcreate)
 		 */
 		if (IsBootstrapProcessingMode())
-			fd = PathNameOpenFile(path, O_RDWR | O_CREAT | O_EXCL | PG_BINARY, 0600);
+			fd = PathNameOpenFile(path, MD_OPEN_FLAGS | O_CREAT | O_EXCL, 0600);
 		if (fd < 0)
 		{
 			if ((behavior & EXTENSION_RETURN_NULL) &&
@@ -662,6 +766,10 @@ mdprefetch(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum)
 	off_t		seekpos;
 	MdfdVec    *v;
 
+	/* Reads bypass the kernel's cache, so there's no point in filling it */
+	if (io_direct_flags & IO_DIRECT_DATA)
+		return;
+
 	v = _mdfd_getseg(reln, forknum, blocknum, false, EXTENSION_FAIL);
 
 	seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
@@ -682,6 +790,10 @@ void
 mdwriteback(SMgrRelation reln, ForkNumber forknum,
 			BlockNumber blocknum, BlockNumber nblocks)
 {
+	/* With direct I/O, the writes have reached the device already */
+	if (io_direct_flags & IO_DIRECT_DATA)
+		return;
+
 	/*
 	 * Issue flush requests in as few requests as possible; have to split at
 	 * segment boundaries though, since those are actually separate files.
@@ -754,7 +866,15 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 				 errmsg("could not seek to block %u in file \"%s\": %m",
 						blocknum, FilePathName(v->mdfd_vfd))));
 
-	nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ, WAIT_EVENT_DATA_FILE_READ);
+	if (MD_NEEDS_BOUNCE(buffer))
+	{
+		nbytes = FileRead(v->mdfd_vfd, md_get_bounce_buffer(), BLCKSZ,
+						  WAIT_EVENT_DATA_FILE_READ);
+		if (nbytes > 0)
+			memcpy(buffer, md_bounce_buffer, nbytes);
+	}
+	else
+		nbytes = FileRead(v->mdfd_vfd, buffer, BLCKSZ, WAIT_EVENT_DATA_FILE_READ);
 
 	TRACE_POSTGRESQL_SMGR_MD_READ_DONE(forknum, blocknum,
 									   reln->smgr_rnode.node.spcNode,
@@ -791,6 +911,85 @@ mdread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	}
 }
 
+/*
+ *	mdreadv() -- Read consecutive blocks from relation into the supplied
+ *				 buffers.
+ *
+ *		The blocks of each segment file are read with a single vectored
+ *		read.  Short reads are treated the same as in mdread.
+ */
+void
+mdreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		char **buffers, int nblocks)
+{
+	int			i;
+
+	/* Unaligned buffers can't be read directly; read them one by one */
+	for (i = 0; i < nblocks; i++)
+	{
+		if (MD_NEEDS_BOUNCE(buffers[i]))
+		{
+			for (i = 0; i < nblocks; i++)
+				mdread(reln, forknum, blocknum + i, buffers[i]);
+			return;
+		}
+	}
+
+	while (nblocks > 0)
+	{
+		off_t		seekpos;
+		int			nbytes;
+		int			nthisseg;
+		MdfdVec    *v;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, false,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		/* Don't read past the end of this segment */
+		nthisseg = Min(nblocks,
+					   RELSEG_SIZE - blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek to block %u in file \"%s\": %m",
+							blocknum, FilePathName(v->mdfd_vfd))));
+
+		nbytes = FileReadV(v->mdfd_vfd, buffers, nthisseg, BLCKSZ,
+						   WAIT_EVENT_DATA_FILE_READ);
+
+		if (nbytes != nthisseg * BLCKSZ)
+		{
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read blocks %u..%u in file \"%s\": %m",
+								blocknum, blocknum + nthisseg - 1,
+								FilePathName(v->mdfd_vfd))));
+
+			/* See mdread */
+			if (!(zero_damaged_pages || InRecovery))
+				ereport(ERROR,
+						(errcode(ERRCODE_DATA_CORRUPTED),
+						 errmsg("could not read block %u in file \"%s\": read only %d of %d bytes",
+								blocknum + nbytes / BLCKSZ,
+								FilePathName(v->mdfd_vfd),
+								nbytes % BLCKSZ, BLCKSZ)));
+
+			for (i = nbytes / BLCKSZ; i < nthisseg; i++)
+				MemSet(buffers[i], 0, BLCKSZ);
+		}
+
+		blocknum += nthisseg;
+		buffers += nthisseg;
+		nblocks -= nthisseg;
+	}
+}
+
 /*
  *	mdwrite() -- Write the supplied block at the appropriate location.
  *
@@ -830,6 +1029,9 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 				 errmsg("could not seek to block %u in file \"%s\": %m",
 						blocknum, FilePathName(v->mdfd_vfd))));
 
+	if (MD_NEEDS_BOUNCE(buffer))
+		buffer = memcpy(md_get_bounce_buffer(), buffer, BLCKSZ);
+
 	nbytes = FileWrite(v->mdfd_vfd, buffer, BLCKSZ, WAIT_EVENT_DATA_FILE_WRITE);
 
 	TRACE_POSTGRESQL_SMGR_MD_WRITE_DONE(forknum, blocknum,
@@ -861,6 +1063,84 @@ mdwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 		register_dirty_segment(reln, forknum, v);
 }
 
+/*
+ *	mdwritev() -- Write the supplied consecutive blocks at the appropriate
+ *				  location.
+ *
+ *		Like mdwrite, but the blocks of each segment file are written with
+ *		a single vectored write.
+ */
+void
+mdwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		 char **buffers, int nblocks, bool skipFsync)
+{
+	int			i;
+
+	/* Unaligned buffers can't be written directly; write them one by one */
+	for (i = 0; i < nblocks; i++)
+	{
+		if (MD_NEEDS_BOUNCE(buffers[i]))
+		{
+			for (i = 0; i < nblocks; i++)
+				mdwrite(reln, forknum, blocknum + i, buffers[i], skipFsync);
+			return;
+		}
+	}
+
+	while (nblocks > 0)
+	{
+		off_t		seekpos;
+		int			nbytes;
+		int			nthisseg;
+		MdfdVec    *v;
+
+		v = _mdfd_getseg(reln, forknum, blocknum, skipFsync,
+						 EXTENSION_FAIL | EXTENSION_CREATE_RECOVERY);
+
+		seekpos = (off_t) BLCKSZ * (blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		Assert(seekpos < (off_t) BLCKSZ * RELSEG_SIZE);
+
+		/* Don't write past the end of this segment */
+		nthisseg = Min(nblocks,
+					   RELSEG_SIZE - blocknum % ((BlockNumber) RELSEG_SIZE));
+
+		if (FileSeek(v->mdfd_vfd, seekpos, SEEK_SET) != seekpos)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not seek to block %u in file \"%s\": %m",
+							blocknum, FilePathName(v->mdfd_vfd))));
+
+		nbytes = FileWriteV(v->mdfd_vfd, buffers, nthisseg, BLCKSZ,
+							WAIT_EVENT_DATA_FILE_WRITE);
+
+		if (nbytes != nthisseg * BLCKSZ)
+		{
+			if (nbytes < 0)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not write blocks %u..%u in file \"%s\": %m",
+								blocknum, blocknum + nthisseg - 1,
+								FilePathName(v->mdfd_vfd))));
+			/* short write: complain appropriately */
+			ereport(ERROR,
+					(errcode(ERRCODE_DISK_FULL),
+					 errmsg("could not write blocks %u..%u in file \"%s\": wrote only %d of %d bytes",
+							blocknum, blocknum + nthisseg - 1,
+							FilePathName(v->mdfd_vfd),
+							nbytes, nthisseg * BLCKSZ),
+					 errhint("Check free disk space.")));
+		}
+
+		if (!skipFsync && !SmgrIsTemp(reln))
+			register_dirty_segment(reln, forknum, v);
+
+		blocknum += nthisseg;
+		buffers += nthisseg;
+		nblocks -= nthisseg;
+	}
+}
+
 /*
  *	mdnblocks() -- Get the number of blocks stored in a relation.
  *
@@ -1126,6 +1406,56 @@ mdsync(void)
 	/* Set flag to detect failure if we don't reach the end of the loop */
 	mdsync_in_progress = true;
 
+	/*
+	 * fsync'ing one file after another makes the kernel write out each
+	 * file's dirty data separately, waiting for the disk each time.  To let
+	 * it write out all the files concurrently, which is much faster on
+	 * storage that can handle many requests at once, first ask for
+	 * writeback of every segment we're going to fsync.  Like the writeback
+	 * requests issued while writing buffers, this is controlled by
+	 * checkpoint_flush_after.  Segments that have been deleted meanwhile are
+	 * skipped, as they are below, and failed writeback requests only cause
+	 * a warning.  Any other failure to open a segment throws an error, as it
+	 * would in the fsync loop, so the checkpoint just fails a little sooner.
+	 */
+	if (enableFsync && checkpoint_flush_after > 0)
+	{
+		hash_seq_init(&hstat, pendingOpsTable);
+		while ((entry = (PendingOperationEntry *) hash_seq_search(&hstat)) != NULL)
+		{
+			ForkNumber	forknum;
+
+			if (entry->cycle_ctr == mdsync_cycle_ctr)
+				continue;
+
+			for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+			{
+				SMgrRelation reln;
+				MdfdVec    *seg;
+				int			segno;
+
+				if (entry->canceled[forknum])
+					continue;
+
+				segno = -1;
+				while ((segno = bms_next_member(entry->requests[forknum],
+												segno)) >= 0)
+				{
+					reln = smgropen(entry->rnode, InvalidBackendId);
+					seg = _mdfd_getseg(reln, forknum,
+									   (BlockNumber) segno * (BlockNumber) RELSEG_SIZE,
+									   false,
+									   EXTENSION_RETURN_NULL
+									   | EXTENSION_DONT_CHECK_SIZE);
+					if (seg != NULL)
+						FileWriteback(seg->mdfd_vfd, 0,
+									  (off_t) BLCKSZ * RELSEG_SIZE,
+									  WAIT_EVENT_DATA_FILE_FLUSH);
+				}
+			}
+		}
+	}
+
 	/* Now scan the hashtable for fsync requests to process */
 	absorb_counter = FSYNCS_PER_ABSORB;
 	hash_seq_init(&hstat, pendingOpsTable);
@@ -1780,7 +2110,7 @@ _mdfd_openseg(SMgrRelation reln, ForkNumber forknum, BlockNumber segno,
 	fullpath = _mdfd_segpath(reln, forknum, segno);
 
 	/* open the file */
-	fd = PathNameOpenFile(fullpath, O_RDWR | PG_BINARY | oflags, 0600);
+	fd = PathNameOpenFile(fullpath, MD_OPEN_FLAGS | oflags, 0600);
 
 	pfree(fullpath);
 
@@ -1951,3 +2281,31 @@ _mdnblocks(SMgrRelation reln, ForkNumber forknum, MdfdVec *seg)
 	/* note that this calculation will ignore any partial block at EOF */
 	return (BlockNumber) (len / BLCKSZ);
 }
+
+/*
+ * Get the buffer used to read and write unaligned buffers with direct I/O.
+ */
+static char *
+md_get_bounce_buffer(void)
+{
+	if (md_bounce_buffer == NULL)
+		md_bounce_buffer = (char *)
+			TYPEALIGN(PG_IO_ALIGN_SIZE,
+					  MemoryContextAlloc(TopMemoryContext,
+										 BLCKSZ + PG_IO_ALIGN_SIZE));
+	return md_bounce_buffer;
+}
+
+/*
+ * Get a block of zeroes, suitably aligned for direct I/O.
+ */
+static char *
+md_get_zero_buffer(void)
+{
+	if (md_zero_buffer == NULL)
+		md_zero_buffer = (char *)
+			TYPEALIGN(PG_IO_ALIGN_SIZE,
+					  MemoryContextAllocZero(TopMemoryContext,
+											 BLCKSZ + PG_IO_ALIGN_SIZE));
+	return md_zero_buffer;
+}
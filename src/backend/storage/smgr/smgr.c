@@ -17,6 +17,7 @@
  */
 #include "postgres.h"
 
+#include "access/xlog.h"
 #include "commands/tablespace.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
@@ -47,12 +48,21 @@ typedef struct f_smgr
 								bool isRedo);
 	void		(*smgr_extend) (SMgrRelation reln, ForkNumber forknum,
 								BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_zeroextend) (SMgrRelation reln, ForkNumber forknum,
+									BlockNumber blocknum, int nblocks,
+									bool skipFsync);
 	void		(*smgr_prefetch) (SMgrRelation reln, ForkNumber forknum,
 								  BlockNumber blocknum);
 	void		(*smgr_read) (SMgrRelation reln, ForkNumber forknum,
 							  BlockNumber blocknum, char *buffer);
+	void		(*smgr_readv) (SMgrRelation reln, ForkNumber forknum,
+							   BlockNumber blocknum, char **buffers,
+							   int nblocks);
 	void		(*smgr_write) (SMgrRelation reln, ForkNumber forknum,
 							   BlockNumber blocknum, char *buffer, bool skipFsync);
+	void		(*smgr_writev) (SMgrRelation reln, ForkNumber forknum,
+								BlockNumber blocknum, char **buffers,
+								int nblocks, bool skipFsync);
 	void		(*smgr_writeback) (SMgrRelation reln, ForkNumber forknum,
 								   BlockNumber blocknum, BlockNumber nblocks);
 	BlockNumber (*smgr_nblocks) (SMgrRelation reln, ForkNumber forknum);
@@ -68,7 +78,8 @@ typedef struct f_smgr
 static const f_smgr smgrsw[] = {
 	/* magnetic disk */
 	{mdinit, NULL, mdclose, mdcreate, mdexists, mdunlink, mdextend,
-		mdprefetch, mdread, mdwrite, mdwriteback, mdnblocks, mdtruncate,
+		mdzeroextend, mdprefetch, mdread, mdreadv, mdwrite, mdwritev, mdwriteback,
+		mdnblocks, mdtruncate,
 		mdimmedsync, mdpreckpt, mdsync, mdpostckpt
 	}
 };
@@ -172,9 +183,12 @@ smgropen(RelFileNode rnode, BackendId backend)
 		reln->smgr_vm_nblocks = InvalidBlockNumber;
 		reln->smgr_which = 0;	/* we only have md.c at present */
 
-		/* mark it not open */
+		/* mark it not open, and its size unknown */
 		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+		{
 			reln->md_num_open_segs[forknum] = 0;
+			reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+		}
 
 		/* it has no owner yet */
 		add_to_unowned_list(reln);
@@ -417,15 +431,19 @@ smgrdounlink(SMgrRelation reln, bool isRedo)
 	int			which = reln->smgr_which;
 	ForkNumber	forknum;
 
-	/* Close the forks at smgr level */
-	for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
-		(*(smgrsw[which].smgr_close)) (reln, forknum);
-
 	/*
 	 * Get rid of any remaining buffers for the relation.  bufmgr will just
-	 * drop them without bothering to write the contents.
+	 * drop them without bothering to write the contents.  Do this before
+	 * closing the forks, since bufmgr may want to know their sizes.
 	 */
-	DropRelFileNodesAllBuffers(&rnode, 1);
+	DropRelFileNodesAllBuffers(&reln, 1);
+
+	/* Close the forks at smgr level */
+	for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+	{
+		(*(smgrsw[which].smgr_close)) (reln, forknum);
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+	}
 
 	/*
 	 * It'd be nice to tell the stats collector to forget it immediately, too.
@@ -477,6 +495,13 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 	if (nrels == 0)
 		return;
 
+	/*
+	 * Get rid of any remaining buffers for the relations.  bufmgr will just
+	 * drop them without bothering to write the contents.  Do this before
+	 * closing the forks, since bufmgr may want to know their sizes.
+	 */
+	DropRelFileNodesAllBuffers(rels, nrels);
+
 	/*
 	 * create an array which contains all relations to be dropped, and close
 	 * each relation's forks at the smgr level while at it
@@ -491,15 +516,12 @@ smgrdounlinkall(SMgrRelation *rels, int nrels, bool isRedo)
 
 		/* Close the forks at smgr level */
 		for (forknum = 0; forknum <= MAX_FORKNUM; forknum++)
+		{
 			(*(smgrsw[which].smgr_close)) (rels[i], forknum);
+			rels[i]->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+		}
 	}
 
-	/*
-	 * Get rid of any remaining buffers for the relations.  bufmgr will just
-	 * drop them without bothering to write the contents.
-	 */
-	DropRelFileNodesAllBuffers(rnodes, nrels);
-
 	/*
 	 * It'd be nice to tell the stats collector to forget them immediately,
 	 * too. But we can't because we don't know the OIDs.
@@ -551,14 +573,16 @@ smgrdounlinkfork(SMgrRelation reln, ForkNumber forknum, bool isRedo)
 	RelFileNodeBackend rnode = reln->smgr_rnode;
 	int			which = reln->smgr_which;
 
-	/* Close the fork at smgr level */
-	(*(smgrsw[which].smgr_close)) (reln, forknum);
-
 	/*
 	 * Get rid of any remaining buffers for the fork.  bufmgr will just drop
-	 * them without bothering to write the contents.
+	 * them without bothering to write the contents.  Do this before closing
+	 * the fork, since bufmgr may want to know its size.
 	 */
-	DropRelFileNodeBuffers(rnode, forknum, 0);
+	DropRelFileNodeBuffers(reln, forknum, 0);
+
+	/* Close the fork at smgr level */
+	(*(smgrsw[which].smgr_close)) (reln, forknum);
+	reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
 
 	/*
 	 * It'd be nice to tell the stats collector to forget it immediately, too.
@@ -602,6 +626,35 @@ smgrextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 {
 	(*(smgrsw[reln->smgr_which].smgr_extend)) (reln, forknum, blocknum,
 											   buffer, skipFsync);
+
+	/*
+	 * Normally this adds one block to the cached size.  If we were writing
+	 * beyond what we knew to be the end, forget the size instead.
+	 */
+	if (reln->smgr_cached_nblocks[forknum] == blocknum)
+		reln->smgr_cached_nblocks[forknum] = blocknum + 1;
+	else
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
+}
+
+/*
+ *	smgrzeroextend() -- Add several new, zero-filled blocks to a file.
+ *
+ *		Like calling smgrextend with a page of zeroes for each of blocknum
+ *		.. blocknum + nblocks - 1, but cheaper.
+ */
+void
+smgrzeroextend(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+			   int nblocks, bool skipFsync)
+{
+	(*(smgrsw[reln->smgr_which].smgr_zeroextend)) (reln, forknum, blocknum,
+												   nblocks, skipFsync);
+
+	/* As in smgrextend */
+	if (reln->smgr_cached_nblocks[forknum] == blocknum)
+		reln->smgr_cached_nblocks[forknum] = blocknum + nblocks;
+	else
+		reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
 }
 
 /*
@@ -628,6 +681,23 @@ smgrread(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 	(*(smgrsw[reln->smgr_which].smgr_read)) (reln, forknum, blocknum, buffer);
 }
 
+/*
+ *	smgrreadv() -- read consecutive blocks of a relation into the supplied
+ *				   buffers.
+ *
+ *		Like smgrread, but reads the 'nblocks' blocks starting at 'blocknum',
+ *		into buffers[0] to buffers[nblocks - 1], with as few I/O requests as
+ *		the storage manager can manage.  nblocks must not exceed
+ *		MAX_FILE_IOV_BUFFERS.
+ */
+void
+smgrreadv(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		  char **buffers, int nblocks)
+{
+	(*(smgrsw[reln->smgr_which].smgr_readv)) (reln, forknum, blocknum,
+											  buffers, nblocks);
+}
+
 /*
  *	smgrwrite() -- Write the supplied buffer out.
  *
@@ -651,6 +721,22 @@ smgrwrite(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 											  buffer, skipFsync);
 }
 
+/*
+ *	smgrwritev() -- Write the supplied consecutive blocks out.
+ *
+ *		Like smgrwrite, but writes the 'nblocks' blocks starting at
+ *		'blocknum' from buffers[0] to buffers[nblocks - 1], with as few I/O
+ *		requests as the storage manager can manage.  nblocks must not exceed
+ *		MAX_FILE_IOV_BUFFERS.
+ */
+void
+smgrwritev(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
+		   char **buffers, int nblocks, bool skipFsync)
+{
+	(*(smgrsw[reln->smgr_which].smgr_writev)) (reln, forknum, blocknum,
+											   buffers, nblocks, skipFsync);
+}
+
 
 /*
  *	smgrwriteback() -- Trigger kernel writeback for the supplied range of
@@ -671,7 +757,35 @@ smgrwriteback(SMgrRelation reln, ForkNumber forknum, BlockNumber blocknum,
 BlockNumber
 smgrnblocks(SMgrRelation reln, ForkNumber forknum)
 {
-	return (*(smgrsw[reln->smgr_which].smgr_nblocks)) (reln, forknum);
+	BlockNumber result;
+
+	result = smgrnblocks_cached(reln, forknum);
+	if (result != InvalidBlockNumber)
+		return result;
+
+	result = (*(smgrsw[reln->smgr_which].smgr_nblocks)) (reln, forknum);
+
+	reln->smgr_cached_nblocks[forknum] = result;
+
+	return result;
+}
+
+/*
+ *	smgrnblocks_cached() -- Get the cached number of blocks in the supplied
+ *							relation, or InvalidBlockNumber if unknown.
+ *
+ *		Other backends can extend a relation without telling us, so outside
+ *		recovery the cached size may be stale and we never use it.  During
+ *		recovery only the startup process changes relation sizes, and it
+ *		keeps its cache up to date.
+ */
+BlockNumber
+smgrnblocks_cached(SMgrRelation reln, ForkNumber forknum)
+{
+	if (InRecovery)
+		return reln->smgr_cached_nblocks[forknum];
+
+	return InvalidBlockNumber;
 }
 
 /*
@@ -687,7 +801,7 @@ smgrtruncate(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
 	 * Get rid of any buffers for the about-to-be-deleted blocks. bufmgr will
 	 * just drop them without bothering to write the contents.
 	 */
-	DropRelFileNodeBuffers(reln->smgr_rnode, forknum, nblocks);
+	DropRelFileNodeBuffers(reln, forknum, nblocks);
 
 	/*
 	 * Send a shared-inval message to force other backends to close any smgr
@@ -702,9 +816,12 @@ smgrtruncate(SMgrRelation reln, ForkNumber forknum, BlockNumber nblocks)
 	CacheInvalidateSmgr(reln->smgr_rnode);
 
 	/*
-	 * Do the truncation.
+	 * Do the truncation.  Forget the cached size until it's done, in case
+	 * of an error.
 	 */
+	reln->smgr_cached_nblocks[forknum] = InvalidBlockNumber;
 	(*(smgrsw[reln->smgr_which].smgr_truncate)) (reln, forknum, nblocks);
+	reln->smgr_cached_nblocks[forknum] = nblocks;
 }
 
 /*
@@ -22,6 +22,7 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/postmaster.h"
+#include "storage/bufmgr.h"
 #include "storage/proc.h"
 #include "storage/procarray.h"
 #include "utils/acl.h"
@@ -1861,3 +1862,44 @@ pg_stat_get_archiver(PG_FUNCTION_ARGS)
 	PG_RETURN_DATUM(HeapTupleGetDatum(
 									  heap_form_tuple(tupdesc, values, nulls)));
 }
+
+/*
+ * Get the shared buffer replacement counters.  These are kept in shared
+ * memory by freelist.c rather than by the statistics collector.
+ */
+Datum
+pg_stat_get_buffer_replacement(PG_FUNCTION_ARGS)
+{
+	TupleDesc	tupdesc;
+	Datum		values[6];
+	bool		nulls[6];
+	BufferReplacementStats stats;
+
+	MemSet(nulls, 0, sizeof(nulls));
+
+	tupdesc = CreateTemplateTupleDesc(6, false);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 1, "free_victims",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 2, "clock_victims",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 3, "clock_ticks",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 4, "probation_victims",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 5, "probation_promotions",
+					   INT8OID, -1, 0);
+	TupleDescInitEntry(tupdesc, (AttrNumber) 6, "ghost_hits",
+					   INT8OID, -1, 0);
+	BlessTupleDesc(tupdesc);
+
+	StrategyGetReplacementStats(&stats);
+
+	values[0] = Int64GetDatum((int64) stats.free_victims);
+	values[1] = Int64GetDatum((int64) stats.clock_victims);
+	values[2] = Int64GetDatum((int64) stats.clock_ticks);
+	values[3] = Int64GetDatum((int64) stats.probation_victims);
+	values[4] = Int64GetDatum((int64) stats.probation_promotions);
+	values[5] = Int64GetDatum((int64) stats.ghost_hits);
+
+	PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
@@ -30,9 +30,11 @@
 #include "access/gin.h"
 #include "access/rmgr.h"
 #include "access/transam.h"
+#include "access/tuptoaster.h"
 #include "access/twophase.h"
 #include "access/xact.h"
 #include "access/xlog_internal.h"
+#include "access/xlogprefetch.h"
 #include "catalog/namespace.h"
 #include "catalog/pg_authid.h"
 #include "commands/async.h"
@@ -41,6 +43,8 @@
 #include "commands/vacuum.h"
 #include "commands/variable.h"
 #include "commands/trigger.h"
+#include "executor/execBatch.h"
+#include "executor/executor.h"
 #include "funcapi.h"
 #include "libpq/auth.h"
 #include "libpq/be-fsstubs.h"
@@ -390,6 +394,12 @@ static const struct config_enum_entry huge_pages_options[] = {
 	{NULL, 0, false}
 };
 
+static const struct config_enum_entry buffer_replacement_policy_options[] = {
+	{"clock", BUFFER_REPLACEMENT_CLOCK, false},
+	{"2q", BUFFER_REPLACEMENT_2Q, false},
+	{NULL, 0, false}
+};
+
 static const struct config_enum_entry force_parallel_mode_options[] = {
 	{"off", FORCE_PARALLEL_OFF, false},
 	{"on", FORCE_PARALLEL_ON, false},
@@ -424,6 +434,8 @@ static const struct config_enum_entry password_encryption_options[] = {
 extern const struct config_enum_entry wal_level_options[];
 extern const struct config_enum_entry archive_mode_options[];
 extern const struct config_enum_entry sync_method_options[];
+extern const struct config_enum_entry wal_compression_options[];
+extern const struct config_enum_entry default_toast_compression_options[];
 extern const struct config_enum_entry dynamic_shared_memory_options[];
 
 /*
@@ -506,6 +518,7 @@ static char *log_timezone_string;
 static char *timezone_abbreviations_string;
 static char *XactIsoLevel_string;
 static char *data_directory;
+static char *io_direct_string;
 static char *session_authorization_string;
 static int	max_function_args;
 static int	max_index_keys;
@@ -856,6 +869,15 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_incrementalsort", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of incremental sort steps."),
+			NULL
+		},
+		&enable_incrementalsort,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_hashagg", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of hashed aggregation plans."),
@@ -910,6 +932,51 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_parallel_append", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel append plans."),
+			NULL
+		},
+		&enable_parallel_append,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_parallel_hash", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of parallel hash plans."),
+			NULL
+		},
+		&enable_parallel_hash,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_resultcache", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of result caching."),
+			NULL
+		},
+		&enable_resultcache,
+		true,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_partitionwise_join", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables partition-wise join."),
+			NULL
+		},
+		&enable_partitionwise_join,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_partitionwise_aggregate", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables partition-wise aggregation."),
+			NULL
+		},
+		&enable_partitionwise_aggregate,
+		false,
+		NULL, NULL, NULL
+	},
 
 	{
 		{"geqo", PGC_USERSET, QUERY_TUNING_GEQO,
@@ -1033,16 +1100,6 @@ static struct config_bool ConfigureNamesBool[] =
 		NULL, NULL, NULL
 	},
 
-	{
-		{"wal_compression", PGC_SUSET, WAL_SETTINGS,
-			gettext_noop("Compresses full-page writes written in WAL file."),
-			NULL
-		},
-		&wal_compression,
-		false,
-		NULL, NULL, NULL
-	},
-
 	{
 		{"log_checkpoints", PGC_SIGHUP, LOGGING_WHAT,
 			gettext_noop("Logs each checkpoint."),
@@ -1718,6 +1775,16 @@ static struct config_int ConfigureNamesInt[] =
 		8, 1, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"executor_batch_size", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the maximum number of rows passed at once "
+						 "from a sequential scan to an aggregate."),
+			gettext_noop("Zero processes all rows one at a time.")
+		},
+		&executor_batch_size,
+		0, 0, 65536,
+		NULL, NULL, NULL
+	},
 	{
 		{"join_collapse_limit", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Sets the FROM-list size beyond which JOIN "
@@ -2321,6 +2388,31 @@ static struct config_int ConfigureNamesInt[] =
 		check_wal_buffers, NULL, NULL
 	},
 
+	{
+		{"wal_insert_locks", PGC_POSTMASTER, WAL_SETTINGS,
+			gettext_noop("Sets the number of locks that allow WAL records to be inserted concurrently."),
+			NULL
+		},
+		&wal_insert_locks,
+		8, 1, MAX_WAL_INSERT_LOCKS,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"recovery_prefetch_distance", PGC_SIGHUP, WAL_SETTINGS,
+			gettext_noop("Sets how far ahead of replay recovery looks for data blocks to prefetch."),
+			gettext_noop("Zero disables prefetching during recovery."),
+			GUC_UNIT_KB
+		},
+		&recovery_prefetch_distance,
+#ifdef USE_PREFETCH
+		256, 0, MAX_KILOBYTES,
+#else
+		0, 0, 0,
+#endif
+		NULL, NULL, NULL
+	},
+
 	{
 		{"wal_writer_delay", PGC_SIGHUP, WAL_SETTINGS,
 			gettext_noop("Time between WAL flushes performed in the WAL writer."),
@@ -2380,11 +2472,11 @@ static struct config_int ConfigureNamesInt[] =
 		{"commit_delay", PGC_SUSET, WAL_SETTINGS,
 			gettext_noop("Sets the delay in microseconds between transaction commit and "
 						 "flushing WAL to disk."),
-			NULL
+			gettext_noop("-1 chooses the delay automatically.")
 			/* we have no microseconds designation, so can't supply units here */
 		},
 		&CommitDelay,
-		0, 0, 100000,
+		0, -1, 100000,
 		NULL, NULL, NULL
 	},
 
@@ -2483,6 +2575,19 @@ static struct config_int ConfigureNamesInt[] =
 		check_effective_io_concurrency, assign_effective_io_concurrency, NULL
 	},
 
+	{
+		{"io_combine_limit",
+			PGC_USERSET,
+			RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Limit on the size of data reads combined into one system call."),
+			NULL,
+			GUC_UNIT_BLOCKS
+		},
+		&io_combine_limit,
+		DEFAULT_IO_COMBINE_LIMIT, 1, MAX_IO_COMBINE_LIMIT,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"backend_flush_after", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
 			gettext_noop("Number of pages after which previously performed writes are flushed to disk."),
@@ -2703,6 +2808,16 @@ static struct config_int ConfigureNamesInt[] =
 		check_autovacuum_max_workers, NULL, NULL
 	},
 
+	{
+		{"autovacuum_max_parallel_workers", PGC_SIGHUP, AUTOVACUUM,
+			gettext_noop("Sets the maximum number of parallel processes per autovacuum operation."),
+			NULL
+		},
+		&autovacuum_max_parallel_workers,
+		0, 0, MAX_PARALLEL_WORKER_LIMIT,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"max_parallel_workers_per_gather", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
 			gettext_noop("Sets the maximum number of parallel processes per executor node."),
@@ -2713,6 +2828,16 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"max_parallel_maintenance_workers", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Sets the maximum number of parallel processes per maintenance operation."),
+			NULL
+		},
+		&max_parallel_maintenance_workers,
+		2, 0, MAX_PARALLEL_WORKER_LIMIT,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"max_parallel_workers", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
 			gettext_noop("Sets the maximum number of parallel workers than can be active at one time."),
@@ -2964,6 +3089,16 @@ static struct config_real ConfigureNamesReal[] =
 		DEFAULT_PARALLEL_SETUP_COST, 0, DBL_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"specialize_above_cost", PGC_USERSET, QUERY_TUNING_COST,
+			gettext_noop("Sets the query cost above which the executor "
+						 "precomputes specialized tuple deforming."),
+			gettext_noop("-1 disables specialization.")
+		},
+		&specialize_above_cost,
+		100000, -1, DBL_MAX,
+		NULL, NULL, NULL
+	},
 
 	{
 		{"cursor_tuple_fraction", PGC_USERSET, QUERY_TUNING_OTHER,
@@ -3130,6 +3265,17 @@ static struct config_string ConfigureNamesString[] =
 		check_temp_tablespaces, assign_temp_tablespaces, NULL
 	},
 
+	{
+		{"io_direct", PGC_POSTMASTER, RESOURCES_ASYNCHRONOUS,
+			gettext_noop("Bypasses the kernel's page cache for the listed kinds of files."),
+			gettext_noop("Valid values are \"data\" and \"wal\"."),
+			GUC_LIST_INPUT
+		},
+		&io_direct_string,
+		"",
+		check_io_direct, assign_io_direct, NULL
+	},
+
 	{
 		{"dynamic_library_path", PGC_SUSET, CLIENT_CONN_OTHER,
 			gettext_noop("Sets the path for dynamically loadable modules."),
@@ -3679,6 +3825,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"default_toast_compression", PGC_USERSET, CLIENT_CONN_STATEMENT,
+			gettext_noop("Sets the default compression method for compressible values."),
+			NULL
+		},
+		&default_toast_compression,
+		TOAST_PGLZ_COMPRESSION_ID, default_toast_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"client_min_messages", PGC_USERSET, LOGGING_WHEN,
 			gettext_noop("Sets the message levels that are sent to the client."),
@@ -3865,6 +4021,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, assign_xlog_sync_method, NULL
 	},
 
+	{
+		{"wal_compression", PGC_SUSET, WAL_SETTINGS,
+			gettext_noop("Compresses full-page writes written in WAL file with the specified method."),
+			NULL
+		},
+		&wal_compression,
+		WAL_COMPRESSION_NONE, wal_compression_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"xmlbinary", PGC_USERSET, CLIENT_CONN_STATEMENT,
 			gettext_noop("Sets how binary values are to be encoded in XML."),
@@ -3896,6 +4062,16 @@ static struct config_enum ConfigureNamesEnum[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"buffer_replacement_policy", PGC_POSTMASTER, RESOURCES_MEM,
+			gettext_noop("Selects the algorithm for choosing shared buffers to replace."),
+			NULL
+		},
+		&buffer_replacement_policy,
+		BUFFER_REPLACEMENT_CLOCK, buffer_replacement_policy_options,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"force_parallel_mode", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Forces use of parallel query facilities."),
@@ -591,6 +591,8 @@ SetTransactionSnapshot(Snapshot sourcesnap, VirtualTransactionId *sourcevxid,
 	CurrentSnapshot->xmin = sourcesnap->xmin;
 	CurrentSnapshot->xmax = sourcesnap->xmax;
 	CurrentSnapshot->xcnt = sourcesnap->xcnt;
+	/* the contents are no longer what GetSnapshotData computed */
+	CurrentSnapshot->snapXactCompletionCount = 0;
 	Assert(sourcesnap->xcnt <= GetMaxSnapshotXidCount());
 	memcpy(CurrentSnapshot->xip, sourcesnap->xip,
 		   sourcesnap->xcnt * sizeof(TransactionId));
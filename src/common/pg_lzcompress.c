@@ -676,11 +676,17 @@ pglz_compress(const char *source, int32 slen, char *dest,
  *		Decompresses source into dest. Returns the number of bytes
  *		decompressed in the destination buffer, or -1 if decompression
  *		fails.
+ *
+ *		If check_complete is true, rawsize must be the exact size of the
+ *		decompressed data, and all of the input must be used up.  If it's
+ *		false, we stop once rawsize bytes have been produced, which lets
+ *		callers that only need a prefix of the data avoid decompressing
+ *		the rest.
  * ----------
  */
 int32
 pglz_decompress(const char *source, int32 slen, char *dest,
-				int32 rawsize)
+				int32 rawsize, bool check_complete)
 {
 	const unsigned char *sp;
 	const unsigned char *srcend;
@@ -730,8 +736,13 @@ pglz_decompress(const char *source, int32 slen, char *dest,
 				 */
 				if (dp + len > destend)
 				{
-					dp += len;
-					break;
+					if (check_complete)
+					{
+						dp += len;
+						break;
+					}
+					/* just the part of the match that fits is wanted */
+					len = destend - dp;
 				}
 
 				/*
@@ -768,11 +779,11 @@ pglz_decompress(const char *source, int32 slen, char *dest,
 	/*
 	 * Check we decompressed the right amount.
 	 */
-	if (dp != destend || sp != srcend)
+	if (check_complete && (dp != destend || sp != srcend))
 		return -1;
 
 	/*
 	 * That's it.
 	 */
-	return rawsize;
+	return (char *) dp - dest;
 }
@@ -26,12 +26,22 @@
  * If current_buf isn't InvalidBuffer, then we are holding an extra pin
  * on that buffer.
  *
+ * When a bulk insert extends the relation, it adds several blocks at once
+ * and keeps the ones it doesn't need yet for itself: next_free .. last_free
+ * are the blocks of free_rel it hasn't used yet, or both InvalidBlockNumber.
+ * Whatever is left of them is handed to the free space map when the bulk
+ * insert ends or moves on to another relation.
+ *
  * "typedef struct BulkInsertStateData *BulkInsertState" is in heapam.h
  */
 typedef struct BulkInsertStateData
 {
 	BufferAccessStrategy strategy;	/* our BULKWRITE strategy object */
 	Buffer		current_buf;	/* current insertion target page */
+	BlockNumber next_free;		/* next reserved block, see above */
+	BlockNumber last_free;		/* last reserved block */
+	Relation	free_rel;		/* relation the reserved blocks belong to */
+	uint32		already_extended_by;	/* # of blocks added by us so far */
 }			BulkInsertStateData;
 
 
@@ -41,5 +51,6 @@ extern Buffer RelationGetBufferForTuple(Relation relation, Size len,
 						  Buffer otherBuffer, int options,
 						  BulkInsertState bistate,
 						  Buffer *vmbuffer, Buffer *vmbuffer_other);
+extern void ReleaseBulkInsertReservedBlocks(BulkInsertState bistate);
 
 #endif							/* HIO_H */
@@ -19,6 +19,7 @@
 #include "access/htup_details.h"
 #include "access/itup.h"
 #include "access/tupdesc.h"
+#include "storage/bufmgr.h"
 #include "storage/spin.h"
 
 /*
@@ -72,6 +73,16 @@ typedef struct HeapScanDescData
 	/* NB: if rs_cbuf is not InvalidBuffer, we hold a pin on that buffer */
 	ParallelHeapScanDesc rs_parallel;	/* parallel scan information */
 
+	/*
+	 * Blocks read ahead of the scan position: rs_readahead[rs_nextreadahead ..
+	 * rs_nreadahead - 1] are pinned and hold blocks rs_readahead_block and
+	 * on.
+	 */
+	int			rs_nreadahead;	/* # of buffers in rs_readahead */
+	int			rs_nextreadahead;	/* next one to be returned */
+	BlockNumber rs_readahead_block; /* block # of rs_readahead[rs_nextreadahead] */
+	Buffer		rs_readahead[MAX_IO_COMBINE_LIMIT];
+
 	/* these fields only used in page-at-a-time mode and for bitmap scans */
 	int			rs_cindex;		/* current tuple's index in vistuples */
 	int			rs_ntuples;		/* number of visible tuples on page */
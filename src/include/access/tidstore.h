@@ -0,0 +1,51 @@
+/*-------------------------------------------------------------------------
+ *
+ * tidstore.h
+ *	  Compact storage for a set of TIDs, such as vacuum's dead tuples.
+ *
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/tidstore.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef TIDSTORE_H
+#define TIDSTORE_H
+
+#include "storage/block.h"
+#include "storage/itemptr.h"
+#include "storage/off.h"
+
+typedef struct TidStore TidStore;
+typedef struct TidStoreIter TidStoreIter;
+
+/* Result struct for TidStoreIterateNext */
+typedef struct TidStoreIterResult
+{
+	BlockNumber blkno;
+	int			num_offsets;
+	OffsetNumber offsets[MaxOffsetNumber];
+} TidStoreIterResult;
+
+extern Size TidStoreMaxSize(BlockNumber nblocks, OffsetNumber max_offset);
+extern Size TidStoreEstimate(Size max_bytes, BlockNumber nblocks,
+				 OffsetNumber max_offset);
+extern TidStore *TidStoreInitialize(void *place, Size size,
+				   BlockNumber nblocks, OffsetNumber max_offset);
+extern TidStore *TidStoreCreate(Size max_bytes, BlockNumber nblocks,
+			   OffsetNumber max_offset);
+extern void TidStoreFree(TidStore *ts);
+extern void TidStoreReset(TidStore *ts);
+extern void TidStoreSetBlockOffsets(TidStore *ts, BlockNumber blkno,
+						OffsetNumber *offsets, int num_offsets);
+extern bool TidStoreIsMember(TidStore *ts, ItemPointer tid);
+extern bool TidStoreIsFull(TidStore *ts);
+extern int64 TidStoreNumTids(TidStore *ts);
+extern int64 TidStoreMaxTids(TidStore *ts);
+extern TidStoreIter *TidStoreBeginIterate(TidStore *ts);
+extern TidStoreIterResult *TidStoreIterateNext(TidStoreIter *iter);
+extern void TidStoreEndIterate(TidStoreIter *iter);
+
+#endif							/* TIDSTORE_H */
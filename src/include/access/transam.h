@@ -134,6 +134,9 @@ typedef struct VariableCacheData
 	 */
 	TransactionId latestCompletedXid;	/* newest XID that has committed or
 										 * aborted */
+	uint64		xactCompletionCount;	/* incremented whenever a transaction
+										 * with an XID ends; see
+										 * GetSnapshotData */
 
 	/*
 	 * These fields are protected by CLogTruncationLock
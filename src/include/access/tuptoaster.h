@@ -23,6 +23,23 @@
  */
 #define TOAST_INDEX_HACK
 
+/*
+ * Compression methods for toasted values.  The method used for a compressed
+ * datum is stored in the two high-order bits of its raw size, and of the
+ * external size of a TOAST pointer to it, so there can be at most four.
+ * pglz must remain zero: data written before there was a choice has no
+ * method bits set.
+ */
+typedef enum ToastCompressionId
+{
+	TOAST_PGLZ_COMPRESSION_ID = 0,
+	TOAST_LZ4_COMPRESSION_ID = 1,
+	TOAST_ZSTD_COMPRESSION_ID = 2,
+	TOAST_INVALID_COMPRESSION_ID = 3
+} ToastCompressionId;
+
+/* GUC variable */
+extern int	default_toast_compression;
 
 /*
  * Find the maximum size of a tuple if there are to be N tuples per page.
@@ -101,6 +118,17 @@
 /* Size of an EXTERNAL datum that contains an indirection pointer */
 #define INDIRECT_POINTER_SIZE (VARHDRSZ_EXTERNAL + sizeof(varatt_indirect))
 
+/*
+ * The external size of a TOAST pointer shares va_extsize with the
+ * compression method of the value, if it's compressed.
+ */
+#define VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer) \
+	((toast_pointer).va_extsize & VARLENA_RAWSIZE_MASK)
+#define VARATT_EXTERNAL_GET_COMPRESSION(toast_pointer) \
+	((uint32) (toast_pointer).va_extsize >> VARLENA_RAWSIZE_BITS)
+#define VARATT_EXTERNAL_SET_SIZE_AND_COMPRESSION(toast_pointer, len, cm) \
+	((toast_pointer).va_extsize = (len) | ((uint32) (cm) << VARLENA_RAWSIZE_BITS))
+
 /*
  * Testing whether an externally-stored value is compressed now requires
  * comparing extsize (the actual length of the external data) to rawsize
@@ -109,7 +137,8 @@
  * saves space, so we expect either equality or less-than.
  */
 #define VARATT_EXTERNAL_IS_COMPRESSED(toast_pointer) \
-	((toast_pointer).va_extsize < (toast_pointer).va_rawsize - VARHDRSZ)
+	(VARATT_EXTERNAL_GET_EXTSIZE(toast_pointer) < \
+	 (toast_pointer).va_rawsize - VARHDRSZ)
 
 /*
  * Macro to fetch the possibly-unaligned contents of an EXTERNAL datum
@@ -207,10 +236,29 @@ extern HeapTuple toast_build_flattened_tuple(TupleDesc tupleDesc,
 /* ----------
  * toast_compress_datum -
  *
- *	Create a compressed version of a varlena datum, if possible
+ *	Create a compressed version of a varlena datum, if possible, using
+ *	the given ToastCompressionId
+ * ----------
+ */
+extern Datum toast_compress_datum(Datum value, int cmethod);
+
+/* ----------
+ * toast_get_compression_id -
+ *
+ *	Return the compression method of a varlena datum, or
+ *	TOAST_INVALID_COMPRESSION_ID if it isn't compressed
+ * ----------
+ */
+extern ToastCompressionId toast_get_compression_id(struct varlena *attr);
+
+/* ----------
+ * Compression method names, as used for the default_toast_compression
+ * GUC and the "compression" column option
  * ----------
  */
-extern Datum toast_compress_datum(Datum value);
+extern ToastCompressionId CompressionNameToMethod(const char *name);
+extern const char *GetCompressionMethodName(ToastCompressionId cmethod);
+extern void ValidateCompressionMethod(char *name);
 
 /* ----------
  * toast_raw_datum_size -
@@ -98,13 +98,21 @@ extern int	min_wal_size_mb;
 extern int	max_wal_size_mb;
 extern int	wal_keep_segments;
 extern int	XLOGbuffers;
+extern int	wal_insert_locks;
+
+/*
+ * Upper limit for wal_insert_locks.  Holding all of them must leave room for
+ * other LWLocks below MAX_SIMUL_LWLOCKS, see WALInsertLockAcquireExclusive().
+ */
+#define MAX_WAL_INSERT_LOCKS	128
+
 extern int	XLogArchiveTimeout;
 extern int	wal_retrieve_retry_interval;
 extern char *XLogArchiveCommand;
 extern bool EnableHotStandby;
 extern bool fullPageWrites;
 extern bool wal_log_hints;
-extern bool wal_compression;
+extern int	wal_compression;
 extern bool *wal_consistency_checking;
 extern char *wal_consistency_checking_string;
 extern bool log_checkpoints;
@@ -120,6 +128,15 @@ typedef enum ArchiveMode
 } ArchiveMode;
 extern int	XLogArchiveMode;
 
+/* Compression algorithms for full-page images (wal_compression) */
+typedef enum WalCompression
+{
+	WAL_COMPRESSION_NONE = 0,
+	WAL_COMPRESSION_PGLZ,
+	WAL_COMPRESSION_LZ4,
+	WAL_COMPRESSION_ZSTD
+} WalCompression;
+
 /* WAL levels */
 typedef enum WalLevel
 {
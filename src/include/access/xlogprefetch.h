@@ -0,0 +1,29 @@
+/*-------------------------------------------------------------------------
+ *
+ * xlogprefetch.h
+ *	  Prefetching of data blocks referenced by upcoming WAL records.
+ *
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/access/xlogprefetch.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef XLOGPREFETCH_H
+#define XLOGPREFETCH_H
+
+#include "access/xlogdefs.h"
+
+/* GUC variable */
+extern int	recovery_prefetch_distance;
+
+typedef struct XLogPrefetcher XLogPrefetcher;
+
+extern XLogPrefetcher *XLogPrefetcherAllocate(void);
+extern void XLogPrefetcherFree(XLogPrefetcher *prefetcher);
+extern void XLogPrefetcherReadAhead(XLogPrefetcher *prefetcher,
+						XLogRecPtr replay_lsn, TimeLineID replay_tli);
+
+#endif							/* XLOGPREFETCH_H */
@@ -115,9 +115,11 @@ typedef struct XLogRecordBlockHeader
  * present is BLCKSZ - the length of "hole" bytes.
  *
  * When wal_compression is enabled, a full page image which "hole" was
- * removed is additionally compressed using PGLZ compression algorithm.
- * This can reduce the WAL volume, but at some extra cost of CPU spent
- * on the compression during WAL logging. In this case, since the "hole"
+ * removed is additionally compressed using the chosen algorithm (PGLZ, LZ4
+ * or Zstandard), which is recorded in bimg_info so that a WAL stream can mix
+ * images compressed with different methods.  This can reduce the WAL
+ * volume, but at some extra cost of CPU spent on the compression during WAL
+ * logging. In this case, since the "hole"
  * length cannot be calculated by subtracting the number of page image bytes
  * from BLCKSZ, basically it needs to be stored as an extra information.
  * But when no "hole" exists, we can assume that the "hole" length is zero
@@ -135,7 +137,7 @@ typedef struct XLogRecordBlockImageHeader
 	uint8		bimg_info;		/* flag bits, see below */
 
 	/*
-	 * If BKPIMAGE_HAS_HOLE and BKPIMAGE_IS_COMPRESSED, an
+	 * If BKPIMAGE_HAS_HOLE and BKPIMAGE_COMPRESSED(), an
 	 * XLogRecordBlockCompressHeader struct follows.
 	 */
 } XLogRecordBlockImageHeader;
@@ -145,9 +147,15 @@ typedef struct XLogRecordBlockImageHeader
 
 /* Information stored in bimg_info */
 #define BKPIMAGE_HAS_HOLE		0x01	/* page image has "hole" */
-#define BKPIMAGE_IS_COMPRESSED		0x02	/* page image is compressed */
+#define BKPIMAGE_COMPRESS_PGLZ	0x02	/* page image is compressed with pglz */
 #define BKPIMAGE_APPLY		0x04	/* page image should be restored during
 									 * replay */
+#define BKPIMAGE_COMPRESS_LZ4	0x08	/* page image is compressed with lz4 */
+#define BKPIMAGE_COMPRESS_ZSTD	0x10	/* page image is compressed with zstd */
+
+#define BKPIMAGE_COMPRESSED(info) \
+	(((info) & (BKPIMAGE_COMPRESS_PGLZ | BKPIMAGE_COMPRESS_LZ4 | \
+				BKPIMAGE_COMPRESS_ZSTD)) != 0)
 
 /*
  * Extra header information used when page image has "hole" and
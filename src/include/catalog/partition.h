@@ -13,6 +13,7 @@
 #ifndef PARTITION_H
 #define PARTITION_H
 
+#include "access/stratnum.h"
 #include "fmgr.h"
 #include "executor/tuptable.h"
 #include "nodes/execnodes.h"
@@ -55,6 +56,14 @@ typedef struct PartitionDescData *PartitionDesc;
  *	indexes		Array with partdesc->nparts members (for details on what
  *				individual members represent, see how they are set in
  *				RelationGetPartitionDispatchInfo())
+ *	last_bound	Entry of the partition bounds' indexes array that the last
+ *				tuple routed through this table mapped to, or -1; tried
+ *				first for the next tuple, since bulk loads are often sorted
+ *	listhash	Hash table over the bound values of a list partitioned
+ *				table with many of them, built on first use; NULL if not
+ *				(yet) built
+ *	listhashfn	Hash function to build listhash with, if it is to be used;
+ *				fn_oid is InvalidOid otherwise
  *-----------------------
  */
 typedef struct PartitionDispatchData
@@ -66,6 +75,9 @@ typedef struct PartitionDispatchData
 	TupleTableSlot *tupslot;
 	TupleConversionMap *tupmap;
 	int		   *indexes;
+	int			last_bound;
+	struct partlisthash_hash *listhash;
+	FmgrInfo	listhashfn;
 } PartitionDispatchData;
 
 typedef struct PartitionDispatchData *PartitionDispatch;
@@ -100,4 +112,10 @@ extern int get_partition_for_tuple(PartitionDispatch *pd,
 						EState *estate,
 						PartitionDispatchData **failed_at,
 						TupleTableSlot **failed_slot);
+
+/* For run-time partition pruning */
+extern Bitmapset *get_partitions_for_key_value(PartitionKey key,
+							 PartitionDesc partdesc,
+							 StrategyNumber strategy,
+							 Datum value, bool isnull);
 #endif							/* PARTITION_H */
@@ -0,0 +1,56 @@
+/*-------------------------------------------------------------------------
+ *
+ * execBatch.h
+ *	  support for batch-at-a-time execution of simple scan/aggregate plans
+ *
+ *
+ * Portions Copyright (c) 1996-2017, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/executor/execBatch.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef EXECBATCH_H
+#define EXECBATCH_H
+
+#include "access/tupdesc.h"
+#include "nodes/bitmapset.h"
+#include "nodes/primnodes.h"
+
+/* GUC variable: max # of rows per batch, or 0 to disable batch execution */
+extern int	executor_batch_size;
+
+/*
+ * TupleBatch holds a set of input rows, deformed column-wise.
+ *
+ * Only the columns requested when the batch was created are stored; for the
+ * others, values[] and isnull[] are NULL.  The values of pass-by-reference
+ * columns point into buffers that may no longer be pinned, so only their null
+ * flags may be used.
+ *
+ * selection[] lists, in increasing order, the rows that passed the quals
+ * applied so far; nselected is its length.
+ */
+typedef struct TupleBatch
+{
+	int			natts;			/* # of entries in values[] and isnull[] */
+	int			maxrows;		/* allocated length of the columns */
+	int			nrows;			/* # of rows currently stored */
+	Datum	  **values;			/* values[attno - 1][row] */
+	bool	  **isnull;			/* isnull[attno - 1][row] */
+	int			nselected;		/* # of entries in selection[] */
+	int		   *selection;		/* rows that passed the quals */
+} TupleBatch;
+
+/* A qual clause that can be evaluated over a whole batch at once */
+typedef struct BatchQual BatchQual;
+
+extern bool ExecBatchTypeSupported(Oid typid);
+extern TupleBatch *ExecCreateTupleBatch(TupleDesc tupdesc, Bitmapset *attnums,
+					 int maxrows);
+extern BatchQual *ExecInitBatchQual(Expr *clause);
+extern AttrNumber ExecBatchQualAttno(BatchQual *qual);
+extern void ExecBatchQualFilter(BatchQual *qual, TupleBatch *batch);
+
+#endif							/* EXECBATCH_H */
@@ -37,6 +37,7 @@ extern ParallelExecutorInfo *ExecInitParallelPlan(PlanState *planstate,
 extern void ExecParallelFinish(ParallelExecutorInfo *pei);
 extern void ExecParallelCleanup(ParallelExecutorInfo *pei);
 extern void ExecParallelReinitialize(ParallelExecutorInfo *pei);
+extern void ExecParallelWorkersLaunched(ParallelExecutorInfo *pei);
 
 extern void ParallelQueryMain(dsm_segment *seg, shm_toc *toc);
 
@@ -88,6 +88,9 @@ extern PGDLLIMPORT ExecutorEnd_hook_type ExecutorEnd_hook;
 typedef bool (*ExecutorCheckPerms_hook_type) (List *, bool);
 extern PGDLLIMPORT ExecutorCheckPerms_hook_type ExecutorCheckPerms_hook;
 
+/* GUC parameter */
+extern PGDLLIMPORT double specialize_above_cost;
+
 
 /*
  * prototypes from functions in execAmi.c
@@ -162,6 +165,39 @@ extern TupleTableSlot *ExecFilterJunk(JunkFilter *junkfilter,
 			   TupleTableSlot *slot);
 
 
+/*
+ * PartitionTupleRouting - information needed to route tuples inserted into a
+ * partitioned table to its leaf partitions
+ *
+ *	rootrel			the partitioned table tuples are inserted into
+ *	resultRTindex	its range table index
+ *	partition_dispatch_info		PartitionDispatch objects of all the
+ *					partitioned tables in the partition tree
+ *	num_dispatch	number of entries in partition_dispatch_info
+ *	partition_oids	OIDs of the leaf partitions
+ *	partitions		per leaf partition ResultRelInfo, or NULL if no tuple
+ *					has been routed to that partition yet
+ *	partition_tupconv_maps	per leaf partition map to convert tuples from
+ *					the root table's rowtype to the partition's, or NULL if
+ *					not needed; only valid once the partition's
+ *					ResultRelInfo has been set up
+ *	num_partitions	number of leaf partitions (entries of the above arrays)
+ *	partition_tuple_slot	standalone slot used to hold tuples converted to
+ *					a leaf partition's rowtype
+ */
+typedef struct PartitionTupleRouting
+{
+	Relation	rootrel;
+	Index		resultRTindex;
+	PartitionDispatch *partition_dispatch_info;
+	int			num_dispatch;
+	Oid		   *partition_oids;
+	ResultRelInfo **partitions;
+	TupleConversionMap **partition_tupconv_maps;
+	int			num_partitions;
+	TupleTableSlot *partition_tuple_slot;
+} PartitionTupleRouting;
+
 /*
  * prototypes from functions in execMain.c
  */
@@ -206,13 +242,11 @@ extern void EvalPlanQualSetPlan(EPQState *epqstate,
 extern void EvalPlanQualSetTuple(EPQState *epqstate, Index rti,
 					 HeapTuple tuple);
 extern HeapTuple EvalPlanQualGetTuple(EPQState *epqstate, Index rti);
-extern void ExecSetupPartitionTupleRouting(Relation rel,
-							   Index resultRTindex,
-							   PartitionDispatch **pd,
-							   ResultRelInfo **partitions,
-							   TupleConversionMap ***tup_conv_maps,
-							   TupleTableSlot **partition_tuple_slot,
-							   int *num_parted, int *num_partitions);
+extern PartitionTupleRouting *ExecSetupPartitionTupleRouting(Relation rel,
+							   Index resultRTindex);
+extern ResultRelInfo *ExecInitPartitionResultRel(PartitionTupleRouting *proute,
+						   int partidx, EState *estate);
+extern void ExecCleanupTupleRouting(PartitionTupleRouting *proute);
 extern int ExecFindPartition(ResultRelInfo *resultRelInfo,
 				  PartitionDispatch *pd,
 				  TupleTableSlot *slot,
@@ -16,6 +16,7 @@
 
 #include "nodes/execnodes.h"
 #include "storage/buffile.h"
+#include "utils/dsa.h"
 
 /* ----------------------------------------------------------------
  *				hash-join hash table structures
@@ -54,6 +55,21 @@
  * inner batch file.  Subsequently, while reading either inner or outer batch
  * files, we might find tuples that no longer belong to the current batch;
  * if so, we just dump them out to the correct batch file.
+ *
+ * Parallel-aware hash joins build a single hash table that is shared by all
+ * participating processes, rather than one private copy per process.  The
+ * bucket array and the tuples live in the query's DSA area, and the tuples
+ * are linked together with dsa_pointers instead of ordinary pointers, since
+ * the memory may be mapped at different addresses in each process.  Every
+ * participant inserts the tuples produced by its own share of the (partial)
+ * inner plan, pushing them onto the bucket chains with compare-and-swap.
+ * When the last participant has finished inserting, the table is complete
+ * and all participants probe it with their share of the outer plan.  Only
+ * the single-batch case is supported: the planner does not choose a shared
+ * hash table if it expects the inner relation to exceed work_mem, and the
+ * executor raises an error if the table outgrows the combined work_mem of
+ * the leader and the workers that were actually launched.  See
+ * ParallelHashJoinState.
  * ----------------------------------------------------------------
  */
 
@@ -63,7 +79,12 @@
 
 typedef struct HashJoinTupleData
 {
-	struct HashJoinTupleData *next; /* link to next tuple in same bucket */
+	/* link to next tuple in same bucket */
+	union
+	{
+		struct HashJoinTupleData *unshared;
+		dsa_pointer shared;
+	}			next;
 	uint32		hashvalue;		/* tuple's hash code */
 	/* Tuple data, in MinimalTuple format, follows on a MAXALIGN boundary */
 }			HashJoinTupleData;
@@ -112,8 +133,12 @@ typedef struct HashMemoryChunkData
 	size_t		maxlen;			/* size of the buffer holding the tuples */
 	size_t		used;			/* number of buffer bytes already used */
 
-	struct HashMemoryChunkData *next;	/* pointer to the next chunk (linked
-										 * list) */
+	/* pointer to the next chunk (linked list) */
+	union
+	{
+		struct HashMemoryChunkData *unshared;
+		dsa_pointer shared;
+	}			next;
 
 	char		data[FLEXIBLE_ARRAY_MEMBER];	/* buffer allocated at the end */
 }			HashMemoryChunkData;
@@ -154,6 +179,7 @@ typedef struct HashJoinTableData
 
 	double		totalTuples;	/* # tuples obtained from inner plan */
 	double		skewTuples;		/* # tuples inserted into skew tuples */
+	double		partialTuples;	/* # tuples obtained by this participant */
 
 	/*
 	 * These arrays are allocated for the life of the hash join, but only if
@@ -185,6 +211,13 @@ typedef struct HashJoinTableData
 
 	/* used for dense allocation of tuples (into linked chunks) */
 	HashMemoryChunk chunks;		/* one list for the whole batch */
+
+	/* used only when the hash table is shared by parallel participants */
+	ParallelHashJoinState *parallel_state;	/* shared control block */
+	dsa_area   *area;			/* DSA area holding buckets and tuples */
+	dsa_pointer_atomic *shared_buckets; /* local address of bucket array */
+	HashMemoryChunk current_chunk;	/* chunk we're currently filling */
+	dsa_pointer current_chunk_shared;	/* ... and its dsa_pointer */
 }			HashJoinTableData;
 
 #endif							/* HASHJOIN_H */
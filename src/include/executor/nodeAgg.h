@@ -16,6 +16,14 @@
 
 #include "nodes/execnodes.h"
 
+/*
+ * Range of the number of partitions a spilling hash aggregate may write in
+ * one pass.  More partitions mean fewer passes, but each open file costs a
+ * buffer.
+ */
+#define HASHAGG_MIN_PARTITIONS	4
+#define HASHAGG_MAX_PARTITIONS	256
+
 extern AggState *ExecInitAgg(Agg *node, EState *estate, int eflags);
 extern void ExecEndAgg(AggState *node);
 extern void ExecReScanAgg(AggState *node);
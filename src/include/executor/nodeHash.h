@@ -21,7 +21,7 @@ extern Node *MultiExecHash(HashState *node);
 extern void ExecEndHash(HashState *node);
 extern void ExecReScanHash(HashState *node);
 
-extern HashJoinTable ExecHashTableCreate(Hash *node, List *hashOperators,
+extern HashJoinTable ExecHashTableCreate(HashState *state, List *hashOperators,
 					bool keepNulls);
 extern void ExecHashTableDestroy(HashJoinTable hashtable);
 extern void ExecHashTableInsert(HashJoinTable hashtable,
@@ -43,7 +43,10 @@ extern bool ExecScanHashTableForUnmatched(HashJoinState *hjstate,
 							  ExprContext *econtext);
 extern void ExecHashTableReset(HashJoinTable hashtable);
 extern void ExecHashTableResetMatchFlags(HashJoinTable hashtable);
+extern void ExecParallelHashTableReset(ParallelHashJoinState *pstate,
+						   dsa_area *area);
 extern void ExecChooseHashTableSize(double ntuples, int tupwidth, bool useskew,
+						int parallel_workers,
 						int *numbuckets,
 						int *numbatches,
 						int *num_skew_mcvs);
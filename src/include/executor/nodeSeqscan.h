@@ -15,12 +15,18 @@
 #define NODESEQSCAN_H
 
 #include "access/parallel.h"
+#include "executor/execBatch.h"
 #include "nodes/execnodes.h"
 
 extern SeqScanState *ExecInitSeqScan(SeqScan *node, EState *estate, int eflags);
 extern void ExecEndSeqScan(SeqScanState *node);
 extern void ExecReScanSeqScan(SeqScanState *node);
 
+/* batch-at-a-time support */
+extern bool ExecSeqScanInitBatch(SeqScanState *node, Bitmapset *attnums,
+					 int maxrows);
+extern TupleBatch *ExecSeqScanNextBatch(SeqScanState *node);
+
 /* parallel scan support */
 extern void ExecSeqScanEstimate(SeqScanState *node, ParallelContext *pcxt);
 extern void ExecSeqScanInitializeDSM(SeqScanState *node, ParallelContext *pcxt);
@@ -108,8 +108,45 @@
  *
  * tts_slow/tts_off are saved state for slot_deform_tuple, and should not
  * be touched by any other code.
+ *
+ * tts_deform, if not NULL, is a TupleDeformProgram for tts_tupleDescriptor
+ * that slot_deform_tuple uses to speed up extraction of leading fixed-width
+ * columns; see ExecSetSlotDeformProgram.
  *----------
  */
+
+/*
+ * How to fetch one fixed-width attribute in a TupleDeformProgram.
+ */
+typedef enum DeformFetch
+{
+	DEFORM_FETCH_CHAR,			/* 1-byte pass-by-value */
+	DEFORM_FETCH_INT16,			/* 2-byte pass-by-value */
+	DEFORM_FETCH_INT32,			/* 4-byte pass-by-value */
+	DEFORM_FETCH_DATUM,			/* 8-byte pass-by-value */
+	DEFORM_FETCH_POINTER		/* pass-by-reference */
+} DeformFetch;
+
+typedef struct DeformAttr
+{
+	int32		off;			/* offset from start of tuple data */
+	int16		len;			/* attlen */
+	int16		fetch;			/* a DeformFetch */
+} DeformAttr;
+
+/*
+ * TupleDeformProgram describes the leading run of fixed-width attributes of
+ * a tuple descriptor, whose offsets in the tuple data are the same in every
+ * tuple that has no nulls among them.
+ */
+typedef struct TupleDeformProgram
+{
+	int			nfixed;			/* # of leading fixed-width attributes */
+	int			nnotnull;		/* # of leading attributes that are also
+								 * declared NOT NULL */
+	DeformAttr	attrs[FLEXIBLE_ARRAY_MEMBER];	/* nfixed entries */
+} TupleDeformProgram;
+
 typedef struct TupleTableSlot
 {
 	NodeTag		type;
@@ -127,6 +164,7 @@ typedef struct TupleTableSlot
 	MinimalTuple tts_mintuple;	/* minimal tuple, or NULL if none */
 	HeapTupleData tts_minhdr;	/* workspace for minimal-tuple-only case */
 	long		tts_off;		/* saved state for slot_deform_tuple */
+	TupleDeformProgram *tts_deform; /* specialized deforming, or NULL */
 } TupleTableSlot;
 
 #define TTS_HAS_PHYSICAL_TUPLE(slot)  \
@@ -145,6 +183,7 @@ extern void ExecResetTupleTable(List *tupleTable, bool shouldFree);
 extern TupleTableSlot *MakeSingleTupleTableSlot(TupleDesc tupdesc);
 extern void ExecDropSingleTupleTableSlot(TupleTableSlot *slot);
 extern void ExecSetSlotDescriptor(TupleTableSlot *slot, TupleDesc tupdesc);
+extern void ExecSetSlotDeformProgram(TupleTableSlot *slot);
 extern TupleTableSlot *ExecStoreTuple(HeapTuple tuple,
 			   TupleTableSlot *slot,
 			   Buffer buffer,
@@ -18,6 +18,7 @@
 #include "access/heapam.h"
 #include "access/tupconvert.h"
 #include "executor/instrument.h"
+#include "lib/ilist.h"
 #include "lib/pairingheap.h"
 #include "nodes/params.h"
 #include "nodes/plannodes.h"
@@ -506,6 +507,8 @@ typedef struct EState
 
 	/* The per-query shared memory area to use for parallel execution. */
 	struct dsa_area *es_query_dsa;
+
+	bool		es_specialize;	/* precompute specialized deforming? */
 } EState;
 
 
@@ -970,35 +973,84 @@ typedef struct ModifyTableState
 	TupleTableSlot *mt_existing;	/* slot to store existing target tuple in */
 	List	   *mt_excludedtlist;	/* the excluded pseudo relation's tlist  */
 	TupleTableSlot *mt_conflproj;	/* CONFLICT ... SET ... projection target */
-	struct PartitionDispatchData **mt_partition_dispatch_info;
+	struct PartitionTupleRouting *mt_partition_tuple_routing;
 	/* Tuple-routing support info */
-	int			mt_num_dispatch;	/* Number of entries in the above array */
-	int			mt_num_partitions;	/* Number of members in the following
-									 * arrays */
-	ResultRelInfo *mt_partitions;	/* Per partition result relation */
-	TupleConversionMap **mt_partition_tupconv_maps;
-	/* Per partition tuple conversion map */
-	TupleTableSlot *mt_partition_tuple_slot;
 	struct TransitionCaptureState *mt_transition_capture;
 	/* controls transition table population */
 	TupleConversionMap **mt_transition_tupconv_maps;
 	/* Per plan/partition tuple conversion */
 } ModifyTableState;
 
+/* ----------------
+ *	 PartitionPruneState information
+ *
+ *		Run-time state of the partition pruning steps of an Append; see
+ *		PartitionPruneInfo in plannodes.h.
+ *
+ *		partrel			the partitioned table, kept open for its key
+ *						and partition descriptor
+ *		init_exprs		comparison values of the steps that are only
+ *						evaluated at executor startup
+ *		exec_exprs		comparison values of the steps that are
+ *						evaluated before each scan
+ *		subplan_map		index into appendplans of each partition's subplan,
+ *						or -1 if none is initialized
+ * ----------------
+ */
+typedef struct PartitionPruneState
+{
+	Relation	partrel;
+	int			n_init_steps;
+	StrategyNumber *init_strategies;
+	ExprState **init_exprs;
+	int			n_exec_steps;
+	StrategyNumber *exec_strategies;
+	ExprState **exec_exprs;
+	Bitmapset  *execparamids;
+	int			nparts;
+	int		   *subplan_map;
+} PartitionPruneState;
+
 /* ----------------
  *	 AppendState information
  *
  *		nplans			how many plans are in the array
- *		whichplan		which plan is being executed (0 .. n-1)
+ *		whichplan		which entry of valid_subplans is being executed,
+ *						or -1 if we haven't chosen one yet
+ *		valid_subplans	indexes of the plans to scan, in order; normally
+ *						all of them, unless run-time partition pruning
+ *						removed some
+ *		nvalid			how many entries are in valid_subplans, or -1 if
+ *						they must be recomputed before the next scan
+ *		first_partial_plan	index in appendplans of the first partial plan;
+ *						those before it must be run by a single process
+ *		first_partial	index of the first entry of valid_subplans that is
+ *						a partial plan
+ *		prune_state		partition pruning state, or NULL
+ *		pstate			shared state of a parallel-aware Append, or NULL
+ *		choose_next_subplan	function that advances whichplan
  * ----------------
  */
-typedef struct AppendState
+struct AppendState;
+typedef struct AppendState AppendState;
+struct ParallelAppendState;
+typedef struct ParallelAppendState ParallelAppendState;
+
+struct AppendState
 {
 	PlanState	ps;				/* its first field is NodeTag */
 	PlanState **appendplans;	/* array of PlanStates for my inputs */
 	int			as_nplans;
 	int			as_whichplan;
-} AppendState;
+	int		   *as_valid_subplans;
+	int			as_nvalid;
+	int			as_first_partial_plan;
+	int			as_first_partial;
+	PartitionPruneState *as_prune_state;
+	ParallelAppendState *as_pstate; /* parallel coordination info */
+	Size		pstate_len;		/* size of parallel coordination info */
+	bool		(*choose_next_subplan) (AppendState *);
+};
 
 /* ----------------
  *	 MergeAppendState information
@@ -1106,6 +1158,12 @@ typedef struct SeqScanState
 {
 	ScanState	ss;				/* its first field is NodeTag */
 	Size		pscan_len;		/* size of parallel heap scan descriptor */
+	/* these fields are set only when the parent reads batches: */
+	struct TupleBatch *batch;	/* batch returned by ExecSeqScanNextBatch */
+	List	   *batchquals;		/* quals applied to whole batches */
+	ExprState  *batchresidual;	/* other quals, applied to each tuple */
+	int			batchlastattno; /* highest column stored in the batch */
+	bool		batchdone;		/* scan exhausted? */
 } SeqScanState;
 
 /* ----------------
@@ -1651,6 +1709,63 @@ typedef struct MergeJoinState
 	ExprContext *mj_InnerEContext;
 } MergeJoinState;
 
+/* ----------------
+ *	 SharedHashJoinPhase information
+ *
+ *		PHJ_PHASE_INIT		nobody has started building yet; the first
+ *							participant to arrive allocates the buckets
+ *		PHJ_PHASE_ALLOCATING	bucket array is being allocated; others wait
+ *		PHJ_PHASE_BUILDING	participants are inserting inner tuples
+ *		PHJ_PHASE_RESIZING	all builders have finished; the last one to
+ *							finish is resizing the bucket array if needed
+ *		PHJ_PHASE_DONE		hash table is complete and may be probed
+ * ----------------
+ */
+typedef enum
+{
+	PHJ_PHASE_INIT,
+	PHJ_PHASE_ALLOCATING,
+	PHJ_PHASE_BUILDING,
+	PHJ_PHASE_RESIZING,
+	PHJ_PHASE_DONE
+} SharedHashJoinPhase;
+
+/* ----------------
+ *	 ParallelHashJoinState information
+ *		mutex					mutual exclusion for all the fields below
+ *		phase					current build phase of the shared hash table
+ *		nbuilders				# participants currently inserting tuples
+ *		nparticipants			# processes taking part (workers plus leader);
+ *								the planned number until workers_launched
+ *		workers_launched		has the leader launched the workers yet?
+ *		nbuckets				# buckets in the shared hash table
+ *		log2_nbuckets			its log2
+ *		buckets					array of dsa_pointer_atomic bucket heads
+ *		chunks					list of all tuple chunks, for resizing and
+ *								for freeing the table
+ *		totalTuples				# tuples inserted by all participants
+ *		spaceUsed				memory used by chunks and buckets
+ *		spaceAllowed			combined work_mem of all participants
+ *		cv						conditional wait variable
+ * ----------------
+ */
+typedef struct ParallelHashJoinState
+{
+	slock_t		mutex;
+	SharedHashJoinPhase phase;
+	int			nbuilders;
+	int			nparticipants;
+	bool		workers_launched;
+	int			nbuckets;
+	int			log2_nbuckets;
+	dsa_pointer buckets;
+	dsa_pointer chunks;
+	double		totalTuples;
+	Size		spaceUsed;
+	Size		spaceAllowed;
+	ConditionVariable cv;
+} ParallelHashJoinState;
+
 /* ----------------
  *	 HashJoinState information
  *
@@ -1727,6 +1842,49 @@ typedef struct MaterialState
 	Tuplestorestate *tuplestorestate;
 } MaterialState;
 
+/* ----------------
+ *	 ResultCacheState information
+ *
+ *		result cache nodes keep the output of their subplan for each set
+ *		of parameter values it was scanned with, so that rescans with
+ *		values seen before need not run the subplan again.  The least
+ *		recently used entries are evicted to stay within work_mem.
+ * ----------------
+ */
+struct resultcache_hash;		/* private in nodeResultCache.c */
+struct ResultCacheEntry;
+struct ResultCacheTuple;
+
+typedef struct ResultCacheState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	int			rc_status;		/* state of ExecResultCache's state machine */
+	int			nkeys;			/* number of cache keys */
+	struct resultcache_hash *hashtable; /* hash table of cache entries */
+	TupleDesc	hashkeydesc;	/* tuple descriptor for cache keys */
+	TupleTableSlot *tableslot;	/* slot for a cache entry's key */
+	TupleTableSlot *probeslot;	/* slot for the current parameter values */
+	ExprState **param_exprs;	/* exprs computing the parameter values */
+	FmgrInfo   *hashfunctions;	/* hash functions for the cache keys */
+	FmgrInfo   *eqfunctions;	/* equality functions for the cache keys */
+	AttrNumber *keyColIdx;		/* 1..nkeys, for execTuplesMatch */
+	MemoryContext tableContext; /* memory context holding the cache */
+	MemoryContext tempContext;	/* short-term context for comparisons */
+	dlist_head	lru_list;		/* cache keys, least recently used first */
+	struct ResultCacheEntry *entry; /* entry of the current scan, or NULL */
+	struct ResultCacheTuple *last_tuple;	/* last tuple returned from or
+											 * stored into entry */
+	Size		mem_used;		/* bytes used by the cache */
+	Size		mem_limit;		/* bytes the cache may use */
+	bool		singlerow;		/* entries complete after the first tuple? */
+	/* statistics for EXPLAIN ANALYZE */
+	uint64		cache_hits;		/* rescans answered from the cache */
+	uint64		cache_misses;	/* rescans that had to run the subplan */
+	uint64		cache_evictions;	/* entries evicted to free memory */
+	uint64		cache_overflows;	/* scans too big to cache at all */
+	Size		mem_peak;		/* peak bytes used by the cache */
+} ResultCacheState;
+
 /* ----------------
  *	 SortState information
  * ----------------
@@ -1743,6 +1901,35 @@ typedef struct SortState
 	void	   *tuplesortstate; /* private state of tuplesort.c */
 } SortState;
 
+/* ----------------
+ *	 IncrementalSortState information
+ *
+ *		The input is read in batches made of one or more complete groups of
+ *		tuples with equal presorted keys, and each batch is sorted on its
+ *		own.  group_pivot holds a tuple of the batch's last group, and
+ *		transfer_tuple the first tuple of the next batch, which was read
+ *		before we could tell the batch was complete.
+ * ----------------
+ */
+typedef struct IncrementalSortState
+{
+	ScanState	ss;				/* its first field is NodeTag */
+	bool		bounded;		/* is the result set bounded? */
+	int64		bound;			/* if bounded, how many tuples are needed */
+	bool		batch_sorted;	/* current batch sorted and being returned? */
+	bool		input_done;		/* reached end of input? */
+	int64		bound_Done;		/* # of tuples already returned */
+	FmgrInfo   *eqfunctions;	/* equality fns for presorted columns */
+	MemoryContext tempContext;	/* short-term context for comparisons */
+	TupleTableSlot *group_pivot;	/* a tuple of the last group in batch */
+	TupleTableSlot *transfer_tuple; /* first tuple of the next batch */
+	void	   *tuplesortstate; /* private state of tuplesort.c */
+	/* statistics for EXPLAIN ANALYZE */
+	int64		nbatches;		/* # of batches sorted */
+	long		maxSpaceUsed;	/* largest space used by any batch, in kB */
+	const char *maxSpaceType;	/* "Memory" or "Disk" for that batch */
+} IncrementalSortState;
+
 /* ---------------------
  *	GroupState information
  * ---------------------
@@ -1810,7 +1997,23 @@ typedef struct AggState
 	bool		table_filled;	/* hash table filled yet? */
 	int			num_hashes;
 	AggStatePerHash perhash;
+	bool		batch_mode;		/* reading input batches (see execBatch.c)? */
 	AggStatePerGroup *hash_pergroup;	/* array of per-group pointers */
+	/* these fields are used when a hash table spills to disk: */
+	bool		hash_spill_enabled; /* may the hash table spill at all? */
+	bool		hash_spill_mode;	/* spilling new groups to disk now? */
+	bool		hash_spilled;	/* has the hash table spilled at all? */
+	Size		hash_mem_limit; /* limit before spilling hash table */
+	Size		hash_mem_used;	/* estimated memory used by groups */
+	double		hash_ngroups_estimate;	/* # of groups expected in this pass */
+	int			hash_spill_bits;	/* # of hash bits used by earlier passes */
+	int			hash_spill_npartitions; /* # of partitions being written */
+	struct BufFile **hash_spill_files;	/* partition files being written */
+	double	   *hash_spill_ntuples; /* # of tuples in each partition */
+	List	   *hash_batches;	/* spilled HashAggBatches yet to process */
+	TupleTableSlot *hash_spill_slot;	/* slot for reading spilled tuples */
+	int			hash_batches_used;	/* # of spilled batches processed */
+	Size		hash_disk_used; /* bytes written to temporary files */
 	/* support for evaluation of agg inputs */
 	TupleTableSlot *evalslot;	/* slot for agg inputs */
 	ProjectionInfo *evalproj;	/* projection machinery */
@@ -1956,6 +2159,9 @@ typedef struct HashState
 	HashJoinTable hashtable;	/* hash table for the hashjoin */
 	List	   *hashkeys;		/* list of ExprState nodes */
 	/* hashkeys is same as parent's hj_InnerHashKeys */
+
+	/* shared build state, set up by the parent HashJoin if parallel-aware */
+	ParallelHashJoinState *parallel_state;
 } HashState;
 
 /* ----------------
@@ -248,6 +248,10 @@ typedef struct Append
 	/* RT indexes of non-leaf tables in a partition tree */
 	List	   *partitioned_rels;
 	List	   *appendplans;
+	/* Subplans from this index on are partial plans (see AppendPath) */
+	int			first_partial_plan;
+	/* Info for skipping partitions at run time, or NULL if none */
+	struct PartitionPruneInfo *part_prune_info;
 } Append;
 
 /* ----------------
@@ -735,6 +739,25 @@ typedef struct Material
 	Plan		plan;
 } Material;
 
+/* ----------------
+ *		result cache node
+ *
+ *		Caches the output of its subplan, which is rescanned with changing
+ *		parameter values, keyed by the values of param_exprs.  The
+ *		equality operators are used to compare cache keys; the matching
+ *		hash functions are looked up at executor startup.
+ * ----------------
+ */
+typedef struct ResultCache
+{
+	Plan		plan;
+	int			numKeys;		/* number of cache keys */
+	Oid		   *hashOperators;	/* equality operators for the cache keys */
+	List	   *param_exprs;	/* exprs computing the cache key values */
+	bool		singlerow;		/* true if the cache entry is complete after
+								 * the first tuple */
+} ResultCache;
+
 /* ----------------
  *		sort node
  * ----------------
@@ -749,6 +772,20 @@ typedef struct Sort
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
 } Sort;
 
+/* ----------------
+ *		incremental sort node
+ *
+ *		The input is already sorted on the first presortedCols sort columns;
+ *		only the remaining columns need sorting, one group of equal leading
+ *		keys at a time.
+ * ----------------
+ */
+typedef struct IncrementalSort
+{
+	Sort		sort;
+	int			presortedCols;	/* number of presorted leading columns */
+} IncrementalSort;
+
 /* ---------------
  *	 group node -
  *		Used for queries with GROUP BY (but no aggregates) specified.
@@ -857,6 +894,10 @@ typedef struct GatherMerge
  * If the executor is supposed to try to apply skew join optimization, then
  * skewTable/skewColumn/skewInherit identify the outer relation's join key
  * column, from which the relevant MCV statistics can be fetched.
+ *
+ * rows_total is the planner's estimate of the number of tuples in the whole
+ * hash table; it differs from the input's plan_rows only when the Hash is
+ * parallel-aware, and the input is a partial plan.
  * ----------------
  */
 typedef struct Hash
@@ -865,6 +906,7 @@ typedef struct Hash
 	Oid			skewTable;		/* outer join key's table OID, or InvalidOid */
 	AttrNumber	skewColumn;		/* outer join key's column #, or zero */
 	bool		skewInherit;	/* is outer join rel an inheritance tree? */
+	double		rows_total;		/* estimate total rows if parallel_aware */
 	/* all other info is in the parent HashJoin node */
 } Hash;
 
@@ -1028,4 +1070,38 @@ typedef struct PlanInvalItem
 	uint32		hashValue;		/* hash value of object's cache lookup key */
 } PlanInvalItem;
 
+
+/*
+ * PartitionPruneInfo - run-time partition pruning info for an Append
+ *
+ * When the subplans of an Append scan the leaf partitions of a partitioned
+ * table, some of them can often be skipped based on values that aren't known
+ * until execution, such as Params of a generic plan or the outer values of
+ * a parameterized nestloop.  Each pruning step is a condition
+ * "partkey <strategy> expr" that every row returned must satisfy, where the
+ * strategy is a btree strategy number in the partition key's operator
+ * family.  Only single-column partition keys are supported.
+ *
+ * The init steps' comparison values can be computed at executor startup,
+ * so that the subplans of partitions they rule out are never initialized.
+ * The exec steps depend on PARAM_EXEC Params; they're evaluated before each
+ * scan of the Append, and again whenever one of execparamids changes.
+ *
+ * subplan_map gives, for each partition in the order of the partitioned
+ * table's PartitionDesc, the index of the subplan scanning it, or -1 if the
+ * planner already excluded it.
+ */
+typedef struct PartitionPruneInfo
+{
+	NodeTag		type;
+	Oid			reloid;			/* OID of the partitioned table */
+	List	   *init_strategies;	/* IntList of strategy numbers */
+	List	   *init_exprs;		/* comparison values of the init steps */
+	List	   *exec_strategies;	/* IntList of strategy numbers */
+	List	   *exec_exprs;		/* comparison values of the exec steps */
+	Bitmapset  *execparamids;	/* PARAM_EXEC Params used by exec_exprs */
+	int			nparts;			/* # of partitions at plan time */
+	int		   *subplan_map;	/* subplan index by partition index */
+} PartitionPruneInfo;
+
 #endif							/* PLANNODES_H */
@@ -253,6 +253,9 @@ typedef struct PlannerInfo
 
 	List	   *pcinfo_list;	/* list of PartitionedChildRelInfos */
 
+	List	   *part_schemes;	/* Canonicalised partition schemes used in the
+								 * query. */
+
 	List	   *rowMarks;		/* list of PlanRowMarks */
 
 	List	   *placeholder_list;	/* list of PlaceHolderInfos */
@@ -356,6 +359,11 @@ typedef struct PlannerInfo
  * and/or MergeAppend paths comprising the best paths for the individual
  * member rels.  (See comments for AppendRelInfo for more information.)
  *
+ * Similarly, when two partitioned tables are joined partition-wise, each
+ * join between a pair of matching partitions is an "other" joinrel, or child
+ * join.  Child joins aren't part of the join search either; they are only
+ * used to build the Append paths of their parent joinrel.
+ *
  * At one time we also made otherrels to represent join RTEs, for use in
  * handling join alias Vars.  Currently this is not needed because all join
  * alias Vars are expanded to non-aliased form during preprocess_expression.
@@ -472,6 +480,20 @@ typedef struct PlannerInfo
  *					EquivalenceClasses)
  *		has_eclass_joins - flag that EquivalenceClass joins are possible
  *
+ * For a partitioned table whose partitions all are children of it in the
+ * appendrel, and for a join between such tables that was planned
+ * partition-wise, the following fields describe the partitioning:
+ *
+ *		part_scheme - Partitioning scheme of the relation, or NULL if it's
+ *					not to be treated as partitioned
+ *		boundinfo - Partition bounds
+ *		nparts - Number of partitions
+ *		part_rels - RelOptInfos of the partitions, in the order of the bounds;
+ *					for a join, the "child joins" of the matching partitions
+ *		partexprs - Array of Lists, one per partition key column, of the
+ *					expressions equal to that key column (more than one
+ *					for a join)
+ *
  * Note: Keeping a restrictinfo list in the RelOptInfo is useful only for
  * base rels, because for a join rel the set of clauses that are treated as
  * restrict clauses varies depending on which sub-relations we choose to join.
@@ -489,11 +511,41 @@ typedef struct PlannerInfo
  * and may need it multiple times to price index scans.
  *----------
  */
+/*
+ * If multiple relations are partitioned the same way, all such partitions
+ * will have a pointer to the same PartitionScheme.  A list of PartitionScheme
+ * objects is attached to the PlannerInfo.  By design, the partition scheme
+ * incorporates only the general properties of the partition method (LIST vs.
+ * RANGE, number of partitioning columns and the type information for each)
+ * and not the specific bounds.
+ *
+ * We store the opclass-declared input data types instead of the partition key
+ * datatypes since the former rather than the latter are used to compare
+ * partition bounds.  Since partition key data types and the opclass declared
+ * input data types are expected to be binary compatible (per ResolveOpClass),
+ * both of those should have same byval and length properties.
+ */
+typedef struct PartitionSchemeData
+{
+	char		strategy;		/* partition strategy */
+	int16		partnatts;		/* number of partition attributes */
+	Oid		   *partopfamily;	/* OIDs of operator families */
+	Oid		   *partopcintype;	/* OIDs of opclass declared input data types */
+	Oid		   *partcollation;	/* OIDs of partitioning collations */
+
+	/* Cached information about partition key data types. */
+	int16	   *parttyplen;
+	bool	   *parttypbyval;
+} PartitionSchemeData;
+
+typedef struct PartitionSchemeData *PartitionScheme;
+
 typedef enum RelOptKind
 {
 	RELOPT_BASEREL,
 	RELOPT_JOINREL,
 	RELOPT_OTHER_MEMBER_REL,
+	RELOPT_OTHER_JOINREL,
 	RELOPT_UPPER_REL,
 	RELOPT_DEADREL
 } RelOptKind;
@@ -507,13 +559,17 @@ typedef enum RelOptKind
 	 (rel)->reloptkind == RELOPT_OTHER_MEMBER_REL)
 
 /* Is the given relation a join relation? */
-#define IS_JOIN_REL(rel) ((rel)->reloptkind == RELOPT_JOINREL)
+#define IS_JOIN_REL(rel)	\
+	((rel)->reloptkind == RELOPT_JOINREL || \
+	 (rel)->reloptkind == RELOPT_OTHER_JOINREL)
 
 /* Is the given relation an upper relation? */
 #define IS_UPPER_REL(rel) ((rel)->reloptkind == RELOPT_UPPER_REL)
 
 /* Is the given relation an "other" relation? */
-#define IS_OTHER_REL(rel) ((rel)->reloptkind == RELOPT_OTHER_MEMBER_REL)
+#define IS_OTHER_REL(rel) \
+	((rel)->reloptkind == RELOPT_OTHER_MEMBER_REL || \
+	 (rel)->reloptkind == RELOPT_OTHER_JOINREL)
 
 typedef struct RelOptInfo
 {
@@ -592,6 +648,14 @@ typedef struct RelOptInfo
 
 	/* used by "other" relations */
 	Relids		top_parent_relids;	/* Relids of topmost parents */
+
+	/* used for partitioned relations */
+	PartitionScheme part_scheme;	/* Partitioning scheme. */
+	int			nparts;			/* number of partitions */
+	struct PartitionBoundInfoData *boundinfo;	/* Partition bounds */
+	struct RelOptInfo **part_rels;	/* Array of RelOptInfos of partitions,
+									 * stored in the same order of bounds */
+	List	  **partexprs;		/* Partition key expressions. */
 } RelOptInfo;
 
 /*
@@ -1178,6 +1242,9 @@ typedef struct AppendPath
 	/* RT indexes of non-leaf tables in a partition tree */
 	List	   *partitioned_rels;
 	List	   *subpaths;		/* list of component Paths */
+
+	/* Index of first partial path in subpaths */
+	int			first_partial_path;
 } AppendPath;
 
 #define IS_DUMMY_PATH(p) \
@@ -1226,6 +1293,27 @@ typedef struct MaterialPath
 	Path	   *subpath;
 } MaterialPath;
 
+/*
+ * ResultCachePath represents a ResultCache plan node, which caches the
+ * output of a parameterized subpath for each distinct set of parameter
+ * values.  This pays off below a nestloop whose outer side repeats the
+ * same join keys many times.
+ *
+ * param_exprs are the outer-side expressions the subpath is parameterized
+ * by, and hash_operators the equality operators used to compare them.
+ * calls is the expected number of rescans, used for costing.
+ */
+typedef struct ResultCachePath
+{
+	Path		path;
+	Path	   *subpath;		/* path representing input source */
+	List	   *hash_operators; /* equality operator OIDs for param_exprs */
+	List	   *param_exprs;	/* cache keys */
+	bool		singlerow;		/* true if the cache entry is complete after
+								 * the first tuple */
+	double		calls;			/* expected number of rescans */
+} ResultCachePath;
+
 /*
  * UniquePath represents elimination of distinct rows from the output of
  * its subpath.
@@ -1363,6 +1451,11 @@ typedef struct MergePath
  *
  * Hashjoin does not care what order its inputs appear in, so we have
  * no need for sortkeys.
+ *
+ * A parallel-aware hashjoin (jpath.path.parallel_aware) builds one hash
+ * table shared by all participants from a partial inner path; in that case
+ * inner_rows_total is the estimated size of the whole inner relation, rather
+ * than of one participant's share of it.
  */
 
 typedef struct HashPath
@@ -1370,6 +1463,7 @@ typedef struct HashPath
 	JoinPath	jpath;
 	List	   *path_hashclauses;	/* join clauses used for hashing */
 	int			num_batches;	/* number of batches expected */
+	double		inner_rows_total;	/* total inner rows expected */
 } HashPath;
 
 /*
@@ -1418,6 +1512,19 @@ typedef struct SortPath
 	Path	   *subpath;		/* path representing input source */
 } SortPath;
 
+/*
+ * IncrementalSortPath represents a sort of input that is already sorted on
+ * a leading subset of the requested pathkeys
+ *
+ * Like SortPath, the sort keys are path.pathkeys; the first nPresortedCols
+ * of them are the subpath's own leading pathkeys.
+ */
+typedef struct IncrementalSortPath
+{
+	SortPath	spath;
+	int			nPresortedCols; /* number of presorted leading columns */
+} IncrementalSortPath;
+
 /*
  * GroupPath represents grouping (of presorted input)
  *
@@ -2221,6 +2328,7 @@ typedef struct JoinCostWorkspace
 	/* private for cost_hashjoin code */
 	int			numbuckets;
 	int			numbatches;
+	double		inner_rows_total;
 } JoinCostWorkspace;
 
 #endif							/* RELATION_H */
@@ -236,6 +236,14 @@
  */
 #define PG_CACHE_LINE_SIZE		128
 
+/*
+ * Assumed alignment requirement for direct I/O.  Buffers that are read or
+ * written with O_DIRECT (see io_direct) must be aligned to this boundary,
+ * and their length and file offset must be multiples of it.  4kB is enough
+ * for common file systems and devices.
+ */
+#define PG_IO_ALIGN_SIZE		4096
+
 /*
  *------------------------------------------------------------------------
  * The following symbols are for enabling debugging code, not for
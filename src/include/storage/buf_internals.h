@@ -311,6 +311,11 @@ extern BufferDesc *StrategyGetBuffer(BufferAccessStrategy strategy,
 extern void StrategyFreeBuffer(BufferDesc *buf);
 extern bool StrategyRejectBuffer(BufferAccessStrategy strategy,
 					 BufferDesc *buf);
+extern bool StrategyAdmitBuffer(BufferAccessStrategy strategy,
+					uint32 hashcode);
+extern void StrategyAddProbationBuffer(BufferDesc *buf);
+extern void StrategyBufferEvicted(BufferAccessStrategy strategy,
+					  uint32 hashcode);
 
 extern int	StrategySyncStart(uint32 *complete_passes, uint32 *num_buf_alloc);
 extern void StrategyNotifyBgWriter(int bgwprocno);
@@ -323,6 +328,8 @@ extern Size BufTableShmemSize(int size);
 extern void InitBufTable(int size);
 extern uint32 BufTableHashCode(BufferTag *tagPtr);
 extern int	BufTableLookup(BufferTag *tagPtr, uint32 hashcode);
+extern bool BufTableLookupNoLock(BufferTag *tagPtr, uint32 hashcode,
+					 int *buf_id);
 extern int	BufTableInsert(BufferTag *tagPtr, uint32 hashcode, int buf_id);
 extern void BufTableDelete(BufferTag *tagPtr, uint32 hashcode);
 
@@ -47,9 +47,30 @@ typedef enum
 								 * replay; otherwise same as RBM_NORMAL */
 } ReadBufferMode;
 
+/* Possible values for buffer_replacement_policy */
+typedef enum BufferReplacementPolicy
+{
+	BUFFER_REPLACEMENT_CLOCK,	/* plain clock sweep */
+	BUFFER_REPLACEMENT_2Q		/* new pages start on a probation queue */
+} BufferReplacementPolicy;
+
+/* Counters reported by pg_stat_get_buffer_replacement() */
+typedef struct BufferReplacementStats
+{
+	uint64		free_victims;	/* buffers taken from the freelist */
+	uint64		clock_victims;	/* buffers found by the clock sweep */
+	uint64		clock_ticks;	/* buffers visited by the clock sweep */
+	uint64		probation_victims;	/* buffers taken from probation */
+	uint64		probation_promotions;	/* probationary buffers used again */
+	uint64		ghost_hits;		/* recently evicted pages read back in */
+} BufferReplacementStats;
+
 /* forward declared, to avoid having to expose buf_internals.h here */
 struct WritebackContext;
 
+/* forward declared, to avoid including smgr.h here */
+struct SMgrRelationData;
+
 /* in globals.c ... this duplicates miscadmin.h */
 extern PGDLLIMPORT int NBuffers;
 
@@ -64,9 +85,14 @@ extern int	checkpoint_flush_after;
 extern int	backend_flush_after;
 extern int	bgwriter_flush_after;
 
+extern int	io_combine_limit;
+
 /* in buf_init.c */
 extern PGDLLIMPORT char *BufferBlocks;
 
+/* in freelist.c */
+extern int	buffer_replacement_policy;
+
 /* in guc.c */
 extern int	effective_io_concurrency;
 
@@ -78,6 +104,10 @@ extern PGDLLIMPORT int32 *LocalRefCount;
 /* upper limit for effective_io_concurrency */
 #define MAX_IO_CONCURRENCY 1000
 
+/* upper limit and default for io_combine_limit */
+#define MAX_IO_COMBINE_LIMIT 32
+#define DEFAULT_IO_COMBINE_LIMIT 16
+
 /* special block number for ReadBuffer() */
 #define P_NEW	InvalidBlockNumber	/* grow the file to get a new page */
 
@@ -163,6 +193,8 @@ extern PGDLLIMPORT int32 *LocalRefCount;
  * prototypes for functions in bufmgr.c
  */
 extern bool ComputeIoConcurrency(int io_concurrency, double *target);
+extern bool PrefetchSharedBuffer(struct SMgrRelationData *smgr_reln,
+					 ForkNumber forkNum, BlockNumber blockNum);
 extern void PrefetchBuffer(Relation reln, ForkNumber forkNum,
 			   BlockNumber blockNum);
 extern Buffer ReadBuffer(Relation reln, BlockNumber blockNum);
@@ -172,6 +204,10 @@ extern Buffer ReadBufferExtended(Relation reln, ForkNumber forkNum,
 extern Buffer ReadBufferWithoutRelcache(RelFileNode rnode,
 						  ForkNumber forkNum, BlockNumber blockNum,
 						  ReadBufferMode mode, BufferAccessStrategy strategy);
+extern int	GetAdditionalPinLimit(void);
+extern void ReadBufferRange(Relation reln, ForkNumber forkNum,
+				BlockNumber blockNum, int nblocks,
+				BufferAccessStrategy strategy, Buffer *buffers);
 extern void ReleaseBuffer(Buffer buffer);
 extern void UnlockReleaseBuffer(Buffer buffer);
 extern void MarkBufferDirty(Buffer buffer);
@@ -191,9 +227,10 @@ extern BlockNumber RelationGetNumberOfBlocksInFork(Relation relation,
 extern void FlushOneBuffer(Buffer buffer);
 extern void FlushRelationBuffers(Relation rel);
 extern void FlushDatabaseBuffers(Oid dbid);
-extern void DropRelFileNodeBuffers(RelFileNodeBackend rnode,
+extern void DropRelFileNodeBuffers(struct SMgrRelationData *smgr_reln,
 					   ForkNumber forkNum, BlockNumber firstDelBlock);
-extern void DropRelFileNodesAllBuffers(RelFileNodeBackend *rnodes, int nnodes);
+extern void DropRelFileNodesAllBuffers(struct SMgrRelationData **smgr_reln,
+						   int nnodes);
 extern void DropDatabaseBuffers(Oid dbid);
 
 #define RelationGetNumberOfBlocks(reln) \
@@ -231,6 +268,8 @@ extern void TestForOldSnapshot_impl(Snapshot snapshot, Relation relation);
 /* in freelist.c */
 extern BufferAccessStrategy GetAccessStrategy(BufferAccessStrategyType btype);
 extern void FreeAccessStrategy(BufferAccessStrategy strategy);
+extern int	GetAccessStrategyBufferCount(BufferAccessStrategy strategy);
+extern void StrategyGetReplacementStats(BufferReplacementStats *stats);
 
 
 /* inline functions */
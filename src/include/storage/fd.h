@@ -50,10 +50,23 @@ typedef char *FileName;
 
 typedef int File;
 
+/*
+ * Maximum number of buffers FileReadV and FileWriteV can transfer at once.
+ * POSIX only guarantees that readv() and writev() accept 16, but every
+ * platform we support allows far more.
+ */
+#define MAX_FILE_IOV_BUFFERS	32
+
 
 /* GUC parameter */
 extern int	max_files_per_process;
 
+/* Values for io_direct_flags, set by the io_direct GUC */
+#define IO_DIRECT_DATA			0x01
+#define IO_DIRECT_WAL			0x02
+
+extern int	io_direct_flags;
+
 /*
  * This is private to fd.c, but exported for save/restore_backend_variables()
  */
@@ -70,7 +83,11 @@ extern File OpenTemporaryFile(bool interXact);
 extern void FileClose(File file);
 extern int	FilePrefetch(File file, off_t offset, int amount, uint32 wait_event_info);
 extern int	FileRead(File file, char *buffer, int amount, uint32 wait_event_info);
+extern int	FileReadV(File file, char **buffers, int nbuffers, int amount,
+		  uint32 wait_event_info);
 extern int	FileWrite(File file, char *buffer, int amount, uint32 wait_event_info);
+extern int	FileWriteV(File file, char **buffers, int nbuffers, int amount,
+		   uint32 wait_event_info);
 extern int	FileSync(File file, uint32 wait_event_info);
 extern off_t FileSeek(File file, off_t offset, int whence);
 extern int	FileTruncate(File file, off_t offset, uint32 wait_event_info);
@@ -109,6 +109,14 @@ extern PGDLLIMPORT int NamedLWLockTrancheRequests;
  * having this file include lock.h or bufmgr.h would be backwards.
  */
 
+/*
+ * Maximum number of LWLocks a backend can hold at once.  Normally, only a few
+ * will be held at once, but occasionally the number can be much higher; for
+ * example, the pg_buffercache extension locks all buffer partitions
+ * simultaneously, and a checkpoint holds all the WAL insertion locks.
+ */
+#define MAX_SIMUL_LWLOCKS	200
+
 /* Number of partitions of the shared buffer mapping hashtable */
 #define NUM_BUFFER_PARTITIONS  128
 
@@ -213,6 +221,7 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_PREDICATE_LOCK_MANAGER,
 	LWTRANCHE_PARALLEL_QUERY_DSA,
 	LWTRANCHE_TBM,
+	LWTRANCHE_PARALLEL_APPEND,
 	LWTRANCHE_FIRST_USER_DEFINED
 }			BuiltinTrancheIds;
 
@@ -93,6 +93,13 @@ typedef struct SnapshotData
 	bool		takenDuringRecovery;	/* recovery-shaped snapshot? */
 	bool		copied;			/* false if it's a static snapshot */
 
+	/*
+	 * ShmemVariableCache->xactCompletionCount when the snapshot was built by
+	 * GetSnapshotData, or 0.  While they're equal, no transaction has ended
+	 * since, and GetSnapshotData can return the snapshot unchanged.
+	 */
+	uint64		snapXactCompletionCount;
+
 	CommandId	curcid;			/* in my xact, CID < curcid are visible */
 
 	/*
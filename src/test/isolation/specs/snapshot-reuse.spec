@@ -0,0 +1,45 @@
+# Test that a snapshot taken after another transaction ends sees that
+# transaction's effects.  While no transaction has ended, GetSnapshotData
+# may hand out the backend's previous snapshot again, so each permutation
+# takes a snapshot first, lets the writer end a transaction, and then
+# takes another one.
+
+setup {
+    create table reuse_tab (id int);
+}
+
+teardown {
+    drop table reuse_tab;
+}
+
+session "reader"
+step "r_count" { select count(*) from reuse_tab; }
+step "r_begin_rr" { begin isolation level repeatable read; }
+step "r_commit" { commit; }
+
+session "writer"
+step "w_begin" { begin; }
+step "w_insert" { insert into reuse_tab values (1); }
+step "w_savepoint" { savepoint s; }
+step "w_insert_sub" { insert into reuse_tab values (2); }
+step "w_rollback_sub" { rollback to savepoint s; }
+step "w_commit" { commit; }
+step "w_abort" { abort; }
+step "w_autocommit" { insert into reuse_tab values (3); }
+
+# A transaction running at the first snapshot, and committed before the
+# second one
+permutation "r_count" "w_begin" "w_insert" "r_count" "w_commit" "r_count"
+
+# A transaction started and committed between two snapshots
+permutation "r_count" "w_autocommit" "r_count"
+
+# An aborted transaction's rows stay invisible
+permutation "w_begin" "w_insert" "r_count" "w_abort" "r_count" "w_autocommit" "r_count"
+
+# A subtransaction that aborted before its parent commits
+permutation "w_begin" "w_insert" "w_savepoint" "w_insert_sub" "r_count" "w_rollback_sub" "r_count" "w_commit" "r_count"
+
+# A repeatable read transaction that starts after a commit sees it, and
+# keeps its snapshot after later commits
+permutation "r_count" "w_autocommit" "r_begin_rr" "r_count" "w_autocommit" "r_count" "r_commit" "r_count"
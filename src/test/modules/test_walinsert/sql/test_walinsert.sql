@@ -0,0 +1,8 @@
+CREATE EXTENSION test_walinsert;
+
+SELECT test_wal_insert(1000, 100) >= 0 AS ok;
+SELECT test_wal_insert(10, 0) >= 0 AS ok;
+
+-- errors
+SELECT test_wal_insert(-1, 100);
+SELECT test_wal_insert(10, -1);
@@ -0,0 +1,9 @@
+/* src/test/modules/test_walinsert/test_walinsert--1.0.sql */
+
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION test_walinsert" to load this file. \quit
+
+CREATE FUNCTION test_wal_insert(count pg_catalog.int8,
+                                size pg_catalog.int4 DEFAULT 100)
+   RETURNS pg_catalog.int8
+       AS 'MODULE_PATHNAME' LANGUAGE C STRICT;
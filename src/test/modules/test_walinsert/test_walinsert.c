@@ -0,0 +1,85 @@
+/*--------------------------------------------------------------------------
+ *
+ * test_walinsert.c
+ *		Benchmark for concurrent WAL insertion.
+ *
+ * test_wal_insert() writes a number of no-op WAL records of a given size
+ * as fast as it can, and returns the time that took.  Running it in many
+ * sessions at once stresses WAL insertion without the overhead of
+ * modifying any tables, to measure the effect of wal_insert_locks.
+ *
+ * Copyright (c) 2017, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *		src/test/modules/test_walinsert/test_walinsert.c
+ *
+ * -------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include "access/xloginsert.h"
+#include "catalog/pg_control.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "portability/instr_time.h"
+
+PG_MODULE_MAGIC;
+
+/* Largest record payload we allow */
+#define MAX_RECORD_SIZE		(1024 * 1024)
+
+PG_FUNCTION_INFO_V1(test_wal_insert);
+
+/*
+ * test_wal_insert(count int8, size int4) returns int8
+ *
+ * Insert "count" XLOG_NOOP records carrying "size" bytes of payload each,
+ * and return the elapsed time in microseconds.  The records are replayed as
+ * no-ops, so this is harmless even on a server with standbys.
+ */
+Datum
+test_wal_insert(PG_FUNCTION_ARGS)
+{
+	int64		count = PG_GETARG_INT64(0);
+	int32		size = PG_GETARG_INT32(1);
+	char	   *payload;
+	instr_time	start_time;
+	instr_time	elapsed;
+	int64		i;
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to use test_wal_insert")));
+
+	if (count < 0)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("number of records must not be negative")));
+	if (size < 0 || size > MAX_RECORD_SIZE)
+		ereport(ERROR,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("record size must be between 0 and %d",
+						MAX_RECORD_SIZE)));
+
+	payload = palloc0(Max(size, 1));
+
+	INSTR_TIME_SET_CURRENT(start_time);
+
+	for (i = 0; i < count; i++)
+	{
+		CHECK_FOR_INTERRUPTS();
+
+		XLogBeginInsert();
+		if (size > 0)
+			XLogRegisterData(payload, size);
+		(void) XLogInsert(RM_XLOG_ID, XLOG_NOOP);
+	}
+
+	INSTR_TIME_SET_CURRENT(elapsed);
+	INSTR_TIME_SUBTRACT(elapsed, start_time);
+
+	pfree(payload);
+
+	PG_RETURN_INT64((int64) INSTR_TIME_GET_MICROSEC(elapsed));
+}
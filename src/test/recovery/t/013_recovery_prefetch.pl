@@ -0,0 +1,59 @@
+# Test replay with recovery_prefetch_distance, on a standby and in crash
+# recovery, including records that drop and truncate relations while the
+# prefetcher is reading ahead.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 2;
+
+# Use few buffers and no full-page writes, so that replay has to read most
+# of the blocks it modifies.
+my $node_master = get_new_node('master');
+$node_master->init(allows_streaming => 1);
+$node_master->append_conf(
+	'postgresql.conf', qq{
+shared_buffers = 1MB
+full_page_writes = off
+recovery_prefetch_distance = 1MB
+});
+$node_master->start;
+
+my $backup_name = 'my_backup';
+$node_master->backup($backup_name);
+
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_master, $backup_name,
+	has_streaming => 1);
+$node_standby->start;
+
+$node_master->safe_psql(
+	'postgres', qq{
+CREATE TABLE prefetch_tab (id int PRIMARY KEY, v text);
+INSERT INTO prefetch_tab SELECT g, md5(g::text) FROM generate_series(1, 20000) g;
+CHECKPOINT;
+UPDATE prefetch_tab SET v = md5(v) WHERE id % 7 = 0;
+CREATE TABLE prefetch_tmp AS SELECT * FROM prefetch_tab;
+UPDATE prefetch_tmp SET v = 'x' WHERE id % 3 = 0;
+TRUNCATE prefetch_tmp;
+INSERT INTO prefetch_tmp SELECT * FROM prefetch_tab WHERE id < 100;
+DROP TABLE prefetch_tmp;
+DELETE FROM prefetch_tab WHERE id > 15000;
+VACUUM prefetch_tab;
+UPDATE prefetch_tab SET v = md5(v) WHERE id % 11 = 0;
+});
+
+my $check_query =
+  "SELECT count(*), sum(id), md5(string_agg(v, ',' ORDER BY id)) FROM prefetch_tab";
+my $expected = $node_master->safe_psql('postgres', $check_query);
+
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+is($node_standby->safe_psql('postgres', $check_query),
+	$expected, 'standby replayed correctly with prefetching');
+
+# Crash the master, and make it replay everything since the checkpoint.
+$node_master->stop('immediate');
+$node_master->start;
+is($node_master->safe_psql('postgres', $check_query),
+	$expected, 'crash recovery replayed correctly with prefetching');
@@ -0,0 +1,99 @@
+# Test that truncating or dropping a relation leaves no buffers behind for
+# the blocks that are gone, in normal running and in replay on a standby.
+# Small relations have their buffers looked up block by block, large ones
+# need a scan of all of shared_buffers.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 6;
+
+# With 2048 buffers, relations of fewer than 64 blocks are small.
+my $node_master = get_new_node('master');
+$node_master->init(allows_streaming => 1);
+$node_master->append_conf(
+	'postgresql.conf', qq{
+shared_buffers = 16MB
+autovacuum = off
+});
+$node_master->start;
+
+my $backup_name = 'my_backup';
+$node_master->backup($backup_name);
+
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_master, $backup_name,
+	has_streaming => 1);
+$node_standby->start;
+
+$node_master->safe_psql(
+	'postgres', qq{
+CREATE EXTENSION pg_buffercache;
+CREATE TABLE small_tab (id int, v text);
+INSERT INTO small_tab SELECT g, repeat('x', 100) FROM generate_series(1, 2000) g;
+CREATE TABLE large_tab (id int, v text);
+INSERT INTO large_tab SELECT g, repeat('x', 100) FROM generate_series(1, 20000) g;
+});
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+
+my $small = $node_master->safe_psql('postgres',
+	"SELECT pg_relation_filenode('small_tab')");
+my $large = $node_master->safe_psql('postgres',
+	"SELECT pg_relation_filenode('large_tab')");
+
+# Replay leaves the blocks in dirty buffers on the standby, as long as there
+# is no restartpoint.
+is( $node_standby->safe_psql(
+		'postgres', qq{
+SELECT count(DISTINCT relfilenode) FROM pg_buffercache
+WHERE relfilenode IN ($small, $large) AND isdirty}),
+	'2',
+	'standby has dirty buffers for both relations');
+
+# Truncate both relations with VACUUM, and check that no buffers are left
+# past the new end.
+$node_master->safe_psql(
+	'postgres', qq{
+DELETE FROM small_tab WHERE id > 100;
+DELETE FROM large_tab WHERE id > 100;
+VACUUM small_tab;
+VACUUM large_tab;
+});
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+
+my $truncated_query = qq{
+SELECT count(*) FROM pg_buffercache b JOIN pg_class c
+  ON b.relfilenode = pg_relation_filenode(c.oid)
+WHERE c.relname IN ('small_tab', 'large_tab') AND b.relforknumber = 0
+  AND b.relblocknumber >=
+	pg_relation_size(c.oid) / current_setting('block_size')::int};
+is($node_master->safe_psql('postgres', $truncated_query),
+	'0', 'no buffers past the end of truncated relations on master');
+is($node_standby->safe_psql('postgres', $truncated_query),
+	'0', 'no buffers past the end of truncated relations on standby');
+
+# Make the remaining blocks dirty again, then drop both relations.
+$node_master->safe_psql(
+	'postgres', qq{
+UPDATE small_tab SET v = 'y';
+UPDATE large_tab SET v = 'y';
+DROP TABLE small_tab, large_tab;
+});
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+
+my $dropped_query = qq{
+SELECT count(*) FROM pg_buffercache WHERE relfilenode IN ($small, $large)};
+is($node_master->safe_psql('postgres', $dropped_query),
+	'0', 'no buffers for dropped relations on master');
+is($node_standby->safe_psql('postgres', $dropped_query),
+	'0', 'no buffers for dropped relations on standby');
+
+# Same again in crash recovery, which replays everything since the last
+# checkpoint, including the drop.
+$node_master->stop('immediate');
+$node_master->start;
+is($node_master->safe_psql('postgres', $dropped_query),
+	'0', 'no buffers for dropped relations after crash recovery');
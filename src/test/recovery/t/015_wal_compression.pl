@@ -0,0 +1,81 @@
+# Test replay of full-page images compressed by wal_compression, on a
+# standby and in crash recovery, and that the compression methods the
+# server was built without are rejected.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 5;
+
+my $node_master = get_new_node('master');
+$node_master->init(allows_streaming => 1);
+$node_master->append_conf(
+	'postgresql.conf', qq{
+wal_compression = pglz
+full_page_writes = on
+autovacuum = off
+});
+$node_master->start;
+
+my $backup_name = 'my_backup';
+$node_master->backup($backup_name);
+
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_master, $backup_name,
+	has_streaming => 1);
+$node_standby->start;
+
+$node_master->safe_psql(
+	'postgres', qq{
+CREATE TABLE fpi_tab (id int, v text);
+INSERT INTO fpi_tab SELECT g, md5(g::text) FROM generate_series(1, 10000) g;
+CHECKPOINT;
+});
+
+# The first change to each page after the checkpoint logs a full-page image
+my $start_lsn = $node_master->lsn('insert');
+$node_master->safe_psql('postgres', "UPDATE fpi_tab SET v = md5(v)");
+my $end_lsn = $node_master->lsn('insert');
+
+command_like(
+	[   'pg_waldump', '-b', '-p', $node_master->data_dir . '/pg_wal',
+		'-s', $start_lsn, '-e', $end_lsn ],
+	qr/\(FPW\);.*method: pglz/,
+	'WAL contains full-page images compressed with pglz');
+
+my $check_query =
+  "SELECT count(*), md5(string_agg(v, ',' ORDER BY id)) FROM fpi_tab";
+my $expected = $node_master->safe_psql('postgres', $check_query);
+
+$node_master->wait_for_catchup($node_standby, 'replay', $end_lsn);
+is($node_standby->safe_psql('postgres', $check_query),
+	$expected, 'standby replayed compressed full-page images');
+
+# Crash the master, and make it replay everything since the checkpoint.
+$node_master->stop('immediate');
+$node_master->start;
+is($node_master->safe_psql('postgres', $check_query),
+	$expected, 'crash recovery replayed compressed full-page images');
+
+# lz4 and zstd are only accepted if the server was built with them.
+my $configure = `pg_config --configure`;
+foreach my $method ('lz4', 'zstd')
+{
+	my ($stdout, $stderr);
+	my $ret = $node_master->psql(
+		'postgres', "SET wal_compression = $method",
+		stdout => \$stdout,
+		stderr => \$stderr);
+
+	if ($configure =~ /--with-$method/)
+	{
+		is($ret, 0, "wal_compression = $method is accepted");
+	}
+	else
+	{
+		like(
+			$stderr,
+			qr/invalid value for parameter "wal_compression": "$method"/,
+			"wal_compression = $method is rejected without --with-$method");
+	}
+}
@@ -0,0 +1,48 @@
+# Run pgbench with io_direct = 'data, wal', then crash the server and check
+# that recovery, which also uses direct I/O, brings back consistent data.
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More;
+
+# Use few buffers, so that most blocks are read and written with direct I/O.
+my $node = get_new_node('main');
+$node->init;
+$node->append_conf('postgresql.conf', "shared_buffers = 1MB\n");
+$node->start;
+
+my $stderr;
+$node->psql(
+	'postgres', "ALTER SYSTEM SET io_direct = 'data, wal'",
+	stderr => \$stderr);
+if ($stderr =~ /Direct I\/O is not supported/)
+{
+	plan skip_all => 'direct I/O is not supported on this platform';
+}
+plan tests => 5;
+
+$node->restart;
+is($node->safe_psql('postgres', 'SHOW io_direct'),
+	'data, wal', 'direct I/O is enabled');
+
+$node->command_ok([qw(pgbench --initialize --scale=1)],
+	'pgbench initialization');
+$node->command_like(
+	[qw(pgbench --no-vacuum --client=4 --transactions=200)],
+	qr{processed: 800/800},
+	'pgbench run');
+
+my $check_query = qq{
+SELECT (SELECT sum(abalance) FROM pgbench_accounts) =
+		(SELECT sum(delta) FROM pgbench_history)
+	AND (SELECT sum(bbalance) FROM pgbench_branches) =
+		(SELECT sum(delta) FROM pgbench_history)
+	AND (SELECT count(*) FROM pgbench_history) = 800};
+is($node->safe_psql('postgres', $check_query),
+	't', 'balances match the history');
+
+$node->stop('immediate');
+$node->start;
+is($node->safe_psql('postgres', $check_query),
+	't', 'balances match the history after crash recovery');
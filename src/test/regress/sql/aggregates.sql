@@ -824,3 +824,48 @@ create aggregate my_half_sum(int4)
 select my_sum(one),my_half_sum(one) from (values(1),(2),(3),(4)) t(one);
 
 rollback;
+
+-- Hash aggregation that exceeds work_mem must spill to disk and still
+-- produce every group exactly once.  The number of batches and the disk
+-- usage depend on the platform, so hide them.
+create function explain_hashagg_spill(text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, timing off, summary off) %s',
+            $1)
+    loop
+        ln := regexp_replace(ln, 'Batches: \d+', 'Batches: N');
+        ln := regexp_replace(ln, 'Disk Usage: \d+', 'Disk Usage: N');
+        return next ln;
+    end loop;
+end;
+$$;
+begin;
+set local work_mem = '64kB';
+set local enable_sort = off;
+select explain_hashagg_spill('
+select sum(c), count(*) from
+  (select g % 10000 as k, count(*) as c from generate_series(1, 50000) g
+   group by 1) s');
+select sum(c), count(*) from
+  (select g % 10000 as k, count(*) as c from generate_series(1, 50000) g
+   group by 1) s;
+rollback;
+drop function explain_hashagg_spill(text);
+
+-- Batch-at-a-time execution of simple aggregates over a seqscan
+create temp table batch_agg_t as
+  select case when g % 100 = 0 then null else g end as a,
+         (g * 2)::int8 as b, g / 4.0::float8 as c
+  from generate_series(1, 10000) g;
+set executor_batch_size = 1000;
+select count(*), count(a), sum(a), min(a), max(a), min(b), max(b),
+       sum(c), min(c), max(c)
+  from batch_agg_t where a > 10 and b <= 15000::int8 and a % 7 <> 0;
+select count(*), count(a), sum(a), min(a), max(a), sum(c) from batch_agg_t;
+reset executor_batch_size;
+drop table batch_agg_t;
@@ -288,3 +288,19 @@ set default_text_search_config = no_such_config;
 select func_with_bad_set();
 
 reset check_function_bodies;
+
+-- commit_delay = -1 lets the WAL flush leader choose its own delay; commits
+-- must still succeed and be visible
+set commit_delay = -1;
+set commit_siblings = 0;
+show commit_delay;
+create table commit_delay_tab (a int);
+insert into commit_delay_tab select generate_series(1, 10);
+begin;
+insert into commit_delay_tab values (11);
+commit;
+select count(*) from commit_delay_tab;
+drop table commit_delay_tab;
+set commit_delay = -2;
+reset commit_delay;
+reset commit_siblings;
@@ -0,0 +1,30 @@
+--
+-- INCREMENTAL SORT
+--
+
+-- An index on the leading sort key lets us sort one group at a time,
+-- without reading the whole input before returning the first rows
+explain (costs off)
+select hundred, unique1 from tenk1 order by hundred, unique1 limit 5;
+select hundred, unique1 from tenk1 order by hundred, unique1 limit 5;
+
+-- Small groups are combined into batches; make sure we get the rows
+-- around a batch boundary right
+create temp table incsort (a int, b int);
+insert into incsort select i / 10, 1000 - i from generate_series(1, 100) i;
+create index incsort_a_idx on incsort (a);
+analyze incsort;
+
+set enable_sort = off;
+explain (costs off)
+select a, b from incsort order by a, b offset 28 limit 8;
+select a, b from incsort order by a, b offset 28 limit 8;
+select count(*), sum(b) from (select a, b from incsort order by a, b) s;
+
+set enable_incrementalsort = off;
+explain (costs off)
+select a, b from incsort order by a, b offset 28 limit 8;
+reset enable_incrementalsort;
+reset enable_sort;
+
+drop table incsort;
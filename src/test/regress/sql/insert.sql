@@ -412,3 +412,32 @@ alter table returningwrtest2 drop c;
 alter table returningwrtest attach partition returningwrtest2 for values in (2);
 insert into returningwrtest values (2, 'foo') returning returningwrtest;
 drop table returningwrtest;
+
+-- check tuple routing through a list partitioned table with enough values to
+-- look them up in a hash table, and through range partitions in both sorted
+-- and unsorted order
+create table listhashp (a int, b text) partition by list (a);
+create table listhashp_even partition of listhashp for values in (0, 2, 4,
+    6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30, 32, 34, 36, 38, 40, 42,
+    44, 46, 48, 50, 52, 54, 56, 58, 60, 62, 64, 66, 68, 70, 72, 74, 76, 78, 80,
+    82, 84, 86, 88, 90, 92, 94, 96, 98);
+create table listhashp_odd partition of listhashp for values in (1, 3, 5, 7,
+    9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31, 33, 35, 37, 39, 41, 43, 45,
+    47, 49, 51, 53, 55, 57, 59, 61, 63, 65, 67, 69, 71, 73, 75, 77, 79, 81, 83,
+    85, 87, 89, 91, 93, 95, 97, 99);
+insert into listhashp select i, 'x' from generate_series(0, 99) i;
+insert into listhashp values (42, 'y'), (42, 'z'), (7, 'y');
+select tableoid::regclass, count(*), min(a), max(a) from listhashp group by 1 order by 1;
+insert into listhashp values (100, 'x');
+drop table listhashp;
+
+create table sortedrangep (a int) partition by range (a);
+create table sortedrangep1 partition of sortedrangep for values from (0) to (10);
+create table sortedrangep2 partition of sortedrangep for values from (10) to (20);
+create table sortedrangep3 partition of sortedrangep for values from (20) to (30);
+create table sortedrangep4 partition of sortedrangep for values from (40) to (50);
+insert into sortedrangep select generate_series(0, 29);
+insert into sortedrangep values (45), (5), (25), (15), (49), (40);
+select tableoid::regclass, count(*), min(a), max(a) from sortedrangep group by 1 order by 1;
+insert into sortedrangep values (25), (30);
+drop table sortedrangep;
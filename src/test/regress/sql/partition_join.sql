@@ -0,0 +1,61 @@
+--
+-- PARTITION_JOIN
+-- Test partition-wise join and aggregation between partitioned tables
+--
+set enable_partitionwise_join = on;
+set enable_partitionwise_aggregate = on;
+
+create table pj_bill (tenant int, amount int) partition by list (tenant);
+create table pj_bill_p1 partition of pj_bill for values in (1, 2);
+create table pj_bill_p2 partition of pj_bill for values in (3, 4);
+create table pj_bill_p3 partition of pj_bill for values in (5, 6);
+insert into pj_bill select i % 6 + 1, i from generate_series(1, 60) i;
+
+create table pj_usage (tenant int, units int) partition by list (tenant);
+create table pj_usage_p1 partition of pj_usage for values in (1, 2);
+create table pj_usage_p2 partition of pj_usage for values in (3, 4);
+create table pj_usage_p3 partition of pj_usage for values in (5, 6);
+insert into pj_usage select i % 6 + 1, i * 10 from generate_series(1, 30) i;
+
+-- Partitioned on the same key, with different bounds
+create table pj_other (tenant int, note text) partition by list (tenant);
+create table pj_other_p1 partition of pj_other for values in (1, 2, 3);
+create table pj_other_p2 partition of pj_other for values in (4, 5, 6);
+insert into pj_other select i, 'tenant ' || i from generate_series(1, 6) i;
+
+analyze pj_bill;
+analyze pj_usage;
+analyze pj_other;
+
+-- Join on the partition key, then group by it
+select b.tenant, count(*), sum(b.amount), sum(u.units)
+  from pj_bill b join pj_usage u on b.tenant = u.tenant
+  group by b.tenant order by b.tenant;
+
+-- Some partitions excluded
+select b.tenant, count(*), sum(b.amount)
+  from pj_bill b join pj_usage u on b.tenant = u.tenant
+  where b.tenant > 3
+  group by b.tenant order by b.tenant;
+
+-- Join clause that doesn't cover the partition key
+select count(*) from pj_bill b join pj_usage u on b.amount = u.units;
+
+-- Tables with different partition bounds
+select o.note, sum(b.amount)
+  from pj_bill b join pj_other o on b.tenant = o.tenant
+  group by o.note order by o.note;
+
+-- Aggregation of a single partitioned table
+select tenant, sum(amount) from pj_bill
+  group by tenant having sum(amount) > 300 order by tenant;
+
+-- Grouping that doesn't include the partition key
+select amount % 2 as odd, count(*) from pj_bill group by 1 order by 1;
+
+reset enable_partitionwise_aggregate;
+reset enable_partitionwise_join;
+
+drop table pj_bill;
+drop table pj_usage;
+drop table pj_other;
@@ -0,0 +1,44 @@
+--
+-- Run-time partition pruning
+--
+
+create table rp (a int, b text) partition by list (a);
+create table rp1 partition of rp for values in (1);
+create table rp2 partition of rp for values in (2);
+create table rp3 partition of rp for values in (3);
+insert into rp values (1, 'one'), (2, 'two'), (3, 'three');
+
+-- A stable function can't be used by constraint exclusion, but it can be
+-- evaluated when the Append is started
+set prune.val = '2';
+explain (costs off)
+select * from rp where a = current_setting('prune.val')::int;
+explain (analyze, costs off, summary off, timing off)
+select * from rp where a = current_setting('prune.val')::int;
+select * from rp where a = current_setting('prune.val')::int;
+explain (costs off)
+select * from rp where a > current_setting('prune.val')::int;
+select * from rp where a > current_setting('prune.val')::int;
+reset prune.val;
+
+-- Values from an initplan are only known once the Append is executed; the
+-- pruned subplans are never executed
+explain (analyze, costs off, summary off, timing off)
+select * from rp where a = (select 3);
+select * from rp where a = (select 3);
+select * from rp where a = (select 4);
+
+-- The outer values of a nestloop change on each rescan
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+select * from (values (1), (3), (4)) v(x), rp where rp.a = v.x order by x;
+reset enable_mergejoin;
+reset enable_hashjoin;
+
+-- Each rescan of the Append scans only the partition matching the outer
+-- value, and none for the value that matches no partition
+explain (analyze, costs off, summary off, timing off)
+select * from (values (1), (3), (4)) v(x),
+  lateral (select * from rp where rp.a = v.x offset 0) s;
+
+drop table rp;
@@ -0,0 +1,33 @@
+--
+-- RESULT CACHE
+--
+
+-- Force nested loops, so that the parameterized inner side gets cached
+set enable_hashjoin = off;
+set enable_mergejoin = off;
+
+-- Only 20 distinct values of twenty, so most lookups should be hits
+explain (costs off)
+select count(*), avg(t1.unique1) from tenk1 t1
+inner join tenk1 t2 on t1.unique1 = t2.twenty
+where t2.unique1 < 1000;
+select count(*), avg(t1.unique1) from tenk1 t1
+inner join tenk1 t2 on t1.unique1 = t2.twenty
+where t2.unique1 < 1000;
+
+-- With a tiny cache, entries get evicted; the result must not change
+set work_mem = '64kB';
+select count(*), avg(t1.unique1) from tenk1 t1
+inner join tenk1 t2 on t1.unique1 = t2.thousand
+where t2.unique1 < 5000;
+
+-- And the same without the cache
+set enable_resultcache = off;
+select count(*), avg(t1.unique1) from tenk1 t1
+inner join tenk1 t2 on t1.unique1 = t2.thousand
+where t2.unique1 < 5000;
+
+reset enable_resultcache;
+reset work_mem;
+reset enable_mergejoin;
+reset enable_hashjoin;
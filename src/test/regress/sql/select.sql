@@ -254,3 +254,16 @@ drop function sillysrf(int);
 -- (see bug #5084)
 select * from (values (2),(null),(1)) v(k) where k = k order by k;
 select * from (values (2),(null),(1)) v(k) where k = k;
+
+-- Specialized deforming of leading fixed-width columns, with and without
+-- nulls in the tuple
+create temp table deform_t (a int2 not null, b int4 not null, c int8 not null,
+  d float8, e bool not null, f text, g int4);
+insert into deform_t values (1, 2, 3, null, true, 'x', 7),
+  (4, 5, 6, 1.5, false, null, 8), (7, 8, 9, 2.5, true, 'y', 10);
+set specialize_above_cost = 0;
+select * from deform_t order by a;
+select a, g from deform_t where b = 5;
+select a from deform_t where 5 < b;
+reset specialize_above_cost;
+drop table deform_t;
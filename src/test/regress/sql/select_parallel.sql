@@ -19,6 +19,16 @@ explain (costs off)
   select count(*) from a_star;
 select count(*) from a_star;
 
+-- Parallel Append mixing partial and non-partial subpaths; the non-partial
+-- ones are each run by a single worker
+alter table c_star set (parallel_workers = 0);
+alter table d_star set (parallel_workers = 0);
+explain (costs off)
+  select round(avg(aa)), sum(aa) from a_star;
+select round(avg(aa)), sum(aa) from a_star;
+alter table c_star reset (parallel_workers);
+alter table d_star reset (parallel_workers);
+
 -- test that parallel_restricted function doesn't run in worker
 alter table tenk1 set (parallel_workers = 4);
 explain (verbose, costs off)
@@ -110,6 +120,36 @@ select  count(*) from tenk1, tenk2 where tenk1.unique1 = tenk2.unique1;
 reset enable_hashjoin;
 reset enable_nestloop;
 
+-- test parallel hash join with a shared hash table.  Use tables of our own,
+-- so that the plans don't depend on what has happened to tenk1 and tenk2.
+set enable_mergejoin to off;
+set enable_nestloop to off;
+
+create table phj_outer as select g as id from generate_series(1, 20000) g;
+create table phj_inner as select g as id from generate_series(1, 10000) g;
+analyze phj_outer;
+analyze phj_inner;
+
+explain (costs off)
+	select  count(*) from phj_outer o join phj_inner i using (id);
+select  count(*) from phj_outer o join phj_inner i using (id);
+
+-- a shared hash table can't be split into batches, so it isn't used if the
+-- inner side doesn't fit in work_mem
+set work_mem = '64kB';
+explain (costs off)
+	select  count(*) from phj_outer o join phj_inner i using (id);
+select  count(*) from phj_outer o join phj_inner i using (id);
+reset work_mem;
+
+select  count(*) from tenk1 t1 join tenk2 t2 on t1.unique1 = t2.unique2
+	where t2.ten < 5;
+
+drop table phj_outer;
+drop table phj_inner;
+reset enable_mergejoin;
+reset enable_nestloop;
+
 -- test gather merge
 set enable_hashagg = false;
 
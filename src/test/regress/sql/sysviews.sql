@@ -15,6 +15,10 @@ select count(*) >= 0 as ok from pg_available_extensions;
 -- At introduction, pg_config had 23 entries; it may grow
 select count(*) > 20 as ok from pg_config;
 
+-- The server has surely needed some buffers by now
+select free_victims + clock_victims + probation_victims > 0 as ok
+  from pg_stat_get_buffer_replacement();
+
 -- We expect no cursors in this test; see also portals.sql
 select count(*) = 0 as ok from pg_cursors;
 
@@ -74,3 +74,40 @@ VACUUM (ANALYZE) vacparted;
 VACUUM (FULL) vacparted;
 VACUUM (FREEZE) vacparted;
 DROP TABLE vacparted;
+
+-- index vacuuming, with dead tuples spread over the pages in various ways
+CREATE TABLE vactid (i int) WITH (autovacuum_enabled = off);
+INSERT INTO vactid SELECT generate_series(1, 20000);
+CREATE INDEX vactid_i_idx ON vactid (i);
+DELETE FROM vactid WHERE i % 7 = 0 OR i BETWEEN 5000 AND 9000 OR i = 15002;
+VACUUM vactid;
+-- reuse the freed line pointers; no index entry may still point to them
+INSERT INTO vactid SELECT -i FROM generate_series(1, 7000) i;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM vactid WHERE i > 0;
+SELECT count(*) FROM vactid WHERE i BETWEEN 5000 AND 9000;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE vactid;
+
+-- parallel index vacuuming
+CREATE TABLE vacparallel (i int, j int) WITH (autovacuum_enabled = off);
+INSERT INTO vacparallel SELECT i, i FROM generate_series(1, 10000) i;
+CREATE INDEX vacparallel_i_idx ON vacparallel (i);
+CREATE INDEX vacparallel_j_idx ON vacparallel (j);
+CREATE INDEX vacparallel_ij_idx ON vacparallel (i, j);
+DELETE FROM vacparallel WHERE i % 3 = 0;
+SET min_parallel_index_scan_size = 0;
+SET max_parallel_maintenance_workers = 2;
+VACUUM vacparallel;
+RESET min_parallel_index_scan_size;
+RESET max_parallel_maintenance_workers;
+INSERT INTO vacparallel SELECT -i, -i FROM generate_series(1, 4000) i;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*) FROM vacparallel WHERE i > 0;
+SELECT count(*) FROM vacparallel WHERE j > 0;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE vacparallel;